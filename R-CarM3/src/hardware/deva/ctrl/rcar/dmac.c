@@ -20,6 +20,7 @@
  */
 
 #include <audio_driver.h>
+#include <stdio.h>
 #include <string.h>
 #include "dmac.h"
 #include "rcar_support.h"
@@ -379,6 +380,20 @@ extern int get_audioppdmafuncs(dma_functions_t *functable, int tabsize);
 
 static dma_functions_t  audiodmafuncs;
 static dma_functions_t  audiodmappfuncs;
+static char             audiodma_ver_opt[DMA_OPT_LEN];
+
+/* the descriptors of a memory transfer channel are reserved from the on-chip
+   descriptor memory when the channel is attached, so size them for the ring */
+static void audio_dmac_attach_opt(char* opt, size_t len, uint32_t desc_num, const char* ver_opt)
+{
+    if( desc_num < 2 ) {
+        desc_num = 2;
+    } else if( desc_num > AUDIO_DMAC_DESC_MAX ) {
+        desc_num = AUDIO_DMAC_DESC_MAX;
+    }
+
+    snprintf(opt, len, "dma=audio,desc=%u,%s", desc_num, ver_opt);
+}
 
 int audio_dmac_init(audio_dmac_context_t* tx_context, audio_dmac_context_t* rx_context)
 {
@@ -427,12 +442,11 @@ int audio_dmac_init(audio_dmac_context_t* tx_context, audio_dmac_context_t* rx_c
             ado_error( "%s: invalid rcar version", __func__);
             return EINVAL;
     }
-
-    strlcpy(attach_opt, "dma=audio,desc=2,", sizeof(attach_opt));
-    strlcat(attach_opt, ver_opt, sizeof(attach_opt));
+    strlcpy(audiodma_ver_opt, ver_opt, sizeof(audiodma_ver_opt));
 
     /* Playback DMA channel */
     if( tx_context ) {
+        audio_dmac_attach_opt(attach_opt, sizeof(attach_opt), tx_context->desc_num, ver_opt);
         tx_context->audiodma_chn =
             audiodmafuncs.channel_attach(attach_opt, NULL, NULL, 0, DMA_ATTACH_ANY_CHANNEL | DMA_ATTACH_EVENT_PER_SEGMENT);
 
@@ -448,6 +462,7 @@ int audio_dmac_init(audio_dmac_context_t* tx_context, audio_dmac_context_t* rx_c
     }
     /* Capture DMA channel */
     if( rx_context ) {
+        audio_dmac_attach_opt(attach_opt, sizeof(attach_opt), rx_context->desc_num, ver_opt);
         rx_context->audiodma_chn =
             audiodmafuncs.channel_attach(attach_opt, NULL, NULL, 0, DMA_ATTACH_ANY_CHANNEL | DMA_ATTACH_EVENT_PER_SEGMENT);
         if ( !rx_context->audiodma_chn )
@@ -549,6 +564,42 @@ void audio_dmac_deinit(audio_dmac_context_t* tx_context, audio_dmac_context_t* r
     audio_dmac_init_cleanup( tx_context, rx_context );
 }
 
+/* attach a memory transfer channel only, for a further playback stream that shares
+   the peripheral-peripheral transfer of the first one; audio_dmac_init goes first */
+int audio_dmac_mp_init(audio_dmac_context_t* context)
+{
+    char attach_opt[DMA_OPT_LEN];
+    dma_channel_query_t chinfo;
+
+    if( !context || !audiodma_ver_opt[0] ) {
+        return EINVAL;
+    }
+
+    audio_dmac_attach_opt(attach_opt, sizeof(attach_opt), context->desc_num, audiodma_ver_opt);
+    context->audiodma_chn =
+        audiodmafuncs.channel_attach(attach_opt, NULL, NULL, 0, DMA_ATTACH_ANY_CHANNEL | DMA_ATTACH_EVENT_PER_SEGMENT);
+
+    if( !context->audiodma_chn ) {
+        ado_error( "%s: unable to attach to audio DMA playback channel", __func__ );
+        return EAGAIN;
+    }
+
+    audiodmafuncs.query_channel( context->audiodma_chn, &chinfo );
+    context->audiodma_irq = chinfo.irq;
+    context->audiodma_pp_chn = NULL;
+
+    return EOK;
+}
+
+void audio_dmac_mp_deinit(audio_dmac_context_t* context)
+{
+    if( context && context->audiodma_chn ) {
+        audio_dmac_stop( context->audiodma_chn );
+        audiodmafuncs.channel_release( context->audiodma_chn );
+        context->audiodma_chn = NULL;
+    }
+}
+
 int audio_dmac_count_register_get(void *audiodma_chn, uint32_t* tc_val)
 {
     if( !audiodma_chn ) {
@@ -560,13 +611,18 @@ int audio_dmac_count_register_get(void *audiodma_chn, uint32_t* tc_val)
     return EOK;
 }
 
-int audio_dmac_mp_setup(void *audiodma_chn, audio_peripheral_t dst,  off64_t mem_addr, int len)
+/*
+ * The PCM buffer is split into desc_num equally sized descriptors that the DMAC
+ * repeats as a ring; each descriptor raises one interrupt on completion.
+ */
+int audio_dmac_mp_setup(void *audiodma_chn, audio_peripheral_t dst,  off64_t mem_addr, int len, int desc_num)
 {
     dma_transfer_t  tinfo;
-    dma_addr_t      saddr[2], daddr[2];
+    dma_addr_t      saddr[AUDIO_DMAC_DESC_MAX], daddr;
     audio_dmac_config_t audio_dmac_config;
+    int             i;
 
-    if (!audiodma_chn) {
+    if (!audiodma_chn || desc_num < 1 || desc_num > AUDIO_DMAC_DESC_MAX || len % (desc_num * 4) ) {
         return EINVAL;
     }
 
@@ -580,33 +636,36 @@ int audio_dmac_mp_setup(void *audiodma_chn, audio_peripheral_t dst,  off64_t mem
     tinfo.xfer_unit_size = 4;
     tinfo.xfer_bytes     = len;
     tinfo.src_flags      = DMA_ADDR_FLAG_SEGMENTED;
-    tinfo.src_fragments  = 2;
+    tinfo.src_fragments  = desc_num;
     tinfo.dst_flags      = DMA_ADDR_FLAG_NO_INCREMENT | DMA_ADDR_FLAG_DEVICE;
 
-    saddr[0].paddr       = mem_addr;
-    saddr[1].paddr       = mem_addr + len / 2;
-    saddr[0].len         = len / 2;
-    saddr[1].len         = len / 2;
+    for( i = 0; i < desc_num; i++ ) {
+        saddr[i].paddr   = mem_addr + i * (len / desc_num);
+        saddr[i].len     = len / desc_num;
+    }
     tinfo.src_addrs      = &saddr[0];
 
-    daddr[0].paddr       = daddr[1].paddr = audio_dmac_config.addr;
-    tinfo.dst_addrs      = &daddr[0];
+    daddr.paddr          = audio_dmac_config.addr;
+    tinfo.dst_addrs      = &daddr;
 
     tinfo.req_id         = audio_dmac_config.mid_rid;
 
-    audiodmafuncs.setup_xfer(audiodma_chn, &tinfo);
+    if( audiodmafuncs.setup_xfer(audiodma_chn, &tinfo) != 0 ) {
+        return EINVAL;
+    }
 
     return EOK;
 }
 
 /*  peripheral to memory  */
-int audio_dmac_pm_setup(void *audiodma_chn, audio_peripheral_t src, off64_t mem_addr, int len)
+int audio_dmac_pm_setup(void *audiodma_chn, audio_peripheral_t src, off64_t mem_addr, int len, int desc_num)
 {
     dma_transfer_t  tinfo;
-    dma_addr_t      saddr[2], daddr[2];
+    dma_addr_t      saddr, daddr[AUDIO_DMAC_DESC_MAX];
     audio_dmac_config_t audio_dmac_config;
+    int             i;
 
-    if (!audiodma_chn) {
+    if (!audiodma_chn || desc_num < 1 || desc_num > AUDIO_DMAC_DESC_MAX || len % (desc_num * 4) ) {
         return EINVAL;
     }
 
@@ -620,21 +679,23 @@ int audio_dmac_pm_setup(void *audiodma_chn, audio_peripheral_t src, off64_t mem_
     tinfo.xfer_unit_size = 4;
     tinfo.xfer_bytes     = len;
     tinfo.dst_flags      = DMA_ADDR_FLAG_SEGMENTED;
-    tinfo.dst_fragments  = 2;
+    tinfo.dst_fragments  = desc_num;
     tinfo.src_flags      = DMA_ADDR_FLAG_NO_INCREMENT | DMA_ADDR_FLAG_DEVICE;
 
-    daddr[0].paddr       = mem_addr;
-    daddr[1].paddr       = mem_addr + len / 2;
-    daddr[0].len         = len / 2;
-    daddr[1].len         = len / 2;
+    for( i = 0; i < desc_num; i++ ) {
+        daddr[i].paddr   = mem_addr + i * (len / desc_num);
+        daddr[i].len     = len / desc_num;
+    }
     tinfo.dst_addrs      = &daddr[0];
 
-    saddr[0].paddr       = saddr[1].paddr = audio_dmac_config.addr;
-    tinfo.src_addrs      = &saddr[0];
+    saddr.paddr          = audio_dmac_config.addr;
+    tinfo.src_addrs      = &saddr;
 
     tinfo.req_id         = audio_dmac_config.mid_rid;
 
-    audiodmafuncs.setup_xfer(audiodma_chn, &tinfo);
+    if( audiodmafuncs.setup_xfer(audiodma_chn, &tinfo) != 0 ) {
+        return EINVAL;
+    }
 
     return EOK;
 }
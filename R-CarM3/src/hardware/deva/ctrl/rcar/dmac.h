@@ -115,25 +115,33 @@ typedef struct {
    uint32_t chcr;
 } audio_dmac_pp_config_t;
 
+/* maximum number of descriptors in the ring of one memory transfer channel */
+#define AUDIO_DMAC_DESC_MAX 64
+
 typedef struct {
    uint32_t audiodma_irq;
    void* audiodma_chn;
    void* audiodma_pp_chn;
+   uint32_t desc_num; /* descriptors reserved at attach time, 0 for the default of 2 */
 } audio_dmac_context_t;
 
 int audio_dmac_init(audio_dmac_context_t* tx_context, audio_dmac_context_t* rx_context);
 void audio_dmac_init_cleanup(audio_dmac_context_t* tx_context, audio_dmac_context_t* rx_context);
 void audio_dmac_deinit(audio_dmac_context_t* tx_context, audio_dmac_context_t* rx_context);
 
+/* memory transfer channel only, sharing the peripheral-peripheral channel of another context */
+int audio_dmac_mp_init(audio_dmac_context_t* context);
+void audio_dmac_mp_deinit(audio_dmac_context_t* context);
+
 int audio_dmac_count_register_get(void *audiodma_chn, uint32_t * tc_val);
 
 /* memory to peripheral transfer */
 int audio_dmac_mp_get_config(audio_peripheral_t dst, audio_dmac_config_t* dmac_config);
-int audio_dmac_mp_setup(void *audiodma_chn, audio_peripheral_t dst, off64_t mem_addr, int len);
+int audio_dmac_mp_setup(void *audiodma_chn, audio_peripheral_t dst, off64_t mem_addr, int len, int desc_num);
 
 /* peripheral to memory transfer */
 int audio_dmac_pm_get_config(audio_peripheral_t src, audio_dmac_config_t* dmac_config);
-int audio_dmac_pm_setup(void *audiodma_chn, audio_peripheral_t src, off64_t mem_addr, int len);
+int audio_dmac_pm_setup(void *audiodma_chn, audio_peripheral_t src, off64_t mem_addr, int len, int desc_num);
 
 /* peripheral to memory and memory to peripheral transfer start/stop/clean */
 int audio_dmac_start(void *audiodma_chn);
@@ -31,6 +31,7 @@ typedef struct ak4613_context
 {
     ado_mixer_t             *mixer;
     HW_CONTEXT_T            *hwc;
+    uint32_t                dvc_level[2];   /* SCU DVC volume mixer values, left and right */
 } ak4613_context_t;
 
 #include "scu.h"
@@ -50,6 +51,14 @@ static struct snd_mixer_element_volume1_range   ak4613_output_range[2] = {
     {0, AK4613_MAX_DIGITAL_VOL, -12700, 0}     // min, max, min_dB, max_dB (SPEAKER)
 };
 
+/* SCU DVC volume range, 1dB per step, 0 mutes */
+#define RCAR_DVC_MAX_VOL    96
+
+static struct snd_mixer_element_volume1_range   rcar_dvc_range[2] = {
+    {0, RCAR_DVC_MAX_VOL, -RCAR_DVC_MAX_VOL * 100, 0},    // min, max, min_dB, max_dB
+    {0, RCAR_DVC_MAX_VOL, -RCAR_DVC_MAX_VOL * 100, 0}     // min, max, min_dB, max_dB
+};
+
 
 static  int32_t
 ak4613_master_vol_control (MIXER_CONTEXT_T * ak4613, ado_mixer_delement_t * element, uint8_t set,
@@ -82,6 +91,44 @@ ak4613_master_vol_control (MIXER_CONTEXT_T * ak4613, ado_mixer_delement_t * elem
     return altered;
 }
 
+/* Playback volume applied by the SCU DVC in front of the codec; the left and right
+ * values are applied to the even and odd voices. The DVC ramps to the new level
+ * if the driver was started with the dvc_ramp option.
+ */
+static  int32_t
+rcar_dvc_vol_control (MIXER_CONTEXT_T * ak4613, ado_mixer_delement_t * element, uint8_t set,
+    uint32_t * vol, void *instance_data)
+{
+    HW_CONTEXT_T *hwc = ak4613->hwc;
+    int32_t altered = 0;
+    uint32_t i, level;
+
+    if (set)
+    {
+        altered = (vol[0] != ak4613->dvc_level[0] || vol[1] != ak4613->dvc_level[1]);
+
+        ak4613->dvc_level[0] = vol[0] < RCAR_DVC_MAX_VOL ? vol[0] : RCAR_DVC_MAX_VOL;
+        ak4613->dvc_level[1] = vol[1] < RCAR_DVC_MAX_VOL ? vol[1] : RCAR_DVC_MAX_VOL;
+
+        ado_mutex_lock( &hwc->hw_lock );
+        for( i = 0; i < sizeof(hwc->playback.dvc_volume)/sizeof(hwc->playback.dvc_volume[0]); i++ ) {
+            level = ak4613->dvc_level[i & 1];
+            hwc->playback.dvc_volume[i] = level ? scu_dvc_db_to_vol( RCAR_DVC_MAX_VOL - level ) : 0;
+        }
+        ado_debug( DB_LVL_DRIVER, "rcar : %s: setting DVC volume to %x:%x", __func__,
+                   hwc->playback.dvc_volume[0], hwc->playback.dvc_volume[1] );
+        scu_dvc_update_vol( hwc->playback.cmd_chan, hwc->playback.dvc_volume );
+        ado_mutex_unlock( &hwc->hw_lock );
+    }
+    else /* read volume */
+    {
+        vol[0] = ak4613->dvc_level[0];
+        vol[1] = ak4613->dvc_level[1];
+    }
+
+    return altered;
+}
+
 /* Required for compatibility with Audioman
  * This switch is called by audio manager to ask deva to send the current HW status, i.e., whether headset is connected
  */
@@ -122,6 +169,26 @@ build_ak4613_mixer(MIXER_CONTEXT_T * ak4613)
 
     pre_elem = elem;
 
+    /* with the SCU the stream goes through the DVC before it reaches the codec */
+    if (!error && ak4613->hwc->use_scu && ak4613->hwc->playback.ssi_chan != SSI_CHANNEL_NUM)
+    {
+        ak4613->dvc_level[0] = ak4613->dvc_level[1] = RCAR_DVC_MAX_VOL;
+
+        if ((elem = ado_mixer_element_volume1 (ak4613->mixer, "DVC Volume",
+                    2, rcar_dvc_range, rcar_dvc_vol_control, NULL, NULL)) == NULL)
+            error++;
+
+        /* mixed playback subchannels get their own volume group when they are acquired */
+        if (!error && ado_mixer_element_route_add(ak4613->mixer, pre_elem, elem) != 0)
+            error++;
+
+        if (!error && ado_mixer_playback_group_create(ak4613->mixer, SND_MIXER_PCM_OUT,
+                    SND_MIXER_CHN_MASK_STEREO, elem, NULL) == NULL)
+            error++;
+
+        pre_elem = elem;
+    }
+
     if (!error && (vol_elem = ado_mixer_element_volume1 (ak4613->mixer, "DAC Volume",
                 2, ak4613_output_range, ak4613_master_vol_control, NULL, NULL)) == NULL)
     error++;
@@ -33,30 +33,52 @@ struct  rcar_audio_channel;
 #include <stdint.h>
 #include "dmac.h"
 #include "ssiu.h"
+#include "rcar_prof.h"
 
 #define SAMPLE_RATE_MIN         8000
 #define SAMPLE_RATE_MAX         48000
 
+#define DMA_FRAGS_DEFAULT       2       /* fragments of the PCM buffer in the default mode */
+#define DMA_FRAGS_LOWLATENCY    32      /* default descriptor ring size in low latency mode */
+
+#define PLAYBACK_SUBCHN_MAX     4       /* playback subchannels mixed by the SCU, one per MIX input */
+
 typedef struct rcar_audio_channel
 {
     ado_pcm_cap_t         pcm_caps;
     ado_pcm_hw_t          pcm_funcs;
     ado_pcm_subchn_t      *subchn;
+    ado_pcm_subchn_mixer_t *subchn_mixer; /* volume group of the acquired stream, only applicable to mixed playback */
     audio_dmac_context_t  dma_context;
     uint32_t              ssi_chan;
     uint32_t              src_chan;
     uint32_t              cmd_chan; /* only applicable to playback channels */
+    uint32_t              mix_input; /* SCU MIX input fed by the SRC, only applicable to mixed playback */
     uint32_t              dvc_volume[8]; /* only applicable to playback channels */
+    uint32_t              sample_rate; /* rate of the acquired stream when converted by the SCU, 0 if none */
+    uint32_t              dma_size;    /* size of the PCM buffer covered by the descriptor ring */
+    uint32_t              frag_size;   /* size of one PCM fragment (period) */
+    uint32_t              desc_num;    /* number of descriptors in the ring */
+    uint32_t              dma_pos;     /* DMA position seen at the last interrupt */
+    uint32_t              dma_pending; /* bytes transferred since the last fragment was signalled */
+    uint32_t              byte_rate;   /* bytes per second of the acquired stream */
+    rcar_prof_t           prof;        /* interrupt and position profiler of the channel */
 } rcar_audio_channel_t;
 
 typedef struct rcar_context
 {
     ado_mutex_t              hw_lock;
+    ado_mutex_t              ssi_lock;  /* held while the playback SSI goes idle, hw_lock is taken first */
     ado_pcm_t                *pcm;
     ado_mixer_t              *mixer;
     rcar_audio_channel_t     playback;  /* Settings for one playback channel.*/
     rcar_audio_channel_t     capture;   /* Settings for one capture channel.*/
+    rcar_audio_channel_t     mix[PLAYBACK_SUBCHN_MAX - 1]; /* further playback subchannels, mixed with playback by the SCU */
+    uint32_t                 playback_subchns;  /* number of playback subchannels, more than one go through the SCU MIX */
+    uint32_t                 playback_running;  /* bitmask of the triggered playback subchannels */
+    uint32_t                 mix_volume[PLAYBACK_SUBCHN_MAX]; /* attenuation of each MIX input, MIX_MDBxR values */
     uint32_t                 use_scu;   /* use the Sampling Rate Convertor Unit (SCU) */
+    int32_t                  dvc_ramp;  /* DVC volume ramp period code, -1 if the ramp is not used */
     uint32_t                 use_mlp;   /* use the Media LB Port (MLP) */
     uint32_t                 use_dtcp;  /* use Digital Transmission Content Protection (available in conjunction with MLP) */
     uint32_t                 voices;
@@ -73,9 +95,17 @@ typedef struct rcar_context
     ssi_pin_mode_t           ssi_pin_mode;
     ssi_config_t             ssi_config;
     uint32_t                 ssi_voices; /* if the TDM split feature is used, this can be different from the host voices */
+    uint32_t                 dma_frags; /* maximum number of fragments, bounds the descriptor ring */
+    uint32_t                 irq_frags; /* fragments per DMA descriptor, i.e. per interrupt */
     uint32_t                 debug;
 } rcar_context_t;
 
+/* playback subchannel idx, the first one being the playback channel */
+static inline rcar_audio_channel_t * rcar_playback_chn( rcar_context_t * rcar, uint32_t idx )
+{
+    return idx == 0 ? &rcar->playback : &rcar->mix[idx - 1];
+}
+
 #endif /* _R_Car_H */
 
 #if defined(__QNXNTO__) && defined(__USESRCVERSION)
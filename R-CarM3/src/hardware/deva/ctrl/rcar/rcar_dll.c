@@ -55,8 +55,37 @@ static const uint32_t supported_rate_list = SND_PCM_RATE_8000 |
 static uint32_t configured_rate_list;
 
 static int rcar_set_clock_rate (rcar_context_t * rcar);
+static int rcar_scu_set_rate (rcar_context_t * rcar, rcar_audio_channel_t * chn);
 static void rcar_register_dump( HW_CONTEXT_T * rcar );
 
+/* first playback subchannel not acquired, NULL if all are in use */
+static rcar_audio_channel_t * rcar_playback_free_chn( rcar_context_t * rcar )
+{
+    uint32_t i;
+
+    for( i = 0; i < rcar->playback_subchns; i++ ) {
+        if( !rcar_playback_chn( rcar, i )->subchn ) {
+            return rcar_playback_chn( rcar, i );
+        }
+    }
+
+    return NULL;
+}
+
+/* index of a playback subchannel, playback_subchns if pc is not one */
+static uint32_t rcar_playback_idx( rcar_context_t * rcar, rcar_audio_channel_t * pc )
+{
+    uint32_t i;
+
+    for( i = 0; i < rcar->playback_subchns; i++ ) {
+        if( pc == rcar_playback_chn( rcar, i ) ) {
+            break;
+        }
+    }
+
+    return i;
+}
+
 static int32_t rcar_capabilities(HW_CONTEXT_T* rcar, ado_pcm_t *pcm, snd_pcm_channel_info_t* info)
 {
     int chn_avail;
@@ -74,10 +103,13 @@ static int32_t rcar_capabilities(HW_CONTEXT_T* rcar, ado_pcm_t *pcm, snd_pcm_cha
     info->min_rate = rcar->sample_rate_min;
     info->max_rate = rcar->sample_rate_max;
 
+    /* With the SCU the SSI runs at SAMPLE_RATE_SRC and each direction has its own SRC,
+     * so only without it are playback and capture rate locked.
+     */
     if (info->channel == SND_PCM_CHANNEL_PLAYBACK) {
-        if ( rcar->playback.subchn ) {
+        if ( !rcar_playback_free_chn( rcar ) ) {
             chn_avail = 0;
-        } else if (rcar->sample_rate_min != rcar->sample_rate_max) {
+        } else if (!rcar->use_scu && rcar->sample_rate_min != rcar->sample_rate_max) {
 
             ado_mutex_lock(&rcar->hw_lock);
 
@@ -94,7 +126,7 @@ static int32_t rcar_capabilities(HW_CONTEXT_T* rcar, ado_pcm_t *pcm, snd_pcm_cha
     } else if (info->channel == SND_PCM_CHANNEL_CAPTURE) {
         if ( rcar->capture.subchn ) {
             chn_avail = 0;
-        } else if (rcar->sample_rate_min != rcar->sample_rate_max) {
+        } else if (!rcar->use_scu && rcar->sample_rate_min != rcar->sample_rate_max) {
 
             ado_mutex_lock(&rcar->hw_lock);
 
@@ -124,29 +156,111 @@ static int32_t rcar_capabilities(HW_CONTEXT_T* rcar, ado_pcm_t *pcm, snd_pcm_cha
     return EOK;
 }
 
+/*
+ * Lay out the descriptor ring for the PCM buffer: one descriptor covers irq_frags
+ * fragments, so the DMAC raises one interrupt per irq_frags fragments whatever the
+ * fragment size. A single fragment buffer is still split in two descriptors so that
+ * an interrupt always comes before the ring wraps.
+ */
+static void rcar_dma_ring_setup (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T * pc, ado_pcm_config_t * config)
+{
+    uint32_t frags;
+    uint32_t irq_frags = rcar->irq_frags;
+
+    pc->dma_size = config->dmabuf.size;
+    pc->frag_size = ado_pcm_dma_int_size( config );
+    if( pc->frag_size == 0 || pc->frag_size > pc->dma_size ) {
+        pc->frag_size = pc->dma_size;
+    }
+
+    /* the ring covers whole fragments only */
+    frags = pc->dma_size / pc->frag_size;
+    pc->dma_size = frags * pc->frag_size;
+
+    if( irq_frags == 0 || irq_frags > frags ) {
+        irq_frags = frags;
+    }
+    while( frags % irq_frags || frags / irq_frags > pc->dma_context.desc_num ) {
+        irq_frags++;
+    }
+
+    pc->desc_num = frags / irq_frags;
+    if( pc->desc_num < 2 ) {
+        pc->desc_num = 2;
+    }
+    pc->dma_pos = 0;
+    pc->dma_pending = 0;
+    pc->byte_rate = config->format.rate * config->format.voices * ( rcar->sample_size == 16 ? 2 : 4 );
+
+    ado_debug( DB_LVL_DRIVER, "%s: buffer %u, fragment %u, %u descriptors", __func__,
+               pc->dma_size, pc->frag_size, pc->desc_num );
+}
+
+/*
+ * Signal io-audio once for every fragment boundary the DMA crossed since the last
+ * interrupt; the count is derived from the DMA position rather than from the number
+ * of interrupts, so coalesced or late interrupts do not lose fragments.
+ */
+static void rcar_dma_elapsed (PCM_SUBCHN_CONTEXT_T * pc)
+{
+    uint64_t now = ClockCycles();
+    uint32_t left = 0;
+    uint32_t pos, progress;
+    uint32_t frags = 0;
+
+    if( pc->frag_size == 0 || pc->dma_size == 0 ) {
+        dma_interrupt( pc->subchn );
+        return;
+    }
+
+    audio_dmac_count_register_get( pc->dma_context.audiodma_chn, &left );
+    pos = left < pc->dma_size ? pc->dma_size - left : 0;
+
+    progress = ( pos + pc->dma_size - pc->dma_pos ) % pc->dma_size;
+    pc->dma_pending += progress;
+    pc->dma_pos = pos;
+
+    while( pc->dma_pending >= pc->frag_size ) {
+        pc->dma_pending -= pc->frag_size;
+        frags++;
+        dma_interrupt( pc->subchn );
+    }
+
+    rcar_prof_irq( &pc->prof, now, frags, progress, pc->dma_pending, pos );
+}
+
 static int32_t rcar_playback_acquire (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T ** pc,
         ado_pcm_config_t * config, ado_pcm_subchn_t * subchn, uint32_t * why_failed)
 {
+    rcar_audio_channel_t *chn;
+    uint32_t i, first = 1;
     int status;
 
     ado_debug ( DB_LVL_DRIVER, "rcar : %s", __func__ );
 
     ado_mutex_lock( &rcar->hw_lock );
 
-    if( rcar->playback.subchn ) {
+    if( ( chn = rcar_playback_free_chn( rcar ) ) == NULL ) {
         *why_failed = SND_PCM_PARAMS_NO_CHANNEL;
         ado_mutex_unlock( &rcar->hw_lock );
         ado_error( "%s: no channel available", __func__ );
         return EAGAIN;
     }
 
+    /* the CMD to SSI transfer is shared by the mixed subchannels, set it up for the first one */
+    for( i = 0; i < rcar->playback_subchns; i++ ) {
+        if( rcar_playback_chn( rcar, i )->subchn ) {
+            first = 0;
+        }
+    }
+
     if( rcar->sample_rate_min == rcar->sample_rate_max ) {
         if( config->format.rate != rcar->sample_rate_min ) {
             ado_mutex_unlock (&rcar->hw_lock);
             ado_error( "%s: rate not supported: %d", __func__, config->format.rate );
             return EINVAL;
         }
-    } else {
+    } else if( !rcar->use_scu ) {
         if( rcar->sample_rate && config->format.rate != rcar->sample_rate ) {
             ado_mutex_unlock (&rcar->hw_lock);
             ado_error( "%s: rate is locked by capture session: locked rate: %d, requested rate: %d",
@@ -155,9 +269,14 @@ static int32_t rcar_playback_acquire (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T
         }
     }
 
-    rcar->sample_rate = config->format.rate;
-
-    status = rcar_set_clock_rate( rcar );
+    if( rcar->use_scu ) {
+        /* only the SRC of this subchannel changes, the SSI stays at SAMPLE_RATE_SRC */
+        chn->sample_rate = config->format.rate;
+        status = rcar_scu_set_rate( rcar, chn );
+    } else {
+        rcar->sample_rate = config->format.rate;
+        status = rcar_set_clock_rate( rcar );
+    }
     if( status != EOK ) {
         ado_mutex_unlock (&rcar->hw_lock);
         ado_error( "%s: failed setting the clock rate", __func__ );
@@ -176,6 +295,8 @@ static int32_t rcar_playback_acquire (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T
 
     ado_debug( DB_LVL_DRIVER, "%s: dmabuf.size = %X ", __func__, config->dmabuf.size );
 
+    rcar_dma_ring_setup( rcar, chn, config );
+
     if ( !rcar->use_scu ) {
         audio_peripheral_t dest;
         if( rcar->ssi_transfer_mode == SSI_BUSIF_TRANSFER ) {
@@ -184,24 +305,26 @@ static int32_t rcar_playback_acquire (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T
             dest = AUDIO_PERIPHERAL_SSI(rcar->playback.ssi_chan);
         }
         /* Not to use SCU: DMA transfer from Memory to SSI */
-        status = audio_dmac_mp_setup( rcar->playback.dma_context.audiodma_chn,
+        status = audio_dmac_mp_setup( chn->dma_context.audiodma_chn,
                                       dest,
                                       config->dmabuf.phys_addr,
-                                      config->dmabuf.size );
+                                      chn->dma_size,
+                                      chn->desc_num );
         if( status != EOK ) {
             ado_error( "%s: failed setting up dmac mp to peripheral %x", __func__, dest );
         }
     } else {
         /* To use SCU: DMA transfer from Memory to SRC */
-        status = audio_dmac_mp_setup( rcar->playback.dma_context.audiodma_chn,
-                                      AUDIO_PERIPHERAL_SCUSRC(rcar->playback.src_chan),
+        status = audio_dmac_mp_setup( chn->dma_context.audiodma_chn,
+                                      AUDIO_PERIPHERAL_SCUSRC(chn->src_chan),
                                       config->dmabuf.phys_addr,
-                                      config->dmabuf.size);
+                                      chn->dma_size,
+                                      chn->desc_num);
 
         if( status != EOK ) {
             ado_error( "%s: failed setting up dmac mp to peripheral %x", __func__,
-                       AUDIO_PERIPHERAL_SCUSRC(rcar->playback.src_chan) );
-        } else {
+                       AUDIO_PERIPHERAL_SCUSRC(chn->src_chan) );
+        } else if( first ) {
             /* Setup peripheral-peripheral DMA transfer from SCU-CMD0 to SSI0-0 */
             status = audio_dmac_pp_setup( rcar->playback.dma_context.audiodma_pp_chn,
                                            AUDIO_PERIPHERAL_SCUCMD(rcar->playback.cmd_chan),
@@ -214,18 +337,28 @@ static int32_t rcar_playback_acquire (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T
         }
     }
 
+    /* the volume of a mixed stream belongs to the stream, not to the SRC/MIX input it got */
+    if( status == EOK && rcar->playback_subchns > 1 ) {
+        chn->subchn_mixer = ado_pcm_subchn_mixer_create( subchn, rcar->mixer, SND_MIXER_CHN_MASK_STEREO );
+        if( chn->subchn_mixer == NULL ) {
+            ado_error( "%s: failed creating the subchannel mixer", __func__ );
+            status = ENOMEM;
+        }
+    }
+
     if( status == EOK ) {
-        rcar->playback.subchn = subchn;
-        *pc = &rcar->playback;
+        chn->subchn = subchn;
+        *pc = chn;
     } else {
         ado_shm_free (config->dmabuf.addr, config->dmabuf.size, config->dmabuf.name);
         config->dmabuf.addr = NULL;
         rcar->sample_rate = 0;
+        chn->sample_rate = 0;
     }
 
     ado_mutex_unlock (&rcar->hw_lock);
 
-    return EOK;
+    return status;
 }
 
 /* */
@@ -238,7 +371,12 @@ static int32_t rcar_playback_release (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T
 
     ado_mutex_lock (&rcar->hw_lock);
 
-    rcar->playback.subchn = NULL;
+    pc->subchn = NULL;
+    pc->sample_rate = 0;
+    if( pc->subchn_mixer ) {
+        ado_pcm_subchn_mixer_destroy( pc->subchn_mixer );
+        pc->subchn_mixer = NULL;
+    }
     if( !rcar->capture.subchn ) {
         rcar->sample_rate = 0;
     }
@@ -275,7 +413,7 @@ static int32_t rcar_capture_acquire (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
             ado_error( "%s: rate not supported: %d", __func__, config->format.rate );
             return EINVAL;
         }
-    } else {
+    } else if( !rcar->use_scu ) {
         if( rcar->sample_rate && config->format.rate != rcar->sample_rate ) {
             ado_mutex_unlock (&rcar->hw_lock);
             ado_error( "%s: rate is locked by playback session: locked rate: %d, requested rate: %d",
@@ -284,9 +422,14 @@ static int32_t rcar_capture_acquire (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
         }
     }
 
-    rcar->sample_rate = config->format.rate;
-
-    status = rcar_set_clock_rate( rcar );
+    if( rcar->use_scu ) {
+        /* only the SRC of this direction changes, the SSI stays at SAMPLE_RATE_SRC */
+        rcar->capture.sample_rate = config->format.rate;
+        status = rcar_scu_set_rate( rcar, &rcar->capture );
+    } else {
+        rcar->sample_rate = config->format.rate;
+        status = rcar_set_clock_rate( rcar );
+    }
     if( status != EOK ) {
         ado_mutex_unlock (&rcar->hw_lock);
         ado_error( "%s: failed setting the clock rate", __func__ );
@@ -305,6 +448,8 @@ static int32_t rcar_capture_acquire (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
 
     ado_debug( DB_LVL_DRIVER, "%s: dmabuf.size = %X ", __func__, config->dmabuf.size );
 
+    rcar_dma_ring_setup( rcar, &rcar->capture, config );
+
     if ( !rcar->use_scu ) {
         audio_peripheral_t src;
         if( rcar->ssi_transfer_mode == SSI_BUSIF_TRANSFER ) {
@@ -316,7 +461,8 @@ static int32_t rcar_capture_acquire (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
         status = audio_dmac_pm_setup( rcar->capture.dma_context.audiodma_chn,
                                       src,
                                       config->dmabuf.phys_addr,
-                                      config->dmabuf.size );
+                                      rcar->capture.dma_size,
+                                      rcar->capture.desc_num );
         if( status != EOK ) {
             ado_error( "%s: failed setting up dmac pm from peripheral %x", __func__, src );
         }
@@ -324,7 +470,8 @@ static int32_t rcar_capture_acquire (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
         status = audio_dmac_pm_setup( rcar->capture.dma_context.audiodma_chn,
                                       AUDIO_PERIPHERAL_SCUSRC(rcar->capture.src_chan),
                                       config->dmabuf.phys_addr,
-                                      config->dmabuf.size );
+                                      rcar->capture.dma_size,
+                                      rcar->capture.desc_num );
         if( status != EOK ) {
             ado_error( "%s: failed setting up dmac pm from peripheral %x", __func__,
                        AUDIO_PERIPHERAL_SCUSRC(rcar->capture.src_chan) );
@@ -348,6 +495,7 @@ static int32_t rcar_capture_acquire (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
         ado_shm_free( config->dmabuf.addr, config->dmabuf.size, config->dmabuf.name );
         config->dmabuf.addr = NULL;
         rcar->sample_rate = 0;
+        rcar->capture.sample_rate = 0;
     }
 
     ado_mutex_unlock (&rcar->hw_lock);
@@ -367,6 +515,7 @@ static int32_t rcar_capture_release (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
     ado_mutex_lock (&rcar->hw_lock);
 
     rcar->capture.subchn = NULL;
+    rcar->capture.sample_rate = 0;
     if( !rcar->playback.subchn ) {
         rcar->sample_rate = 0;
     }
@@ -390,6 +539,8 @@ static int32_t rcar_playback_prepare (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T
 
     /* TBD: why is memory to peripheral DMA set-up repeated here (already done in acquire)? 
 	        Answer: If not to re-set-up here, pause/re-start does not work */
+    rcar_dma_ring_setup( rcar, pc, config );
+
     if ( !rcar->use_scu ) {
         audio_peripheral_t dest;
         if( rcar->ssi_transfer_mode == SSI_BUSIF_TRANSFER ) {
@@ -398,22 +549,24 @@ static int32_t rcar_playback_prepare (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T
             dest = AUDIO_PERIPHERAL_SSI(rcar->playback.ssi_chan);
         }
         /* Not to use SCU: DMA transfer from Memory to SSI */
-        status = audio_dmac_mp_setup( rcar->playback.dma_context.audiodma_chn,
+        status = audio_dmac_mp_setup( pc->dma_context.audiodma_chn,
                                       dest,
                                       config->dmabuf.phys_addr,
-                                      config->dmabuf.size );
+                                      pc->dma_size,
+                                      pc->desc_num );
         if( status != EOK ) {
             ado_error( "%s: failed setting up dmac mp to peripheral %x", __func__, dest );
         }
     } else {
         /* To use SCU: DMA transfer from Memory to SRC */
-        status = audio_dmac_mp_setup( rcar->playback.dma_context.audiodma_chn,
-                                      AUDIO_PERIPHERAL_SCUSRC(rcar->playback.src_chan),
+        status = audio_dmac_mp_setup( pc->dma_context.audiodma_chn,
+                                      AUDIO_PERIPHERAL_SCUSRC(pc->src_chan),
                                       config->dmabuf.phys_addr,
-                                      config->dmabuf.size );
+                                      pc->dma_size,
+                                      pc->desc_num );
         if( status != EOK ) {
             ado_error( "%s: failed setting up dmac mp to peripheral %x", __func__,
-                       AUDIO_PERIPHERAL_SCUSRC(rcar->playback.src_chan) );
+                       AUDIO_PERIPHERAL_SCUSRC(pc->src_chan) );
         }
     }
 
@@ -426,6 +579,8 @@ static int32_t rcar_capture_prepare (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
 
     ado_debug (DB_LVL_DRIVER, "rcar : %s", __func__);
 
+    rcar_dma_ring_setup( rcar, pc, config );
+
     if ( !rcar->use_scu ) {
        audio_peripheral_t src;
         if( rcar->ssi_transfer_mode == SSI_BUSIF_TRANSFER ) {
@@ -437,7 +592,8 @@ static int32_t rcar_capture_prepare (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
         status = audio_dmac_pm_setup( rcar->capture.dma_context.audiodma_chn,
                                       src,
                                       config->dmabuf.phys_addr,
-                                      config->dmabuf.size );
+                                      rcar->capture.dma_size,
+                                      rcar->capture.desc_num );
         if( status != EOK ) {
             ado_error( "%s: failed setting up dmac pm from peripheral %x", __func__, src );
         }
@@ -446,7 +602,8 @@ static int32_t rcar_capture_prepare (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
         status = audio_dmac_pm_setup( rcar->capture.dma_context.audiodma_chn,
                                       AUDIO_PERIPHERAL_SCUSRC(rcar->capture.src_chan),
                                       config->dmabuf.phys_addr,
-                                      config->dmabuf.size );
+                                      rcar->capture.dma_size,
+                                      rcar->capture.desc_num );
         if( status != EOK ) {
             ado_error( "%s: failed setting up dmac pm from peripheral %x", __func__,
                        AUDIO_PERIPHERAL_SCUSRC(rcar->capture.src_chan) );
@@ -456,90 +613,175 @@ static int32_t rcar_capture_prepare (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
     return status;
 }
 
+/* start the SSI (and BUSIF) shared by the playback subchannels */
+static void rcar_playback_ssi_start (HW_CONTEXT_T * rcar)
+{
+    if( rcar->ssi_start_mode == SSI_SYNC_SSI0129_START ) {
+        /* Multichannel SSI */
+
+        /* start the individual SSIs */
+        ado_debug( DB_LVL_DRIVER, "%s: Start SSI 0,1,2 (no CR.EN)", __func__ );
+        ssi_start( SSI_CHANNEL_0, SSI_SYNC_SSI0129_START );
+        ssi_start( SSI_CHANNEL_1, SSI_SYNC_SSI0129_START );
+        ssi_start( SSI_CHANNEL_2, SSI_SYNC_SSI0129_START );
+        if( rcar->voices == 8 ) {
+            ado_debug( DB_LVL_DRIVER, "%s: Start SSI 9 (no CR.EN)", __func__ );
+            ssi_start( SSI_CHANNEL_9, SSI_SYNC_SSI0129_START );
+        }
+
+        /* start in a synchronized fashion the SSI0129 or SSI012 channels */
+        ado_debug( DB_LVL_DRIVER, "%s: Synchronized start of SSI 0,1,2(,9)", __func__ );
+        ssiu_start( SSI_SYNC_SSI0129_START );
+    } else if( rcar->ssi_start_mode == SSI_SYNC_SSI34_START ) {
+        /* SSI 3,4 configured for synchronized start */
+
+        /* start the individual SSIs */
+        ado_debug( DB_LVL_DRIVER, "%s: Start SSI 3,4 (no CR.EN)", __func__ );
+        ssi_start( SSI_CHANNEL_3, SSI_SYNC_SSI34_START );
+        ssi_start( SSI_CHANNEL_4, SSI_SYNC_SSI34_START );
+
+        /* start in a synchronized fashion the SSI34 */
+        ado_debug( DB_LVL_DRIVER, "%s: Synchronized start of SSI 3,4", __func__ );
+        ssiu_start( SSI_SYNC_SSI34_START );
+    } else {
+        /* start SSIx as independent SSI */
+        ado_debug( DB_LVL_DRIVER, "%s: Start SSI %d (CR.EN)", __func__,
+                   rcar->playback.ssi_chan );
+        ssi_start( rcar->playback.ssi_chan, SSI_INDEPENDENT_START );
+    }
+
+    /* start applicable busif if required */
+    if( rcar->ssi_transfer_mode == SSI_BUSIF_TRANSFER ) {
+        /* start busif SSIx-0 */
+        ado_debug( DB_LVL_DRIVER, "%s: Start BUSIF for SSI %d subchan 0", __func__,
+                   rcar->playback.ssi_chan );
+        ssiu_busif_start(rcar->playback.ssi_chan, 0);
+
+        /* start busif SSIx-1,2,3 if in TDM split mode */
+        if( rcar->ssi_op_mode == SSI_OP_MODE_TDMSPLIT_4XMONO ||
+            rcar->ssi_op_mode == SSI_OP_MODE_TDMSPLIT_4XSTEREO ) {
+            ado_debug( DB_LVL_DRIVER, "%s: Start BUSIF for SSI %d subchan 1,2,3", __func__,
+                       rcar->playback.ssi_chan );
+            ssiu_busif_start(rcar->playback.ssi_chan, 1);
+            ssiu_busif_start(rcar->playback.ssi_chan, 2);
+            ssiu_busif_start(rcar->playback.ssi_chan, 3);
+        }
+    }
+}
+
+/* stop the SSI (and BUSIF) shared by the playback subchannels */
+static void rcar_playback_ssi_stop (HW_CONTEXT_T * rcar)
+{
+    /* stop applicable busif if required */
+    if( rcar->ssi_transfer_mode == SSI_BUSIF_TRANSFER ) {
+        /* stop busif SSIx-0 */
+        ado_debug( DB_LVL_DRIVER, "%s: Stop BUSIF for SSI %d subchan 0", __func__,
+                   rcar->playback.ssi_chan );
+        ssiu_busif_stop(rcar->playback.ssi_chan, 0);
+
+        /* stop busif SSIx-1,2,3 if in TDM split mode */
+        if( rcar->ssi_op_mode == SSI_OP_MODE_TDMSPLIT_4XMONO ||
+            rcar->ssi_op_mode == SSI_OP_MODE_TDMSPLIT_4XSTEREO ) {
+            ado_debug( DB_LVL_DRIVER, "%s: Stop BUSIF for SSI %d subchan 1,2,3", __func__,
+                       rcar->playback.ssi_chan );
+            ssiu_busif_stop(rcar->playback.ssi_chan, 1);
+            ssiu_busif_stop(rcar->playback.ssi_chan, 2);
+            ssiu_busif_stop(rcar->playback.ssi_chan, 3);
+        }
+    }
+    if( rcar->ssi_start_mode == SSI_SYNC_SSI0129_START ) {
+        /* Multichannel SSI */
+        ado_debug( DB_LVL_DRIVER, "%s: Synchronized stop of SSI 0,1,2(,9)", __func__ );
+        ssiu_stop( SSI_SYNC_SSI0129_START );
+
+        /* stop the individual SSIs */
+        ado_debug( DB_LVL_DRIVER, "%s: Stop SSI 0,1,2 (no CR.EN)", __func__ );
+        ssi_stop( SSI_CHANNEL_0 );
+        ssi_stop( SSI_CHANNEL_1 );
+        ssi_stop( SSI_CHANNEL_2 );
+        if( rcar->voices == 8 ) {
+            ado_debug( DB_LVL_DRIVER, "%s: Stop SSI 9 (no CR.EN)", __func__ );
+            ssi_stop( SSI_CHANNEL_9 );
+        }
+    } else if( rcar->ssi_start_mode == SSI_SYNC_SSI34_START ) {
+        /* SSI 3,4 configured for synchronized start */
+        ado_debug( DB_LVL_DRIVER, "%s: Synchronized stop of SSI 3,4", __func__ );
+        ssiu_stop( SSI_SYNC_SSI34_START );
+
+        /* stop the individual SSIs */
+        ado_debug( DB_LVL_DRIVER, "%s: Stop SSI 3,4 (no CR.EN)", __func__ );
+        ssi_stop( SSI_CHANNEL_3 );
+        ssi_stop( SSI_CHANNEL_4 );
+    } else {
+        /* stop SSIx */
+        ado_debug( DB_LVL_DRIVER, "%s: Stop SSI %d (CR.EN)", __func__,
+                   rcar->playback.ssi_chan );
+        ssi_stop( rcar->playback.ssi_chan );
+    }
+}
+
+/* wait for the playback SSI to go idle after rcar_playback_ssi_stop, with ssi_lock held but not hw_lock */
+static void rcar_playback_ssi_wait_idle (HW_CONTEXT_T * rcar)
+{
+    /* Wait for idle mode*/
+    delay(1);
+    ado_debug( DB_LVL_DRIVER, "%s: Waiting for IDST clear on SSI %d", __func__,
+               rcar->playback.ssi_chan );
+    ssi_wait_status_clear(rcar->playback.ssi_chan, SSISR_IDST_MASK);
+}
+
 static int32_t rcar_playback_trigger (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T * pc, uint32_t cmd)
 {
+    uint32_t idx = rcar_playback_idx( rcar, pc );
+    uint32_t running;
+
     ado_debug (DB_LVL_DRIVER, "rcar : %s", __func__);
 
-    if( pc->subchn != rcar->playback.subchn ) {
+    if( idx >= rcar->playback_subchns || pc->subchn == NULL ) {
         ado_debug( DB_LVL_DRIVER, "%s: unknown subchn", __func__ );
         return EINVAL;
     }
 
+    /* the SSI, the CMD and the CMD to SSI transfer run while any playback subchannel runs */
+    ado_mutex_lock( &rcar->hw_lock );
+    running = rcar->playback_running;
+
     if( cmd == ADO_PCM_TRIGGER_GO ) {
         ado_debug( DB_LVL_DRIVER, "%s: ADO_PCM_TRIGGER_GO", __func__ );
 
+        rcar->playback_running |= ( 1 << idx );
+
+        rcar_prof_start( &pc->prof, pc->byte_rate, pc->dma_size, pc->dma_size / pc->desc_num );
+
         /* Start Audio-DMAC */
         ado_debug( DB_LVL_DRIVER, "%s: Start Audio DMAC", __func__ );
-        audio_dmac_start( rcar->playback.dma_context.audiodma_chn );
+        audio_dmac_start( pc->dma_context.audiodma_chn );
 
-        if( rcar->use_scu ) {
+        if( rcar->use_scu && !running ) {
             /* Start Peripheral-Peripheral DMAC */
             ado_debug( DB_LVL_DRIVER, "%s: Start Audio DMAC PP", __func__ );
             audio_dmac_pp_start( rcar->playback.dma_context.audiodma_pp_chn );
         }
 
-        if( rcar->ssi_start_mode == SSI_SYNC_SSI0129_START ) {
-            /* Multichannel SSI */
-
-            /* start the individual SSIs */
-            ado_debug( DB_LVL_DRIVER, "%s: Start SSI 0,1,2 (no CR.EN)", __func__ );
-            ssi_start( SSI_CHANNEL_0, SSI_SYNC_SSI0129_START );
-            ssi_start( SSI_CHANNEL_1, SSI_SYNC_SSI0129_START );
-            ssi_start( SSI_CHANNEL_2, SSI_SYNC_SSI0129_START );
-            if( rcar->voices == 8 ) {
-                ado_debug( DB_LVL_DRIVER, "%s: Start SSI 9 (no CR.EN)", __func__ );
-                ssi_start( SSI_CHANNEL_9, SSI_SYNC_SSI0129_START );
-            }
-
-            /* start in a synchronized fashion the SSI0129 or SSI012 channels */
-            ado_debug( DB_LVL_DRIVER, "%s: Synchronized start of SSI 0,1,2(,9)", __func__ );
-            ssiu_start( SSI_SYNC_SSI0129_START );
-        } else if( rcar->ssi_start_mode == SSI_SYNC_SSI34_START ) {
-            /* SSI 3,4 configured for synchronized start */
-
-            /* start the individual SSIs */
-            ado_debug( DB_LVL_DRIVER, "%s: Start SSI 3,4 (no CR.EN)", __func__ );
-            ssi_start( SSI_CHANNEL_3, SSI_SYNC_SSI34_START );
-            ssi_start( SSI_CHANNEL_4, SSI_SYNC_SSI34_START );
-
-            /* start in a synchronized fashion the SSI34 */
-            ado_debug( DB_LVL_DRIVER, "%s: Synchronized start of SSI 3,4", __func__ );
-            ssiu_start( SSI_SYNC_SSI34_START );
-        } else {
-            /* start SSIx as independent SSI */
-            ado_debug( DB_LVL_DRIVER, "%s: Start SSI %d (CR.EN)", __func__,
-                       rcar->playback.ssi_chan );
-            ssi_start( rcar->playback.ssi_chan, SSI_INDEPENDENT_START );
-        }
-
-        /* start applicable busif if required */
-        if( rcar->ssi_transfer_mode == SSI_BUSIF_TRANSFER ) {
-            /* start busif SSIx-0 */
-            ado_debug( DB_LVL_DRIVER, "%s: Start BUSIF for SSI %d subchan 0", __func__,
-                       rcar->playback.ssi_chan );
-            ssiu_busif_start(rcar->playback.ssi_chan, 0);
-
-            /* start busif SSIx-1,2,3 if in TDM split mode */
-            if( rcar->ssi_op_mode == SSI_OP_MODE_TDMSPLIT_4XMONO ||
-                rcar->ssi_op_mode == SSI_OP_MODE_TDMSPLIT_4XSTEREO ) {
-                ado_debug( DB_LVL_DRIVER, "%s: Start BUSIF for SSI %d subchan 1,2,3", __func__,
-                           rcar->playback.ssi_chan );
-                ssiu_busif_start(rcar->playback.ssi_chan, 1);
-                ssiu_busif_start(rcar->playback.ssi_chan, 2);
-                ssiu_busif_start(rcar->playback.ssi_chan, 3);
-            }
+        if( !running ) {
+            /* not before a stop of the last subchannel has seen the SSI go idle */
+            ado_mutex_lock( &rcar->ssi_lock );
+            rcar_playback_ssi_start( rcar );
+            ado_mutex_unlock( &rcar->ssi_lock );
         }
 
         if( rcar->use_scu ) {
             /* start src */
             ado_debug( DB_LVL_DRIVER, "%s: Start SRC %d", __func__,
-                       rcar->playback.src_chan );
-            scu_src_start(rcar->playback.src_chan);
-
-            /* start cmd */
-            ado_debug( DB_LVL_DRIVER, "%s: Start CMD %d", __func__,
-                       rcar->playback.cmd_chan );
-            scu_cmd_start(rcar->playback.cmd_chan);
+                       pc->src_chan );
+            scu_src_start(pc->src_chan);
+
+            if( !running ) {
+                /* start cmd */
+                ado_debug( DB_LVL_DRIVER, "%s: Start CMD %d", __func__,
+                           rcar->playback.cmd_chan );
+                scu_cmd_start(rcar->playback.cmd_chan);
+            }
         }
 
         ado_debug (DB_LVL_DRIVER, "%s: ADO_PCM_TRIGGER_START complete", __func__);
@@ -547,79 +789,49 @@ static int32_t rcar_playback_trigger (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T
     } else if (cmd == ADO_PCM_TRIGGER_STOP) {
         ado_debug (DB_LVL_DRIVER, "%s: ADO_PCM_TRIGGER_STOP", __func__);
 
+        rcar->playback_running &= ~( 1 << idx );
+        running = rcar->playback_running;
+
+        rcar_prof_stop( &pc->prof );
+
         /* DMA request disable*/
         ado_debug( DB_LVL_DRIVER, "%s: Stop Audio DMAC", __func__ );
-        audio_dmac_stop(rcar->playback.dma_context.audiodma_chn);
+        audio_dmac_stop(pc->dma_context.audiodma_chn);
 
         if (rcar->use_scu == 1) {
-            /* Stop Peripheral-Peripheral DMAC */
-            ado_debug( DB_LVL_DRIVER, "%s: Stop Audio DMAC PP", __func__ );
-            audio_dmac_pp_stop(rcar->playback.dma_context.audiodma_pp_chn);
+            if( !running ) {
+                /* Stop Peripheral-Peripheral DMAC */
+                ado_debug( DB_LVL_DRIVER, "%s: Stop Audio DMAC PP", __func__ );
+                audio_dmac_pp_stop(rcar->playback.dma_context.audiodma_pp_chn);
+            }
 
             /* stop src0 */
             ado_debug( DB_LVL_DRIVER, "%s: Stop SRC %d", __func__,
-                       rcar->playback.src_chan );
-            scu_src_stop(rcar->playback.src_chan);
-
-            /* stop cmd0 */
-            ado_debug( DB_LVL_DRIVER, "%s: Stop CMD %d", __func__,
-                       rcar->playback.cmd_chan );
-            scu_cmd_stop(rcar->playback.cmd_chan);
-        }
-
-        /* stop applicable busif if required */
-        if( rcar->ssi_transfer_mode == SSI_BUSIF_TRANSFER ) {
-            /* stop busif SSIx-0 */
-            ado_debug( DB_LVL_DRIVER, "%s: Stop BUSIF for SSI %d subchan 0", __func__,
-                       rcar->playback.ssi_chan );
-            ssiu_busif_stop(rcar->playback.ssi_chan, 0);
-
-            /* stop busif SSIx-1,2,3 if in TDM split mode */
-            if( rcar->ssi_op_mode == SSI_OP_MODE_TDMSPLIT_4XMONO ||
-                rcar->ssi_op_mode == SSI_OP_MODE_TDMSPLIT_4XSTEREO ) {
-                ado_debug( DB_LVL_DRIVER, "%s: Stop BUSIF for SSI %d subchan 1,2,3", __func__,
-                           rcar->playback.ssi_chan );
-                ssiu_busif_stop(rcar->playback.ssi_chan, 1);
-                ssiu_busif_stop(rcar->playback.ssi_chan, 2);
-                ssiu_busif_stop(rcar->playback.ssi_chan, 3);
+                       pc->src_chan );
+            scu_src_stop(pc->src_chan);
+
+            if( !running ) {
+                /* stop cmd0 */
+                ado_debug( DB_LVL_DRIVER, "%s: Stop CMD %d", __func__,
+                           rcar->playback.cmd_chan );
+                scu_cmd_stop(rcar->playback.cmd_chan);
             }
         }
-        if( rcar->ssi_start_mode == SSI_SYNC_SSI0129_START ) {
-            /* Multichannel SSI */
-            ado_debug( DB_LVL_DRIVER, "%s: Synchronized stop of SSI 0,1,2(,9)", __func__ );
-            ssiu_stop( SSI_SYNC_SSI0129_START );
-
-            /* stop the individual SSIs */
-            ado_debug( DB_LVL_DRIVER, "%s: Stop SSI 0,1,2 (no CR.EN)", __func__ );
-            ssi_stop( SSI_CHANNEL_0 );
-            ssi_stop( SSI_CHANNEL_1 );
-            ssi_stop( SSI_CHANNEL_2 );
-            if( rcar->voices == 8 ) {
-                ado_debug( DB_LVL_DRIVER, "%s: Stop SSI 9 (no CR.EN)", __func__ );
-                ssi_stop( SSI_CHANNEL_9 );
-            }
-        } else if( rcar->ssi_start_mode == SSI_SYNC_SSI34_START ) {
-            /* SSI 3,4 configured for synchronized start */
-            ado_debug( DB_LVL_DRIVER, "%s: Synchronized stop of SSI 3,4", __func__ );
-            ssiu_stop( SSI_SYNC_SSI34_START );
 
-            /* stop the individual SSIs */
-            ado_debug( DB_LVL_DRIVER, "%s: Stop SSI 3,4 (no CR.EN)", __func__ );
-            ssi_stop( SSI_CHANNEL_3 );
-            ssi_stop( SSI_CHANNEL_4 );
-        } else {
-            /* stop SSIx */
-            ado_debug( DB_LVL_DRIVER, "%s: Stop SSI %d (CR.EN)", __func__,
-                       rcar->playback.ssi_chan );
-            ssi_stop( rcar->playback.ssi_chan );
+        if( !running ) {
+            rcar_playback_ssi_stop( rcar );
+            ado_mutex_lock( &rcar->ssi_lock );
         }
+    }
 
-        /* Wait for idle mode*/
-        delay(1);
-        ado_debug( DB_LVL_DRIVER, "%s: Waiting for IDST clear on SSI %d", __func__,
-                   rcar->playback.ssi_chan );
-        ssi_wait_status_clear(rcar->playback.ssi_chan, SSISR_IDST_MASK);
+    ado_mutex_unlock( &rcar->hw_lock );
 
+    if( cmd == ADO_PCM_TRIGGER_STOP ) {
+        /* outside hw_lock, only a restart of the SSI waits for it to go idle */
+        if( !running ) {
+            rcar_playback_ssi_wait_idle( rcar );
+            ado_mutex_unlock( &rcar->ssi_lock );
+        }
         ado_debug (DB_LVL_DRIVER, "%s: ADO_PCM_TRIGGER_STOP complete", __func__);
     }
 
@@ -642,6 +854,8 @@ static int32_t rcar_capture_trigger (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
     if (cmd == ADO_PCM_TRIGGER_GO) {
         ado_debug (DB_LVL_DRIVER, "%s: ADO_PCM_TRIGGER_GO", __func__);
 
+        rcar_prof_start( &pc->prof, pc->byte_rate, pc->dma_size, pc->dma_size / pc->desc_num );
+
         /* Start Audio-DMAC */
         ado_debug( DB_LVL_DRIVER, "%s: Start Audio DMAC", __func__ );
         audio_dmac_start(rcar->capture.dma_context.audiodma_chn);
@@ -696,6 +910,8 @@ static int32_t rcar_capture_trigger (HW_CONTEXT_T * rcar, PCM_SUBCHN_CONTEXT_T *
     } else if (cmd == ADO_PCM_TRIGGER_STOP) {
         ado_debug (DB_LVL_DRIVER, "%s: ADO_PCM_TRIGGER_STOP", __func__);
 
+        rcar_prof_stop( &pc->prof );
+
         /* DMA request disable */
         ado_debug( DB_LVL_DRIVER, "%s: Stop Audio DMAC", __func__ );
         audio_dmac_stop(rcar->capture.dma_context.audiodma_chn);
@@ -781,7 +997,11 @@ static uint32_t rcar_position
 
     ado_debug (DB_LVL_DRIVER, "%s: position=%x", __func__, pos);
 
-    return (config->dmabuf.size - pos);
+    /* the count left spans the whole descriptor ring, so this is the offset in the buffer */
+    pos = ( pos < pc->dma_size ? pc->dma_size - pos : 0 );
+    rcar_prof_position( &pc->prof, pos );
+
+    return pos;
 }
 
 static void rcar_playback_interrupt (HW_CONTEXT_T * rcar, int32_t irq)
@@ -791,8 +1011,25 @@ static void rcar_playback_interrupt (HW_CONTEXT_T * rcar, int32_t irq)
     /* Clear Interrupt status */
     audio_dmac_cleanup(rcar->playback.dma_context.audiodma_chn);
 
-    /* Signal to io-audio (DMA transfer was completed) */
-    dma_interrupt(rcar->playback.subchn);
+    /* Signal to io-audio the fragments completed since the last interrupt */
+    rcar_dma_elapsed(&rcar->playback);
+}
+
+static void rcar_mix_interrupt (HW_CONTEXT_T * rcar, int32_t irq)
+{
+    uint32_t i;
+
+    ado_debug (DB_LVL_INTERRUPT, "%s: irq=%d", __func__, irq);
+
+    for( i = 0; i + 1 < rcar->playback_subchns; i++ ) {
+        if( rcar->mix[i].dma_context.audiodma_irq == irq ) {
+            /* Clear Interrupt status */
+            audio_dmac_cleanup(rcar->mix[i].dma_context.audiodma_chn);
+
+            /* Signal to io-audio the fragments completed since the last interrupt */
+            rcar_dma_elapsed(&rcar->mix[i]);
+        }
+    }
 }
 
 static void rcar_capture_interrupt (HW_CONTEXT_T * rcar, int32_t irq)
@@ -802,8 +1039,8 @@ static void rcar_capture_interrupt (HW_CONTEXT_T * rcar, int32_t irq)
     /* Clear Interrupt status */
     audio_dmac_cleanup(rcar->capture.dma_context.audiodma_chn);
 
-    /* Signal to io-audio (DMA transfer was completed) */
-    dma_interrupt(rcar->capture.subchn);
+    /* Signal to io-audio the fragments completed since the last interrupt */
+    rcar_dma_elapsed(&rcar->capture);
 }
 
 static void rcar_parse_version(char * str)
@@ -834,6 +1071,7 @@ static int rcar_parse_commandline (rcar_context_t * rcar, char *args)
     uint32_t use_tx = 0;
     uint32_t use_rx = 0;
     uint32_t min_idx, max_idx;
+    uint32_t i;
     char     cs_machine_str[CS_MACHINE_LEN];
     char     *opts[] = {
         "tx_ssi",           // 0 - e.g. tx_ssi=0, tx_ssi=0129, enumerates the SSI indexes used for transmit
@@ -855,6 +1093,11 @@ static int rcar_parse_commandline (rcar_context_t * rcar, char *args)
         "slot_size",        // 15
         "ver",              // 16
         "debug",            // 17
+        "lowlatency",       // 18 - e.g. lowlatency, lowlatency=64, allows up to the given number of fragments
+                            //      (default 32) backed by a DMA descriptor ring, for periods down to 1ms
+        "irq_frags",        // 19 - e.g. irq_frags=4, number of fragments per DMA descriptor and interrupt
+        "dvc_ramp",         // 20 - e.g. dvc_ramp=10, SCU DVC volume ramp period code (0 fastest - 25 slowest)
+        "mix",              // 21 - e.g. mix=4, number of playback subchannels mixed by the SCU MIX (2 - 4)
         NULL
     };
 
@@ -882,6 +1125,10 @@ static int rcar_parse_commandline (rcar_context_t * rcar, char *args)
     rcar->ssi_config.serial_data_alignment = SSI_SER_DATA_ALIGN_DATA_FIRST;
     rcar->ssi_config.sys_word_length       = SSI_SYS_WORD_LEN_16BIT_STEREO;
     rcar->ssi_config.data_word_length      = SSI_DATA_WORD_LEN_16BIT;
+    rcar->dma_frags                        = DMA_FRAGS_DEFAULT;             /* by default, two fragments */
+    rcar->irq_frags                        = 1;                             /* by default, one interrupt per fragment */
+    rcar->dvc_ramp                         = -1;                            /* by default, no volume ramp */
+    rcar->playback_subchns                 = 1;                             /* by default, one playback subchannel */
     rcar->debug                            = 0;                             /* by default, no register dumps */
 
     /* Detect R-Car version based on confstr */
@@ -1176,9 +1423,61 @@ static int rcar_parse_commandline (rcar_context_t * rcar, char *args)
         case 17: // "debug"
             rcar->debug = 1;
             ado_debug( DB_LVL_DRIVER, "%s: Debug mode is on", __func__ );
+            break;
+        case 18: // "lowlatency"
+            rcar->dma_frags = DMA_FRAGS_LOWLATENCY;
+            if( value != NULL ) {
+                numvalue = strtol( value, NULL, 0 );
+                if( numvalue >= DMA_FRAGS_DEFAULT && numvalue <= AUDIO_DMAC_DESC_MAX ) {
+                    rcar->dma_frags = numvalue;
+                } else {
+                    ado_error( "%s: lowlatency %d out of range [%d,%d], using %d", __func__, numvalue,
+                               DMA_FRAGS_DEFAULT, AUDIO_DMAC_DESC_MAX, rcar->dma_frags );
+                }
+            }
+            ado_debug( DB_LVL_DRIVER, "%s: lowlatency, up to %d fragments", __func__, rcar->dma_frags );
+            break;
+        case 19: // "irq_frags"
+            if( value != NULL ) {
+                numvalue = strtol( value, NULL, 0 );
+                if( numvalue >= 1 && numvalue <= AUDIO_DMAC_DESC_MAX ) {
+                    rcar->irq_frags = numvalue;
+                }
+                ado_debug( DB_LVL_DRIVER, "%s: irq_frags %d", __func__, rcar->irq_frags );
+            }
+            break;
+        case 20: // "dvc_ramp"
+            if( value != NULL ) {
+                numvalue = strtol( value, NULL, 0 );
+                if( numvalue >= 0 && numvalue <= SCU_DVC_RAMP_MAX ) {
+                    rcar->dvc_ramp = numvalue;
+                } else {
+                    ado_error( "%s: Invalid dvc_ramp %d", __func__, numvalue );
+                }
+                ado_debug( DB_LVL_DRIVER, "%s: dvc_ramp %d", __func__, rcar->dvc_ramp );
+            }
+            break;
+        case 21: // "mix"
+            if( value != NULL ) {
+                numvalue = strtol( value, NULL, 0 );
+                if( numvalue >= 2 && numvalue <= PLAYBACK_SUBCHN_MAX ) {
+                    rcar->playback_subchns = numvalue;
+                } else {
+                    ado_error( "%s: Invalid mix %d, 2 to %d subchannels", __func__, numvalue, PLAYBACK_SUBCHN_MAX );
+                    return EINVAL;
+                }
+                ado_debug( DB_LVL_DRIVER, "%s: %d playback subchannels", __func__, rcar->playback_subchns );
+            }
+            break;
         }
     }
 
+    for( i = 0; i < PLAYBACK_SUBCHN_MAX - 1; i++ ) {
+        rcar->mix[i].ssi_chan = SSI_CHANNEL_NUM;
+        rcar->mix[i].src_chan = SCU_SRC_CHANNEL_NUM;
+        rcar->mix[i].cmd_chan = SCU_CMD_CHANNEL_NUM;
+    }
+
     use_tx = ( rcar->playback.ssi_chan != SSI_CHANNEL_NUM ? 1 : 0 );
     use_rx = ( rcar->capture.ssi_chan != SSI_CHANNEL_NUM ? 1 : 0 );
 
@@ -1189,6 +1488,12 @@ static int rcar_parse_commandline (rcar_context_t * rcar, char *args)
         return EINVAL;
     }
 
+    /* the playback subchannels are mixed by the SCU in front of the transmit SSI */
+    if( rcar->playback_subchns > 1 && ( !use_tx || !rcar->use_scu ) ) {
+        ado_error( "%s: mix requires the SCU and a transmit SSI", __func__ );
+        return EINVAL;
+    }
+
     ret = EOK;
 
     /* the only reason to configure a transmit and receive SSI in the same driver
@@ -1342,6 +1647,7 @@ static int rcar_parse_commandline (rcar_context_t * rcar, char *args)
 static void rcar_register_dump( HW_CONTEXT_T * rcar )
 {
     uint32_t use_tx = 0, use_rx = 0;
+    uint32_t i;
 
     ado_debug (DB_LVL_DRIVER, "rcar : %s", __func__);
 
@@ -1370,6 +1676,12 @@ static void rcar_register_dump( HW_CONTEXT_T * rcar )
         if( use_tx ) {
             scu_src_register_dump( rcar->playback.src_chan );
             scu_cmd_register_dump( rcar->playback.cmd_chan );
+            if( rcar->playback_subchns > 1 ) {
+                for( i = 0; i + 1 < rcar->playback_subchns; i++ ) {
+                    scu_src_register_dump( rcar->mix[i].src_chan );
+                }
+                scu_mix_register_dump( rcar->playback.cmd_chan );
+            }
             scu_dvc_register_dump( rcar->playback.cmd_chan );
         }
         if( use_rx ) {
@@ -1386,6 +1698,7 @@ static int rcar_init_cleanup( HW_CONTEXT_T * rcar )
 {
     uint32_t use_tx = rcar->playback.ssi_chan == SSI_CHANNEL_NUM ? 0 : 1;
     uint32_t use_rx = rcar->capture.ssi_chan == SSI_CHANNEL_NUM ? 0 : 1;
+    uint32_t i;
 
     ado_debug (DB_LVL_DRIVER, "rcar : %s", __func__);
 
@@ -1440,6 +1753,18 @@ static int rcar_init_cleanup( HW_CONTEXT_T * rcar )
             scu_src_cleanup(rcar->playback.src_chan);
             scu_dvc_cleanup(rcar->playback.cmd_chan);
 
+            for( i = 0; i + 1 < rcar->playback_subchns; i++ ) {
+                if( rcar->mix[i].src_chan != SCU_SRC_CHANNEL_NUM ) {
+                    scu_src_stop(rcar->mix[i].src_chan);
+                    scu_src_cleanup(rcar->mix[i].src_chan);
+                    rcar_release_src( rcar->mix[i].src_chan );
+                    rcar->mix[i].src_chan = SCU_SRC_CHANNEL_NUM;
+                }
+            }
+            if( rcar->playback_subchns > 1 ) {
+                scu_mix_cleanup(rcar->playback.cmd_chan);
+            }
+
             rcar_release_src( rcar->playback.src_chan );
             rcar_release_cmd( rcar->playback.cmd_chan );
             rcar->playback.src_chan = SCU_SRC_CHANNEL_NUM;
@@ -1458,6 +1783,44 @@ static int rcar_init_cleanup( HW_CONTEXT_T * rcar )
     return EOK;
 }
 
+/*
+ * Reserve an inline SRC for each playback subchannel such that every SRC reaches
+ * a different input of the MIX in the CTU-MIX path of the CMD.
+ */
+static int rcar_reserve_mix_src( rcar_context_t * rcar )
+{
+    rcar_audio_channel_t *chn;
+    uint32_t i, src, input = 0, inputs = 0;
+
+    for( i = 0; i < rcar->playback_subchns; i++ ) {
+        chn = rcar_playback_chn( rcar, i );
+
+        for( src = 0; src < SCU_SRC_CHANNEL_NUM; src++ ) {
+            if( scu_mix_input( src, &input ) != EOK || ( inputs & ( 1 << input ) ) ) {
+                continue;
+            }
+            if( rcar->voices > 2 && !rcar_src_multichan_supported( src ) ) {
+                continue;
+            }
+            if( rcar_reserve_src_channel( src ) == EOK ) {
+                break;
+            }
+        }
+        if( src == SCU_SRC_CHANNEL_NUM ) {
+            ado_error( "%s: no SRC left for MIX subchannel %d", __func__, i );
+            return EAGAIN;
+        }
+
+        ado_debug( DB_LVL_DRIVER, "%s: playback subchannel %d uses SRC %d on MIX input %d",
+                   __func__, i, src, input );
+        chn->src_chan = src;
+        chn->mix_input = input;
+        inputs |= ( 1 << input );
+    }
+
+    return EOK;
+}
+
 int rcar_init( HW_CONTEXT_T * hw )
 {
     int status = EOK;
@@ -1505,7 +1868,14 @@ int rcar_init( HW_CONTEXT_T * hw )
         }
     }
     if (rcar->use_scu) {
-        if( use_tx ) {
+        if( use_tx && rcar->playback_subchns > 1 ) {
+            if( rcar_reserve_mix_src( rcar ) != EOK ||
+                rcar_reserve_cmd( &rcar->playback.cmd_chan ) != EOK ) {
+                ado_error("%s: failed reserving playback SRCs", __func__);
+                rcar_init_cleanup( rcar );
+                return EAGAIN;
+            }
+        } else if( use_tx ) {
             if( rcar_reserve_src( rcar->voices > 2 ? 1 : 0, 0, 1,
                                   &rcar->playback.src_chan ) != EOK ||
                 rcar_reserve_cmd( &rcar->playback.cmd_chan ) != EOK ) {
@@ -1579,7 +1949,10 @@ int rcar_init( HW_CONTEXT_T * hw )
         if( use_tx ) {
             /* Initialize the DVC volume variables to 0dB = 0x100000 for all channels */
             for( i = 0; i < sizeof(rcar->playback.dvc_volume)/sizeof(rcar->playback.dvc_volume[0]); i++ ) {
-                rcar->playback.dvc_volume[i] = 0x100000;
+                rcar->playback.dvc_volume[i] = SCU_DVC_VOL_0DB;
+            }
+            for( i = 0; i < PLAYBACK_SUBCHN_MAX; i++ ) {
+                rcar->mix_volume[i] = SCU_MIX_VOL_0DB;
             }
 
             /* Setup syncronous SRC0 */
@@ -1590,12 +1963,43 @@ int rcar_init( HW_CONTEXT_T * hw )
                                     rcar->voices,
                                     rcar->sample_rate_max,
                                     SAMPLE_RATE_SRC );
-            /* use SRC0 -> CMD0 */
-            if( status == EOK ) {
+            /* further subchannels, all converting to SAMPLE_RATE_SRC for the MIX */
+            for( i = 0; i + 1 < rcar->playback_subchns && status == EOK; i++ ) {
+                status = scu_src_setup( rcar->mix[i].src_chan,
+                                        1,
+                                        0,
+                                        rcar->sample_size,
+                                        rcar->voices,
+                                        rcar->sample_rate_max,
+                                        SAMPLE_RATE_SRC );
+            }
+            if( status == EOK && rcar->playback_subchns > 1 ) {
+                /* use SRCs -> CTU -> MIX -> DVC0 */
+                uint32_t src_mask = 0, input_mask = 0;
+
+                for( i = 0; i < rcar->playback_subchns; i++ ) {
+                    src_mask |= ( 1 << rcar_playback_chn( rcar, i )->src_chan );
+                    input_mask |= ( 1 << rcar_playback_chn( rcar, i )->mix_input );
+                }
+                status = scu_cmd_mix_setup( rcar->playback.cmd_chan, src_mask );
+                if( status == EOK ) {
+                    status = scu_mix_setup( rcar->playback.cmd_chan,
+                                            rcar->voices,
+                                            input_mask,
+                                            rcar->mix_volume );
+                }
+            } else if( status == EOK ) {
+                /* use SRC0 -> CMD0 */
                 status = scu_cmd_setup( rcar->playback.cmd_chan,
                                         rcar->playback.src_chan );
             }
 
+            /* volume ramp of DVC0, used for every later DVC set-up */
+            if( status == EOK && rcar->dvc_ramp >= 0 ) {
+                status = scu_dvc_set_ramp( rcar->playback.cmd_chan, 1,
+                                           rcar->dvc_ramp, rcar->dvc_ramp );
+            }
+
             /* setup DVC0 */
             if( status == EOK ) {
                 status = scu_dvc_setup( rcar->playback.cmd_chan,
@@ -1647,6 +2051,7 @@ static int rcar_set_clock_rate( rcar_context_t * rcar )
     uint32_t ssi_sample_rate;
 
     uint32_t adg_clk = AUDIO_CLKA;
+    uint32_t i;
 
     ado_debug( DB_LVL_DRIVER, "rcar : %s : sample_rate=%d, sample_rate_max=%d", __func__,
                rcar->sample_rate, rcar->sample_rate_max );
@@ -1824,31 +2229,12 @@ static int rcar_set_clock_rate( rcar_context_t * rcar )
 
     if( rcar->use_scu ) {
         if( rcar->playback.ssi_chan != SSI_CHANNEL_NUM ) {
-            /* Re-setup SRC */
-            ret = scu_src_setup( rcar->playback.src_chan,
-                                 1,
-                                 0,
-                                 rcar->sample_size,
-                                 rcar->voices,
-                                 sample_rate,
-                                 ssi_sample_rate );
-            /* Re-setup DVC  */
-            if( ret == EOK ) {
-                scu_dvc_setup( rcar->playback.cmd_chan,
-                               rcar->sample_size,
-                               rcar->voices,
-                               rcar->playback.dvc_volume );
+            for( i = 0; i < rcar->playback_subchns && ret == EOK; i++ ) {
+                ret = rcar_scu_set_rate( rcar, rcar_playback_chn( rcar, i ) );
             }
         }
         if( rcar->capture.ssi_chan != SSI_CHANNEL_NUM ) {
-            /* Re-configure scu-src with new sample rate */
-            ret = scu_src_setup( rcar->capture.src_chan,
-                                 0,
-                                 1,
-                                 rcar->sample_size,
-                                 rcar->voices,
-                                 ssi_sample_rate,
-                                 sample_rate );
+            ret = rcar_scu_set_rate( rcar, &rcar->capture );
         }
 
         if( ret != EOK) {
@@ -1859,6 +2245,50 @@ static int rcar_set_clock_rate( rcar_context_t * rcar )
     return EOK;
 }
 
+/*
+ * (Re-)configure the SRC of one direction, or of one of the mixed playback
+ * subchannels, for the rate of its stream, converting
+ * to or from SAMPLE_RATE_SRC at the SSI; the rates of the two directions are
+ * independent. Without an acquired stream the SRC is set for the maximum rate.
+ */
+static int rcar_scu_set_rate( rcar_context_t * rcar, rcar_audio_channel_t * chn )
+{
+    int ret;
+    uint32_t sample_rate = chn->sample_rate ? chn->sample_rate : rcar->sample_rate_max;
+
+    ado_debug( DB_LVL_DRIVER, "rcar : %s : %s rate %d", __func__,
+               chn == &rcar->capture ? "capture" : "playback", sample_rate );
+
+    if( chn != &rcar->capture ) {
+        /* Re-setup SRC */
+        ret = scu_src_setup( chn->src_chan,
+                             1,
+                             0,
+                             rcar->sample_size,
+                             rcar->voices,
+                             sample_rate,
+                             SAMPLE_RATE_SRC );
+        /* Re-setup DVC, unless it is shared with the other mixed subchannels */
+        if( ret == EOK && rcar->playback_subchns == 1 ) {
+            ret = scu_dvc_setup( rcar->playback.cmd_chan,
+                                 rcar->sample_size,
+                                 rcar->voices,
+                                 rcar->playback.dvc_volume );
+        }
+    } else {
+        /* Re-configure scu-src with new sample rate */
+        ret = scu_src_setup( rcar->capture.src_chan,
+                             0,
+                             1,
+                             rcar->sample_size,
+                             rcar->voices,
+                             SAMPLE_RATE_SRC,
+                             sample_rate );
+    }
+
+    return ret;
+}
+
 ado_dll_version_t ctrl_version;
 void ctrl_version (int *major, int *minor, char *date)
 {
@@ -1869,13 +2299,19 @@ void ctrl_version (int *major, int *minor, char *date)
 
 static void ctrl_init_cleanup(rcar_context_t * rcar)
 {
+    uint32_t i;
+
     ado_debug (DB_LVL_DRIVER, "rcar : %s", __func__);
 
+    ado_mutex_destroy (&rcar->ssi_lock);
     ado_mutex_destroy (&rcar->hw_lock);
 
     ssiu_deinit();
     scu_deinit();
     adg_deinit();
+    for( i = 0; i + 1 < rcar->playback_subchns; i++ ) {
+        audio_dmac_mp_deinit(&rcar->mix[i].dma_context);
+    }
     audio_dmac_deinit(&rcar->playback.dma_context, &rcar->capture.dma_context);
 
     ado_free (rcar);
@@ -1891,6 +2327,7 @@ int ctrl_init (HW_CONTEXT_T ** hw_context, ado_card_t * card, char *args)
 {
     rcar_context_t *rcar;
     int status;
+    uint32_t i;
 
     ado_debug (DB_LVL_DRIVER, "rcar : CTRL_DLL_INIT");
 
@@ -1938,7 +2375,9 @@ int ctrl_init (HW_CONTEXT_T ** hw_context, ado_card_t * card, char *args)
         return status;
     }
 
-    /* Map DMAC */
+    /* Map DMAC, reserving a descriptor per fragment */
+    rcar->playback.dma_context.desc_num = rcar->dma_frags;
+    rcar->capture.dma_context.desc_num = rcar->dma_frags;
     if ((status = audio_dmac_init(&rcar->playback.dma_context, &rcar->capture.dma_context)) != EOK) {
         ado_error ("rcar %s: Audio DMAC init failed (%s)", __func__, strerror (errno));
         ssiu_deinit();
@@ -1949,7 +2388,26 @@ int ctrl_init (HW_CONTEXT_T ** hw_context, ado_card_t * card, char *args)
         return status;
     }
 
+    /* the further playback subchannels only have their memory to SRC transfer */
+    for( i = 0; i + 1 < rcar->playback_subchns; i++ ) {
+        rcar->mix[i].dma_context.desc_num = rcar->dma_frags;
+        if ((status = audio_dmac_mp_init(&rcar->mix[i].dma_context)) != EOK) {
+            ado_error ("rcar %s: Audio DMAC init failed for playback subchannel %d", __func__, i + 1);
+            while( i-- > 0 ) {
+                audio_dmac_mp_deinit(&rcar->mix[i].dma_context);
+            }
+            audio_dmac_deinit(&rcar->playback.dma_context, &rcar->capture.dma_context);
+            ssiu_deinit();
+            scu_deinit();
+            adg_deinit();
+            ado_free (rcar);
+            rcar = NULL;
+            return status;
+        }
+    }
+
     ado_mutex_init (&rcar->hw_lock);
+    ado_mutex_init (&rcar->ssi_lock);
 
     if( (status = rcar_init(rcar)) != EOK ) {
         ado_error ("rcar %s: RCAR hw init failed", __func__);
@@ -1967,6 +2425,14 @@ int ctrl_init (HW_CONTEXT_T ** hw_context, ado_card_t * card, char *args)
         return status;
     }
 
+    for( i = 0; i + 1 < rcar->playback_subchns; i++ ) {
+        if ((status = ado_attach_interrupt (card, rcar->mix[i].dma_context.audiodma_irq, rcar_mix_interrupt, rcar)) != EOK) {
+            ado_error ("rcar %s: Unable to attach interrupt (%s)", __func__, strerror (errno));
+            ctrl_init_cleanup(rcar);
+            return status;
+        }
+    }
+
     rcar->playback.pcm_caps.chn_flags = SND_PCM_CHNINFO_BLOCK | SND_PCM_CHNINFO_STREAM |
         SND_PCM_CHNINFO_INTERLEAVE | SND_PCM_CHNINFO_BLOCK_TRANSFER |
         SND_PCM_CHNINFO_MMAP | SND_PCM_CHNINFO_MMAP_VALID;
@@ -1990,7 +2456,7 @@ int ctrl_init (HW_CONTEXT_T ** hw_context, ado_card_t * card, char *args)
     rcar->playback.pcm_caps.max_voices = rcar->voices;
     rcar->playback.pcm_caps.min_fragsize = 64;
     rcar->playback.pcm_caps.max_fragsize = 64 * 1024;
-    rcar->playback.pcm_caps.max_frags = 2;
+    rcar->playback.pcm_caps.max_frags = rcar->dma_frags;
 
     /* Set capabilities of recording */
     memcpy (&rcar->capture.pcm_caps, &rcar->playback.pcm_caps,
@@ -2029,9 +2495,16 @@ int ctrl_init (HW_CONTEXT_T ** hw_context, ado_card_t * card, char *args)
         return status;
     }
 
+    if( (status = rcar_prof_mixer_init(rcar)) != EOK ) {
+        ado_error ("rcar %s: Unable to create the profiler switches", __func__);
+        ctrl_init_cleanup(rcar);
+        return status;
+    }
+
     /* Create a PCM audio device */
+    /* all playback subchannels share the capabilities and functions of the first one */
     if( (status = ado_pcm_create (card, "R-Car SSI", 0, "rcar",
-            1, &rcar->playback.pcm_caps, &rcar->playback.pcm_funcs,
+            rcar->playback_subchns, &rcar->playback.pcm_caps, &rcar->playback.pcm_funcs,
             1, &rcar->capture.pcm_caps, &rcar->capture.pcm_funcs, rcar->mixer, &rcar->pcm)) != EOK ) {
         ado_error ("rcar %s: Unable to create pcm devices (%s)", __func__, strerror (errno));
         ctrl_init_cleanup(rcar);
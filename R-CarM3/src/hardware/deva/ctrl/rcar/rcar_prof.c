@@ -0,0 +1,447 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2016, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/neutrino.h>
+#include <sys/syspage.h>
+
+#include "rcar.h"
+#include "rcar_prof.h"
+
+static uint64_t rcar_prof_cycles_per_sec;
+
+static const char *rcar_prof_stat_names[RCAR_PROF_STAT_NUM] = {
+    "Periods",
+    "Late Interrupts",
+    "DMA Stalls",
+    "Ring Wraps",
+    "IRQ Latency Max",
+    "IRQ Latency Avg",
+    "Wakeup Jitter Max",
+    "Position Jitter Max"
+};
+
+static const char *rcar_prof_event_names[RCAR_PROF_EVENT_NUM] = {
+    "period",
+    "late",
+    "stall"
+};
+
+static const char *rcar_prof_cause_names[RCAR_PROF_CAUSE_NUM] = {
+    "none",
+    "irq-late",
+    "dma-stall",
+    "ring-wrap"
+};
+
+static const char *rcar_prof_field_names[RCAR_PROF_FIELD_NUM] = {
+    "Time",
+    "Event",
+    "Cause",
+    "Frags",
+    "Position",
+    "Latency",
+    "Jitter"
+};
+
+static uint32_t rcar_prof_cycles_to_us( uint64_t cycles )
+{
+    if( rcar_prof_cycles_per_sec == 0 ) {
+        rcar_prof_cycles_per_sec = SYSPAGE_ENTRY(qtime)->cycles_per_sec;
+    }
+
+    return (uint32_t)( cycles * 1000000 / rcar_prof_cycles_per_sec );
+}
+
+/* absolute timestamps, cycles * 1000000 would overflow */
+static uint32_t rcar_prof_time_to_us( uint64_t cycles )
+{
+    if( rcar_prof_cycles_per_sec == 0 ) {
+        rcar_prof_cycles_per_sec = SYSPAGE_ENTRY(qtime)->cycles_per_sec;
+    }
+
+    return (uint32_t)( cycles / rcar_prof_cycles_per_sec * 1000000 +
+                       cycles % rcar_prof_cycles_per_sec * 1000000 / rcar_prof_cycles_per_sec );
+}
+
+static uint32_t rcar_prof_bytes_to_us( rcar_prof_t *prof, uint32_t bytes )
+{
+    return (uint32_t)( (uint64_t)bytes * 1000000 / prof->byte_rate );
+}
+
+/* called when the DMA of the channel starts, the statistics and the ring are kept */
+void rcar_prof_start( rcar_prof_t *prof, uint32_t byte_rate, uint32_t buf_size, uint32_t irq_bytes )
+{
+    prof->buf_size = buf_size;
+    prof->irq_bytes = irq_bytes;
+    prof->last_pos = 0;
+    prof->last_irq = ClockCycles();
+    prof->byte_rate = byte_rate;
+}
+
+void rcar_prof_stop( rcar_prof_t *prof )
+{
+    prof->byte_rate = 0;
+}
+
+/*
+ * Record one DMA interrupt: frags fragments were signalled, the DMA moved progress
+ * bytes since the previous interrupt and is pending bytes past the end of the last
+ * fragment signalled. Only the interrupt handler of the channel calls this.
+ */
+void rcar_prof_irq( rcar_prof_t *prof, uint64_t timestamp, uint32_t frags, uint32_t progress,
+                    uint32_t pending, uint32_t position )
+{
+    rcar_prof_record_t *rec;
+    uint32_t *stats = prof->stats;
+    uint32_t latency = 0;
+    uint32_t elapsed = 0;
+    int32_t jitter = 0;
+    uint32_t event, cause;
+
+    if( progress == 0 ) {
+        event = RCAR_PROF_EVENT_STALL;
+        stats[RCAR_PROF_STAT_STALLS]++;
+    } else if( frags > 1 ) {
+        event = RCAR_PROF_EVENT_LATE;
+        stats[RCAR_PROF_STAT_LATE]++;
+    } else {
+        event = RCAR_PROF_EVENT_PERIOD;
+    }
+    stats[RCAR_PROF_STAT_PERIODS] += frags;
+
+    if( prof->byte_rate ) {
+        latency = rcar_prof_bytes_to_us( prof, pending );
+        elapsed = rcar_prof_cycles_to_us( timestamp - prof->last_irq );
+        jitter = (int32_t)elapsed - (int32_t)rcar_prof_bytes_to_us( prof, prof->irq_bytes );
+
+        if( latency > stats[RCAR_PROF_STAT_IRQ_LATENCY_MAX] ) {
+            stats[RCAR_PROF_STAT_IRQ_LATENCY_MAX] = latency;
+        }
+        stats[RCAR_PROF_STAT_IRQ_LATENCY_AVG] += ( (int32_t)latency -
+                                                   (int32_t)stats[RCAR_PROF_STAT_IRQ_LATENCY_AVG] ) / 16;
+        if( (uint32_t)( jitter < 0 ? -jitter : jitter ) > stats[RCAR_PROF_STAT_WAKEUP_JITTER_MAX] ) {
+            stats[RCAR_PROF_STAT_WAKEUP_JITTER_MAX] = jitter < 0 ? -jitter : jitter;
+        }
+    }
+
+    /* the position only tells fragments modulo the ring, the elapsed time tells a wrap */
+    if( prof->byte_rate && prof->buf_size &&
+        (uint64_t)elapsed * prof->byte_rate / 1000000 >= prof->buf_size ) {
+        cause = RCAR_PROF_CAUSE_RING_WRAP;
+        stats[RCAR_PROF_STAT_WRAPS]++;
+    } else if( progress == 0 ) {
+        cause = RCAR_PROF_CAUSE_DMA_STALL;
+    } else if( frags > 1 ) {
+        cause = RCAR_PROF_CAUSE_IRQ_LATE;
+    } else {
+        cause = RCAR_PROF_CAUSE_NONE;
+    }
+
+    rec = &prof->ring[prof->head & ( RCAR_PROF_RING_SIZE - 1 )];
+    rec->seq = 0;
+    __sync_synchronize();
+    rec->timestamp = timestamp;
+    rec->event = event;
+    rec->cause = cause;
+    rec->frags = frags;
+    rec->position = position;
+    rec->irq_latency = latency;
+    rec->wakeup_jitter = jitter;
+    __sync_synchronize();
+    rec->seq = prof->head + 1;
+
+    /* publish the record before the head moves past it */
+    __sync_synchronize();
+    prof->last_irq = timestamp;
+    prof->last_pos = position;
+    prof->head++;
+}
+
+/*
+ * Compare a position reported to io-audio with the one extrapolated from the last
+ * interrupt at the nominal byte rate, keeping the largest deviation in bytes.
+ */
+void rcar_prof_position( rcar_prof_t *prof, uint32_t position )
+{
+    uint32_t head, last_pos, expected, diff;
+    uint64_t last_irq;
+
+    if( prof->byte_rate == 0 || prof->buf_size == 0 ) {
+        return;
+    }
+
+    /* the handler may update the reference meanwhile, retry on a changed head */
+    do {
+        head = prof->head;
+        __sync_synchronize();
+        last_irq = prof->last_irq;
+        last_pos = prof->last_pos;
+        __sync_synchronize();
+    } while( head != prof->head );
+
+    expected = (uint32_t)( ( last_pos + (uint64_t)rcar_prof_cycles_to_us( ClockCycles() - last_irq ) *
+                           prof->byte_rate / 1000000 ) % prof->buf_size );
+    diff = ( position + prof->buf_size - expected ) % prof->buf_size;
+    if( diff > prof->buf_size / 2 ) {
+        diff = prof->buf_size - diff;
+    }
+
+    if( diff > prof->stats[RCAR_PROF_STAT_POS_JITTER_MAX] ) {
+        prof->stats[RCAR_PROF_STAT_POS_JITTER_MAX] = diff;
+    }
+}
+
+void rcar_prof_reset( rcar_prof_t *prof )
+{
+    memset( prof->stats, 0, sizeof(prof->stats) );
+}
+
+/*
+ * Copy up to num of the latest records, oldest first, without stopping the writer.
+ * A record is intact if it carries its own sequence number before and after the
+ * copy; the records up to the last one the handler touched during the copy are
+ * dropped. Returns the number of records copied.
+ */
+uint32_t rcar_prof_read( rcar_prof_t *prof, rcar_prof_record_t *records, uint32_t num )
+{
+    volatile rcar_prof_record_t *rec;
+    uint32_t head, count, skip, seq, i;
+
+    head = prof->head;
+    __sync_synchronize();
+
+    count = num < RCAR_PROF_RING_SIZE ? num : RCAR_PROF_RING_SIZE;
+    if( count > head ) {
+        count = head;
+    }
+
+    skip = 0;
+    for( i = 0; i < count; i++ ) {
+        rec = &prof->ring[( head - count + i ) & ( RCAR_PROF_RING_SIZE - 1 )];
+        seq = rec->seq;
+        __sync_synchronize();
+        records[i] = *(rcar_prof_record_t *)rec;
+        __sync_synchronize();
+        if( seq != head - count + i + 1 || rec->seq != seq ) {
+            skip = i + 1;
+        }
+    }
+
+    if( skip ) {
+        memmove( records, records + skip, ( count - skip ) * sizeof(records[0]) );
+        count -= skip;
+    }
+
+    return count;
+}
+
+/* copy the record 'age' interrupts old for the record field switches */
+static void rcar_prof_select( rcar_prof_t *prof, uint32_t age )
+{
+    rcar_prof_record_t records[RCAR_PROF_RING_SIZE];
+
+    if( age >= RCAR_PROF_RING_SIZE ) {
+        age = RCAR_PROF_RING_SIZE - 1;
+    }
+    prof->select = age;
+
+    if( rcar_prof_read( prof, records, age + 1 ) == age + 1 ) {
+        prof->selected = records[0];
+    } else {
+        memset( &prof->selected, 0, sizeof(prof->selected) );
+    }
+}
+
+static uint32_t rcar_prof_field( rcar_prof_t *prof, uint32_t field )
+{
+    rcar_prof_record_t *rec = &prof->selected;
+
+    if( rec->seq == 0 ) {
+        return 0;
+    }
+
+    switch( field ) {
+        case RCAR_PROF_FIELD_TIME:
+            return rcar_prof_time_to_us( rec->timestamp );
+        case RCAR_PROF_FIELD_EVENT:
+            return rec->event;
+        case RCAR_PROF_FIELD_CAUSE:
+            return rec->cause;
+        case RCAR_PROF_FIELD_FRAGS:
+            return rec->frags;
+        case RCAR_PROF_FIELD_POSITION:
+            return rec->position;
+        case RCAR_PROF_FIELD_LATENCY:
+            return rec->irq_latency;
+        case RCAR_PROF_FIELD_JITTER:
+            return (uint32_t)rec->wakeup_jitter;
+        default:
+            return 0;
+    }
+}
+
+void rcar_prof_dump( rcar_prof_t *prof, const char *name )
+{
+    rcar_prof_record_t records[RCAR_PROF_RING_SIZE];
+    uint32_t count, i;
+
+    count = rcar_prof_read( prof, records, RCAR_PROF_RING_SIZE );
+
+    ado_debug( DB_LVL_DRIVER, "%s profile: periods=%u late=%u stalls=%u wraps=%u", name,
+               prof->stats[RCAR_PROF_STAT_PERIODS], prof->stats[RCAR_PROF_STAT_LATE],
+               prof->stats[RCAR_PROF_STAT_STALLS], prof->stats[RCAR_PROF_STAT_WRAPS] );
+    ado_debug( DB_LVL_DRIVER, "%s profile: irq latency max=%uus avg=%uus, wakeup jitter max=%uus, position jitter max=%u",
+               name, prof->stats[RCAR_PROF_STAT_IRQ_LATENCY_MAX], prof->stats[RCAR_PROF_STAT_IRQ_LATENCY_AVG],
+               prof->stats[RCAR_PROF_STAT_WAKEUP_JITTER_MAX], prof->stats[RCAR_PROF_STAT_POS_JITTER_MAX] );
+
+    for( i = 0; i < count; i++ ) {
+        ado_debug( DB_LVL_DRIVER, "%s profile: %llu %s cause=%s frags=%u pos=%u latency=%uus jitter=%dus", name,
+                   (unsigned long long)records[i].timestamp, rcar_prof_event_names[records[i].event],
+                   rcar_prof_cause_names[records[i].cause], records[i].frags, records[i].position, records[i].irq_latency, records[i].wakeup_jitter );
+    }
+}
+
+static int32_t
+rcar_prof_stat_get( void *hw_ctx, ado_dswitch_t *dswitch, snd_switch_t *cswitch, void *instance_data )
+{
+    rcar_prof_switch_t *sw = instance_data;
+
+    cswitch->type = SND_SW_TYPE_DWORD;
+    cswitch->value.dword.low = 0;
+    cswitch->value.dword.high = 0xFFFFFFFF;
+    if( sw->stat < RCAR_PROF_STAT_NUM ) {
+        cswitch->value.dword.data = sw->prof->stats[sw->stat];
+    } else if( sw->stat == RCAR_PROF_SW_SELECT ) {
+        cswitch->value.dword.high = RCAR_PROF_RING_SIZE - 1;
+        cswitch->value.dword.data = sw->prof->select;
+    } else {
+        cswitch->value.dword.data = rcar_prof_field( sw->prof, sw->stat - RCAR_PROF_SW_FIELD );
+    }
+
+    return 0;
+}
+
+static int32_t
+rcar_prof_stat_set( void *hw_ctx, ado_dswitch_t *dswitch, snd_switch_t *cswitch, void *instance_data )
+{
+    rcar_prof_switch_t *sw = instance_data;
+
+    /* the statistics and the record fields are read only */
+    if( sw->stat == RCAR_PROF_SW_SELECT ) {
+        rcar_prof_select( sw->prof, cswitch->value.dword.data );
+    }
+
+    return EOK;
+}
+
+static int32_t
+rcar_prof_action_get( void *hw_ctx, ado_dswitch_t *dswitch, snd_switch_t *cswitch, void *instance_data )
+{
+    /* Always return disabled as this switch does not maintain state */
+    cswitch->type = SND_SW_TYPE_BOOLEAN;
+    cswitch->value.enable = 0;
+
+    return 0;
+}
+
+static int32_t
+rcar_prof_action_set( void *hw_ctx, ado_dswitch_t *dswitch, snd_switch_t *cswitch, void *instance_data )
+{
+    rcar_prof_switch_t *sw = instance_data;
+
+    if( cswitch->value.enable ) {
+        if( sw->stat == RCAR_PROF_SW_RESET ) {
+            rcar_prof_reset( sw->prof );
+        } else {
+            rcar_prof_dump( sw->prof, sw->name );
+        }
+    }
+
+    return EOK;
+}
+
+static int rcar_prof_switches_create( ado_mixer_t *mixer, rcar_prof_t *prof, const char *dir )
+{
+    rcar_prof_switch_t *sw;
+    uint32_t i;
+
+    for( i = 0; i < RCAR_PROF_SW_NUM; i++ ) {
+        sw = &prof->switches[i];
+        sw->prof = prof;
+        sw->stat = i;
+
+        if( i == RCAR_PROF_SW_RESET || i == RCAR_PROF_SW_DUMP ) {
+            /* reset the statistics, dump the ring to the log */
+            snprintf( sw->name, sizeof(sw->name), "%s Profile %s", dir,
+                      i == RCAR_PROF_SW_RESET ? "Reset" : "Dump" );
+            if( ado_mixer_switch_new( mixer, sw->name, SND_SW_TYPE_BOOLEAN, 0,
+                                      (void *)rcar_prof_action_get, (void *)rcar_prof_action_set,
+                                      sw, NULL ) == NULL ) {
+                return ENOMEM;
+            }
+            continue;
+        }
+
+        if( i < RCAR_PROF_STAT_NUM ) {
+            snprintf( sw->name, sizeof(sw->name), "%s %s", dir, rcar_prof_stat_names[i] );
+        } else if( i == RCAR_PROF_SW_SELECT ) {
+            /* writing the age of a record copies it for the field switches below */
+            snprintf( sw->name, sizeof(sw->name), "%s Profile Select", dir );
+        } else {
+            snprintf( sw->name, sizeof(sw->name), "%s Profile %s", dir,
+                      rcar_prof_field_names[i - RCAR_PROF_SW_FIELD] );
+        }
+        if( ado_mixer_switch_new( mixer, sw->name, SND_SW_TYPE_DWORD, 0,
+                                  (void *)rcar_prof_stat_get, (void *)rcar_prof_stat_set,
+                                  sw, NULL ) == NULL ) {
+            return ENOMEM;
+        }
+    }
+
+    return EOK;
+}
+
+int rcar_prof_mixer_init( struct rcar_context *rcar )
+{
+    char dir[16];
+    uint32_t i;
+    int status = EOK;
+
+    /* one profiler per playback subchannel, each has its own DMA and interrupts */
+    for( i = 0; status == EOK && i < rcar->playback_subchns; i++ ) {
+        if( rcar->playback.ssi_chan == SSI_CHANNEL_NUM ) {
+            break;
+        }
+        if( i == 0 ) {
+            snprintf( dir, sizeof(dir), "Playback" );
+        } else {
+            snprintf( dir, sizeof(dir), "Playback %u", i + 1 );
+        }
+        status = rcar_prof_switches_create( rcar->mixer, &rcar_playback_chn( rcar, i )->prof, dir );
+    }
+    if( status == EOK && rcar->capture.ssi_chan != SSI_CHANNEL_NUM ) {
+        status = rcar_prof_switches_create( rcar->mixer, &rcar->capture.prof, "Capture" );
+    }
+
+    return status;
+}
@@ -0,0 +1,139 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2016, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#ifndef _R_Car_PROF_H
+#define _R_Car_PROF_H
+
+#include <stdint.h>
+
+/*
+ * Always-on profiler of the DMA interrupts of a PCM channel. Every interrupt adds
+ * a record to a ring written only by the interrupt handler of the channel, readers
+ * (mixer switches) copy it without locking and use the sequence number of each
+ * record to drop the ones overwritten meanwhile. Latencies are derived from the DMA position: the
+ * bytes transferred past the last fragment boundary when the handler runs tell how
+ * long after the end of the fragment the handler was woken up.
+ */
+
+#define RCAR_PROF_RING_SIZE     64      /* records kept per channel, power of two */
+
+typedef enum
+{
+    RCAR_PROF_EVENT_PERIOD,     /* one fragment completed, signalled to io-audio */
+    RCAR_PROF_EVENT_LATE,       /* several fragments completed since the last interrupt, io-audio was late */
+    RCAR_PROF_EVENT_STALL,      /* interrupt without DMA progress, the peripheral stopped requesting data */
+    RCAR_PROF_EVENT_NUM
+} rcar_prof_event_t;
+
+/* what an interrupt that did not signal exactly one fragment in time points at */
+typedef enum
+{
+    RCAR_PROF_CAUSE_NONE,       /* on time */
+    RCAR_PROF_CAUSE_IRQ_LATE,   /* interrupt or thread wakeup more than a fragment late */
+    RCAR_PROF_CAUSE_DMA_STALL,  /* the SSI/SRC stopped requesting data, underrun at the peripheral */
+    RCAR_PROF_CAUSE_RING_WRAP,  /* a whole ring elapsed since the last interrupt, fragments were lost */
+    RCAR_PROF_CAUSE_NUM
+} rcar_prof_cause_t;
+
+typedef struct
+{
+    uint32_t seq;               /* records written up to this one, 0 while the handler writes it */
+    uint32_t event;             /* rcar_prof_event_t */
+    uint64_t timestamp;         /* ClockCycles() when the handler ran */
+    uint32_t cause;             /* rcar_prof_cause_t */
+    uint32_t frags;             /* fragments signalled by this interrupt */
+    uint32_t position;          /* DMA position in the buffer */
+    uint32_t irq_latency;       /* us from the end of the last fragment to the handler */
+    int32_t  wakeup_jitter;     /* us the handler interval deviates from the nominal interval */
+} rcar_prof_record_t;
+
+typedef enum
+{
+    RCAR_PROF_STAT_PERIODS,             /* fragments signalled */
+    RCAR_PROF_STAT_LATE,                /* interrupts that signalled more than one fragment */
+    RCAR_PROF_STAT_STALLS,              /* interrupts without DMA progress */
+    RCAR_PROF_STAT_WRAPS,               /* interrupts more than a ring after the previous one */
+    RCAR_PROF_STAT_IRQ_LATENCY_MAX,     /* us */
+    RCAR_PROF_STAT_IRQ_LATENCY_AVG,     /* us, running average over 16 interrupts */
+    RCAR_PROF_STAT_WAKEUP_JITTER_MAX,   /* us */
+    RCAR_PROF_STAT_POS_JITTER_MAX,      /* bytes between a reported position and the one expected from the elapsed time */
+    RCAR_PROF_STAT_NUM
+} rcar_prof_stat_t;
+
+/* fields of the record selected with the "Profile Select" switch */
+typedef enum
+{
+    RCAR_PROF_FIELD_TIME,               /* us, low 32 bits */
+    RCAR_PROF_FIELD_EVENT,              /* rcar_prof_event_t */
+    RCAR_PROF_FIELD_CAUSE,              /* rcar_prof_cause_t */
+    RCAR_PROF_FIELD_FRAGS,
+    RCAR_PROF_FIELD_POSITION,           /* bytes */
+    RCAR_PROF_FIELD_LATENCY,            /* us */
+    RCAR_PROF_FIELD_JITTER,             /* us, two's complement */
+    RCAR_PROF_FIELD_NUM
+} rcar_prof_field_t;
+
+/* statistics, then the Reset, Dump and Select switches, then the record fields */
+#define RCAR_PROF_SW_RESET      RCAR_PROF_STAT_NUM
+#define RCAR_PROF_SW_DUMP       ( RCAR_PROF_STAT_NUM + 1 )
+#define RCAR_PROF_SW_SELECT     ( RCAR_PROF_STAT_NUM + 2 )
+#define RCAR_PROF_SW_FIELD      ( RCAR_PROF_STAT_NUM + 3 )
+#define RCAR_PROF_SW_NUM        ( RCAR_PROF_SW_FIELD + RCAR_PROF_FIELD_NUM )
+
+struct rcar_prof;
+struct rcar_context;
+
+/* instance data of the mixer switches of a profiler */
+typedef struct
+{
+    struct rcar_prof    *prof;
+    uint32_t            stat;   /* rcar_prof_stat_t, or RCAR_PROF_SW_* */
+    char                name[32];
+} rcar_prof_switch_t;
+
+typedef struct rcar_prof
+{
+    volatile uint32_t   head;   /* records written so far, the ring holds the last RCAR_PROF_RING_SIZE */
+    rcar_prof_record_t  ring[RCAR_PROF_RING_SIZE];
+    uint32_t            stats[RCAR_PROF_STAT_NUM];
+    rcar_prof_switch_t  switches[RCAR_PROF_SW_NUM];
+    uint32_t            select;     /* age of the selected record, 0 is the latest */
+    rcar_prof_record_t  selected;   /* copy of it, seq is 0 if there was no such record */
+    uint32_t            byte_rate;  /* bytes per second of the running stream, 0 if stopped */
+    uint32_t            buf_size;   /* bytes in the DMA ring */
+    uint32_t            irq_bytes;  /* nominal bytes between two interrupts */
+    uint64_t            last_irq;   /* ClockCycles() of the previous interrupt */
+    uint32_t            last_pos;   /* DMA position at the previous interrupt */
+} rcar_prof_t;
+
+void rcar_prof_start( rcar_prof_t *prof, uint32_t byte_rate, uint32_t buf_size, uint32_t irq_bytes );
+void rcar_prof_stop( rcar_prof_t *prof );
+void rcar_prof_irq( rcar_prof_t *prof, uint64_t timestamp, uint32_t frags, uint32_t progress,
+                    uint32_t pending, uint32_t position );
+void rcar_prof_position( rcar_prof_t *prof, uint32_t position );
+void rcar_prof_reset( rcar_prof_t *prof );
+uint32_t rcar_prof_read( rcar_prof_t *prof, rcar_prof_record_t *records, uint32_t num );
+void rcar_prof_dump( rcar_prof_t *prof, const char *name );
+
+/* mixer switches of the playback subchannel and capture profilers, created after the mixer */
+int rcar_prof_mixer_init( struct rcar_context *rcar );
+
+#endif /* _R_Car_PROF_H */
@@ -229,6 +229,28 @@ int rcar_reserve_src( uint32_t multichannel, uint32_t highsound, uint32_t is_inl
     return rsrc_ret;
 }
 
+/* reserve specified SRC channel */
+int rcar_reserve_src_channel( uint32_t src_channel )
+{
+    uint32_t min_rsrc_idx, max_rsrc_idx;
+    rsrc_request_t rsrc_req;
+
+    if( rcar_src_get_supported_range( &min_rsrc_idx, &max_rsrc_idx ) != EOK ) {
+        return ENOTSUP;
+    }
+    if( src_channel < min_rsrc_idx || src_channel > max_rsrc_idx ) {
+        return ENOTSUP;
+    }
+
+    rsrc_req.name = RCAR_SRC_RSRC_NAME;
+    rsrc_req.length = 1;
+    rsrc_req.flags = RSRCDBMGR_IO_PORT|RSRCDBMGR_FLAG_NAME|RSRCDBMGR_FLAG_RANGE;
+    rsrc_req.start = src_channel;
+    rsrc_req.end = src_channel;
+
+    return rsrcdbmgr_attach( &rsrc_req, 1 );
+}
+
 /* release specified SRC */
 int rcar_release_src( uint32_t src_channel )
 {
@@ -37,6 +37,9 @@ int rcar_release_ssi( uint32_t min_ssi_channel, uint32_t max_ssi_channel );
 /* reserve a sample rate convertor (SRC) with specified features */
 int rcar_reserve_src( uint32_t multichannel, uint32_t highsound, uint32_t is_inline, uint32_t* src_channel );
 
+/* reserve the specified sample rate convertor (SRC) channel */
+int rcar_reserve_src_channel( uint32_t src_channel );
+
 /* release specified sample rate convertor (SRC) */
 int rcar_release_src( uint32_t src_channel );
 
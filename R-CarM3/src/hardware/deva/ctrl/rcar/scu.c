@@ -47,9 +47,13 @@
 #define CMD_ROUTE_SELECT_CMDINCTU2_SRC0        0
 #define CMD_ROUTE_SELECT_CMDINCTU2_SRC1        0x1
 
-/* structure definitions for memory mapped SRC, CMD and DVC registers */
-/* CTU and MIX registers are not currently mapped, CTU/MIX path is
-   currently not supported - TBA */
+/*
+ * In the CTU-MIX path of a CMD the audio data 0,1,2,3 of the route above go through
+ * the CTUs x0,x1,x2,x3 into the MIX inputs A,B,C,D; the SRC feeding each input is
+ * fixed except for the CMDIN_CTU2/CMDIN_CTU3 selections.
+ */
+
+/* structure definitions for memory mapped SRC, CMD, CTU, MIX and DVC registers */
 typedef struct
 {
     volatile uint32_t in_busif_mode;
@@ -107,11 +111,47 @@ typedef struct
     volatile uint32_t dummy2[43];
 } scu_dvc_reg_t;
 
+typedef struct
+{
+    volatile uint32_t swrsr;
+    volatile uint32_t ctuir;
+    volatile uint32_t adinr;
+    volatile uint32_t dummy1;
+    volatile uint32_t cpmdr;
+    volatile uint32_t scmdr;
+    volatile uint32_t sv[4][8];
+    volatile uint32_t dummy2[26];
+} scu_ctu_reg_t;
+
+typedef struct
+{
+    volatile uint32_t swrsr;
+    volatile uint32_t mixir;
+    volatile uint32_t adinr;
+    volatile uint32_t dummy1;
+    volatile uint32_t mixmr;
+    volatile uint32_t mvpdr;
+    volatile uint32_t mdbr[SCU_MIX_INPUT_NUM];
+    volatile uint32_t mdber;
+    volatile uint32_t dummy2[5];
+} scu_mix_reg_t;
+
+
+/* volume ramp settings of each DVC, applied by scu_dvc_setup */
+typedef struct
+{
+    uint32_t enable;
+    uint32_t vrpdr;
+} scu_dvc_ramp_t;
+
+static scu_dvc_ramp_t dvc_ramp[SCU_CMD_CHANNEL_NUM];
 
 static scu_scusrc_reg_t *rcar_scusrc = MAP_FAILED;
 static scu_src_reg_t    *rcar_src = MAP_FAILED;
 static scu_cmd_reg_t    *rcar_cmd = MAP_FAILED;
 static scu_dvc_reg_t    *rcar_dvc = MAP_FAILED;
+static scu_ctu_reg_t    *rcar_ctu = MAP_FAILED;
+static scu_mix_reg_t    *rcar_mix = MAP_FAILED;
 
 int scu_init()
 {
@@ -121,6 +161,8 @@ int scu_init()
         rcar_src = MAP_FAILED;
         rcar_cmd = MAP_FAILED;
         rcar_dvc = MAP_FAILED;
+        rcar_ctu = MAP_FAILED;
+        rcar_mix = MAP_FAILED;
         return ENOMEM;
     }
 
@@ -130,6 +172,12 @@ int scu_init()
     /* SCU CMD registers */
     rcar_cmd = (scu_cmd_reg_t *)((uintptr_t)rcar_scusrc + 0x184);
 
+    /* SCU CTU registers */
+    rcar_ctu = (scu_ctu_reg_t *)((uintptr_t)rcar_scusrc + 0x500);
+
+    /* SCU MIX registers */
+    rcar_mix = (scu_mix_reg_t *)((uintptr_t)rcar_scusrc + 0xD00);
+
     /* SCU DVC registers */
     rcar_dvc = (scu_dvc_reg_t *)((uintptr_t)rcar_scusrc + 0xE00);
 
@@ -357,6 +405,170 @@ int scu_cmd_setup(uint32_t cmd_channel, uint32_t src_channel)
     return EOK;
 }
 
+/* CMD routing set-up through the CTU-MIX path for the SRCs in src_mask; the
+   CMDIN_CTU2/CMDIN_CTU3 selections follow the SRCs feeding MIX inputs C and D */
+int scu_cmd_mix_setup(uint32_t cmd_channel, uint32_t src_mask)
+{
+    uint32_t route = CMD_ROUTE_SELECT_CMDCASESEL_CTUMIXDVC;
+
+    if( !rcar_cmd_supported(cmd_channel) ) {
+        ado_error("scu_cmd_mix_setup: CMD %d is not supported", cmd_channel);
+        return EINVAL;
+    }
+    if( ( src_mask & (1 << 0) ) && ( src_mask & (1 << 1) ) ) {
+        ado_error("scu_cmd_mix_setup: SRC 0 and 1 share MIX input C");
+        return EINVAL;
+    }
+    if( ( src_mask & (1 << 2) ) && ( src_mask & (1 << 5) ) ) {
+        ado_error("scu_cmd_mix_setup: SRC 2 and 5 share MIX input D");
+        return EINVAL;
+    }
+    if (rcar_scusrc == MAP_FAILED ) {
+        ado_error("scu_cmd_mix_setup: SCU memory is not mapped");
+        return EFAULT;
+    }
+
+    if( src_mask & (1 << 1) ) {
+        route |= CMD_ROUTE_SELECT_CMDINCTU2_SRC1;
+    }
+    if( src_mask & (1 << 5) ) {
+        route |= CMD_ROUTE_SELECT_CMDINCTU3_SRC5;
+    }
+    rcar_cmd[cmd_channel].route_select = route;
+
+    return EOK;
+}
+
+/* MIX input (0-3 for A-D) reached by the given SRC in the CTU-MIX path */
+int scu_mix_input(uint32_t src_channel, uint32_t * mix_input)
+{
+    switch( src_channel ) {
+        case 3:
+            *mix_input = 0;
+            break;
+        case 4:
+            *mix_input = 1;
+            break;
+        case 0:
+        case 1:
+            *mix_input = 2;
+            break;
+        case 2:
+        case 5:
+            *mix_input = 3;
+            break;
+        default:
+            return ENOTSUP;
+    }
+
+    return EOK;
+}
+
+/* CTUs of the inputs in input_mask pass the data through unchanged, the MIX sums
+   the inputs with the attenuation given per input in vol[] (MIX_MDBxR values);
+   the inputs not in input_mask are muted */
+int scu_mix_setup
+(
+    uint32_t cmd_channel,
+    uint32_t voicenum,
+    uint32_t input_mask,
+    uint32_t *vol
+)
+{
+    uint32_t i, j, ctu;
+
+    if( !rcar_cmd_supported(cmd_channel) ) {
+        ado_error("scu_mix_setup: CMD %d is not supported", cmd_channel);
+        return EINVAL;
+    }
+    if (rcar_scusrc == MAP_FAILED ) {
+        ado_error("scu_mix_setup: SCU memory is not mapped");
+        return EFAULT;
+    }
+
+    for (i = 0; i < SCU_MIX_INPUT_NUM; i++) {
+        if( !( input_mask & (1 << i) ) ) {
+            continue;
+        }
+        ctu = cmd_channel * SCU_MIX_INPUT_NUM + i;
+
+        rcar_ctu[ctu].swrsr = 0;    // reset ctu
+        rcar_ctu[ctu].swrsr = 1;    // ctu operates
+        rcar_ctu[ctu].ctuir = 1;    // ctu initialization
+        rcar_ctu[ctu].adinr = voicenum & 0xF;   // channels number
+        rcar_ctu[ctu].cpmdr = 0;    // pass through, no channel conversion
+        rcar_ctu[ctu].scmdr = 0;
+        for (j = 0; j < 4 * 8; j++) {
+            rcar_ctu[ctu].sv[j / 8][j % 8] = 0;
+        }
+        rcar_ctu[ctu].ctuir = 0;
+    }
+
+    rcar_mix[cmd_channel].swrsr = 0;    // reset mix
+    rcar_mix[cmd_channel].swrsr = 1;    // mix operates
+    rcar_mix[cmd_channel].mixir = 1;    // mix initialization
+    rcar_mix[cmd_channel].adinr = voicenum & 0xF;   // channels number
+    rcar_mix[cmd_channel].mixmr = 0;    // no volume ramp
+    rcar_mix[cmd_channel].mvpdr = 0;
+    for (i = 0; i < SCU_MIX_INPUT_NUM; i++) {
+        rcar_mix[cmd_channel].mdbr[i] = ( input_mask & (1 << i) ) ? vol[i] : SCU_MIX_VOL_MUTE;
+    }
+    rcar_mix[cmd_channel].mixir = 0;
+    rcar_mix[cmd_channel].mdber = 1;    // use the volume values
+
+    return EOK;
+}
+
+int scu_mix_cleanup(uint32_t cmd_channel)
+{
+    uint32_t i, ctu;
+
+    if( !rcar_cmd_supported(cmd_channel) ) {
+        ado_error("scu_mix_cleanup: CMD %d is not supported", cmd_channel);
+        return EINVAL;
+    }
+    if (rcar_scusrc == MAP_FAILED ) {
+        ado_error("scu_mix_cleanup: SCU memory is not mapped");
+        return EFAULT;
+    }
+
+    rcar_mix[cmd_channel].mixir = 1;
+    rcar_mix[cmd_channel].adinr = 0;
+    rcar_mix[cmd_channel].mdber = 0;
+    rcar_mix[cmd_channel].swrsr = 0;
+
+    for (i = 0; i < SCU_MIX_INPUT_NUM; i++) {
+        ctu = cmd_channel * SCU_MIX_INPUT_NUM + i;
+        rcar_ctu[ctu].ctuir = 1;
+        rcar_ctu[ctu].adinr = 0;
+        rcar_ctu[ctu].swrsr = 0;
+    }
+
+    return EOK;
+}
+
+/*
+ * With the volume ramp function the DVC fades from the current level to the one
+ * given by VRDBR, which is common to all voices, so the per-voice registers are
+ * left at full scale and the level of the first voice drives the ramp.
+ */
+static void scu_dvc_vol_params( uint32_t cmd_channel, uint32_t *vol )
+{
+    uint32_t i;
+
+    if( dvc_ramp[cmd_channel].enable ) {
+        rcar_dvc[cmd_channel].vrpdr = dvc_ramp[cmd_channel].vrpdr;
+        rcar_dvc[cmd_channel].vrdbr = 0x3FF - ((vol[0] & SCU_DVC_VOL_MAX) >> 13);
+        for (i = 0; i < SCU_DVC_VOICE_NUM; i++) {
+            rcar_dvc[cmd_channel].vol[i] = SCU_DVC_VOL_MAX;
+        }
+    } else {
+        for (i = 0; i < SCU_DVC_VOICE_NUM; i++) {
+            rcar_dvc[cmd_channel].vol[i] = vol[i];  // volume
+        }
+    }
+}
+
 int scu_dvc_setup
 (
     uint32_t cmd_channel,
@@ -365,7 +577,6 @@ int scu_dvc_setup
     uint32_t *vol
 )
 {
-    int i;
 
     if( !rcar_cmd_supported(cmd_channel) ) {
         ado_error("scu_dvc_setup: CMD %d is not supported", cmd_channel);
@@ -387,16 +598,14 @@ int scu_dvc_setup
 
     rcar_dvc[cmd_channel].dvucr = (0 << 16) |   // Disables the DVC_MUTE pin
                               (1 << 8) |    // Use the digital volume value function
-                              (0 << 4) |    // No Use the volume ramp function
+                              ((dvc_ramp[cmd_channel].enable & 1) << 4) |   // Use the volume ramp function
                               (1 << 0);     // Use the zero cross mute function
     rcar_dvc[cmd_channel].zcmcr = 0;
-    rcar_dvc[cmd_channel].vrctr = 0;    // Enable the volume ramp function for all channel
+    rcar_dvc[cmd_channel].vrctr = dvc_ramp[cmd_channel].enable ? 0xFF : 0;  // Enable the volume ramp function for all channel
     rcar_dvc[cmd_channel].vrpdr = 0;    // Volume Ramp Period for Volume Up/Down
     rcar_dvc[cmd_channel].vrdbr = 0;    // Control the decibel (gain level) of volume ramp
     rcar_dvc[cmd_channel].vrwtr = 0;    // Control the standby time to start the volume ramp function
-    for (i = 0; i < 8; i++) {
-        rcar_dvc[cmd_channel].vol[i] = vol[i];  // volume
-    }
+    scu_dvc_vol_params( cmd_channel, vol );
     rcar_dvc[cmd_channel].dvuir = 0;
     rcar_dvc[cmd_channel].dvuer = 1;    // dvu enable
 
@@ -445,6 +654,63 @@ int scu_dvc_set_vol(uint32_t cmd_channel, uint32_t voice_channel, uint32_t vol)
     return EOK;
 }
 
+/* update the volume of a running DVC, ramping to the new level if the ramp is enabled */
+int scu_dvc_update_vol(uint32_t cmd_channel, uint32_t *vol)
+{
+    if( !rcar_cmd_supported(cmd_channel) ) {
+        ado_error("scu_dvc_update_vol: CMD %d is not supported", cmd_channel);
+        return EINVAL;
+    }
+    if (rcar_scusrc == MAP_FAILED ) {
+        ado_error("scu_dvc_update_vol: SCU memory is not mapped");
+        return EFAULT;
+    }
+
+    /* the volume registers can only be written while register access is disabled */
+    rcar_dvc[cmd_channel].dvuer = 0;
+    scu_dvc_vol_params( cmd_channel, vol );
+    rcar_dvc[cmd_channel].dvuer = 1;
+
+    return EOK;
+}
+
+/* ramp_up and ramp_down are VRPDR period codes, from 0 (128dB per step) to
+   SCU_DVC_RAMP_MAX (0.125dB per 8192 steps); takes effect at the next scu_dvc_setup */
+int scu_dvc_set_ramp(uint32_t cmd_channel, uint32_t enable, uint32_t ramp_up, uint32_t ramp_down)
+{
+    if( !rcar_cmd_supported(cmd_channel) ) {
+        ado_error("scu_dvc_set_ramp: CMD %d is not supported", cmd_channel);
+        return EINVAL;
+    }
+    if( ramp_up > SCU_DVC_RAMP_MAX || ramp_down > SCU_DVC_RAMP_MAX ) {
+        ado_error("scu_dvc_set_ramp: invalid ramp period %d:%d", ramp_up, ramp_down);
+        return EINVAL;
+    }
+
+    dvc_ramp[cmd_channel].enable = enable ? 1 : 0;
+    dvc_ramp[cmd_channel].vrpdr = (ramp_up << 8) | ramp_down;
+
+    return EOK;
+}
+
+/* DVC_VOLxR value for an attenuation in dB, computed without floating point:
+   10^(-n/20) for the 0-19dB remainder times a power of ten for every 20dB */
+uint32_t scu_dvc_db_to_vol(uint32_t atten_db)
+{
+    static const uint32_t db_gain[20] = {
+        1000000, 891251, 794328, 707946, 630957, 562341, 501187, 446684, 398107, 354813,
+        316228, 281838, 251189, 223872, 199526, 177828, 158489, 141254, 125893, 112202
+    };
+    uint64_t vol = (uint64_t)SCU_DVC_VOL_0DB * db_gain[atten_db % 20] / 1000000;
+    uint32_t i;
+
+    for (i = 0; i < atten_db / 20 && vol; i++) {
+        vol /= 10;
+    }
+
+    return (uint32_t)vol;
+}
+
 int scu_dvc_cleanup(uint32_t cmd_channel)
 {
     int i;
@@ -610,6 +876,25 @@ void scu_dvc_register_dump( uint32_t cmd_channel )
                rcar_dvc[cmd_channel].dvusr, rcar_dvc[cmd_channel].dvier );
 }
 
+void scu_mix_register_dump( uint32_t cmd_channel )
+{
+    /* the MIX is part of the CMD, use the cmd_channel index */
+    if( !rcar_cmd_supported(cmd_channel) ) {
+        ado_error("scu_mix_register_dump: CMD%d is not supported", cmd_channel);
+        return;
+    }
+
+    ado_debug( DB_LVL_DRIVER, "SCU MIX%d reg dump: SWRSR=%x MIXIR=%x ADINR=%x MIXMR=%x MVPDR=%x",
+               cmd_channel, rcar_mix[cmd_channel].swrsr, rcar_mix[cmd_channel].mixir,
+               rcar_mix[cmd_channel].adinr, rcar_mix[cmd_channel].mixmr,
+               rcar_mix[cmd_channel].mvpdr );
+
+    ado_debug( DB_LVL_DRIVER, "SCU MIX%d reg dump: MDBAR=%x MDBBR=%x MDBCR=%x MDBDR=%x MDBER=%x",
+               cmd_channel, rcar_mix[cmd_channel].mdbr[0], rcar_mix[cmd_channel].mdbr[1],
+               rcar_mix[cmd_channel].mdbr[2], rcar_mix[cmd_channel].mdbr[3],
+               rcar_mix[cmd_channel].mdber );
+}
+
 #if defined(__QNXNTO__) && defined(__USESRCVERSION)
 #include <sys/srcversion.h>
 __SRCVERSION("$URL: http://svn.ott.qnx.com/product/branches/7.0.0/beta/hardware/deva/ctrl/rcar/scu.c $ $Rev: 804482 $")
@@ -36,6 +36,15 @@
 #define SCU_SRC_CHANNEL_NUM     9
 #define SCU_CMD_CHANNEL_NUM     2
 
+#define SCU_DVC_VOICE_NUM       8
+#define SCU_DVC_VOL_0DB         0x100000    /* DVC_VOLxR value for a gain of 0dB */
+#define SCU_DVC_VOL_MAX         0x7FFFFF    /* DVC_VOLxR value for a gain of +18dB */
+#define SCU_DVC_RAMP_MAX        0x19        /* fastest (0) to slowest volume ramp period code */
+
+#define SCU_MIX_INPUT_NUM       4           /* inputs A-D of the MIX of one CMD */
+#define SCU_MIX_VOL_0DB         0           /* MIX_MDBxR value for an attenuation of 0dB */
+#define SCU_MIX_VOL_MUTE        0x3FF       /* MIX_MDBxR value muting an input */
+
 /* SCU level functionality */
 int scu_init();
 void scu_deinit();
@@ -62,9 +71,21 @@ int scu_dvc_setup( uint32_t dvc_channel,
 int scu_dvc_cleanup( uint32_t dvc_channel );
 int scu_dvc_get_vol( uint32_t dvc_channel, uint32_t voice_channel, uint32_t * vol );
 int scu_dvc_set_vol( uint32_t dvc_channel, uint32_t voice_channel, uint32_t vol );
+int scu_dvc_update_vol( uint32_t dvc_channel, uint32_t *vol );
+int scu_dvc_set_ramp( uint32_t dvc_channel, uint32_t enable, uint32_t ramp_up, uint32_t ramp_down );
+uint32_t scu_dvc_db_to_vol( uint32_t atten_db );
+
+/* MIX level functionality */
+int scu_mix_input( uint32_t src_channel, uint32_t * mix_input );
+int scu_mix_setup( uint32_t cmd_channel,
+                   uint32_t voicenum,
+                   uint32_t input_mask,
+                   uint32_t *vol );
+int scu_mix_cleanup( uint32_t cmd_channel );
 
 /* CMD level functionality */
 int scu_cmd_setup( uint32_t cmd_channel, uint32_t src_channel );
+int scu_cmd_mix_setup( uint32_t cmd_channel, uint32_t src_mask );
 int scu_cmd_start( uint32_t cmd_channel );
 int scu_cmd_stop( uint32_t cmd_channel );
 
@@ -72,6 +93,7 @@ int scu_cmd_stop( uint32_t cmd_channel );
 void scu_src_register_dump( uint32_t src_channel );
 void scu_cmd_register_dump( uint32_t cmd_channel );
 void scu_dvc_register_dump( uint32_t dvc_channel );
+void scu_mix_register_dump( uint32_t cmd_channel );
 
 #endif /* _R_Car_SCU_H */
 
@@ -140,6 +140,101 @@ typedef void (WFD_APIENTRY PFNWFDDESTROYDESTINATIONQNX) (WFDDevice device, WFDDe
 typedef void (WFD_APIENTRY PFNWFDBINDDESTINATIONTOPORTQNX) (WFDDevice device, WFDPort port, WFDDestinationQNX destination, WFDTransition transition);
 #endif
 
+/*
+ * Frame timing of a pipeline, over its last commits. Read with
+ * wfdGetPipelineAttribiv() and WFD_FRAME_TIMING_COUNT_RCAR values, times are
+ * in microseconds from commit entry. Writing any value restarts the record.
+ */
+#ifndef WFD_RCAR_frame_timing
+#define WFD_RCAR_frame_timing 1
+#define WFD_PIPELINE_FRAME_TIMING_RCAR          0x7780
+typedef enum
+{   WFD_FRAME_TIMING_SAMPLES_RCAR = 0,     /* commits in the record */
+	WFD_FRAME_TIMING_COMMITS_RCAR,         /* commits since the last restart */
+	WFD_FRAME_TIMING_MISSED_RCAR,          /* vblanks lists were latched late by */
+	WFD_FRAME_TIMING_READY_P50_RCAR,       /* display list published */
+	WFD_FRAME_TIMING_READY_P90_RCAR,
+	WFD_FRAME_TIMING_READY_P99_RCAR,
+	WFD_FRAME_TIMING_READY_MAX_RCAR,
+	WFD_FRAME_TIMING_LATCH_P50_RCAR,       /* display list latched at vblank */
+	WFD_FRAME_TIMING_LATCH_P90_RCAR,
+	WFD_FRAME_TIMING_LATCH_P99_RCAR,
+	WFD_FRAME_TIMING_LATCH_MAX_RCAR,
+	WFD_FRAME_TIMING_SCANOUT_P50_RCAR,     /* first active line scanned out */
+	WFD_FRAME_TIMING_SCANOUT_P90_RCAR,
+	WFD_FRAME_TIMING_SCANOUT_P99_RCAR,
+	WFD_FRAME_TIMING_SCANOUT_MAX_RCAR,
+	WFD_FRAME_TIMING_COUNT_RCAR
+} WFDFrameTimingRCAR;
+#endif
+
+/*
+ * Display list statistics of a port. Read WFD_PORT_DL_STATS_RCAR with
+ * WFD_DL_STATS_COUNT_RCAR values, writing it restarts the statistics.
+ * Writing WFD_PORT_DL_CHECK_RCAR to 1 plays every new display list back
+ * into a register model and checks it against the pipeline state.
+ * WFD_PORT_SCALE_POOL_STATS_RCAR reads WFD_SCALE_POOL_STATS_COUNT_RCAR
+ * values of the device's scaler buffer pool, writing it restarts them.
+ */
+#ifndef WFD_RCAR_dl_stats
+#define WFD_RCAR_dl_stats 1
+#define WFD_PORT_DL_STATS_RCAR                  0x7781
+#define WFD_PORT_DL_CHECK_RCAR                  0x7782
+typedef enum
+{   WFD_DL_STATS_COMMITS_RCAR = 0,         /* display lists generated */
+	WFD_DL_STATS_BYTES_LAST_RCAR,          /* size of the last list */
+	WFD_DL_STATS_BYTES_AVG_RCAR,
+	WFD_DL_STATS_GEN_AVG_RCAR,             /* usec from setup to publish */
+	WFD_DL_STATS_GEN_MAX_RCAR,
+	WFD_DL_STATS_CHECKED_RCAR,             /* lists played back by the checker */
+	WFD_DL_STATS_ERRORS_RCAR,              /* lists that failed the check */
+	WFD_DL_STATS_COUNT_RCAR
+} WFDDlStatsRCAR;
+#define WFD_PORT_SCALE_POOL_STATS_RCAR          0x7783
+typedef enum
+{   WFD_SCALE_POOL_ALLOCS_RCAR = 0,        /* buffers allocated */
+	WFD_SCALE_POOL_REUSES_RCAR,            /* allocations avoided by reuse */
+	WFD_SCALE_POOL_EVICTIONS_RCAR,
+	WFD_SCALE_POOL_FAILURES_RCAR,
+	WFD_SCALE_POOL_BUFFERS_RCAR,           /* buffers held by the pool now */
+	WFD_SCALE_POOL_BYTES_RCAR,
+	WFD_SCALE_POOL_STATS_COUNT_RCAR
+} WFDScalePoolStatsRCAR;
+#endif
+
+/*
+ * Import of an existing physically contiguous buffer (capture or IMR output)
+ * as a WFDEGLImage, so it can be bound to a source without a copy. The
+ * buffer is given either by physical address (fd == -1) or as a shared or
+ * typed memory object and offset, which is resolved and checked for
+ * contiguity. Set WFD_IMAGE_IMPORT_CPU_CACHED_RCAR when the producer writes
+ * through a cached CPU mapping; such buffers need fd, the cache is then
+ * cleaned before each commit. A zero size or planar offset is derived from
+ * the stride and height. Release with wfdDestroyWFDEGLImagesQNX(), the
+ * memory stays owned by the caller.
+ */
+#ifndef WFD_RCAR_image_import
+#define WFD_RCAR_image_import 1
+#define WFD_IMAGE_IMPORT_CPU_CACHED_RCAR        (1 << 0)
+typedef struct
+{   WFDint              fd;                /* memory object, -1 to use paddr */
+	WFDint              format;            /* WFD_FORMAT_*_QNX */
+	khronos_uint64_t    offset;            /* buffer offset in fd */
+	khronos_uint64_t    paddr;             /* physical address when fd is -1 */
+	WFDint              width;
+	WFDint              height;
+	WFDint              stride;            /* luma line pitch in bytes */
+	WFDint              planar_offsets[3];
+	WFDint              size;
+	WFDint              flags;
+} WFDImageImportRCAR;
+#ifdef WFD_WFDEXT_PROTOTYPES
+WFD_API_CALL WFDErrorCode WFD_APIENTRY
+    wfdImportWFDEGLImageRCAR(WFDDevice device, const WFDImageImportRCAR *desc, WFDEGLImage *image) WFD_APIEXIT;
+#endif /* WFD_WFDEXT_PROTOTYPES */
+typedef WFDErrorCode (WFD_APIENTRY PFNWFDIMPORTWFDEGLIMAGERCAR) (WFDDevice device, const WFDImageImportRCAR *desc, WFDEGLImage *image);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
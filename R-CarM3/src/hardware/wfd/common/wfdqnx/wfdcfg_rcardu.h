@@ -97,5 +97,22 @@ enum rcar_clock_source {
 #define WFDCFG_EXT_FN_EXTCLK_CONFIG "extclk_config"
 typedef int (wfdcfg_ext_fn_extclk_config_t)(int channel, int clock);
 
+/**
+ * Upper limit of scaling output buffers kept by the driver, in use or idle.
+ * Idle buffers are unmapped least recently used first above this limit.
+ * This is a device extension.
+ *  .p is NULL.
+ *  .i is the number of buffers.
+ */
+#define WFDCFG_EXT_SCALE_POOL_MAX_BUFFERS "scale_pool_max_buffers"
+
+/**
+ * Same as WFDCFG_EXT_SCALE_POOL_MAX_BUFFERS, as a number of bytes.
+ * This is a device extension.
+ *  .p is NULL.
+ *  .i is the number of bytes.
+ */
+#define WFDCFG_EXT_SCALE_POOL_MAX_BYTES "scale_pool_max_bytes"
+
 #endif /* HDRINCL_WFDCFG_RCARDU included */
 
@@ -42,7 +42,11 @@ compose_hdl vsp_compose = {
 	.activate_pipeline = vsp_activate_pipeline,
 	.deactivate_pipeline = vsp_deactivate_pipeline,
 	.frame_update = vsp_frame_update,
-	.sub_hw_frame_sync = NULL,
+	.sub_hw_frame_sync = VspLib_compose_update_sync,
+	.dl_stats = vsp_dl_stats,
+	.dl_check = vsp_dl_check_enable,
+	.dl_seq = vsp_dl_seq,
+	.dl_latched = vsp_dl_latched,
 };
 
 du_cfg_t du_cfg_list[] = {
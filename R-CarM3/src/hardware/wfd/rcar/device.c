@@ -57,6 +57,15 @@
  *    - indicates we provide these port attributes:
  *      WFD_PORT_RED_GAMMA_CURVE_QNX, WFD_PORT_GREEN_GAMMA_CURVE_QNX,
  *      WFD_PORT_BLUE_GAMMA_CURVE_QNX
+ *  WFD_RCAR_frame_timing
+ *    - indicates we provide this pipeline attribute:
+ *      WFD_PIPELINE_FRAME_TIMING_RCAR
+ *  WFD_RCAR_dl_stats
+ *    - indicates we provide these port attributes:
+ *      WFD_PORT_DL_STATS_RCAR, WFD_PORT_DL_CHECK_RCAR,
+ *      WFD_PORT_SCALE_POOL_STATS_RCAR
+ *  WFD_RCAR_image_import
+ *    - indicates we provide the wfdImportWFDEGLImageRCAR function
  */
 
 #undef RCARDU_EXT
@@ -110,8 +119,27 @@
     #define RCARDU_EXT_GAMMA_CURVE
 #endif
 
+#if WFD_RCAR_frame_timing
+    #define RCARDU_EXT_FTIMING RCARDU_EXT("WFD_RCAR_frame_timing")
+#else
+    #define RCARDU_EXT_FTIMING
+#endif
+
+#if WFD_RCAR_dl_stats
+    #define RCARDU_EXT_DLSTATS RCARDU_EXT("WFD_RCAR_dl_stats")
+#else
+    #define RCARDU_EXT_DLSTATS
+#endif
+
+#if WFD_RCAR_image_import
+    #define RCARDU_EXT_IMPORT RCARDU_EXT("WFD_RCAR_image_import")
+#else
+    #define RCARDU_EXT_IMPORT
+#endif
+
 #define RCARDU_EXT_LIST RCARDU_EXT_IMG RCARDU_EXT_VSYNC RCARDU_EXT_MINFO RCARDU_EXT_BCHS \
-    RCARDU_EXT_PCOLORSPACE RCARDU_EXT_COLORSPACE RCARDU_EXT_PBRIGHTNESS RCARDU_EXT_GAMMA_CURVE
+    RCARDU_EXT_PCOLORSPACE RCARDU_EXT_COLORSPACE RCARDU_EXT_PBRIGHTNESS RCARDU_EXT_GAMMA_CURVE \
+    RCARDU_EXT_FTIMING RCARDU_EXT_DLSTATS RCARDU_EXT_IMPORT
 
 #define RCARDU_EXT(x) { .name=(x) },
 static const struct
@@ -206,43 +234,58 @@ wfdGetStrings(WFDDevice device, WFDStringID name,
 struct timespec start, stop;
 double accum;
 	
+/*
+ * Wait until the display list published by the last commit of this port has
+ * been latched: the vsync ISR writes it to the DL header at the next vblank
+ * and the VSP fetches it DL_LATCH_VSYNCS vblanks after the commit, only then
+ * is the frame it replaces off the screen. Returns at once if that vblank has
+ * already passed.
+ */
 int rcardu_wait_vsync(du_dev_t *dev, port_t *port)
 {
     struct _pulse       pulse;
     iov_t               iov;
     uint64_t            MaxWaitTime =50*1000*1000;
+    unsigned            target = port->commit_vsync;
 
-	atomic_clr( &port->vsync_done, 0x01 );
     pthread_mutex_lock( &port->vsync_mutex );
-    if (port->vsync_done & 1) 
-    {
-        pthread_mutex_unlock( &port->vsync_mutex );
-        usleep(2);
-        return 1;
-    }
-	
-	atomic_add(&port->want_vsync_pulse, 1);
 
 	SETIOV(&iov, &pulse, sizeof (pulse));
 
-	while (1)
+	/* the pulse is only a wakeup, a stale one from an earlier wait is harmless */
+	while (port->vsync_counter - target < DL_LATCH_VSYNCS)
 	{
-		TimerTimeout(CLOCK_REALTIME, _NTO_TIMEOUT_RECEIVE, NULL, &MaxWaitTime, NULL);
-
-		if (MsgReceivev(port->irqchan, &iov, 1, NULL) == -1)
+		atomic_set(&port->want_vsync_pulse, 1);
+		if (port->vsync_counter - target >= DL_LATCH_VSYNCS)
 			break;
 
-		if (pulse.code == R_CAR_DU_VSYNC_PULSE)
+		TimerTimeout(CLOCK_REALTIME, _NTO_TIMEOUT_RECEIVE, NULL, &MaxWaitTime, NULL);
+		if (MsgReceivev(port->irqchan, &iov, 1, NULL) == -1)
+		{
+			SLOG_WARNING("port %d: no vsync within 50ms", port->portId);
 			break;
+		}
 	}
 
-	atomic_set( &port->vsync_done, 0x01 );
 	pthread_mutex_unlock( &port->vsync_mutex );
-	usleep (1);
-		
+
     return 1;
 }
 
+/* called after a commit of this port has published its display list */
+static void rcardu_commit_done(port_t *port, port_t **wait_ports, int *wait_num)
+{
+	int i;
+
+	port->commit_vsync = port->vsync_counter;
+	for (i = 0; i < *wait_num; i++)
+	{
+		if (wait_ports[i] == port)
+			return;
+	}
+	wait_ports[(*wait_num)++] = port;
+}
+
 WFD_API_CALL WFDboolean WFD_APIENTRY
 wfdIsExtensionSupported(WFDDevice device, const char *string) WFD_APIEXIT
 {
@@ -336,6 +379,7 @@ wfdCreateDevice(WFDint deviceId, const WFDint *attribList) WFD_APIEXIT
 
     dev->max_width  = 0xfff;
     dev->max_height = 0xfff;
+    scale_pool_init(dev);
     get_chip_info(dev);
     dev->eventSize = RCARDU_MAX_NUMBER_EVENTS;
     SLOG_DEBUG2("    Parsing device config ...");
@@ -393,6 +437,7 @@ wfdCreateDevice(WFDint deviceId, const WFDint *attribList) WFD_APIEXIT
     {
         pthread_mutex_destroy(&dev->mutex);
         rcardu_fini(dev);
+        scale_pool_fini(dev);
         free(dev->cfglib_device);
         free(dev);
         return WFD_INVALID_HANDLE;
@@ -405,11 +450,19 @@ WFD_API_CALL WFDErrorCode WFD_APIENTRY
 wfdDestroyDevice(WFDDevice device) WFD_APIEXIT
 {
 	du_dev_t *dev = (du_dev_t *)device;
+	unsigned it;
 	TRACE;
 
 	DEVICE_VALIDATE(return WFD_ERROR_BAD_DEVICE)
 
+	/* the scaler threads use the pool and the VSP devices */
+	for (it = 0; it < dev->pipesSize; it++)
+	{
+		scale_pipe_quit(dev, &dev->pipes[it]);
+	}
+
 	rcardu_fini(dev);
+	scale_pool_fini(dev);
 
 	pthread_mutex_destroy(&dev->mutex);
 	free(dev->cfglib_device);
@@ -425,7 +478,8 @@ wfdDeviceCommit(WFDDevice device,
 	du_dev_t	*dev = (du_dev_t *)device;
 	port_t		*port = NULL;
 	pipe_t		*pipe = NULL;
-	int		wait_for_vsync = 0;	/* CHECK */
+	port_t		*wait_ports[RCARDU_WFD_MAX_NUMBER_OF_PORTS];
+	int		wait_num = 0;
 	int		i;
 
 	TRACE;
@@ -438,14 +492,9 @@ wfdDeviceCommit(WFDDevice device,
 		if (dev->changes) {
 			for ( i = 0; i < dev->portsSize; i++ ) {
 				if (dev->ports[i].changes) {
-					/*
-					* TODO - what we really want to do here is to have a multiple
-					* wait_for_vsync function down below.
-					*/
-					wait_for_vsync |= wfdCommitPortUpdates(dev,&dev->ports[i]);
-                    /* Choose any port for vsync waiting. If screen do not */
-                    /* care about visual appearance how WFD driver should care? */
-                    port = &dev->ports[i];
+					if (wfdCommitPortUpdates(dev,&dev->ports[i])) {
+						rcardu_commit_done(&dev->ports[i], wait_ports, &wait_num);
+					}
 				}
 			}
 			dev->changes = 0;
@@ -457,20 +506,27 @@ wfdDeviceCommit(WFDDevice device,
 		PORT_CREATED(WFD_ERROR_BAD_HANDLE, return);
 			LOCK_DEVICE();
 		if (port->changes) {
-			wait_for_vsync = wfdCommitPortUpdates(dev,port);
+			if (wfdCommitPortUpdates(dev,port)) {
+				rcardu_commit_done(port, wait_ports, &wait_num);
+			}
 		}
 			UNLOCK_DEVICE();
 	} else if (type == WFD_COMMIT_PIPELINE) {
 			LOCK_DEVICE();
 		pipe = (pipe_t *)handle;
 		port=pipe->port;
-		wait_for_vsync = wfdCommitPipelineUpdates(dev, pipe);
+		if (wfdCommitPipelineUpdates(dev, pipe) && port) {
+			rcardu_commit_done(port, wait_ports, &wait_num);
+		}
 			UNLOCK_DEVICE();
 	}
 
-
-	if (wait_for_vsync && port) {
-		rcardu_wait_vsync(dev, port);
+	/*
+	 * Every port latches at its own vblanks. The waits overlap, so a device
+	 * commit costs the time until the slowest port has latched, not their sum.
+	 */
+	for (i = 0; i < wait_num; i++) {
+		rcardu_wait_vsync(dev, wait_ports[i]);
 	}
 
 }
@@ -20,6 +20,7 @@
  */
 #include <stddef.h>
 #include <unistd.h>
+#include <time.h>
 #include "hdmic.h"
 
 enum hdmi_datamap {
@@ -36,35 +37,49 @@ enum hdmi_datamap {
 	YCbCr422_12B = 0x12,
 };
 
-static const unsigned short csc_coeff_default[3][4] = {
-	{ 0x2000, 0x0000, 0x0000, 0x0000 },
-	{ 0x0000, 0x2000, 0x0000, 0x0000 },
-	{ 0x0000, 0x0000, 0x2000, 0x0000 }
-};
-
-static const unsigned short csc_coeff_rgb_out_eitu601[3][4] = {
-	{ 0x2000, 0x6926, 0x74fd, 0x010e },
-	{ 0x2000, 0x2cdd, 0x0000, 0x7e9a },
-	{ 0x2000, 0x0000, 0x38b4, 0x7e3b }
-};
+/*
+ * CSC coefficient sets, kept as the image of the HDMI_CSC_COEF_A1_MSB ..
+ * HDMI_CSC_COEF_C4_LSB register block (rows A/B/C, MSB first) so a set is
+ * written in a single pass without per-coefficient shuffling.
+ */
+#define CSC_COEF(c)		(unsigned char)((c) >> 8), (unsigned char)((c) & 0xff)
+#define CSC_ROW(c1, c2, c3, c4)	CSC_COEF(c1), CSC_COEF(c2), CSC_COEF(c3), CSC_COEF(c4)
+#define HDMI_CSC_COEF_NUM	(HDMI_CSC_COEF_C4_LSB - HDMI_CSC_COEF_A1_MSB + 1)
 
-static const unsigned short csc_coeff_rgb_out_eitu709[3][4] = {
-	{ 0x2000, 0x7106, 0x7a02, 0x00a7 },
-	{ 0x2000, 0x3264, 0x0000, 0x7e6d },
-	{ 0x2000, 0x0000, 0x3b61, 0x7e25 }
+struct hdmi_csc_set {
+	unsigned char scale;
+	unsigned char coef[HDMI_CSC_COEF_NUM];
 };
 
-static const unsigned short csc_coeff_rgb_in_eitu601[3][4] = {
-	{ 0x2591, 0x1322, 0x074b, 0x0000 },
-	{ 0x6535, 0x2000, 0x7acc, 0x0200 },
-	{ 0x6acd, 0x7534, 0x2000, 0x0200 }
-};
-
-static const unsigned short csc_coeff_rgb_in_eitu709[3][4] = {
-	{ 0x2dc5, 0x0d9b, 0x049e, 0x0000 },
-	{ 0x62f0, 0x2000, 0x7d11, 0x0200 },
-	{ 0x6756, 0x78ab, 0x2000, 0x0200 }
-};
+static const struct hdmi_csc_set csc_coeff_default = { 1, {
+	CSC_ROW(0x2000, 0x0000, 0x0000, 0x0000),
+	CSC_ROW(0x0000, 0x2000, 0x0000, 0x0000),
+	CSC_ROW(0x0000, 0x0000, 0x2000, 0x0000)
+} };
+
+static const struct hdmi_csc_set csc_coeff_rgb_out_eitu601 = { 1, {
+	CSC_ROW(0x2000, 0x6926, 0x74fd, 0x010e),
+	CSC_ROW(0x2000, 0x2cdd, 0x0000, 0x7e9a),
+	CSC_ROW(0x2000, 0x0000, 0x38b4, 0x7e3b)
+} };
+
+static const struct hdmi_csc_set csc_coeff_rgb_out_eitu709 = { 1, {
+	CSC_ROW(0x2000, 0x7106, 0x7a02, 0x00a7),
+	CSC_ROW(0x2000, 0x3264, 0x0000, 0x7e6d),
+	CSC_ROW(0x2000, 0x0000, 0x3b61, 0x7e25)
+} };
+
+static const struct hdmi_csc_set csc_coeff_rgb_in_eitu601 = { 0, {
+	CSC_ROW(0x2591, 0x1322, 0x074b, 0x0000),
+	CSC_ROW(0x6535, 0x2000, 0x7acc, 0x0200),
+	CSC_ROW(0x6acd, 0x7534, 0x2000, 0x0200)
+} };
+
+static const struct hdmi_csc_set csc_coeff_rgb_in_eitu709 = { 0, {
+	CSC_ROW(0x2dc5, 0x0d9b, 0x049e, 0x0000),
+	CSC_ROW(0x62f0, 0x2000, 0x7d11, 0x0200),
+	CSC_ROW(0x6756, 0x78ab, 0x2000, 0x0200)
+} };
 
 static const struct dw_hdmi_mpll_config rcar_du_hdmienc_mpll_cfg[] = {
 	{
@@ -175,6 +190,64 @@ static void hdmi_mask_writeb(struct dw_hdmi *hdmi, unsigned char data, unsigned
 	hdmi_modb(hdmi, data << shift, mask, reg);
 }
 
+/*
+ * Register scripts: HDMI programming sequences are tables of hdmi_reg_op
+ * entries replayed by hdmi_run_script(). Mode dependent sequences are built
+ * on the stack from the same ops. Only the steps the hardware needs to settle
+ * (PHY reset) carry an explicit delay.
+ */
+enum {
+	HDMI_OP_END = 0,
+	HDMI_OP_WRITE,		/* reg = val */
+	HDMI_OP_MODIFY,		/* reg = (reg & ~mask) | (val & mask) */
+	HDMI_OP_PHY,		/* PHY register reg = val through the PHY I2C master */
+	HDMI_OP_DELAY,		/* sleep val milliseconds */
+};
+
+struct hdmi_reg_op {
+	unsigned char op;
+	unsigned char mask;
+	unsigned short reg;
+	unsigned short val;
+};
+
+#define HDMI_WR(r, v)		{ HDMI_OP_WRITE, 0, (r), (v) }
+#define HDMI_MOD(r, v, m)	{ HDMI_OP_MODIFY, (m), (r), (v) }
+#define HDMI_PHY(r, v)		{ HDMI_OP_PHY, 0, (r), (v) }
+#define HDMI_DELAY(ms)		{ HDMI_OP_DELAY, 0, 0, (ms) }
+#define HDMI_END		{ HDMI_OP_END, 0, 0, 0 }
+
+static int __hdmi_phy_i2c_write(struct dw_hdmi *hdmi, unsigned short data,
+				unsigned char addr);
+
+static int hdmi_run_script(struct dw_hdmi *hdmi, const struct hdmi_reg_op *op)
+{
+	int ret = 0;
+
+	for (; op->op != HDMI_OP_END; op++) {
+		switch (op->op) {
+		case HDMI_OP_WRITE:
+			hdmi_writeb(hdmi, (unsigned char)op->val, op->reg);
+			break;
+		case HDMI_OP_MODIFY:
+			hdmi_modb(hdmi, (unsigned char)op->val, op->mask, op->reg);
+			break;
+		case HDMI_OP_PHY:
+			if (__hdmi_phy_i2c_write(hdmi, op->val, (unsigned char)op->reg))
+				ret = -1;
+			break;
+		case HDMI_OP_DELAY:
+			delay(op->val);
+			break;
+		default:
+			SLOG_ERROR("%s: bad op %d", __func__, op->op);
+			return -1;
+		}
+	}
+
+	return ret;
+}
+
 static void hdmi_set_cts_n(struct dw_hdmi *hdmi, unsigned int cts,
 			   unsigned int n)
 {
@@ -380,6 +453,20 @@ void dw_hdmi_audio_disable(struct dw_hdmi *hdmi)
  *			pin{31~24} <==> G[7:0]
  *			pin{15~8}  <==> B[7:0]
  */
+static const struct hdmi_reg_op hdmi_tx_stuffing_script[] = {
+	/* Enable TX stuffing: When DE is inactive, fix the output data to 0 */
+	HDMI_WR(HDMI_TX_INSTUFFING, HDMI_TX_INSTUFFING_BDBDATA_STUFFING_ENABLE |
+			HDMI_TX_INSTUFFING_RCRDATA_STUFFING_ENABLE |
+			HDMI_TX_INSTUFFING_GYDATA_STUFFING_ENABLE),
+	HDMI_WR(HDMI_TX_GYDATA0, 0x0),
+	HDMI_WR(HDMI_TX_GYDATA1, 0x0),
+	HDMI_WR(HDMI_TX_RCRDATA0, 0x0),
+	HDMI_WR(HDMI_TX_RCRDATA1, 0x0),
+	HDMI_WR(HDMI_TX_BCBDATA0, 0x0),
+	HDMI_WR(HDMI_TX_BCBDATA1, 0x0),
+	HDMI_END
+};
+
 static void hdmi_video_sample(struct dw_hdmi *hdmi)
 {
 	int color_format = 0;
@@ -423,24 +510,7 @@ static void hdmi_video_sample(struct dw_hdmi *hdmi)
 		HDMI_TX_INVID0_VIDEO_MAPPING_MASK);
 	hdmi_writeb(hdmi, val, HDMI_TX_INVID0);
 
-	/* Enable TX stuffing: When DE is inactive, fix the output data to 0 */
-	val = HDMI_TX_INSTUFFING_BDBDATA_STUFFING_ENABLE |
-		HDMI_TX_INSTUFFING_RCRDATA_STUFFING_ENABLE |
-		HDMI_TX_INSTUFFING_GYDATA_STUFFING_ENABLE;
-	hdmi_writeb(hdmi, val, HDMI_TX_INSTUFFING);
-	delay(10);
-	hdmi_writeb(hdmi, 0x0, HDMI_TX_GYDATA0);
-	delay(10);
-	hdmi_writeb(hdmi, 0x0, HDMI_TX_GYDATA1);
-	delay(10);
-	hdmi_writeb(hdmi, 0x0, HDMI_TX_RCRDATA0);
-	delay(10);
-	hdmi_writeb(hdmi, 0x0, HDMI_TX_RCRDATA1);
-	delay(10);
-	hdmi_writeb(hdmi, 0x0, HDMI_TX_BCBDATA0);
-	delay(10);
-	hdmi_writeb(hdmi, 0x0, HDMI_TX_BCBDATA1);
-	delay(10);
+	hdmi_run_script(hdmi, hdmi_tx_stuffing_script);
 }
 
 static int is_color_space_conversion(struct dw_hdmi *hdmi)
@@ -468,50 +538,35 @@ static int is_color_space_interpolation(struct dw_hdmi *hdmi)
 	return 0;
 }
 
-static void dw_hdmi_update_csc_coeffs(struct dw_hdmi *hdmi)
+static const struct hdmi_csc_set *hdmi_csc_select(struct dw_hdmi *hdmi)
 {
-	const unsigned short (*csc_coeff)[3][4] = &csc_coeff_default;
-	unsigned i;
-	uint32_t csc_scale = 1;
+	if (!is_color_space_conversion(hdmi))
+		return &csc_coeff_default;
 
-	if (is_color_space_conversion(hdmi)) {
-		if (hdmi->hdmi_data.enc_out_format == RGB) {
-			if (hdmi->hdmi_data.colorimetry ==
-					HDMI_COLORIMETRY_ITU_601)
-				csc_coeff = &csc_coeff_rgb_out_eitu601;
-			else
-				csc_coeff = &csc_coeff_rgb_out_eitu709;
-		} else if (hdmi->hdmi_data.enc_in_format == RGB) {
-			if (hdmi->hdmi_data.colorimetry ==
-					HDMI_COLORIMETRY_ITU_601)
-				csc_coeff = &csc_coeff_rgb_in_eitu601;
-			else
-				csc_coeff = &csc_coeff_rgb_in_eitu709;
-			csc_scale = 0;
-		}
+	if (hdmi->hdmi_data.enc_out_format == RGB) {
+		if (hdmi->hdmi_data.colorimetry == HDMI_COLORIMETRY_ITU_601)
+			return &csc_coeff_rgb_out_eitu601;
+		return &csc_coeff_rgb_out_eitu709;
+	}
+	if (hdmi->hdmi_data.enc_in_format == RGB) {
+		if (hdmi->hdmi_data.colorimetry == HDMI_COLORIMETRY_ITU_601)
+			return &csc_coeff_rgb_in_eitu601;
+		return &csc_coeff_rgb_in_eitu709;
 	}
 
+	return &csc_coeff_default;
+}
+
+static void dw_hdmi_update_csc_coeffs(struct dw_hdmi *hdmi)
+{
+	const struct hdmi_csc_set *csc = hdmi_csc_select(hdmi);
+	unsigned i;
+
 	/* The CSC registers are sequential, alternating MSB then LSB */
-	for (i = 0; i < sizeof(csc_coeff_default[0])/sizeof(csc_coeff_default[0][0]); i++) {
-		unsigned short coeff_a = (*csc_coeff)[0][i];
-		unsigned short coeff_b = (*csc_coeff)[1][i];
-		unsigned short coeff_c = (*csc_coeff)[2][i];
-
-		hdmi_writeb(hdmi, coeff_a & 0xff, HDMI_CSC_COEF_A1_LSB + i * 2);
-		delay(10);
-		hdmi_writeb(hdmi, coeff_a >> 8, HDMI_CSC_COEF_A1_MSB + i * 2);
-		delay(10);
-		hdmi_writeb(hdmi, coeff_b & 0xff, HDMI_CSC_COEF_B1_LSB + i * 2);
-		delay(10);
-		hdmi_writeb(hdmi, coeff_b >> 8, HDMI_CSC_COEF_B1_MSB + i * 2);
-		delay(10);
-		hdmi_writeb(hdmi, coeff_c & 0xff, HDMI_CSC_COEF_C1_LSB + i * 2);
-		delay(10);
-		hdmi_writeb(hdmi, coeff_c >> 8, HDMI_CSC_COEF_C1_MSB + i * 2);
-		delay(10);
-	}
+	for (i = 0; i < HDMI_CSC_COEF_NUM; i++)
+		hdmi_writeb(hdmi, csc->coef[i], HDMI_CSC_COEF_A1_MSB + i);
 
-	hdmi_modb(hdmi, csc_scale, HDMI_CSC_SCALE_CSCSCALE_MASK,
+	hdmi_modb(hdmi, csc->scale, HDMI_CSC_SCALE_CSCSCALE_MASK,
 		  HDMI_CSC_SCALE);
 }
 
@@ -540,7 +595,6 @@ static void hdmi_video_csc(struct dw_hdmi *hdmi)
 
 	/* Configure the CSC registers */
 	hdmi_writeb(hdmi, interpolation | decimation, HDMI_CSC_CFG);
-	delay(10);
 	hdmi_modb(hdmi, color_depth, HDMI_CSC_SCALE_CSC_COLORDE_PTH_MASK,
 		  HDMI_CSC_SCALE);
 
@@ -614,11 +668,9 @@ static void hdmi_video_packetize(struct dw_hdmi *hdmi)
 	hdmi_modb(hdmi, vp_conf,
 		  HDMI_VP_CONF_PR_EN_MASK |
 		  HDMI_VP_CONF_BYPASS_SELECT_MASK, HDMI_VP_CONF);
-	delay(10);
 
 	hdmi_modb(hdmi, 1 << HDMI_VP_STUFF_IDEFAULT_PHASE_OFFSET,
 		  HDMI_VP_STUFF_IDEFAULT_PHASE_MASK, HDMI_VP_STUFF);
-	delay(10);
 
 	hdmi_writeb(hdmi, remap_size, HDMI_VP_REMAP);
 
@@ -641,30 +693,35 @@ static void hdmi_video_packetize(struct dw_hdmi *hdmi)
 	hdmi_modb(hdmi, vp_conf,
 		  HDMI_VP_CONF_BYPASS_EN_MASK | HDMI_VP_CONF_PP_EN_ENMASK |
 		  HDMI_VP_CONF_YCC422_EN_MASK, HDMI_VP_CONF);
-	delay(10);
 
 	hdmi_modb(hdmi, HDMI_VP_STUFF_PP_STUFFING_STUFFING_MODE |
 			HDMI_VP_STUFF_YCC422_STUFFING_STUFFING_MODE,
 		  HDMI_VP_STUFF_PP_STUFFING_MASK |
 		  HDMI_VP_STUFF_YCC422_STUFFING_MASK, HDMI_VP_STUFF);
-	delay(10);
 
 	hdmi_modb(hdmi, output_select, HDMI_VP_CONF_OUTPUT_SELECTOR_MASK,
 		  HDMI_VP_CONF);
 }
 
-static inline void hdmi_phy_test_clear(struct dw_hdmi *hdmi,
-				       unsigned char bit)
-{
-	hdmi_modb(hdmi, bit << HDMI_PHY_TST0_TSTCLR_OFFSET,
-		  HDMI_PHY_TST0_TSTCLR_MASK, HDMI_PHY_TST0);
-}
+/*
+ * The PHY I2C master completes a register write in a few microseconds, far
+ * below the 1ms sleep granularity, so poll it busily for a short while and
+ * only fall back to sleeping when the transfer is unexpectedly slow.
+ */
+#define HDMI_PHY_I2C_SPIN_NS	1000
+#define HDMI_PHY_I2C_SPINS	200
 
 static int hdmi_phy_wait_i2c_done(struct dw_hdmi *hdmi, int msec)
 {
 	unsigned int val;
+	int spins = HDMI_PHY_I2C_SPINS;
 
 	while ((val = hdmi_readb(hdmi, HDMI_IH_I2CMPHY_STAT0) & 0x3) == 0) {
+		if (spins > 0) {
+			spins--;
+			nanospin_ns(HDMI_PHY_I2C_SPIN_NS);
+			continue;
+		}
 		if (msec-- == 0)
 		{
 			SLOG_ERROR("hdmi_phy_wait_i2c_done FAIL");
@@ -677,8 +734,12 @@ static int hdmi_phy_wait_i2c_done(struct dw_hdmi *hdmi, int msec)
 	return 1;
 }
 
-static void __hdmi_phy_i2c_write(struct dw_hdmi *hdmi, unsigned short data,
-				 unsigned char addr)
+/*
+ * The PHY I2C master carries a single register per operation, there is no
+ * burst mode: each write is issued and waited for individually.
+ */
+static int __hdmi_phy_i2c_write(struct dw_hdmi *hdmi, unsigned short data,
+				unsigned char addr)
 {
 	hdmi_writeb(hdmi, 0xFF, HDMI_IH_I2CMPHY_STAT0);
 	hdmi_writeb(hdmi, addr, HDMI_PHY_I2CM_ADDRESS_ADDR);
@@ -688,14 +749,7 @@ static void __hdmi_phy_i2c_write(struct dw_hdmi *hdmi, unsigned short data,
 		    HDMI_PHY_I2CM_DATAO_0_ADDR);
 	hdmi_writeb(hdmi, HDMI_PHY_I2CM_OPERATION_ADDR_WRITE,
 		    HDMI_PHY_I2CM_OPERATION_ADDR);
-	hdmi_phy_wait_i2c_done(hdmi, 1000);
-}
-
-static int hdmi_phy_i2c_write(struct dw_hdmi *hdmi, unsigned short data,
-			      unsigned char addr)
-{
-	__hdmi_phy_i2c_write(hdmi, data, addr);
-	return 0;
+	return hdmi_phy_wait_i2c_done(hdmi, 1000) ? 0 : -1;
 }
 
 static void dw_hdmi_phy_enable_powerdown(struct dw_hdmi *hdmi, int enable)
@@ -712,27 +766,6 @@ static void dw_hdmi_phy_enable_tmds(struct dw_hdmi *hdmi, unsigned char enable)
 			 HDMI_PHY_CONF0_ENTMDS_MASK);
 }
 
-static void dw_hdmi_phy_enable_spare(struct dw_hdmi *hdmi, unsigned char enable)
-{
-	hdmi_mask_writeb(hdmi, enable, HDMI_PHY_CONF0,
-			 HDMI_PHY_CONF0_SPARECTRL_OFFSET,
-			 HDMI_PHY_CONF0_SPARECTRL_MASK);
-}
-
-static void dw_hdmi_phy_gen2_pddq(struct dw_hdmi *hdmi, unsigned char enable)
-{
-	hdmi_mask_writeb(hdmi, enable, HDMI_PHY_CONF0,
-			 HDMI_PHY_CONF0_GEN2_PDDQ_OFFSET,
-			 HDMI_PHY_CONF0_GEN2_PDDQ_MASK);
-}
-
-static void dw_hdmi_phy_gen2_txpwron(struct dw_hdmi *hdmi, unsigned char enable)
-{
-	hdmi_mask_writeb(hdmi, enable, HDMI_PHY_CONF0,
-			 HDMI_PHY_CONF0_GEN2_TXPWRON_OFFSET,
-			 HDMI_PHY_CONF0_GEN2_TXPWRON_MASK);
-}
-
 static void dw_hdmi_phy_sel_data_en_pol(struct dw_hdmi *hdmi, unsigned char enable)
 {
 	hdmi_mask_writeb(hdmi, enable, HDMI_PHY_CONF0,
@@ -811,42 +844,55 @@ static int hdmi_phy_configure(struct dw_hdmi *hdmi, unsigned char res, int cscon
 		val = HDMI_MC_FLOWCTRL_FEED_THROUGH_OFF_CSC_IN_PATH;
 	else
 		val = HDMI_MC_FLOWCTRL_FEED_THROUGH_OFF_CSC_BYPASS;
-	hdmi_writeb(hdmi, val, HDMI_MC_FLOWCTRL);
-	
-	/* gen2 tx power off */
-	dw_hdmi_phy_gen2_txpwron(hdmi, 0);
-
-	/* gen2 pddq */
-	dw_hdmi_phy_gen2_pddq(hdmi, 1);
 
-	/* PHY reset */
-	hdmi_writeb(hdmi, HDMI_MC_PHYRSTZ_DEASSERT, HDMI_MC_PHYRSTZ);
-	delay(10);
-	hdmi_writeb(hdmi, HDMI_MC_PHYRSTZ_ASSERT, HDMI_MC_PHYRSTZ);
-	delay(10);
-
-	hdmi_writeb(hdmi, HDMI_MC_HEACPHY_RST_ASSERT, HDMI_MC_HEACPHY_RST);
-
-	hdmi_phy_test_clear(hdmi, 1);
-	hdmi_writeb(hdmi, HDMI_PHY_I2CM_SLAVE_ADDR_PHY_GEN2,
-		    HDMI_PHY_I2CM_SLAVE_ADDR);
-	hdmi_phy_test_clear(hdmi, 0);
-
-	hdmi_phy_i2c_write(hdmi, mpll_config->res[res_idx].cpce, 0x06);
-	hdmi_phy_i2c_write(hdmi, curr_ctrl->curr[res_idx], 0x10);
-	hdmi_phy_i2c_write(hdmi, multi_div->multi[res_idx], 0x11);
-
-	dw_hdmi_phy_enable_powerdown(hdmi, 0);
-
-	/* toggle TMDS enable */
-	dw_hdmi_phy_enable_tmds(hdmi, 0);
-	dw_hdmi_phy_enable_tmds(hdmi, 1);
-
-	/* gen2 tx power on */
-	dw_hdmi_phy_gen2_txpwron(hdmi, 1);
-	dw_hdmi_phy_gen2_pddq(hdmi, 0);
-
-	dw_hdmi_phy_enable_spare(hdmi, 1);
+	{
+		const struct hdmi_reg_op script[] = {
+			HDMI_WR(HDMI_MC_FLOWCTRL, val),
+
+			/* gen2 tx power off, gen2 pddq */
+			HDMI_MOD(HDMI_PHY_CONF0, 0, HDMI_PHY_CONF0_GEN2_TXPWRON_MASK),
+			HDMI_MOD(HDMI_PHY_CONF0, HDMI_PHY_CONF0_GEN2_PDDQ_MASK,
+				 HDMI_PHY_CONF0_GEN2_PDDQ_MASK),
+
+			/* PHY reset */
+			HDMI_WR(HDMI_MC_PHYRSTZ, HDMI_MC_PHYRSTZ_DEASSERT),
+			HDMI_DELAY(10),
+			HDMI_WR(HDMI_MC_PHYRSTZ, HDMI_MC_PHYRSTZ_ASSERT),
+			HDMI_DELAY(10),
+
+			HDMI_WR(HDMI_MC_HEACPHY_RST, HDMI_MC_HEACPHY_RST_ASSERT),
+
+			HDMI_MOD(HDMI_PHY_TST0, HDMI_PHY_TST0_TSTCLR_MASK,
+				 HDMI_PHY_TST0_TSTCLR_MASK),
+			HDMI_WR(HDMI_PHY_I2CM_SLAVE_ADDR, HDMI_PHY_I2CM_SLAVE_ADDR_PHY_GEN2),
+			HDMI_MOD(HDMI_PHY_TST0, 0, HDMI_PHY_TST0_TSTCLR_MASK),
+
+			HDMI_PHY(0x06, mpll_config->res[res_idx].cpce),
+			HDMI_PHY(0x10, curr_ctrl->curr[res_idx]),
+			HDMI_PHY(0x11, multi_div->multi[res_idx]),
+
+			/* leave power down */
+			HDMI_MOD(HDMI_PHY_CONF0, HDMI_PHY_CONF0_PDZ_MASK,
+				 HDMI_PHY_CONF0_PDZ_MASK),
+
+			/* toggle TMDS enable */
+			HDMI_MOD(HDMI_PHY_CONF0, 0, HDMI_PHY_CONF0_ENTMDS_MASK),
+			HDMI_MOD(HDMI_PHY_CONF0, HDMI_PHY_CONF0_ENTMDS_MASK,
+				 HDMI_PHY_CONF0_ENTMDS_MASK),
+
+			/* gen2 tx power on */
+			HDMI_MOD(HDMI_PHY_CONF0, HDMI_PHY_CONF0_GEN2_TXPWRON_MASK,
+				 HDMI_PHY_CONF0_GEN2_TXPWRON_MASK),
+			HDMI_MOD(HDMI_PHY_CONF0, 0, HDMI_PHY_CONF0_GEN2_PDDQ_MASK),
+
+			HDMI_MOD(HDMI_PHY_CONF0, HDMI_PHY_CONF0_SPARECTRL_MASK,
+				 HDMI_PHY_CONF0_SPARECTRL_MASK),
+			HDMI_END
+		};
+
+		if (hdmi_run_script(hdmi, script))
+			SLOG_WARNING("%s: PHY I2C write timed out", __func__);
+	}
 
 	/*Wait for PHY PLL lock */
 	msec = 5;
@@ -925,52 +971,43 @@ static void hdmi_av_composer(struct dw_hdmi *hdmi)
 				HDMI_FC_INVIDCONF_R_V_BLANK_IN_OSC_ACTIVE_LOW |
 				HDMI_FC_INVIDCONF_IN_I_P_PROGRESSIVE |
 				HDMI_FC_INVIDCONF_DVI_MODEZ_HDMI_MODE;
-	hdmi_writeb(hdmi, inv_val, HDMI_FC_INVIDCONF);
-	delay(10);
-	
-	/* Set up horizontal active pixel width */
-	hdmi_writeb(hdmi, timing->hpixels >> 8, HDMI_FC_INHACTV1);
-	delay(10);
-	hdmi_writeb(hdmi, timing->hpixels, HDMI_FC_INHACTV0);
-	delay(10);
-	/* Set up vertical active lines */
-	hdmi_writeb(hdmi, timing->vlines >> 8, HDMI_FC_INVACTV1);
-	delay(10);
-	hdmi_writeb(hdmi, timing->vlines, HDMI_FC_INVACTV0);
-	delay(10);
-	/* Set up horizontal blanking pixel region width */
+
 	hblank = timing->hsw + timing->hfp + timing->hbp;
-	hdmi_writeb(hdmi, hblank >> 8, HDMI_FC_INHBLANK1);
-	delay(10);
-	hdmi_writeb(hdmi, hblank, HDMI_FC_INHBLANK0);
-	delay(10);
-	
-	/* Set up vertical blanking pixel region width */
 	vblank = timing->vsw + timing->vfp + timing->vbp;
-	hdmi_writeb(hdmi, vblank, HDMI_FC_INVBLANK);
-	delay(10);
-	/* Set up HSYNC active edge delay width (in pixel clks) */
 	h_de_hs = timing->hfp; /*hsync_start - hdisplay */
-	hdmi_writeb(hdmi, h_de_hs >> 8, HDMI_FC_HSYNCINDELAY1);
-	delay(10);
-	hdmi_writeb(hdmi, h_de_hs, HDMI_FC_HSYNCINDELAY0);
-	delay(10);
-	
-	/* Set up VSYNC active edge delay (in lines) */
 	v_de_vs = timing->vfp; /* vsync_start - vdisplay */
-	hdmi_writeb(hdmi, v_de_vs, HDMI_FC_VSYNCINDELAY);
-	delay(10);
-	
-	/* Set up HSYNC active pulse width (in pixel clks) */
 	hsync_len = timing->hsw; /* hsync_end - hsync_start */
-	hdmi_writeb(hdmi, hsync_len >> 8, HDMI_FC_HSYNCINWIDTH1);
-	delay(10);
-	hdmi_writeb(hdmi, hsync_len, HDMI_FC_HSYNCINWIDTH0);
-	delay(10);
-	
-	/* Set up VSYNC active edge delay (in lines) */
 	vsync_len = timing->vsw; /* vsync_end - vsync_start */
-	hdmi_writeb(hdmi, vsync_len, HDMI_FC_VSYNCINWIDTH);
+
+	{
+		const struct hdmi_reg_op script[] = {
+			HDMI_WR(HDMI_FC_INVIDCONF, inv_val),
+			/* horizontal active pixel width */
+			HDMI_WR(HDMI_FC_INHACTV1, (timing->hpixels >> 8) & 0xff),
+			HDMI_WR(HDMI_FC_INHACTV0, timing->hpixels & 0xff),
+			/* vertical active lines */
+			HDMI_WR(HDMI_FC_INVACTV1, (timing->vlines >> 8) & 0xff),
+			HDMI_WR(HDMI_FC_INVACTV0, timing->vlines & 0xff),
+			/* horizontal blanking pixel region width */
+			HDMI_WR(HDMI_FC_INHBLANK1, (hblank >> 8) & 0xff),
+			HDMI_WR(HDMI_FC_INHBLANK0, hblank & 0xff),
+			/* vertical blanking pixel region width */
+			HDMI_WR(HDMI_FC_INVBLANK, vblank & 0xff),
+			/* HSYNC active edge delay width (in pixel clks) */
+			HDMI_WR(HDMI_FC_HSYNCINDELAY1, (h_de_hs >> 8) & 0xff),
+			HDMI_WR(HDMI_FC_HSYNCINDELAY0, h_de_hs & 0xff),
+			/* VSYNC active edge delay (in lines) */
+			HDMI_WR(HDMI_FC_VSYNCINDELAY, v_de_vs & 0xff),
+			/* HSYNC active pulse width (in pixel clks) */
+			HDMI_WR(HDMI_FC_HSYNCINWIDTH1, (hsync_len >> 8) & 0xff),
+			HDMI_WR(HDMI_FC_HSYNCINWIDTH0, hsync_len & 0xff),
+			/* VSYNC active pulse width (in lines) */
+			HDMI_WR(HDMI_FC_VSYNCINWIDTH, vsync_len & 0xff),
+			HDMI_END
+		};
+
+		hdmi_run_script(hdmi, script);
+	}
 }
 
 static void dw_hdmi_phy_disable(struct dw_hdmi *hdmi)
@@ -984,26 +1021,25 @@ static void dw_hdmi_phy_disable(struct dw_hdmi *hdmi)
 	hdmi->phy_enabled = 0;
 }
 
+static const struct hdmi_reg_op hdmi_video_path_script[] = {
+	/* control period minimum duration */
+	HDMI_WR(HDMI_FC_CTRLDUR, 12),
+	HDMI_WR(HDMI_FC_EXCTRLDUR, 32),
+	HDMI_WR(HDMI_FC_EXCTRLSPAC, 1),
+
+	/* Set to fill TMDS data channels */
+	HDMI_WR(HDMI_FC_CH0PREAM, 0x0B),
+	HDMI_WR(HDMI_FC_CH1PREAM, 0x16),
+	HDMI_WR(HDMI_FC_CH2PREAM, 0x21),
+	HDMI_END
+};
+
 /* HDMI Initialization Step B.4 */
 static void dw_hdmi_enable_video_path(struct dw_hdmi *hdmi)
 {
 	unsigned char clkdis;
 
-	/* control period minimum duration */
-	hdmi_writeb(hdmi, 12, HDMI_FC_CTRLDUR);
-	delay(10);
-	hdmi_writeb(hdmi, 32, HDMI_FC_EXCTRLDUR);
-	delay(10);
-	hdmi_writeb(hdmi, 1, HDMI_FC_EXCTRLSPAC);
-	delay(10);
-
-	/* Set to fill TMDS data channels */
-	hdmi_writeb(hdmi, 0x0B, HDMI_FC_CH0PREAM);
-	delay(10);
-	hdmi_writeb(hdmi, 0x16, HDMI_FC_CH1PREAM);
-	delay(10);
-	hdmi_writeb(hdmi, 0x21, HDMI_FC_CH2PREAM);
-	delay(10);
+	hdmi_run_script(hdmi, hdmi_video_path_script);
 
 	/* Enable pixel clock and tmds data path */
 	clkdis = 0x7F;
@@ -1040,6 +1076,14 @@ static void dw_hdmi_clear_overflow(struct dw_hdmi *hdmi)
 		hdmi_writeb(hdmi, val, HDMI_FC_INVIDCONF);
 }
 
+static const struct hdmi_reg_op hdmi_audio_script[] = {
+	HDMI_WR(HDMI_AUD_CONF0, 0x2F),			// Enable I2S0,1,2,3
+	HDMI_WR(HDMI_AUD_CONF1, 0x30),			// Right-justified, 16 bit data
+	HDMI_WR(HDMI_AUD_CONF2, 0x00),			// L-PCM audio data
+	HDMI_WR(HDMI_AUD_INPUTCLKFS, 0x04),		// 64Fs
+	HDMI_END
+};
+
 static int dw_hdmi_setup(struct dw_hdmi *hdmi)
 {
 	int ret;
@@ -1069,14 +1113,8 @@ static int dw_hdmi_setup(struct dw_hdmi *hdmi)
 
 	if (hdmi->audio_enable)
 	{
-		hdmi_writeb(hdmi, 0x2F, HDMI_AUD_CONF0);			// Enable I2S0,1,2,3
-		delay(10);
-		hdmi_writeb(hdmi, 0x30, HDMI_AUD_CONF1);			// Right-justified, 16 bit data
-		delay(10);
-		hdmi_writeb(hdmi, 0x00, HDMI_AUD_CONF2);			// L-PCM audio data
-		delay(10);
-		hdmi_writeb(hdmi, 0x04, HDMI_AUD_INPUTCLKFS);		// 64Fs
-	
+		hdmi_run_script(hdmi, hdmi_audio_script);
+
 		/* HDMI Initialization Step E - Configure audio */
 		hdmi_clk_regenerator_update_pixel_clock(hdmi);
 		hdmi_enable_audio_clk(hdmi);
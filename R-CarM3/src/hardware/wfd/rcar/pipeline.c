@@ -20,12 +20,159 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <math.h>
+#include <sys/neutrino.h>
+#include <sys/syspage.h>
 #include <screen/screen.h>
 #include <screen/iomsg.h>
 #include "rcar_display.h"
 
+static uint32_t cycles_to_us(uint64_t cycles)
+{
+	return (uint32_t)(cycles * 1000000 / SYSPAGE_ENTRY(qtime)->cycles_per_sec);
+}
+
+/*
+ * Fill in the latch time of earlier commits while the port still has their
+ * vblank. The composer's vsync ISR logs the vblank it latched each list at;
+ * without that log a list is taken as latched DL_LATCH_VSYNCS after ready.
+ */
+static void frame_timing_resolve(du_dev_t *dev, frame_timing_t *timing, port_t *port)
+{
+	compose_hdl *hw_compose = port->du_cfg->hw_compose;
+	frame_time_t *t;
+	unsigned latch_vsync;
+	unsigned i;
+	int ret;
+
+	for (i = 0; i < timing->count; i++) {
+		t = &timing->ring[(timing->head + FRAME_TIMING_RING - 1 - i) % FRAME_TIMING_RING];
+		if (t->resolved) {
+			continue;
+		}
+		if (t->seq && hw_compose->dl_latched) {
+			ret = hw_compose->dl_latched(dev, port, t->seq, &latch_vsync);
+			if (ret == 0) {
+				continue;
+			}
+			if (ret < 0) {
+				/* replaced by a later commit before the VSP fetched it */
+				t->resolved = 1;
+				continue;
+			}
+		} else {
+			latch_vsync = t->vsync + DL_LATCH_VSYNCS;
+			if ((int)(port->vsync_counter - latch_vsync) < 0) {
+				continue;
+			}
+		}
+		if (port->vsync_counter - latch_vsync >= VBLANK_HISTORY) {
+			t->resolved = 1;
+			continue;
+		}
+		/* the ISR bumps the counter before storing the time, skip until it did */
+		if (port->vblank_cycles[latch_vsync & (VBLANK_HISTORY - 1)] <= t->ready) {
+			continue;
+		}
+		t->latch = port->vblank_cycles[latch_vsync & (VBLANK_HISTORY - 1)];
+		t->resolved = 1;
+		if ((int)(latch_vsync - t->target) > 0) {
+			timing->missed += latch_vsync - t->target;
+		}
+	}
+}
+
+static void frame_timing_record(du_dev_t *dev, pipe_t *pipe, port_t *port, uint64_t commit, unsigned commit_vsync)
+{
+	compose_hdl *hw_compose = port->du_cfg->hw_compose;
+	frame_timing_t *timing = &pipe->timing;
+	frame_time_t *t;
+
+	frame_timing_resolve(dev, timing, port);
+
+	t = &timing->ring[timing->head];
+	t->commit = commit;
+	t->ready = ClockCycles();
+	t->latch = 0;
+	t->vsync = port->vsync_counter;
+	/* published before the next vblank, it is latched DL_LATCH_VSYNCS after the entry */
+	t->target = commit_vsync + DL_LATCH_VSYNCS;
+	t->seq = hw_compose->dl_seq ? hw_compose->dl_seq(dev, port) : 0;
+	/* the same list as the last record: this commit published nothing */
+	t->resolved = t->seq && (t->seq == timing->seq) && timing->commits;
+	timing->seq = t->seq;
+	timing->head = (timing->head + 1) % FRAME_TIMING_RING;
+	if (timing->count < FRAME_TIMING_RING) {
+		timing->count++;
+	}
+	timing->commits++;
+}
+
+static int frame_timing_cmp(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* p50, p90, p99 and max of n samples */
+static void frame_timing_percentiles(uint32_t *v, int n, WFDint *out)
+{
+	if (n == 0) {
+		out[0] = out[1] = out[2] = out[3] = 0;
+		return;
+	}
+	qsort(v, n, sizeof(*v), frame_timing_cmp);
+	out[0] = v[(n - 1) * 50 / 100];
+	out[1] = v[(n - 1) * 90 / 100];
+	out[2] = v[(n - 1) * 99 / 100];
+	out[3] = v[n - 1];
+}
+
+static void frame_timing_report(du_dev_t *dev, pipe_t *pipe, port_t *port, WFDint *value)
+{
+	frame_timing_t *timing = &pipe->timing;
+	uint32_t ready[FRAME_TIMING_RING];
+	uint32_t latch[FRAME_TIMING_RING];
+	uint32_t scanout[FRAME_TIMING_RING];
+	uint32_t blank_us = 0;
+	int nr = 0, nl = 0;
+	unsigned i;
+
+	if (port) {
+		frame_timing_resolve(dev, timing, port);
+		/* vblank is signalled at the start of the vertical blanking */
+		if (port->active_mode && port->active_mode->timings->pixel_clock_kHz) {
+			const struct wfdcfg_timing *tm = port->active_mode->timings;
+			uint64_t htotal = tm->hpixels + tm->hfp + tm->hsw + tm->hbp;
+			uint64_t vblank = tm->vfp + tm->vsw + tm->vbp;
+
+			blank_us = (uint32_t)(vblank * htotal * 1000 / tm->pixel_clock_kHz);
+		}
+	}
+
+	for (i = 0; i < timing->count; i++) {
+		frame_time_t *t = &timing->ring[i];
+
+		ready[nr++] = cycles_to_us(t->ready - t->commit);
+		if (t->latch) {
+			latch[nl] = cycles_to_us(t->latch - t->commit);
+			scanout[nl] = latch[nl] + blank_us;
+			nl++;
+		}
+	}
+
+	value[WFD_FRAME_TIMING_SAMPLES_RCAR] = timing->count;
+	value[WFD_FRAME_TIMING_COMMITS_RCAR] = timing->commits;
+	value[WFD_FRAME_TIMING_MISSED_RCAR] = timing->missed;
+	frame_timing_percentiles(ready, nr, &value[WFD_FRAME_TIMING_READY_P50_RCAR]);
+	frame_timing_percentiles(latch, nl, &value[WFD_FRAME_TIMING_LATCH_P50_RCAR]);
+	frame_timing_percentiles(scanout, nl, &value[WFD_FRAME_TIMING_SCANOUT_P50_RCAR]);
+}
+
 WFD_API_CALL WFDint WFD_APIENTRY wfdEnumeratePipelines(WFDDevice device, WFDint *pipelineIds,
     WFDint pipelineIdsCount, const WFDint *filterList) WFD_APIEXIT
 {
@@ -137,9 +284,11 @@ wfdDestroyPipeline(WFDDevice device, WFDPipeline pipeline) WFD_APIEXIT
 	}
 
 	wfdCommitPipelineUpdates(dev, pipe);
+
+	/* stops the scaler thread, must see the pipe before it is cleared */
+	scale_pipe_quit(dev, pipe);
+
 	memset(pipe, 0, sizeof(*pipe));
-    
-    scale_pipe_quit(dev, pipe);
 
 	UNLOCK_DEVICE();
 
@@ -393,6 +542,15 @@ wfdGetPipelineAttribiv(WFDDevice device, WFDPipeline pipeline,
 			}
 			*value = 255;
 			break;
+		case WFD_PIPELINE_FRAME_TIMING_RCAR:
+			if (count != WFD_FRAME_TIMING_COUNT_RCAR) {
+				LOG_ERROR(WFD_ERROR_ILLEGAL_ARGUMENT);
+				return;
+			}
+			LOCK_DEVICE();
+			frame_timing_report(dev, pipe, pipe->port, value);
+			UNLOCK_DEVICE();
+			break;
 		default:
 			LOG_ERROR(WFD_ERROR_BAD_ATTRIBUTE);
 			return;
@@ -556,6 +714,11 @@ WFDPipelineConfigAttrib attrib, WFDint count,
 			}
 		}
 		break;
+	case WFD_PIPELINE_FRAME_TIMING_RCAR:
+		LOCK_DEVICE();
+		memset(&pipe->timing, 0, sizeof(pipe->timing));
+		UNLOCK_DEVICE();
+		break;
 	default:
 		LOG_ERROR(WFD_ERROR_BAD_ATTRIBUTE);
 		break;
@@ -741,6 +904,8 @@ wfdCommitPipelineUpdates(du_dev_t *dev, pipe_t *pipe)
 	compose_hdl *hw_compose_hdl;
     int dst_width = pipe->dst_rect[2];
     int dst_height = pipe->dst_rect[3];
+    uint64_t commit_cycles = ClockCycles();
+    unsigned commit_vsync;
 
     source_t *source = NULL;
 	port_t *port = pipe->port;
@@ -754,6 +919,7 @@ wfdCommitPipelineUpdates(du_dev_t *dev, pipe_t *pipe)
         return 0;
     }
 	hw_compose_hdl = port->du_cfg->hw_compose;
+	commit_vsync = port->vsync_counter;
 
 	SLOG_DEBUG("%s: pipeId = %d", __FUNCTION__, pipe->pipeId);
 
@@ -782,6 +948,7 @@ wfdCommitPipelineUpdates(du_dev_t *dev, pipe_t *pipe)
 	hw_compose_hdl->activate_pipeline(dev,pipe);
 	if (hw_compose_hdl->frame_update)
 		hw_compose_hdl->frame_update(dev,pipe);
+	frame_timing_record(dev, pipe, port, commit_cycles, commit_vsync);
 	
 	pipe->bound_src = pipe->src;
 	pipe->bound_port = pipe->port;
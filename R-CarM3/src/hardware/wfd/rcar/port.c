@@ -171,6 +171,8 @@ wfdCreatePort(WFDDevice wfd_device, WFDint portId, const WFDint *attribList) WFD
             port->native_height = pmode->timings->vlines;
         }
         STAILQ_INSERT_TAIL(&port->modelist, pmode, list_entry);
+        /* solve the clocks now, a mode set only replays the registers */
+        rcardu_mode_solve(dev, port, pmode);
     }
 
     port->gamma = LUT_DEF_GAMMA;
@@ -683,6 +685,31 @@ WFD_API_CALL void WFD_APIENTRY wfdGetPortAttribiv(WFDDevice wfd_device, WFDPort
             *value = WFD_FALSE;
             SLOG_DEBUG2("       return: %s (WFD_PORT_PROTECTION_ENABLE)", *value == WFD_FALSE ? "WFD_FALSE" : "WFD_TRUE");
 			break;
+		case WFD_PORT_DL_STATS_RCAR:
+            if (count != WFD_DL_STATS_COUNT_RCAR || !port->du_cfg->hw_compose->dl_stats) {
+                LOG_ERROR(WFD_ERROR_ILLEGAL_ARGUMENT);
+                return;
+            }
+            LOCK_DEVICE();
+            port->du_cfg->hw_compose->dl_stats(dev, port, value);
+            UNLOCK_DEVICE();
+			break;
+		case WFD_PORT_DL_CHECK_RCAR:
+            if (count != 1 || !port->du_cfg->hw_compose->dl_check) {
+                LOG_ERROR(WFD_ERROR_ILLEGAL_ARGUMENT);
+                return;
+            }
+            LOCK_DEVICE();
+            *value = port->du_cfg->hw_compose->dl_check(dev, port, -1) > 0;
+            UNLOCK_DEVICE();
+			break;
+		case WFD_PORT_SCALE_POOL_STATS_RCAR:
+            if (count != WFD_SCALE_POOL_STATS_COUNT_RCAR) {
+                LOG_ERROR(WFD_ERROR_ILLEGAL_ARGUMENT);
+                return;
+            }
+            scale_pool_stats(&dev->scale_pool, value);
+			break;
 		default:
 			LOG_ERROR(WFD_ERROR_BAD_ATTRIBUTE);
 			SLOG_DEBUG2("       return: WFD_ERROR_BAD_ATTRIBUTE");
@@ -836,6 +863,28 @@ wfdSetPortAttribiv(WFDDevice wfd_device, WFDPort wfd_port,
              UNLOCK_DEVICE();
              SLOG_DEBUG2("       set: %08X (WFD_PORT_POWER_MODE)", port->power_mode);
              break;
+        case WFD_PORT_DL_STATS_RCAR:
+             if (port->du_cfg->hw_compose->dl_stats) {
+                 LOCK_DEVICE();
+                 port->du_cfg->hw_compose->dl_stats(dev, port, NULL);
+                 UNLOCK_DEVICE();
+             }
+             break;
+        case WFD_PORT_DL_CHECK_RCAR:
+             if (!port->du_cfg->hw_compose->dl_check) {
+                 LOG_ERROR(WFD_ERROR_NOT_SUPPORTED);
+                 break;
+             }
+             LOCK_DEVICE();
+             if (port->du_cfg->hw_compose->dl_check(dev, port, !!*value) < 0) {
+                 LOG_ERROR_LOCKED(WFD_ERROR_OUT_OF_MEMORY);
+                 break;
+             }
+             UNLOCK_DEVICE();
+             break;
+        case WFD_PORT_SCALE_POOL_STATS_RCAR:
+             scale_pool_stats(&dev->scale_pool, NULL);
+             break;
         default:
              LOG_ERROR(WFD_ERROR_BAD_ATTRIBUTE);
              SLOG_DEBUG2("       return: (WFD_ERROR_BAD_ATTRIBUTE: %08X)", attrib);
@@ -99,6 +99,10 @@
 
 #define RCARDU_POSIX_TYPED_MEM_PATH "/memory/below4G"
 
+/* driver private win_image_t flags of buffers imported by wfdImportWFDEGLImageRCAR() */
+#define WIN_IMAGE_FLAG_IMPORTED_RCAR	(1 << 24)	/* strides[0] is the line pitch, memory not ours */
+#define WIN_IMAGE_FLAG_CACHED_RCAR		(1 << 25)	/* clean the CPU cache of vaddr before a commit */
+
 #define LUT_MIN_GAMMA (0.01f)
 #define LUT_DEF_GAMMA (1.00f)
 #define LUT_MAX_GAMMA (7.99f)
@@ -207,7 +211,11 @@ typedef struct {
 	void	(*deactivate_pipeline)(void *device, void *pipe);
 	void	(*frame_update)(void *device, void *pipe);
 	void	(*sub_hw_fini)(void *device, void *disp);
-	void 	(*sub_hw_frame_sync)(void *device);
+	const struct sigevent *(*sub_hw_frame_sync)(void *device, unsigned vsync);	/* from the vsync ISR */
+	void	(*dl_stats)(void *device, void *disp, int *value);
+	int		(*dl_check)(void *device, void *disp, int enable);
+	unsigned (*dl_seq)(void *device, void *disp);	/* display list of the last commit, 0 if unknown */
+	int		(*dl_latched)(void *device, void *disp, unsigned seq, unsigned *vsync);
 	uint32_t composited_pbuffer;
 	uint8_t *composited_vbuffer;
 } compose_hdl;
@@ -273,6 +281,24 @@ typedef struct
     int             pixel_format;
 } source_t;
 
+/*
+ * Clock and DU timing registers of a mode, solved once when the port is
+ * created so a mode set only writes registers.
+ */
+typedef struct
+{
+    int                 valid;
+    int                 clk_source_mode;
+    int                 source_clk;
+    void                (*ext_clk_config)(int channel,int clock);
+    uint32_t            dpllcr;         /* fixed external clock only */
+    uint32_t            pixel_clk;
+    float               actual_refresh;
+    uint32_t            hdsr, hder, vdsr, vder;
+    uint32_t            hswr, vspr, hcr, vcr;
+    uint32_t            desr, dewr, escr;
+} mode_solution_t;
+
 typedef struct _portmode_t
 {
     STAILQ_ENTRY(_portmode_t) list_entry;
@@ -282,8 +308,19 @@ typedef struct _portmode_t
     WFDint              mirror;
     WFDint              rotation_support;
     WFDint              interlaced;
+    mode_solution_t     solution;
 } portmode_t;
 
+/* vblank timestamps kept per port, power of two */
+#define VBLANK_HISTORY			32
+/*
+ * A display list published at vsync count c is written to the DL header by
+ * the vsync ISR at c+1 and fetched by the VSP at c+2.
+ */
+#define DL_LATCH_VSYNCS			2
+/* commits kept per pipeline for WFD_PIPELINE_FRAME_TIMING_RCAR */
+#define FRAME_TIMING_RING		64
+
 typedef struct _port_t
 {
     int                         portId;
@@ -332,22 +369,129 @@ typedef struct _port_t
 	int							irqcoid;
     pthread_mutex_t             vsync_mutex;
     pthread_cond_t              vsync_cv;
-	unsigned					want_vsync_pulse;
-	volatile uint32_t			vsync_done;
+	volatile unsigned			want_vsync_pulse;
+	unsigned					commit_vsync;	/* vsync_counter when the last commit was published */
+	uint64_t					vblank_cycles[VBLANK_HISTORY];	/* ClockCycles() of vblank n at [n % VBLANK_HISTORY] */
 	uint32_t					dl_phy;
 	uint8_t						*dl_vrt;
 } port_t;
 
+/* Scaling output buffers are recycled through a per-device pool */
+#define SCALE_POOL_SLOTS			16
+#define SCALE_POOL_DEF_MAX_BUFFERS	9
+#define SCALE_POOL_DEF_MAX_BYTES	(96 * 1024 * 1024)
+/* size classes, so that buffers survive small resizes */
+#define SCALE_POOL_STRIDE_ALIGN		1024
+#define SCALE_POOL_HEIGHT_ALIGN		64
+
+typedef struct
+{
+	uint8_t				*vaddr;
+	uint32_t			paddr;
+	int					format;
+	int					stride;
+	int					height;
+	size_t				size;
+	int					in_use;
+	uint64_t			last_used;
+	/* put back while still fetched: in use until *retire_counter reaches retire_vsync */
+	const volatile unsigned	*retire_counter;
+	unsigned			retire_vsync;
+	uint64_t			retire_ns;
+} scale_buf_t;
+
 typedef struct
 {
-	int					cur_idx;
-	uint32_t		obuffer_phys[2];
-	uint8_t				*obuffer[2];
+	pthread_mutex_t		mutex;
+	scale_buf_t			buf[SCALE_POOL_SLOTS];
+	unsigned			max_buffers;
+	size_t				max_bytes;
+	unsigned			count;
+	size_t				bytes;
+	uint64_t			tick;
+	/* statistics */
+	unsigned			allocs;
+	unsigned			reuses;
+	unsigned			evictions;
+	unsigned			failures;
+} scale_pool_t;
+
+/*
+ * A scaled frame is latched DL_LATCH_VSYNCS after its commit: on screen,
+ * programmed for the next frame, last committed and scaler target.
+ */
+#define SCALE_BUFFER_NUM	4
+#define SCALE_LATCH_VSYNCS	DL_LATCH_VSYNCS
+
+typedef struct
+{
+	uint32_t			fence;
+	int					buf_idx;
+	uint32_t			src_paddr[3];
+	int					src_format;
+	int					src_width;
+	int					src_height;
+	int					src_stride;
+	int					src_rect[4];
+	int					dst_format;
+	int					dst_width;
+	int					dst_height;
+} scale_job_t;
+
+typedef struct
+{
+	int					cur_idx;		/* handed to the commits */
+	int					prev_idx;		/* replaced by cur_idx, until cur_idx is published */
+	int					ready_idx;
+	scale_buf_t			*obuf[SCALE_BUFFER_NUM];
+	/* port vsync_counter from which obuf[i] is not fetched anymore */
+	unsigned			release[SCALE_BUFFER_NUM];
+	int					cur_published;
+	unsigned			cur_vsync_lo;	/* counter range of the first publish of cur_idx */
+	unsigned			cur_vsync_hi;
+	unsigned			prev_vsync_lo;
+	unsigned			submit_vsync;	/* counter when the commit entered Run_Scaling */
+	const volatile unsigned	*vsync_counter;	/* of the port showing the scaled layer */
+	scale_pool_t		*pool;
     void                *dev;
 	int					last_dst_width;
 	int					last_dst_height;
+	int					last_dst_format;
+	/* job served by the scaler thread, fences count submitted/done jobs */
+	pthread_t			tid;
+	int					running;
+	pthread_mutex_t		mutex;
+	pthread_cond_t		cond;
+	scale_job_t			job;
+	uint32_t			fence_submitted;
+	uint32_t			fence_done;
+	uint64_t			last_submit_ns;
+	/* statistics */
+	unsigned			jobs;
+	unsigned			fence_waits;
 } scale_t;
 
+typedef struct
+{
+	uint64_t			commit;		/* ClockCycles() at commit entry */
+	uint64_t			ready;		/* display list published */
+	uint64_t			latch;		/* vblank the list was latched at, 0 if unknown */
+	unsigned			vsync;		/* port vsync_counter at ready */
+	unsigned			target;		/* earliest vblank the list could be latched at */
+	unsigned			seq;		/* display list, 0 if the composer does not log latches */
+	int					resolved;	/* latch known, or known never to come */
+} frame_time_t;
+
+typedef struct
+{
+	frame_time_t		ring[FRAME_TIMING_RING];
+	unsigned			head;
+	unsigned			count;
+	unsigned			commits;
+	unsigned			missed;		/* vblanks lists were latched after their target */
+	unsigned			seq;		/* of the last record */
+} frame_timing_t;
+
 typedef struct _pipe_t
 {
     int                 pipeId;
@@ -380,6 +524,7 @@ typedef struct _pipe_t
     int                 filter;
     int                 interlaced;
 	scale_t				scale;
+	frame_timing_t		timing;
 } pipe_t;
 
 typedef struct {
@@ -397,6 +542,17 @@ typedef struct {
 	unsigned		portType;
 } channel_t;
 
+/* DPLL dividers per (pixel clock, input clock), power of two */
+#define DU_PLL_CACHE_SIZE		16
+
+typedef struct
+{
+    uint32_t            ideal_dclk;     /* 0 when free */
+    uint32_t            extclk;
+    uint32_t            n, m, fdpll;
+    uint32_t            best_clk;
+} du_pll_solution_t;
+
 typedef struct _du_dev_t
 {
     struct
@@ -425,6 +581,10 @@ typedef struct _du_dev_t
 
     int  				max_width;
     int  				max_height;
+
+    scale_pool_t		scale_pool;
+    du_pll_solution_t	pll_cache[DU_PLL_CACHE_SIZE];
+    int					clk_source_warned;	/* default clock source logged once */
 } du_dev_t;
 
 /* Internal function prototypes */
@@ -439,6 +599,7 @@ int rcardu_init(du_dev_t *dev);
 port_t * find_port_from_channel (du_dev_t *dev, int chan);
 void rcardu_fini(du_dev_t *dev);
 void port_init(du_dev_t *dev, port_t *port);
+int rcardu_mode_solve(du_dev_t *dev, port_t *port, portmode_t *mode);
 void du0_du1_plane_setting (du_dev_t *dev, port_t *port);
 int lvds_init(void *arg);
 int hdmi_init(void *arg);
@@ -451,6 +612,12 @@ int get_config_data(du_dev_t *dev, const char *filename);
 int rcardu_wait_vsync(du_dev_t *dev, port_t *port);
 void scale_pipe_init(du_dev_t* dev, pipe_t* pipe);
 void scale_pipe_quit(du_dev_t *dev, pipe_t* pipe);
+void scale_pool_init(du_dev_t *dev);
+void scale_pool_fini(du_dev_t *dev);
+scale_buf_t *scale_pool_get(scale_pool_t *pool, int format, int stride, int height, size_t size);
+void scale_pool_put(scale_pool_t *pool, scale_buf_t *buf);
+void scale_pool_stats(scale_pool_t *pool, int *value);
+void scale_pool_put_after(scale_pool_t *pool, scale_buf_t *buf, const volatile unsigned *counter, unsigned vsync);
 
 int wfdCommitPortUpdates(du_dev_t *dev, port_t *port);
 
@@ -119,9 +119,10 @@ parse_device_config(du_dev_t *dev)
 	return (get_config_data(dev, filename));
 }
 
-static inline struct sigevent* du_isr (void *arg, int id)
+static inline const struct sigevent* du_isr (void *arg, int id)
 {
 	port_t *port = arg;
+	const struct sigevent *event = NULL;
 	/* Clear the interrupt */
 	if (!(*DSSR & (1<<11))) {
 		/* Not our interrupt */
@@ -129,15 +130,17 @@ static inline struct sigevent* du_isr (void *arg, int id)
 	}
 	*DSRCR = DSRCR_VBCL;
 	atomic_add(&port->vsync_counter, 1);
+	port->vblank_cycles[port->vsync_counter & (VBLANK_HISTORY - 1)] = ClockCycles();
 	
 	if (port->du_cfg && port->du_cfg->hw_compose->sub_hw_frame_sync && port->du_cfg->compose_dev)
-		port->du_cfg->hw_compose->sub_hw_frame_sync (port->du_cfg->compose_dev);
+		event = port->du_cfg->hw_compose->sub_hw_frame_sync (port->du_cfg->compose_dev, port->vsync_counter);
 	
+	/* one event per interrupt, the composer keeps asking at each vsync until served */
 	if (port->want_vsync_pulse) {
 		port->want_vsync_pulse = 0;
 		return &port->irqevent;
 	}
-	return NULL;
+	return event;
 }
 
 
@@ -323,36 +326,175 @@ void output_route_setting (du_dev_t *dev, port_t *port)
 				DPTSR_PnTS(2);	 	/* Plane 3 uses Display timing generator 1/3 */
 }
 
-void du_timing_setting (du_dev_t *dev, port_t *port)
+/* Look the DPLL dividers up in the device cache, searching them on a miss */
+static uint32_t du_pll_lookup (du_dev_t *dev, port_t *port, uint32_t ideal_dclk, uint32_t extclk,
+		uint32_t *dpll_n, uint32_t *dpll_m, uint32_t *dpll_fdpll)
+{
+	du_pll_solution_t *pll;
+	unsigned hash = (ideal_dclk / 1000 * 31 + extclk / 1000) & (DU_PLL_CACHE_SIZE - 1);
+	uint32_t best_clk;
+	unsigned i;
+
+	for (i = 0; i < DU_PLL_CACHE_SIZE; i++) {
+		pll = &dev->pll_cache[(hash + i) & (DU_PLL_CACHE_SIZE - 1)];
+		if (pll->ideal_dclk == 0) {
+			break;
+		}
+		if ((pll->ideal_dclk == ideal_dclk) && (pll->extclk == extclk)) {
+			*dpll_n = pll->n;
+			*dpll_m = pll->m;
+			*dpll_fdpll = pll->fdpll;
+			return pll->best_clk;
+		}
+	}
+
+	pll = (i < DU_PLL_CACHE_SIZE) ? &dev->pll_cache[(hash + i) & (DU_PLL_CACHE_SIZE - 1)] : NULL;
+	best_clk = gen3_du_pll_setting (port, ideal_dclk, extclk, dpll_n, dpll_m, dpll_fdpll);
+	if (pll) {
+		pll->ideal_dclk = ideal_dclk;
+		pll->extclk = extclk;
+		pll->n = *dpll_n;
+		pll->m = *dpll_m;
+		pll->fdpll = *dpll_fdpll;
+		pll->best_clk = best_clk;
+	}
+
+	return best_clk;
+}
+
+/*
+ * Resolve the clock source of a mode from its wfdcfg extensions and compute
+ * the DPLL/ESCR settings and DU timing registers for it.
+ */
+int rcardu_mode_solve (du_dev_t *dev, port_t *port, portmode_t *mode)
 {
+	const struct wfdcfg_timing *timings = mode->timings;
+	const struct wfdcfg_keyval* keyval = NULL;
+	mode_solution_t *sol = &mode->solution;
 	int hsw,hbp,hfp,hpixels,vsw,vbp,vfp,vlines,hc,vc;
-	float refresh_rate, dclk;
+	float dclk;
 	int escr_divisor = 1;
 	int escr_clock_bit;
+	uint32_t dpll_n, dpll_m, ideal_dclk, best_clock;
+	uint32_t dpll_fdpll;
+
+	memset(sol, 0, sizeof(*sol));
+
+	keyval = wfdcfg_mode_get_extension(timings, WFDCFG_EXT_PORTMODE_CLOCK_SOURCE);
+	if (keyval != NULL) {
+		sol->clk_source_mode = keyval->i;
+	} else {
+		/* Use internal clock by default */
+		sol->clk_source_mode = RCAR_INTERNAL_CLOCK_SOURCE;
+		if (!dev->clk_source_warned) {
+			dev->clk_source_warned = 1;
+			SLOG_WARNING("Clock source mode not provided. Use internal clock by default.");
+		}
+	}
+
+	switch (sol->clk_source_mode){
+		case RCAR_INTERNAL_CLOCK_SOURCE:
+			sol->source_clk = RCAR_DU_INTERNAL_CLOCK;
+
+			/* Internal clock source workaround in R-Car H3(ES1.0) */
+			if ((dev->chip_type == RCAR_PRODUCT_H3) && (dev->chip_revision == RCAR_REVISION_ES10))
+			{
+				sol->source_clk = RCAR_DU_INTERNAL_CLOCK_WS10;
+			}
+			break;
+		case RCAR_FIXED_EXTERNAL_CLOCK_SOURCE:
+			keyval = wfdcfg_mode_get_extension(timings, WFDCFG_EXT_PORTMODE_EXTERNAL_CLOCK_RATE);
+			if (keyval != NULL) {
+				sol->source_clk = keyval->i;
+			} else {
+				SLOG_ERROR("wfdcfg library doesn't provide external clock value for external clock source");
+				return EXIT_FAILURE;
+			}
+			break;
+		case RCAR_CONFIGURABLE_EXTERNAL_CLOCK_SOURCE:
+			keyval = wfdcfg_mode_get_extension(timings, WFDCFG_EXT_FN_EXTCLK_CONFIG);
+			if (keyval != NULL) {
+				sol->ext_clk_config = keyval->p;
+			} else {
+				SLOG_ERROR("wfdcfg library doesn't provide configure function for external clock chip");
+				return EXIT_FAILURE;
+			}
+			break;
+		default:
+			SLOG_ERROR("Unsupported clock mode: %d",sol->clk_source_mode);
+			return EXIT_FAILURE;
+	}
 
-    uint32_t dpll_n, dpll_m, ideal_dclk, best_clock, dpllcr=0;
-    uint32_t dpll_fdpll;
-	
 	/* Get DU timing setting */
-	hsw = port->active_mode->timings->hsw;
-	hbp = port->active_mode->timings->hbp;
-	hfp = port->active_mode->timings->hfp;
-	vsw = port->active_mode->timings->vsw;
-	vbp = port->active_mode->timings->vbp;
-	vfp = port->active_mode->timings->vfp;
-	hpixels = port->active_mode->timings->hpixels;
-	vlines = port->active_mode->timings->vlines;
+	hsw = timings->hsw;
+	hbp = timings->hbp;
+	hfp = timings->hfp;
+	vsw = timings->vsw;
+	vbp = timings->vbp;
+	vfp = timings->vfp;
+	hpixels = timings->hpixels;
+	vlines = timings->vlines;
     hc = hsw + hbp + hfp + hpixels - 1;
     vc = vsw + vbp + vfp + vlines - 1;
-	refresh_rate = port->active_mode->refresh;
 
-    dclk = (hc+1)*(vc+1)*refresh_rate;
-    ideal_dclk = port->active_mode->timings->pixel_clock_kHz*1000;
+    dclk = (hc+1)*(vc+1)*mode->refresh;
+    ideal_dclk = timings->pixel_clock_kHz*1000;
+
+	escr_clock_bit = (sol->clk_source_mode == RCAR_INTERNAL_CLOCK_SOURCE)?1:0;
+
+	if (sol->clk_source_mode == RCAR_FIXED_EXTERNAL_CLOCK_SOURCE){
+	    escr_divisor = 2; //escr_divisor result would be 2 in case using external clock
+		/* Get best clock and calculate DPLL */
+		best_clock = du_pll_lookup (dev, port, ideal_dclk, sol->source_clk, &dpll_n, &dpll_m, &dpll_fdpll);
+		sol->pixel_clk = best_clock/escr_divisor;
+		SLOG_DEBUG("best_clock from gen3_du_pll_setting:%d ", best_clock);
+
+		sol->dpllcr = DPLLCR_CODE | DPLLCR_M(dpll_m) |
+			DPLLCR_FDPLL(dpll_fdpll) | DPLLCR_CLKE |
+			DPLLCR_N(dpll_n) | DPLLCR_STBY;
+
+		if (port->du_cfg->du_index == DU_CH_1)
+			sol->dpllcr |= (DPLLCR_PLCS1 | DPLLCR_INCS_DPLL01_DOTCLKIN13);
+		if (port->du_cfg->du_index == DU_CH_2) {
+			sol->dpllcr |= (DPLLCR_PLCS0 | DPLLCR_INCS_DPLL01_DOTCLKIN02);
+			sol->dpllcr |=  (0x1 << 21); /* workaround for WS1.0/1.1 */
+		}
+		SLOG_DEBUG("dpllcr setting value: dpll_n %d, dpll_m %d, dpll_fdpll %d",dpll_n, dpll_m, dpll_fdpll);
+	} else if (sol->clk_source_mode == RCAR_CONFIGURABLE_EXTERNAL_CLOCK_SOURCE){
+	    escr_divisor = 1; //escr_divisor result would be 1 in case using programmable external clock
+		sol->source_clk = ideal_dclk; // ext_clk_config should configure input clock exactly by ideal_dclk
+		sol->pixel_clk = sol->source_clk/escr_divisor;
+	} else if (sol->clk_source_mode == RCAR_INTERNAL_CLOCK_SOURCE){
+	    escr_divisor    = (uint32_t)(round((float)sol->source_clk/dclk));
+	    sol->pixel_clk = sol->source_clk/escr_divisor;
+	}
+
+	sol->hdsr = hsw + hbp - 19;
+	sol->hder = hsw + hbp - 19 + hpixels;
+	sol->vdsr = vbp - 2;
+	sol->vder = vbp - 2 + vlines;
+	sol->hswr = hsw - 1;
+	sol->vspr = vbp + vfp + vlines - 1;
+	sol->hcr = hc;
+	sol->vcr = vc;
+	sol->desr = hsw + hbp;
+	sol->dewr = hpixels;
+	sol->escr = (escr_divisor - 1) | (escr_clock_bit<<20);
+
+    sol->actual_refresh = (float)sol->pixel_clk/(float)((hc+1)*(vc+1));
+	sol->valid = 1;
+
+	return EXIT_SUCCESS;
+}
 
-	escr_clock_bit = (port->du_cfg->clk_source_mode == RCAR_INTERNAL_CLOCK_SOURCE)?1:0;
+void du_timing_setting (du_dev_t *dev, port_t *port)
+{
+	const mode_solution_t *sol = &port->active_mode->solution;
+	uint32_t ideal_dclk = port->active_mode->timings->pixel_clock_kHz*1000;
 
     SLOG_INFO("DU%d %dx%d @ %.2f %d, %s %d",
-            port->du_cfg->du_index,hpixels,vlines,refresh_rate,ideal_dclk,
+            port->du_cfg->du_index,port->active_mode->timings->hpixels,port->active_mode->timings->vlines,
+            port->active_mode->refresh,ideal_dclk,
             (port->du_cfg->clk_source_mode == RCAR_FIXED_EXTERNAL_CLOCK_SOURCE)?"EXTERNAL":
             (port->du_cfg->clk_source_mode == RCAR_CONFIGURABLE_EXTERNAL_CLOCK_SOURCE)?"EXTERNAL.CFG":
             (port->du_cfg->clk_source_mode == RCAR_INTERNAL_CLOCK_SOURCE)?"INTERNAL":"UNKNOWN",
@@ -363,54 +505,31 @@ void du_timing_setting (du_dev_t *dev, port_t *port)
 					DIDSR_PDCS_CLK(1, 0) |
 					DIDSR_PDCS_CLK(0, 0);
 
-	if (port->du_cfg->clk_source_mode == RCAR_FIXED_EXTERNAL_CLOCK_SOURCE){
-	    escr_divisor = 2; //escr_divisor result would be 2 in case using external clock
-			/* Get best clock and calculate DPLL */
-		best_clock = gen3_du_pll_setting (port, ideal_dclk, port->du_cfg->source_clk, &dpll_n, &dpll_m, &dpll_fdpll);
-		port->pixel_clk = best_clock/escr_divisor;
-		SLOG_DEBUG("best_clock from gen3_du_pll_setting:%d ", best_clock);
-			
-			dpllcr =  DPLLCR_CODE | DPLLCR_M(dpll_m) |
-			DPLLCR_FDPLL(dpll_fdpll) | DPLLCR_CLKE | 
-			DPLLCR_N(dpll_n) | DPLLCR_STBY;
-
-		if (port->du_cfg->du_index == DU_CH_1)
-				dpllcr |= (DPLLCR_PLCS1 | DPLLCR_INCS_DPLL01_DOTCLKIN13);
-		if (port->du_cfg->du_index == DU_CH_2) {
-				dpllcr |= (DPLLCR_PLCS0 | DPLLCR_INCS_DPLL01_DOTCLKIN02);
-				dpllcr |=  (0x1 << 21); /* workaround for WS1.0/1.1 */
-			}
-			*DPLLC2R = DPLLC2R_CODE;
-			*DPLLCR = dpllcr;			
-		SLOG_DEBUG("dpllcr setting value: dpll_n %d, dpll_m %d, dpll_fdpll %d",dpll_n, dpll_m, dpll_fdpll);
-	} else if (port->du_cfg->clk_source_mode == RCAR_CONFIGURABLE_EXTERNAL_CLOCK_SOURCE){
-	    escr_divisor = 1; //escr_divisor result would be 1 in case using programmable external clock
-		port->du_cfg->source_clk = ideal_dclk; // ext_clk_config should configure input clock exactly by ideal_dclk
-			
+	if (sol->clk_source_mode == RCAR_FIXED_EXTERNAL_CLOCK_SOURCE){
+		*DPLLC2R = DPLLC2R_CODE;
+		*DPLLCR = sol->dpllcr;
+	} else if (sol->clk_source_mode == RCAR_CONFIGURABLE_EXTERNAL_CLOCK_SOURCE){
 		if (port->du_cfg->ext_clk_config) {
 		    /* Execute external clock configure function for this port */
 		    ((wfdcfg_ext_fn_extclk_config_t*)port->du_cfg->ext_clk_config)(port->du_cfg->du_index,port->du_cfg->source_clk);
-		}	
-		port->pixel_clk = port->du_cfg->source_clk/escr_divisor;
-	} else if (port->du_cfg->clk_source_mode == RCAR_INTERNAL_CLOCK_SOURCE){
-	    escr_divisor    = (uint32_t)(round((float)port->du_cfg->source_clk/dclk));
-	    port->pixel_clk = port->du_cfg->source_clk/escr_divisor;
-		    }
+		}
+	}
+	port->pixel_clk = sol->pixel_clk;
 
 	/* DU timing setting */
-	*HDSR     		= hsw + hbp - 19;
-	*HDER     		= hsw + hbp - 19 + hpixels;
-	*VDSR     		= vbp - 2;
-	*VDER     		= vbp - 2 + vlines;
-	*HSWR     		= hsw - 1;
-	*VSPR     		= vbp + vfp + vlines - 1;
-	*HCR            = hc;
-	*VCR            = vc;
-	*DESR			= hsw + hbp;
-	*DEWR			= hpixels;
-	*ESCR  			= (escr_divisor - 1) | (escr_clock_bit<<20);
-
-    port->actual_refresh = (float)port->pixel_clk/(float)((hc+1)*(vc+1));
+	*HDSR     		= sol->hdsr;
+	*HDER     		= sol->hder;
+	*VDSR     		= sol->vdsr;
+	*VDER     		= sol->vder;
+	*HSWR     		= sol->hswr;
+	*VSPR     		= sol->vspr;
+	*HCR            = sol->hcr;
+	*VCR            = sol->vcr;
+	*DESR			= sol->desr;
+	*DEWR			= sol->dewr;
+	*ESCR  			= sol->escr;
+
+    port->actual_refresh = sol->actual_refresh;
 	if (port->pixel_clk != ideal_dclk){
 	    SLOG_WARNING("DU%d dot clock is not optimal. Actual rate: %.2f (dclk=%d)",
 	            port->du_cfg->du_index,port->actual_refresh, port->pixel_clk);
@@ -419,52 +538,17 @@ void du_timing_setting (du_dev_t *dev, port_t *port)
 }
 void port_init(du_dev_t *dev, port_t *port)
 {
-	const struct wfdcfg_keyval* keyval = NULL;
-
-	/* Retrieve some port settings from extension  */
-
-	keyval = wfdcfg_mode_get_extension(port->active_mode->timings, WFDCFG_EXT_PORTMODE_CLOCK_SOURCE);
+	mode_solution_t *sol = &port->active_mode->solution;
 
-    if (keyval != NULL) {
-    	port->du_cfg->clk_source_mode = keyval->i;
-    } else {
-    	/* Use internal clock by default */
-    	port->du_cfg->clk_source_mode = RCAR_INTERNAL_CLOCK_SOURCE;
-    	SLOG_WARNING("Clock source mode not provided. Use internal clock by default.");
-    }
-
-    switch (port->du_cfg->clk_source_mode){
-		case RCAR_INTERNAL_CLOCK_SOURCE:
-	    	port->du_cfg->source_clk = RCAR_DU_INTERNAL_CLOCK;
-
-	    	/* Internal clock source workaround in R-Car H3(ES1.0) */
-	    	if ((dev->chip_type == RCAR_PRODUCT_H3) && (dev->chip_revision == RCAR_REVISION_ES10))
-	    	{
-	            port->du_cfg->source_clk = RCAR_DU_INTERNAL_CLOCK_WS10;
-	    	}
-			break;
-		case RCAR_FIXED_EXTERNAL_CLOCK_SOURCE:
-			keyval = wfdcfg_mode_get_extension(port->active_mode->timings, WFDCFG_EXT_PORTMODE_EXTERNAL_CLOCK_RATE);
-		    if (keyval != NULL) {
-		    	port->du_cfg->source_clk = keyval->i;
-		    } else {
-				SLOG_ERROR("wfdcfg library doesn't provide external clock value for external clock source");
-				return;
-		    }
-			break;
-		case RCAR_CONFIGURABLE_EXTERNAL_CLOCK_SOURCE:
-			keyval = wfdcfg_mode_get_extension(port->active_mode->timings, WFDCFG_EXT_FN_EXTCLK_CONFIG);
-			if (keyval != NULL) {
-				port->du_cfg->ext_clk_config = keyval->p;
-			} else {
-				SLOG_ERROR("wfdcfg library doesn't provide configure function for external clock chip");
-				return;
-			}
-			break;
-		default:
-			SLOG_ERROR("Unsupported clock mode: %d",port->du_cfg->clk_source_mode);
-			break;
-    }
+	/* Modes are solved at port creation, this only covers a failed solve */
+	if (!sol->valid && (rcardu_mode_solve(dev, port, port->active_mode) != EXIT_SUCCESS)) {
+		return;
+	}
+	port->du_cfg->clk_source_mode = sol->clk_source_mode;
+	port->du_cfg->source_clk = sol->source_clk;
+	if (sol->ext_clk_config) {
+		port->du_cfg->ext_clk_config = sol->ext_clk_config;
+	}
 
 	/* Reset DU */
 	*DSYSR		= DSYSR_DRES;
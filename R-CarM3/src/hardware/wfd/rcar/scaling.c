@@ -28,12 +28,252 @@
 #include <unistd.h>
 #include <devctl.h>
 #include <string.h>
+#include <time.h>
 #include <screen/screen.h>
 #include <screen/iomsg.h>
 #include "vsp.h"
 
 
 
+/* commits further apart than this are not a stream, scale them synchronously */
+#define SCALE_ASYNC_MAX_GAP_NS	(50 * 1000 * 1000ULL)
+/* a retired buffer is reused after this even if its port stopped counting vsyncs */
+#define SCALE_RETIRE_MAX_NS		(250 * 1000 * 1000ULL)
+
+static uint64_t scale_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return timespec2nsec(&ts);
+}
+
+void scale_pool_init(du_dev_t *dev)
+{
+	scale_pool_t *pool = &dev->scale_pool;
+	const struct wfdcfg_keyval *ext;
+
+	memset(pool, 0, sizeof(*pool));
+	pthread_mutex_init(&pool->mutex, NULL);
+	pool->max_buffers = SCALE_POOL_DEF_MAX_BUFFERS;
+	pool->max_bytes = SCALE_POOL_DEF_MAX_BYTES;
+
+	ext = wfdcfg_device_get_extension(dev->cfglib_device, WFDCFG_EXT_SCALE_POOL_MAX_BUFFERS);
+	if (ext && (ext->i > 0))
+	{
+		pool->max_buffers = (ext->i < SCALE_POOL_SLOTS) ? ext->i : SCALE_POOL_SLOTS;
+	}
+	ext = wfdcfg_device_get_extension(dev->cfglib_device, WFDCFG_EXT_SCALE_POOL_MAX_BYTES);
+	if (ext && (ext->i > 0))
+	{
+		pool->max_bytes = ext->i;
+	}
+	SLOG_DEBUG("scale pool: up to %u buffers, %zu bytes", pool->max_buffers, pool->max_bytes);
+}
+
+static void scale_pool_unmap(scale_pool_t *pool, scale_buf_t *buf)
+{
+	munmap(buf->vaddr, buf->size);
+	pool->count--;
+	pool->bytes -= buf->size;
+	memset(buf, 0, sizeof(*buf));
+}
+
+void scale_pool_fini(du_dev_t *dev)
+{
+	scale_pool_t *pool = &dev->scale_pool;
+	int i;
+
+	for (i = 0; i < SCALE_POOL_SLOTS; i++)
+	{
+		if (pool->buf[i].vaddr)
+		{
+			scale_pool_unmap(pool, &pool->buf[i]);
+		}
+	}
+	SLOG_INFO("scale pool: %u allocations, %u avoided, %u evictions, %u failures",
+		pool->allocs, pool->reuses, pool->evictions, pool->failures);
+	pthread_mutex_destroy(&pool->mutex);
+}
+
+/* fills WFD_SCALE_POOL_STATS_COUNT_RCAR values, NULL restarts the counters */
+void scale_pool_stats(scale_pool_t *pool, int *value)
+{
+	pthread_mutex_lock(&pool->mutex);
+	if (value)
+	{
+		value[WFD_SCALE_POOL_ALLOCS_RCAR] = pool->allocs;
+		value[WFD_SCALE_POOL_REUSES_RCAR] = pool->reuses;
+		value[WFD_SCALE_POOL_EVICTIONS_RCAR] = pool->evictions;
+		value[WFD_SCALE_POOL_FAILURES_RCAR] = pool->failures;
+		value[WFD_SCALE_POOL_BUFFERS_RCAR] = pool->count;
+		value[WFD_SCALE_POOL_BYTES_RCAR] = pool->bytes;
+	}
+	else
+	{
+		pool->allocs = pool->reuses = pool->evictions = pool->failures = 0;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+/* called with pool->mutex held, frees the retired buffers the display is done with */
+static void scale_pool_reap(scale_pool_t *pool)
+{
+	uint64_t now = 0;
+	int i;
+
+	for (i = 0; i < SCALE_POOL_SLOTS; i++)
+	{
+		scale_buf_t *buf = &pool->buf[i];
+		if (!buf->vaddr || !buf->in_use || !buf->retire_counter)
+			continue;
+		if ((int)(*buf->retire_counter - buf->retire_vsync) < 0)
+		{
+			if (!now)
+				now = scale_clock_ns();
+			if (now - buf->retire_ns < SCALE_RETIRE_MAX_NS)
+				continue;
+		}
+		buf->retire_counter = NULL;
+		buf->in_use = 0;
+		buf->last_used = ++pool->tick;
+	}
+}
+
+/* called with pool->mutex held, drops idle buffers until 'size' more bytes fit */
+static void scale_pool_trim(scale_pool_t *pool, unsigned count, size_t size)
+{
+	scale_buf_t *lru;
+	int i;
+
+	scale_pool_reap(pool);
+	while ((pool->count + count > pool->max_buffers) || (pool->bytes + size > pool->max_bytes))
+	{
+		lru = NULL;
+		for (i = 0; i < SCALE_POOL_SLOTS; i++)
+		{
+			scale_buf_t *buf = &pool->buf[i];
+			if (buf->vaddr && !buf->in_use && (!lru || (buf->last_used < lru->last_used)))
+			{
+				lru = buf;
+			}
+		}
+		if (!lru)
+		{
+			/* everything is in use, go above the limit */
+			return;
+		}
+		SLOG_DEBUG("scale pool: evict %dx%d format %d", lru->stride, lru->height, lru->format);
+		scale_pool_unmap(pool, lru);
+		pool->evictions++;
+	}
+}
+
+/*
+ * Return a buffer of the (format, stride, height) class, recycling an idle
+ * one if possible. Stride and height are rounded up to the class size.
+ */
+scale_buf_t *scale_pool_get(scale_pool_t *pool, int format, int stride, int height, size_t size)
+{
+	scale_buf_t *buf = NULL;
+	int pt_fd;
+	int i;
+
+	stride = (stride + SCALE_POOL_STRIDE_ALIGN - 1) & ~(SCALE_POOL_STRIDE_ALIGN - 1);
+	height = (height + SCALE_POOL_HEIGHT_ALIGN - 1) & ~(SCALE_POOL_HEIGHT_ALIGN - 1);
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->tick++;
+	scale_pool_reap(pool);
+
+	for (i = 0; i < SCALE_POOL_SLOTS; i++)
+	{
+		scale_buf_t *b = &pool->buf[i];
+		if (b->vaddr && !b->in_use && (b->format == format) &&
+			(b->stride == stride) && (b->height == height) && (b->size >= size))
+		{
+			buf = b;
+			pool->reuses++;
+			goto done;
+		}
+	}
+
+	/* class sized allocation, the caller's size only has to fit */
+	if (size < (size_t)stride * height)
+	{
+		size = (size_t)stride * height;
+	}
+	scale_pool_trim(pool, 1, size);
+	for (i = 0; i < SCALE_POOL_SLOTS; i++)
+	{
+		if (!pool->buf[i].vaddr)
+		{
+			buf = &pool->buf[i];
+			break;
+		}
+	}
+	if (!buf)
+	{
+		SLOG_ERROR("scale_pool_get: no free slot (%u buffers)", pool->count);
+		goto fail;
+	}
+
+	pt_fd = posix_typed_mem_open(RCARDU_POSIX_TYPED_MEM_PATH, O_RDWR, POSIX_TYPED_MEM_ALLOCATE_CONTIG);
+	if (pt_fd == -1)
+	{
+		SLOG_ERROR("scale_pool_get: WFD_ERROR_OUT_OF_MEMORY (Can't open posix typed memory)");
+		buf = NULL;
+		goto fail;
+	}
+	buf->vaddr = mmap64(NULL, size, PROT_READ | PROT_WRITE | PROT_NOCACHE, MAP_SHARED, pt_fd, 0);
+	close(pt_fd);
+	if (buf->vaddr == MAP_FAILED)
+	{
+		SLOG_ERROR("scale_pool_get: WFD_ERROR_OUT_OF_MEMORY (Can't mmap posix typed memory)");
+		buf->vaddr = NULL;
+		buf = NULL;
+		goto fail;
+	}
+	buf->paddr = (uint32_t)disp_phys_addr(buf->vaddr);
+	buf->format = format;
+	buf->stride = stride;
+	buf->height = height;
+	buf->size = size;
+	pool->count++;
+	pool->bytes += size;
+	pool->allocs++;
+
+done:
+	buf->in_use = 1;
+	buf->last_used = pool->tick;
+	pthread_mutex_unlock(&pool->mutex);
+	return buf;
+
+fail:
+	pool->failures++;
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+void scale_pool_put(scale_pool_t *pool, scale_buf_t *buf)
+{
+	pthread_mutex_lock(&pool->mutex);
+	buf->in_use = 0;
+	buf->last_used = ++pool->tick;
+	scale_pool_trim(pool, 0, 0);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+/* put a buffer back once the vsync 'counter' reaches 'vsync' */
+void scale_pool_put_after(scale_pool_t *pool, scale_buf_t *buf, const volatile unsigned *counter, unsigned vsync)
+{
+	pthread_mutex_lock(&pool->mutex);
+	buf->retire_counter = counter;
+	buf->retire_vsync = vsync;
+	buf->retire_ns = scale_clock_ns();
+	pthread_mutex_unlock(&pool->mutex);
+}
+
 void scale_pipe_init(du_dev_t* dev, pipe_t* pipe)
 {
 	int i;
@@ -44,13 +284,12 @@ void scale_pipe_init(du_dev_t* dev, pipe_t* pipe)
 		if((pipe->pipeId == dev->ports[i].du_cfg->scale_pipe) && 
 			(dev->ports[i].du_cfg->ExScaleHwId != DEVICE_NONE))
 		{
-			pipe->scale.obuffer[0] = NULL;
-			pipe->scale.obuffer[1] = NULL;
-			pipe->scale.obuffer_phys[0] = 0;
-			pipe->scale.obuffer_phys[1] = 0;
-			pipe->scale.cur_idx = 0;
-			pipe->scale.last_dst_width = 0;
-			pipe->scale.last_dst_height = 0;
+			memset(&pipe->scale, 0, sizeof(pipe->scale));
+			pipe->scale.pool = &dev->scale_pool;
+			pipe->scale.cur_idx = -1;
+			pipe->scale.prev_idx = -1;
+			pipe->scale.ready_idx = -1;
+			pipe->scale.cur_published = 0;
 			SLOG_DEBUG2("       return. (done)");
 			return;
 		}
@@ -58,16 +297,63 @@ void scale_pipe_init(du_dev_t* dev, pipe_t* pipe)
 	SLOG_DEBUG2("       return. (not a scale pipe)");
 }
 
-void scale_pipe_quit(du_dev_t *dev, pipe_t* pipe)
+/*
+ * The front buffers are still fetched by the VSPD: a display list without
+ * them is published by the caller's commit at the latest one vsync later
+ * and latched SCALE_LATCH_VSYNCS after that.
+ */
+static void scale_free_buffers(scale_t *scale)
 {
-    int i;
-    for(i = 0; i < 2; i++)
+	unsigned now = 0;
+	unsigned vsync;
+	int i;
+
+	if (scale->vsync_counter)
+		now = *scale->vsync_counter;
+
+	for(i = 0; i < SCALE_BUFFER_NUM; i++)
 	{
-		if (NULL != pipe->scale.obuffer[i])
+		if (NULL == scale->obuf[i])
+			continue;
+
+		if (scale->vsync_counter && ((i == scale->cur_idx) || (i == scale->prev_idx) ||
+			((int)(scale->release[i] - now) > 0)))
+		{
+			vsync = now + SCALE_LATCH_VSYNCS + 1;
+			if ((i != scale->cur_idx) && (i != scale->prev_idx) &&
+				((int)(scale->release[i] - vsync) > 0))
+				vsync = scale->release[i];
+			scale_pool_put_after(scale->pool, scale->obuf[i], scale->vsync_counter, vsync);
+		}
+		else
 		{
-			munmap (pipe->scale.obuffer[i], pipe->scale.last_dst_width*pipe->scale.last_dst_height*4);
+			scale_pool_put(scale->pool, scale->obuf[i]);
 		}
+		scale->obuf[i] = NULL;
 	}
+	scale->cur_idx = -1;
+	scale->prev_idx = -1;
+	scale->ready_idx = -1;
+	scale->cur_published = 0;
+}
+
+void scale_pipe_quit(du_dev_t *dev, pipe_t* pipe)
+{
+	scale_t *scale = &pipe->scale;
+
+	if (scale->running)
+	{
+		pthread_mutex_lock(&scale->mutex);
+		scale->running = 0;
+		pthread_cond_broadcast(&scale->cond);
+		pthread_mutex_unlock(&scale->mutex);
+		pthread_join(scale->tid, NULL);
+		pthread_cond_destroy(&scale->cond);
+		pthread_mutex_destroy(&scale->mutex);
+		SLOG_INFO("scale pipe %d: %u jobs, %u commits waited on a fence",
+			pipe->pipeId, scale->jobs, scale->fence_waits);
+	}
+	scale_free_buffers(scale);
 }
 
 int scaling_possible (pipe_t *pipe)
@@ -95,89 +381,351 @@ void *exscale_init (void *disp)
 	return vsp_dev;
 }
 
+static void scale_job_run(scale_t *scale, scale_job_t *job)
+{
+	vsp_pipe_t vsp;
+
+	/* set parameters */
+	vsp.src.addr.y_rgb = job->src_paddr[0];
+	vsp.src.addr.c0 = job->src_paddr[1];
+	vsp.src.addr.c1 = job->src_paddr[2];
+	vsp.src.fmt = WfdToVspFormat (job->src_format);
+	vsp.src.width = job->src_width;
+	vsp.src.height = job->src_height;
+	vsp.src.stride = job->src_stride;
+	vsp.src_rect[0] = job->src_rect[0];
+	vsp.src_rect[1] = job->src_rect[1];
+	vsp.src_rect[2] = job->src_rect[2];
+	vsp.src_rect[3] = job->src_rect[3];
+
+	vsp.dst.width = job->dst_width;
+	vsp.dst.height = job->dst_height;
+	vsp.dst.fmt = WfdToVspFormat (job->dst_format);
+	vsp.dst.addr.y_rgb = scale->obuf[job->buf_idx]->paddr;
+	if (job->dst_format == WFD_FORMAT_NV12_QNX)
+	{
+		vsp.dst.addr.c0 = scale->obuf[job->buf_idx]->paddr + vsp.dst.width*vsp.dst.height;
+	}
+	else
+	{
+		vsp.dst.addr.c0 = 0;
+	}
+	vsp.dst.addr.c1 = 0;
+
+	VspLib_scale_start(scale->dev, &vsp);
+}
+
+/* The VSPI is only ever driven from this thread once the pipe scales asynchronously */
+static void *scale_thread(void *arg)
+{
+	scale_t *scale = (scale_t *)arg;
+	scale_job_t job;
+
+	pthread_mutex_lock(&scale->mutex);
+	while (scale->running)
+	{
+		if (scale->fence_done == scale->fence_submitted)
+		{
+			pthread_cond_wait(&scale->cond, &scale->mutex);
+			continue;
+		}
+		job = scale->job;
+		pthread_mutex_unlock(&scale->mutex);
+
+		scale_job_run(scale, &job);
+
+		pthread_mutex_lock(&scale->mutex);
+		scale->fence_done = job.fence;
+		scale->ready_idx = job.buf_idx;
+		pthread_cond_broadcast(&scale->cond);
+	}
+	pthread_mutex_unlock(&scale->mutex);
+
+	return NULL;
+}
+
+static int scale_thread_start(pipe_t *pipe)
+{
+	scale_t *scale = &pipe->scale;
+	int err;
+
+	pthread_mutex_init(&scale->mutex, NULL);
+	pthread_cond_init(&scale->cond, NULL);
+	scale->running = 1;
+	err = pthread_create(&scale->tid, NULL, scale_thread, scale);
+	if (err != EOK)
+	{
+		SLOG_ERROR("Run_Scaling: can't create scaler thread (%s)", strerror(err));
+		scale->running = 0;
+		pthread_cond_destroy(&scale->cond);
+		pthread_mutex_destroy(&scale->mutex);
+		return R_VSP_NG;
+	}
+	pthread_setname_np(scale->tid, "wfd-scale");
+	return R_VSP_OK;
+}
+
+/* called with scale->mutex held */
+static void scale_wait_fence(scale_t *scale, uint32_t fence)
+{
+	if ((int32_t)(scale->fence_done - fence) >= 0)
+		return;
+
+	scale->fence_waits++;
+	while ((int32_t)(scale->fence_done - fence) < 0)
+	{
+		pthread_cond_wait(&scale->cond, &scale->mutex);
+	}
+}
+
+/*
+ * Called with scale->mutex held. A front buffer that was never published is
+ * free at once, a published one stays protected until the display list of
+ * its successor is published and the vsync it is latched at is known.
+ */
+static void scale_promote_ready(scale_t *scale, unsigned now)
+{
+	if (scale->ready_idx >= 0)
+	{
+		if ((scale->cur_idx >= 0) && scale->cur_published)
+		{
+			scale->prev_idx = scale->cur_idx;
+			scale->prev_vsync_lo = scale->cur_vsync_lo;
+		}
+		else if (scale->cur_idx >= 0)
+		{
+			scale->release[scale->cur_idx] = now;
+		}
+		scale->cur_idx = scale->ready_idx;
+		scale->cur_published = 0;
+		scale->ready_idx = -1;
+	}
+}
+
+/*
+ * Called by the compose path once the VSPD display list reading cur_idx is
+ * published. The buffer it replaces is fetched until that list is latched,
+ * unless both were published within the same frame and the replaced one
+ * never reached the header.
+ */
+void scale_frame_published(pipe_t *pipe)
+{
+	port_t *port = (port_t *)pipe->port;
+	scale_t *scale = &pipe->scale;
+	unsigned now = port->vsync_counter;
+
+	if (!scale->running)
+		return;
+
+	pthread_mutex_lock(&scale->mutex);
+	if (scale->cur_idx >= 0)
+	{
+		if (!scale->cur_published)
+		{
+			scale->cur_published = 1;
+			scale->cur_vsync_lo = scale->submit_vsync;
+		}
+		scale->cur_vsync_hi = now;
+		if (scale->prev_idx >= 0)
+		{
+			scale->release[scale->prev_idx] = (scale->prev_vsync_lo == scale->cur_vsync_hi) ?
+				now : scale->cur_vsync_hi + SCALE_LATCH_VSYNCS;
+			scale->prev_idx = -1;
+		}
+	}
+	pthread_mutex_unlock(&scale->mutex);
+}
+
+/*
+ * YUV sources are scaled to YUV so that the colour space conversion is only
+ * done once, by the VSPD RPF reading the scaled layer. Planar 4:2:0 has no
+ * partition support in the WPF and is written as NV12.
+ */
+static int scale_output_format(int src_format)
+{
+	switch (src_format)
+	{
+		case WFD_FORMAT_NV12_QNX:
+		case WFD_FORMAT_YV12_QNX:
+		case WFD_FORMAT_YUV420_QNX:
+			return WFD_FORMAT_NV12_QNX;
+		case WFD_FORMAT_UYVY_QNX:
+		case WFD_FORMAT_YUY2_QNX:
+		case WFD_FORMAT_YVYU_QNX:
+			return src_format;
+		default:
+			return WFD_FORMAT_RGBA8888_QNX;
+	}
+}
+
+/* luma stride and total size of a scaled output buffer */
+static void scale_output_layout(int format, int width, int height, int *stride, size_t *size)
+{
+	switch (format)
+	{
+		case WFD_FORMAT_NV12_QNX:
+			*stride = width;
+			*size = (size_t)width * height * 3 / 2;
+			break;
+		case WFD_FORMAT_UYVY_QNX:
+		case WFD_FORMAT_YUY2_QNX:
+		case WFD_FORMAT_YVYU_QNX:
+			*stride = width * 2;
+			*size = (size_t)width * 2 * height;
+			break;
+		default:
+			*stride = width * 4;
+			*size = (size_t)width * 4 * height;
+			break;
+	}
+}
+
+static int scale_alloc_buffers(scale_t *scale, int format, int width, int height)
+{
+	size_t size;
+	int stride;
+	int i;
+
+	scale_free_buffers(scale);
+
+	scale_output_layout(format, width, height, &stride, &size);
+	for(i = 0; i < SCALE_BUFFER_NUM; i++)
+	{
+		scale->obuf[i] = scale_pool_get(scale->pool, format, stride, height, size);
+		scale->release[i] = scale->submit_vsync;
+		if (scale->obuf[i] == NULL)
+		{
+			SLOG_ERROR("Run_Scaling: WFD_ERROR_OUT_OF_MEMORY (no scaling buffer)");
+			return R_VSP_NG;
+		}
+	}
+	scale->last_dst_width = width;
+	scale->last_dst_height = height;
+	scale->last_dst_format = format;
+	return R_VSP_OK;
+}
+
+/*
+ * Queue the scale pass for this commit and hand back the newest finished
+ * output, which normally is the one of the previous commit. The commit only
+ * blocks when the previous pass is still running, when nothing has been
+ * scaled at the current size yet, or when the pipe is not being streamed.
+ */
 int32_t Run_Scaling(pipe_t *pipe, win_image_t* img_dst)
 {
 	port_t *port 		= (port_t *)pipe->port;
 	source_t *source 	= (source_t *)pipe->src;
 	win_image_t *img_src 	= (win_image_t *)source->image;
-	void *scaling_dev 		= port->du_cfg->scaling_dev;
-	vsp_pipe_t scale;
-    int i;
-	int pt_fd = -1;
-    
-	if(pipe->scale.last_dst_width != pipe->dst_rect[2] || pipe->scale.last_dst_height != pipe->dst_rect[3])
+	scale_t *scale		= &pipe->scale;
+	scale_job_t *job	= &scale->job;
+	int dst_format		= scale_output_format(img_src->format);
+	struct timespec ts;
+	size_t size;
+	uint64_t now;
+	unsigned vsync;
+	int streaming;
+	int stride;
+	int i;
+
+	if (!scale->running)
 	{
-		for(i = 0; i < 2; i++)
+		scale->dev = port->du_cfg->scaling_dev;
+		if (R_VSP_OK != scale_thread_start(pipe))
 		{
-			if (NULL != pipe->scale.obuffer[i])
-			{
-				munmap (pipe->scale.obuffer[i], pipe->scale.last_dst_width*pipe->scale.last_dst_height*4);
-				pipe->scale.obuffer[i] = NULL;
-			}
+			return R_VSP_NG;
 		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now = timespec2nsec(&ts);
+	streaming = (scale->last_submit_ns != 0) && (now - scale->last_submit_ns < SCALE_ASYNC_MAX_GAP_NS);
+	scale->last_submit_ns = now;
+
+	pthread_mutex_lock(&scale->mutex);
+
+	scale->vsync_counter = &port->vsync_counter;
+	vsync = port->vsync_counter;
+	scale->submit_vsync = vsync;
+
+	/* the scaler owns one buffer at a time, let the previous pass finish */
+	scale_wait_fence(scale, scale->fence_submitted);
 
-		unsigned int screensize = pipe->dst_rect[2] * pipe->dst_rect[3] * 4;
-		for(i = 0; i < 2; i++)
+	if(scale->last_dst_width != pipe->dst_rect[2] || scale->last_dst_height != pipe->dst_rect[3] ||
+		scale->last_dst_format != dst_format || scale->obuf[0] == NULL)
+	{
+		if (R_VSP_OK != scale_alloc_buffers(scale, dst_format, pipe->dst_rect[2], pipe->dst_rect[3]))
 		{
-			pt_fd = posix_typed_mem_open(RCARDU_POSIX_TYPED_MEM_PATH, O_RDWR, POSIX_TYPED_MEM_ALLOCATE_CONTIG);
-			if (pt_fd == -1) 
-			{
-				SLOG_ERROR("Run_Scaling: return: WFD_ERROR_OUT_OF_MEMORY (Can't open posix typed memory)");
-				return R_VSP_NG;
-			}
-			pipe->scale.obuffer[i] = mmap64(NULL, screensize, PROT_READ | PROT_WRITE | PROT_NOCACHE, MAP_SHARED, pt_fd, 0);
-			if (pipe->scale.obuffer[i] == MAP_FAILED)
-			{
-				SLOG_ERROR("Run_Scaling: WFD_ERROR_OUT_OF_MEMORY (Can't mmap posix typed memory)");
-				close(pt_fd);
-				return R_VSP_NG;
-			}
-			pipe->scale.obuffer_phys[i] = (uint32_t)disp_phys_addr(pipe->scale.obuffer[i]);
-			pipe->scale.last_dst_width = pipe->dst_rect[2];
-			pipe->scale.last_dst_height = pipe->dst_rect[3];
-			close(pt_fd);
+			scale_free_buffers(scale);
+			scale->last_dst_width = 0;
+			scale->last_dst_height = 0;
+			pthread_mutex_unlock(&scale->mutex);
+			return R_VSP_NG;
 		}
 	}
 
-	pipe->scale.cur_idx = (pipe->scale.cur_idx == 0) ? 1 : 0;
-   
-    
-	/* set parameters */
-	scale.src.addr.y_rgb = img_src->paddr;
-	scale.src.addr.c0 = img_src->paddr + img_src->planar_offsets[1];
-	scale.src.addr.c1 = img_src->paddr + img_src->planar_offsets[2];
-	scale.src.fmt = WfdToVspFormat (img_src->format);
-	scale.src.width = img_src->width;
-	scale.src.height = img_src->height;
- 	scale.src_rect[0] = pipe->src_rect[0];
-	scale.src_rect[1] = pipe->src_rect[1];
-	scale.src_rect[2] = pipe->src_rect[2];
-	scale.src_rect[3] = pipe->src_rect[3];
-	
-	scale.dst.width = pipe->dst_rect[2];
-	scale.dst.height = pipe->dst_rect[3];
-	scale.dst.fmt = WfdToVspFormat (/* img_src->format */ WFD_FORMAT_RGBA8888_QNX);	/* hardcode output color format to RGBA8888 */
-	scale.dst.addr.y_rgb = pipe->scale.obuffer_phys[pipe->scale.cur_idx];
-	scale.dst.addr.c0 = pipe->scale.obuffer_phys[pipe->scale.cur_idx] + scale.dst.width*scale.dst.height;
-	scale.dst.addr.c1 = 0;
-    
-    VspLib_scale_start(scaling_dev, &scale);
-    
+	scale_promote_ready(scale, vsync);
+
+	/* never scale into a buffer the VSPD may still be fetching */
+	for (i = 0; i < SCALE_BUFFER_NUM; i++)
+	{
+		if ((i != scale->cur_idx) && (i != scale->prev_idx) &&
+			((int)(scale->release[i] - vsync) <= 0))
+			break;
+	}
+	if (i == SCALE_BUFFER_NUM)
+	{
+		/* no vsync for a while, the display is not fetching anymore */
+		for (i = 0; i < SCALE_BUFFER_NUM; i++)
+		{
+			if ((i != scale->cur_idx) && (i != scale->prev_idx))
+				break;
+		}
+	}
+
+	job->buf_idx = i;
+	job->src_paddr[0] = img_src->paddr;
+	job->src_paddr[1] = img_src->paddr + img_src->planar_offsets[1];
+	job->src_paddr[2] = img_src->paddr + img_src->planar_offsets[2];
+	job->src_format = img_src->format;
+	job->src_width = img_src->width;
+	job->src_height = img_src->height;
+	job->src_stride = (img_src->flags & WIN_IMAGE_FLAG_IMPORTED_RCAR) ? img_src->strides[0] : 0;
+	job->src_rect[0] = pipe->src_rect[0];
+	job->src_rect[1] = pipe->src_rect[1];
+	job->src_rect[2] = pipe->src_rect[2];
+	job->src_rect[3] = pipe->src_rect[3];
+	job->dst_format = dst_format;
+	job->dst_width = pipe->dst_rect[2];
+	job->dst_height = pipe->dst_rect[3];
+	job->fence = ++scale->fence_submitted;
+	scale->jobs++;
+	pthread_cond_broadcast(&scale->cond);
+
+	if ((scale->cur_idx < 0) || !streaming)
+	{
+		/* nothing to show yet, or no next commit to pick the result up */
+		scale_wait_fence(scale, job->fence);
+		scale_promote_ready(scale, vsync);
+	}
+
 	img_dst->width = pipe->dst_rect[2];
 	img_dst->height = pipe->dst_rect[3];
-	img_dst->format = WFD_FORMAT_RGBA8888_QNX; /* hardcode output color format to RGBA8888 */
-	img_dst->paddr = pipe->scale.obuffer_phys[pipe->scale.cur_idx];
-	img_dst->vaddr = pipe->scale.obuffer[pipe->scale.cur_idx];
-	img_dst->strides[0] = pipe->dst_rect[2] * 4;
-	img_dst->planar_offsets[1] = pipe->dst_rect[2]*pipe->dst_rect[3];
+	img_dst->format = dst_format;
+	img_dst->paddr = scale->obuf[scale->cur_idx]->paddr;
+	img_dst->vaddr = scale->obuf[scale->cur_idx]->vaddr;
+
+	pthread_mutex_unlock(&scale->mutex);
 
-	if (img_dst->format == WFD_FORMAT_YUV420_QNX || img_dst->format == WFD_FORMAT_YV12_QNX)
+	scale_output_layout(dst_format, pipe->dst_rect[2], pipe->dst_rect[3], &stride, &size);
+	img_dst->strides[0] = stride;
+	if (dst_format == WFD_FORMAT_NV12_QNX)
 	{
-		img_dst->planar_offsets[2] = pipe->dst_rect[2] * ((pipe->dst_rect[3] * 5 + 1) / 4);
+		img_dst->planar_offsets[1] = pipe->dst_rect[2]*pipe->dst_rect[3];
 	}
 	else
 	{
-		img_dst->planar_offsets[2] = 0;
+		img_dst->planar_offsets[1] = 0;
 	}
+	img_dst->planar_offsets[2] = 0;
     return R_VSP_OK;
 }
@@ -24,6 +24,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include <sys/mman.h>
 #include <screen/screen.h>
 #include <screen/iomsg.h>
@@ -249,10 +250,192 @@ WFD_API_CALL WFDErrorCode WFD_APIENTRY wfdDestroyWFDEGLImagesQNX(WFDDevice devic
         win_image_t* img = images[i];
 
         SLOG_DEBUG("wfdDestroyWFDEGLImagesQNX(): vaddr=%08X", (unsigned int)img->vaddr);
-        munmap(img->vaddr, img->size);
-        close(img->fd);
+        if (img->vaddr)
+            munmap(img->vaddr, img->size);
+        if (img->fd != -1)
+            close(img->fd);
+        free(img);
+    }
+
+    return WFD_ERROR_NONE;
+}
+
+/* RPF constraints on an imported buffer */
+#define IMPORT_ADDR_ALIGN   16              /* plane addresses and line pitch */
+#define IMPORT_STRIDE_MAX   0xFFFF          /* SRCM_PSTRIDE field width */
+#define IMPORT_PADDR_LIMIT  0x100000000ULL  /* RPF addresses are 32 bit */
+
+/* bytes per pixel of the first plane, 0 if the format can't be imported */
+static int import_luma_bpp(int format)
+{
+    switch (format) {
+        case WFD_FORMAT_NV12_QNX:
+        case WFD_FORMAT_YUV420_QNX:
+            return 1;
+        case WFD_FORMAT_RGBA5551_QNX:
+        case WFD_FORMAT_RGB565_QNX:
+        case WFD_FORMAT_YUY2_QNX:
+        case WFD_FORMAT_UYVY_QNX:
+            return 2;
+        case WFD_FORMAT_RGB888_QNX:
+            return 3;
+        case WFD_FORMAT_RGBA8888_QNX:
+        case WFD_FORMAT_RGBX8888_QNX:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+WFD_API_CALL WFDErrorCode WFD_APIENTRY
+wfdImportWFDEGLImageRCAR(WFDDevice device, const WFDImageImportRCAR *desc,
+    WFDEGLImage *image) WFD_APIEXIT
+{
+    du_dev_t*     dev = (du_dev_t*)device;
+    win_image_t*  img;
+    uint64_t      needed, size;
+    int           cached, bpp, i;
+
+    TRACE;
+
+    DEVICE_VALIDATE(return WFD_ERROR_BAD_DEVICE)
+
+    if (!desc || !image || desc->width <= 0 || desc->height <= 0 || desc->size < 0)
+    {
+        SLOG_ERROR("invalid import descriptor or image argument");
+        return WFD_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    SLOG_DEBUG("wfdImportWFDEGLImageRCAR(): fd=%d, paddr=%llX, width=%d, height=%d, format=%d, stride=%d",
+            desc->fd, (unsigned long long)desc->paddr, desc->width, desc->height, desc->format, desc->stride);
+
+    bpp = import_luma_bpp(desc->format);
+    if (!bpp)
+    {
+        SLOG_ERROR("import: format %d not supported", desc->format);
+        return WFD_ERROR_NOT_SUPPORTED;
+    }
+
+    if (desc->width > dev->max_width || desc->height > dev->max_height)
+    {
+        SLOG_ERROR("import: %dx%d exceeds %dx%d", desc->width, desc->height, dev->max_width, dev->max_height);
+        return WFD_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    if (desc->stride < desc->width * bpp || desc->stride > IMPORT_STRIDE_MAX ||
+            (desc->stride % IMPORT_ADDR_ALIGN))
+    {
+        SLOG_ERROR("import: stride %d invalid for width %d", desc->stride, desc->width);
+        return WFD_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    cached = (desc->flags & WFD_IMAGE_IMPORT_CPU_CACHED_RCAR) != 0;
+    if (cached && desc->fd == -1)
+    {
+        /* the cache is cleaned through our own mapping of the object */
+        SLOG_ERROR("import: a CPU cached buffer must be given as a memory object");
+        return WFD_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    img = calloc(1, sizeof(*img));
+    if (!img)
+    {
+        SLOG_ERROR("could not allocate native image");
+        return WFD_ERROR_OUT_OF_MEMORY;
+    }
+
+    img->width = desc->width;
+    img->height = desc->height;
+    img->format = desc->format;
+    img->usage = WFD_USAGE_DISPLAY_QNX;
+    img->strides[0] = desc->stride;
+    img->fd = -1;
+
+    /* plane layout, unset offsets follow the default tight packing */
+    needed = (uint64_t)desc->stride * desc->height;
+    if (desc->format == WFD_FORMAT_NV12_QNX)
+    {
+        img->planar_offsets[1] = desc->planar_offsets[1] ? desc->planar_offsets[1] : desc->stride * desc->height;
+        needed = img->planar_offsets[1] + (uint64_t)desc->stride * ((desc->height + 1) / 2);
+    }
+    else if (desc->format == WFD_FORMAT_YUV420_QNX)
+    {
+        img->planar_offsets[1] = desc->planar_offsets[1] ? desc->planar_offsets[1] : desc->stride * desc->height;
+        img->planar_offsets[2] = desc->planar_offsets[2] ? desc->planar_offsets[2] :
+            img->planar_offsets[1] + (desc->stride / 2) * ((desc->height + 1) / 2);
+        needed = max(img->planar_offsets[1], img->planar_offsets[2]) +
+            (uint64_t)(desc->stride / 2) * ((desc->height + 1) / 2);
+    }
+
+    size = desc->size ? (uint64_t)desc->size : needed;
+    if (size < needed || size > INT_MAX)
+    {
+        SLOG_ERROR("import: %llu bytes don't hold a %dx%d image (%llu bytes)",
+                (unsigned long long)size, desc->width, desc->height, (unsigned long long)needed);
         free(img);
+        return WFD_ERROR_ILLEGAL_ARGUMENT;
     }
+    img->size = (int)size;
+
+    if (desc->fd != -1)
+    {
+        off64_t paddr;
+        size_t  contig = 0;
+
+        /* map the object ourselves to resolve and verify its physical pages */
+        img->vaddr = mmap64(0, img->size, PROT_READ | (cached ? 0 : PROT_NOCACHE), MAP_SHARED,
+                desc->fd, desc->offset);
+        if (img->vaddr == MAP_FAILED)
+        {
+            SLOG_ERROR("import: can't map fd %d at offset %llu: %s", desc->fd,
+                    (unsigned long long)desc->offset, strerror(errno));
+            free(img);
+            return WFD_ERROR_ILLEGAL_ARGUMENT;
+        }
+
+        if (mem_offset64(img->vaddr, NOFD, img->size, &paddr, &contig) == -1 || contig < size)
+        {
+            SLOG_ERROR("import: buffer is not physically contiguous (%zu of %d bytes)", contig, img->size);
+            munmap(img->vaddr, img->size);
+            free(img);
+            return WFD_ERROR_ILLEGAL_ARGUMENT;
+        }
+        img->paddr = paddr;
+    }
+    else
+    {
+        img->paddr = desc->paddr;
+    }
+
+    if (!img->paddr || (uint64_t)img->paddr + size > IMPORT_PADDR_LIMIT)
+    {
+        SLOG_ERROR("import: buffer at %llX is out of RPF reach", (unsigned long long)img->paddr);
+        if (img->vaddr)
+            munmap(img->vaddr, img->size);
+        free(img);
+        return WFD_ERROR_NOT_SUPPORTED;
+    }
+
+    for (i = 0; i < 3; i++)
+    {
+        if ((img->paddr + img->planar_offsets[i]) % IMPORT_ADDR_ALIGN)
+        {
+            SLOG_ERROR("import: plane %d at %llX is not %d byte aligned", i,
+                    (unsigned long long)(img->paddr + img->planar_offsets[i]), IMPORT_ADDR_ALIGN);
+            if (img->vaddr)
+                munmap(img->vaddr, img->size);
+            free(img);
+            return WFD_ERROR_ILLEGAL_ARGUMENT;
+        }
+    }
+
+    img->flags = WIN_IMAGE_FLAG_PHYS_CONTIG | WIN_IMAGE_FLAG_IMPORTED_RCAR;
+    if (cached)
+        img->flags |= WIN_IMAGE_FLAG_CACHED_RCAR;
+    else
+        img->flags |= WIN_IMAGE_FLAG_UNCACHED_MAPPING;
+
+    *image = img;
 
     return WFD_ERROR_NONE;
 }
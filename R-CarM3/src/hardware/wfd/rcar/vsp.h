@@ -46,10 +46,11 @@ void VspLib_fini (void *arg);
 int	VspLib_frame_update( void *arg, vsp_pipe_t *pipe );
 void VspLib_activate_pipe ( void *arg, int pipeId );
 void VspLib_deactivate_pipe ( void *arg, int pipeId );
-void VspLib_compose_update_sync (void *arg);
+const struct sigevent *VspLib_compose_update_sync (void *arg, unsigned vsync);
 
 int scaling_possible (pipe_t *pipe);
 int32_t Run_Scaling(pipe_t *pipe, win_image_t* img_dst);
+void scale_frame_published(pipe_t *pipe);
 
 void set_rpf_var (vsp_dev_t *dev, vsp_pipe_t *pipe);
 void set_wpf_var (vsp_dev_t *dev, vsp_pipe_t *pipe);
@@ -64,11 +65,21 @@ struct dl_body *vsp_dl_get_body(struct vsp_private_data *vdata);
 struct dl_body *vsp_dl_get_single_body(struct dl_memory *dlmemory);
 void vsp_dl_irq_dl_frame_end(struct vsp_private_data *vdata, vsp_dev_t *dev);
 void vsp_dl_irq_frame_end(struct vsp_private_data *vdata, vsp_dev_t *dev);
+const struct sigevent *vsp_dl_irq_vsync(struct vsp_private_data *vdata, vsp_dev_t *dev, unsigned vsync);
 int vsp_dl_irq_display_start(struct vsp_private_data *vdata, vsp_dev_t *dev);
 int vsp_dl_create(struct vsp_private_data *vdata, port_t *port, int dl_mode);
 void vsp_dl_reset(struct vsp_private_data *vdata);
 int vsp_dl_swap(struct vsp_private_data *vdata, vsp_dev_t *dev, void *dl);
 void vsp_dl_destroy(struct vsp_private_data *vdata);
+int vsp_dl_check(struct vsp_private_data *vdata, vsp_dev_t *dev, struct dl_body *body);
+int vsp_dl_set_check(struct vsp_private_data *vdata, int enable);
+void vsp_dl_account(struct vsp_private_data *vdata, struct dl_body *body, uint64_t cycles);
+void vsp_dl_get_stats(struct vsp_private_data *vdata, int *value);
+int vsp_dl_latch_vsync(struct vsp_private_data *vdata, unsigned seq, unsigned *vsync);
+void vsp_dl_stats(void *device, void *disp, int *value);
+int vsp_dl_check_enable(void *device, void *disp, int enable);
+unsigned vsp_dl_seq(void *device, void *disp);
+int vsp_dl_latched(void *device, void *disp, unsigned seq, unsigned *vsync);
 
 void set_rpf (vsp_dev_t *dev, rpf_par_t *rpf_par);
 void set_wpf (vsp_dev_t *dev, wpf_par_t *wpf_par);
@@ -111,16 +111,12 @@ int get_bpp(int fmt){
 }
 
 void get_stride(int fmt, int *mul, int *div, int *mulC, int *divC){
-	/* Y */
+	/* Y, packed 4:2:2 is already 2 bytes per pixel in get_bpp() */
 	switch( fmt ){
 	case VSPCORE_YUV444I: case VSPCORE_YUV420I:
 		*mul = 3;
 		*div = 1;
 		break;
-	case VSPCORE_YUV422Itype0: case VSPCORE_YUV422Itype1:
-		*mul = 2;
-		*div = 1;
-		break;
 	default:
 		*mul = 1;
 		*div = 1;
@@ -401,33 +397,27 @@ void set_rpf_var (vsp_dev_t *dev, vsp_pipe_t *pipe)
 	}
 	else									/* YUV space */
 	{
-		if (pipe->src.fmt != pipe->dst.fmt)
+		if ((pipe->dst.fmt & 0x7f) <= 0x3f)	/* RGB output */
 			rpf_par->infmt 		|= (1<<8);		/* Enable Color space conversion */
 		rpf_par->dswap		= 0xF;
 		rpf_par->alph_sel	= (4 << 28);	/* Fixed alpha */
-		
-		/* Check YC order of VSPCORE_YUV422Itype0 format */
-		if ((rpf_par->infmt & 0x7f) == VSPCORE_YUV422Itype0)
-		{
-			if (pipe->src.fmt & ORDER_YUY2)
-			{
-				rpf_par->infmt |= (1<<15);	/*SPYCS=1*/
-			}
-			else if (pipe->src.fmt & ORDER_YVYU)
-			{
-				rpf_par->infmt |= (1<<15) | (1<<14); /*SPUVS,SPYCS=1*/
-			}
-		}
 	}
 	
 	rpf_par->vrtcol_set		= 0xFF000000;	/* Fixed alpha value */
 	rpf_par->loc			= (pipe->dst.hcoord << 16) | pipe->dst.vcoord;
 	
 	/* Get source memory stride */
-	int bpp = get_bpp(rpf_par->infmt & 0x7f);
-	get_stride(rpf_par->infmt, &multiply, &division, &multiply_c, &division_c);
+	int fmt = pipe->src.fmt & 0x7f;
+	int bpp = get_bpp(fmt);
+	get_stride(fmt, &multiply, &division, &multiply_c, &division_c);
 	int stride_y = (pipe->src.width * bpp * multiply) / division;
 	int stride_c = (pipe->src.width * bpp * multiply_c) / division_c;
+	if (pipe->src.stride)
+	{
+		/* externally laid out buffer, chroma pitch follows the luma pitch */
+		stride_c = (stride_c * pipe->src.stride) / stride_y;
+		stride_y = pipe->src.stride;
+	}
 	rpf_par->srcm_pstride	= ((stride_y & 0xFFFF) << 16) | (stride_c & 0xFFFF);
 
 	rpf_par->srcm_addr_y	= pipe->src.addr.y_rgb + pipe->src_rect[1] * stride_y +
@@ -436,6 +426,19 @@ void set_rpf_var (vsp_dev_t *dev, vsp_pipe_t *pipe)
 								pipe->src_rect[0];
 	rpf_par->srcm_addr_c1	= pipe->src.addr.c1 + (pipe->src_rect[1] * stride_c)/2 +
 								pipe->src_rect[0] * bpp;			
+
+	/* YC order of VSPCORE_YUV422Itype0, register bits only */
+	if (fmt == VSPCORE_YUV422Itype0)
+	{
+		if (pipe->src.fmt & ORDER_YUY2)
+		{
+			rpf_par->infmt |= (1<<15);	/*SPYCS=1*/
+		}
+		else if (pipe->src.fmt & ORDER_YVYU)
+		{
+			rpf_par->infmt |= (1<<15) | (1<<14); /*SPUVS,SPYCS=1*/
+		}
+	}
 }
 
 void set_wpf_var (vsp_dev_t *dev, vsp_pipe_t *pipe)
@@ -626,7 +629,12 @@ void VspLib_fini (void *arg)
 	InterruptDetach(dev->iid);
 	vsp_dl_destroy (dev->pvdata);
     if(is_vspi(dev))
+    {
+        SLOG_INFO("VSPI: %u scale plans replayed, %u rebuilt", dev->plan.hits, dev->plan.misses);
+        ConnectDetach(dev->irqcoid);
+        ChannelDestroy(dev->irqchan);
         pthread_mutex_destroy(&dev->vsp_mutex);
+    }
 	munmap_device_io (dev->reg_base_ptr, dev->reg_size);
   free(dev->pvdata);
   free (dev);
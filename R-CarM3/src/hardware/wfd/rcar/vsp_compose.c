@@ -24,6 +24,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <devctl.h>
 #include <string.h>
@@ -140,6 +141,12 @@ void vsp_frame_update(void *device, void *pipeline)
 	void *compose_dev 		= port->du_cfg->compose_dev;
 	vsp_pipe_t vsp_pipe;
 
+	/* imported buffer written through a cached CPU mapping */
+	if (img->flags & WIN_IMAGE_FLAG_CACHED_RCAR)
+	{
+		msync(img->vaddr, img->size, MS_SYNC | MS_CACHE_ONLY);
+	}
+
 	/* set parameters */
 	vsp_pipe.vsp_pipe_id = (pipe->pipeId-1)%VSP_COMPOSITION_PIPELINE_MAX;
 	if (scaling_possible(pipe))
@@ -156,6 +163,7 @@ void vsp_frame_update(void *device, void *pipeline)
 		vsp_pipe.src.fmt = WfdToVspFormat (img_dst.format);
 		vsp_pipe.src.width = img_dst.width;
 		vsp_pipe.src.height = img_dst.height;
+		vsp_pipe.src.stride = 0;
 		vsp_pipe.src_rect[0] = pipe->src_rect[0];
 		vsp_pipe.src_rect[1] = pipe->src_rect[1];
 		vsp_pipe.src_rect[2] = pipe->dst_rect[2];
@@ -171,16 +179,76 @@ void vsp_frame_update(void *device, void *pipeline)
 			vsp_pipe.src.fmt |= OPACITY_FULL;
 		vsp_pipe.src.width = img->width;
 		vsp_pipe.src.height = img->height;
+		vsp_pipe.src.stride = (img->flags & WIN_IMAGE_FLAG_IMPORTED_RCAR) ? img->strides[0] : 0;
 		vsp_pipe.src_rect[0] = pipe->src_rect[0];
 		vsp_pipe.src_rect[1] = pipe->src_rect[1];
 		vsp_pipe.src_rect[2] = pipe->src_rect[2];
 		vsp_pipe.src_rect[3] = pipe->src_rect[3];
 	}
  		
+	vsp_pipe.dst.fmt = WfdToVspFormat (WFD_FORMAT_RGBA8888_QNX);	/* BRU blends in RGB */
 	vsp_pipe.dst.width = pipe->dst_rect[2];
 	vsp_pipe.dst.height = pipe->dst_rect[3];
 	vsp_pipe.dst.hcoord = pipe->dst_rect[0];
 	vsp_pipe.dst.vcoord = pipe->dst_rect[1];
 	
 	VspLib_frame_update(compose_dev, &vsp_pipe);
+
+	if (scaling_possible(pipe))
+	{
+		scale_frame_published(pipe);
+	}
+}
+
+void vsp_dl_stats(void *device, void *disp, int *value)
+{
+	port_t *port = (port_t *)disp;
+	vsp_dev_t *dev = (vsp_dev_t *)port->du_cfg->compose_dev;
+
+	if (!dev || !dev->pvdata || !dev->pvdata->dlmemory) {
+		if (value)
+			memset(value, 0, WFD_DL_STATS_COUNT_RCAR * sizeof(*value));
+		return;
+	}
+	if (value)
+		vsp_dl_get_stats(dev->pvdata, value);
+	else
+		memset(&dev->pvdata->dlmemory->stats, 0, sizeof(dev->pvdata->dlmemory->stats));
+}
+
+int vsp_dl_check_enable(void *device, void *disp, int enable)
+{
+	port_t *port = (port_t *)disp;
+	vsp_dev_t *dev = (vsp_dev_t *)port->du_cfg->compose_dev;
+
+	if (!dev || !dev->pvdata || !dev->pvdata->dlmemory)
+		return -1;
+	if (enable < 0)
+		return dev->pvdata->dlmemory->shadow != NULL;
+
+	return vsp_dl_set_check(dev->pvdata, enable);
+}
+
+/* Only header mode lists go through the arena and are logged when latched */
+unsigned vsp_dl_seq(void *device, void *disp)
+{
+	port_t *port = (port_t *)disp;
+	vsp_dev_t *dev = (vsp_dev_t *)port->du_cfg->compose_dev;
+
+	if (!dev || !dev->pvdata || !dev->pvdata->dlmemory ||
+	    (dev->pvdata->dlmemory->dl_mode != DL_MODE_AUTO_REPEAT))
+		return 0;
+
+	return dev->pvdata->dlmemory->arena.commits;
+}
+
+int vsp_dl_latched(void *device, void *disp, unsigned seq, unsigned *vsync)
+{
+	port_t *port = (port_t *)disp;
+	vsp_dev_t *dev = (vsp_dev_t *)port->du_cfg->compose_dev;
+
+	if (!dev || !dev->pvdata || !dev->pvdata->dlmemory)
+		return -1;
+
+	return vsp_dl_latch_vsync(dev->pvdata, seq, vsync);
 }
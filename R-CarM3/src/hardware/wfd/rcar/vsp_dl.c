@@ -29,6 +29,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/syspage.h>
 
 #include "vsp.h"
 
@@ -161,6 +162,67 @@ void vsp_dl_irq_frame_end(struct vsp_private_data *vdata, vsp_dev_t *dev)
 	/* no operation */
 }
 
+/*
+ * This function is called from the DU vsync interrupt, after the VSP has
+ * fetched the header for the new frame. The header it fetched was written at
+ * the previous vsync, so that body is now latched and the one it replaces is
+ * released a vsync later. The header is only written here, the VSP does not
+ * fetch it again before the next frame start. Only this ISR writes the
+ * programmed, latched and released state, the commit path only reads it.
+ * vsync is the port vsync count the latch is logged with. Returns the event
+ * waking a commit that waits for a free body, if any.
+ */
+const struct sigevent *vsp_dl_irq_vsync(struct vsp_private_data *vdata, vsp_dev_t *dev, unsigned vsync)
+{
+	struct dl_memory *dlmemory = vdata->dlmemory;
+	struct dl_arena *arena = &dlmemory->arena;
+	struct display_header *dheader = dlmemory->head[0].dheader;
+	const struct sigevent *event = NULL;
+	struct dl_body *body;
+	struct dl_latch *latch;
+	unsigned idx;
+
+	if ((dlmemory->flag & DL_FLAG_HEADER_LESS) || !dlmemory->start)
+		return NULL;
+
+	arena->frame_count++;
+
+	/* the VSP has not read it during the frame that just ended */
+	if (arena->retiring < DL_BODY_ARENA_NUM) {
+		__atomic_add_fetch(&arena->released[arena->retiring], 1, __ATOMIC_RELEASE);
+		arena->retiring = DL_ARENA_IDX_NONE;
+	}
+
+	if (arena->programmed != arena->latched) {
+		arena->retiring = arena->latched;
+		__atomic_store_n(&arena->latched, arena->programmed, __ATOMIC_RELEASE);
+
+		latch = &arena->latch_log[arena->latch_count & (DL_LATCH_LOG - 1)];
+		latch->seq = arena->seq[arena->programmed];
+		latch->vsync = vsync;
+		__atomic_store_n(&arena->latch_count, arena->latch_count + 1, __ATOMIC_RELEASE);
+	}
+
+	idx = __atomic_exchange_n(&arena->pending, DL_ARENA_IDX_NONE, __ATOMIC_ACQUIRE);
+	if ((idx < DL_BODY_ARENA_NUM) && (idx == arena->programmed)) {
+		/* a body borrowed back after a stall, already in the header */
+		__atomic_add_fetch(&arena->released[idx], 1, __ATOMIC_RELEASE);
+	} else if (idx < DL_BODY_ARENA_NUM) {
+		body = &arena->body[idx];
+		dheader->display_list[0].num_bytes = body->reg_count * 8;
+		dheader->display_list[0].plist = body->paddr;
+		dsb();
+		__atomic_store_n(&arena->programmed, idx, __ATOMIC_RELEASE);
+	}
+
+	/* kept set until the commit finds a body, in case the DU delivers its own event */
+	if (__atomic_load_n(&arena->want_retire, __ATOMIC_ACQUIRE)) {
+		event = &arena->event;
+	}
+
+	return event;
+}
+
 /* This function is called when the display start interrupt occurs. */
 int vsp_dl_irq_display_start(struct vsp_private_data *vdata, vsp_dev_t *dev)
 {
@@ -285,7 +347,7 @@ static int vsp_dl_config(struct dl_memory *dlmemory)
             /* body config */
             for (k = 0; k < DL_BODY_NUM_FOR_WORK; k++) 
             {
-                struct dl_body *body = &(dlmemory->body[i + k]);
+                struct dl_body *body = &(dlmemory->body[i * DL_BODY_NUM_FOR_WORK + k]);
 
                 body->reg_count = 0;
                 body->paddr = dlmemory->paddr + offset;
@@ -296,7 +358,21 @@ static int vsp_dl_config(struct dl_memory *dlmemory)
                 /* specify a multiple of 8 bytes for Display List body address*/
                 offset += DL_BODY_SIZE;
             }
-            offset += DL_BODY_SIZE*DL_BODY_NUM_FOR_WORK;
+        }
+
+        /* body arena config, placed behind the header/body pairs */
+        for (k = 0; k < DL_BODY_ARENA_NUM; k++)
+        {
+            struct dl_body *body = &dlmemory->arena.body[k];
+
+            body->reg_count = 0;
+            body->use = DL_MEM_NO_USE;
+            body->paddr = dlmemory->paddr + offset;
+            body->dlist = dlmemory->vaddr + offset;
+            body->dlist_offset = offset;
+            body->next = NULL;
+            body->flag = 0;
+            offset += DL_BODY_SIZE;
         }
 	} else if(dlmemory->dl_mode == DL_MODE_HEADER_LESS_AUTO_REPEAT)
     {
@@ -336,6 +412,7 @@ int vsp_dl_create(struct vsp_private_data *vdata, port_t *port, int dl_mode)
 	if(dl_mode == DL_MODE_AUTO_REPEAT){
 		/* normal auto mode */
 		dl_mem_size = (DL_HEADER_SIZE + (DL_BODY_SIZE * DL_BODY_NUM_FOR_WORK))*DISPLAY_LIST_NUM;
+		dl_mem_size += DL_BODY_SIZE * DL_BODY_ARENA_NUM;
 	}else if(dl_mode == DL_MODE_HEADER_LESS_AUTO_REPEAT){
 		/* header less auto mode */
 		dl_mem_size = DL_BODY_SIZE * DISPLAY_LIST_NUM;
@@ -375,7 +452,27 @@ int vsp_dl_create(struct vsp_private_data *vdata, port_t *port, int dl_mode)
 	_dlmemory->active_body_index = 0;
 	_dlmemory->start = 0;
 	_dlmemory->dl_mode = dl_mode;
+	memset( &_dlmemory->arena, 0, sizeof( _dlmemory->arena ) );
+	_dlmemory->arena.pending = DL_ARENA_IDX_NONE;
+	_dlmemory->arena.programmed = DL_ARENA_IDX_NONE;
+	_dlmemory->arena.latched = DL_ARENA_IDX_NONE;
+	_dlmemory->arena.retiring = DL_ARENA_IDX_NONE;
 	memset( &_dlmemory->lock, 0, sizeof( intrspin_t ) );
+
+	/* commits waiting for a free arena body are woken from the vsync ISR */
+	_dlmemory->arena.chid = ChannelCreate(0);
+	_dlmemory->arena.coid = ConnectAttach(0, 0, _dlmemory->arena.chid, _NTO_SIDE_CHANNEL, 0);
+	if ((_dlmemory->arena.chid == -1) || (_dlmemory->arena.coid == -1)) {
+		SLOG_ERROR("return: Can't create the DL arena channel");
+		if (_dlmemory->arena.chid != -1)
+			ChannelDestroy(_dlmemory->arena.chid);
+		ret = EXIT_FAILURE;
+		goto error2;
+	}
+	SIGEV_PULSE_INIT(&_dlmemory->arena.event, _dlmemory->arena.coid, SIGEV_PULSE_PRIO_INHERIT, DL_ARENA_RETIRE_PULSE, 0);
+
+	memset( &_dlmemory->stats, 0, sizeof( _dlmemory->stats ) );
+	_dlmemory->shadow = NULL;
 	vsp_dl_config(_dlmemory);
 	vdata->dlmemory = _dlmemory;
 	return EXIT_SUCCESS;
@@ -390,29 +487,110 @@ error1:
 
 void vsp_dl_destroy(struct vsp_private_data *vdata)
 {
+	struct dl_arena *arena = &vdata->dlmemory->arena;
+
+	if (arena->commits) {
+		SLOG_INFO("DL arena: %u commits, %u waited for a free body, %u dropped before latch",
+			arena->commits, arena->waits, arena->dropped);
+	}
+	if (vdata->dlmemory->stats.commits) {
+		int value[WFD_DL_STATS_COUNT_RCAR];
+
+		vsp_dl_get_stats(vdata, value);
+		SLOG_INFO("DL: %d commits, %d bytes and %d us average, %d us max, %d of %d checked lists bad",
+			value[WFD_DL_STATS_COMMITS_RCAR], value[WFD_DL_STATS_BYTES_AVG_RCAR],
+			value[WFD_DL_STATS_GEN_AVG_RCAR], value[WFD_DL_STATS_GEN_MAX_RCAR],
+			value[WFD_DL_STATS_ERRORS_RCAR], value[WFD_DL_STATS_CHECKED_RCAR]);
+	}
+	ConnectDetach(arena->coid);
+	ChannelDestroy(arena->chid);
+	free(vdata->dlmemory->shadow);
 	munmap(vdata->dlmemory->vaddr, vdata->dlmemory->size);
 	free(vdata->dlmemory);
 }
 
+/* A body all of whose handovers the vsync ISR has released */
+static int vsp_dl_arena_find_free(struct dl_arena *arena)
+{
+	unsigned i;
+
+	for (i = 0; i < DL_BODY_ARENA_NUM; i++) {
+		if ((int)(arena->handed[i] - __atomic_load_n(&arena->released[i], __ATOMIC_ACQUIRE)) <= 0)
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * No vsync came in, so the display is not fetching anymore: take back what was
+ * never written to the header, else borrow a body the header does not point
+ * at. A borrowed body keeps its handovers, the ISR still releases each of them
+ * once the vsyncs come back.
+ */
+static int vsp_dl_arena_reclaim(struct dl_arena *arena)
+{
+	unsigned programmed = __atomic_load_n(&arena->programmed, __ATOMIC_ACQUIRE);
+	unsigned latched = __atomic_load_n(&arena->latched, __ATOMIC_ACQUIRE);
+	unsigned old;
+	unsigned i;
+
+	old = __atomic_exchange_n(&arena->pending, DL_ARENA_IDX_NONE, __ATOMIC_ACQ_REL);
+	if (old < DL_BODY_ARENA_NUM) {
+		arena->handed[old]--;
+		return old;
+	}
+
+	for (i = 0; i < DL_BODY_ARENA_NUM; i++) {
+		if ((i != programmed) && (i != latched))
+			return i;
+	}
+	for (i = 0; i < DL_BODY_ARENA_NUM; i++) {
+		if (i != programmed)
+			return i;
+	}
+
+	return -1;
+}
+
 struct dl_body *vsp_dl_get_body(struct vsp_private_data *vdata)
 {
-	struct dl_body *body = NULL;
 	struct dl_memory *dlmemory = vdata->dlmemory;
- 	if (-1 == ThreadCtl(_NTO_TCTL_IO, 0)) {
-	    return NULL;
+	struct dl_arena *arena = &dlmemory->arena;
+	struct dl_body *body = NULL;
+	struct _pulse pulse;
+	uint64_t timeout = DL_ARENA_WAIT_MAX_MS * 1000000ULL;
+	int idx;
+
+	idx = vsp_dl_arena_find_free(arena);
+	if (idx < 0) {
+		arena->waits++;
 	}
 
-	InterruptLock( &dlmemory->lock );
+	/* every body is owned by the VSP, a free one shows up at a coming vsync */
+	while (idx < 0) {
+		/* asked before looking again, so a release in between still sends the pulse */
+		__atomic_store_n(&arena->want_retire, 1, __ATOMIC_SEQ_CST);
+		idx = vsp_dl_arena_find_free(arena);
+		if (idx >= 0) {
+			break;
+		}
 
-	if(vdata->active == 0 || dlmemory->active_body_index == DL_BODY_NUM_FOR_WORK - 1){
-		dlmemory->active_body_index = 0;
-	}else{
-		dlmemory->active_body_index++;
+		/* a stale pulse from an earlier wait is only a wakeup */
+		TimerTimeout(CLOCK_MONOTONIC, _NTO_TIMEOUT_RECEIVE, NULL, &timeout, NULL);
+		if (MsgReceivePulse(arena->chid, &pulse, sizeof(pulse), NULL) == -1) {
+			/* no vsync came in, the display is not fetching anymore */
+			idx = vsp_dl_arena_reclaim(arena);
+			break;
+		}
 	}
+	__atomic_store_n(&arena->want_retire, 0, __ATOMIC_RELAXED);
 
-	body = &dlmemory->body[dlmemory->active_body_index];
-	InterruptUnlock(&dlmemory->lock);
+	if (idx < 0) {
+		return NULL;
+	}
 
+	body = &arena->body[idx];
 	body->reg_count = 0;
 	body->next = NULL;
 
@@ -470,14 +648,21 @@ static int vsp_dl_header_setup(struct dl_head *head)
 
 static int vsp_dl_start_header_mode(struct vsp_private_data *vdata, vsp_dev_t *dev, struct dl_head *head)
 {
- 	if (-1 == ThreadCtl(_NTO_TCTL_IO, 0)) {
-	    return EXIT_FAILURE;
+	struct dl_arena *arena = &vdata->dlmemory->arena;
+
+	if (head->dl_body_list[0] == NULL) {
+		return EXIT_FAILURE;
 	}
 
-	InterruptLock( &vdata->dlmemory->lock );
-	vsp_dl_header_setup(&vdata->dlmemory->head[0]);
+	/* the VSP is stopped and the ISR skips the arena, nothing to synchronize with yet */
+	vsp_dl_header_setup(head);
+	arena->last = head->dl_body_list[0] - arena->body;
+	arena->handed[arena->last]++;
+	arena->programmed = arena->last;
+	arena->latched = arena->last;
+	arena->commits++;
+	arena->seq[arena->last] = arena->commits;
 	vdata->dlmemory->start = 1;
-	InterruptUnlock(&vdata->dlmemory->lock);
 
 	dev->reg.dl->ctrl = VI6_DL_CTRL_AR_WAIT | VI6_DL_CTRL_DL_ENABLE;
 	/* DL LWORD swap */
@@ -562,20 +747,29 @@ int vsp_dl_start(struct vsp_private_data *vdata, vsp_dev_t *dev, void *dl, int d
 
 static int vsp_dl_swap_header_mode(struct vsp_private_data *vdata, struct dl_head *head)
 {
-	struct display_header *dheader = head->dheader;
+	struct dl_memory *dlmemory = vdata->dlmemory;
+	struct dl_arena *arena = &dlmemory->arena;
 	struct dl_body *dl_body_list = head->dl_body_list[0];
+	unsigned idx, old;
 
-	if (dl_body_list != NULL)
-	{
-	 	if (-1 == ThreadCtl(_NTO_TCTL_IO, 0)) {
-		    return EXIT_FAILURE;
-		}
-		InterruptLock( &vdata->dlmemory->lock );
-		dheader->display_list[0].plist = dl_body_list->paddr;
-		InterruptUnlock( &vdata->dlmemory->lock );
-	} else {
+	if (dl_body_list == NULL) {
 		return EXIT_FAILURE;
 	}
+	idx = dl_body_list - arena->body;
+	arena->handed[idx]++;
+	arena->last = idx;
+	arena->commits++;
+	arena->seq[idx] = arena->commits;
+
+	dsb();
+
+	/* publish: the vsync ISR writes it to the header while the VSP is not fetching */
+	old = __atomic_exchange_n(&arena->pending, idx, __ATOMIC_ACQ_REL);
+	if (old < DL_BODY_ARENA_NUM) {
+		/* the ISR never took it, it never reached the header */
+		arena->handed[old]--;
+		arena->dropped++;
+	}
 
 	return EXIT_SUCCESS;
 }
@@ -668,6 +862,15 @@ void vsp_dl_reset(struct vsp_private_data *vdata)
 		for (i = 0; i < DL_BODY_NUM_FOR_WORK; i++) {
 			dlmemory->body[i].reg_count = 0;
 		}
+		dlmemory->arena.pending = DL_ARENA_IDX_NONE;
+		dlmemory->arena.programmed = DL_ARENA_IDX_NONE;
+		dlmemory->arena.latched = DL_ARENA_IDX_NONE;
+		dlmemory->arena.retiring = DL_ARENA_IDX_NONE;
+		dlmemory->arena.want_retire = 0;
+		for (i = 0; i < DL_BODY_ARENA_NUM; i++) {
+			dlmemory->arena.body[i].reg_count = 0;
+			dlmemory->arena.handed[i] = dlmemory->arena.released[i];
+		}
 	} else {
 		for (i = 0; i < DISPLAY_LIST_NUM; i++) {
 			vsp_dl_free_multi_body(&dlmemory->single_body[i]);
@@ -677,3 +880,189 @@ void vsp_dl_reset(struct vsp_private_data *vdata)
 	InterruptUnlock( &dlmemory->lock );
 
 }
+
+/*
+ * Display list checker. A list is played back into a model of the VSP
+ * register file the way the DL loader would execute it, starting from the
+ * header in header mode, and the model is compared with the RPF/WPF
+ * parameters the list was generated from. It runs in the driver on the
+ * target, enabled by WFD_PORT_DL_CHECK_RCAR, and in utils/vsp-dlsim on the
+ * host.
+ */
+static int vsp_dl_play_body(struct dl_memory *dlmemory, uint64_t paddr, uint32_t num_bytes)
+{
+	struct display_list *dlist;
+	uint32_t i;
+
+	if ((num_bytes & 7) || (num_bytes > DL_BODY_SIZE)) {
+		SLOG_ERROR("DL check: bad body size %u", num_bytes);
+		return -1;
+	}
+	if ((paddr < dlmemory->paddr) || (paddr + num_bytes > dlmemory->paddr + dlmemory->size)) {
+		SLOG_ERROR("DL check: body 0x%llx outside of the DL memory", (unsigned long long)paddr);
+		return -1;
+	}
+	dlist = (struct display_list *)((uint8_t *)dlmemory->vaddr + (paddr - dlmemory->paddr));
+
+	for (i = 0; i < num_bytes / 8; i++) {
+		if ((dlist[i].set_address & 3) || (dlist[i].set_address >= VSP_REG_SIZE)) {
+			SLOG_ERROR("DL check: entry %u writes to bad register 0x%x", i, dlist[i].set_address);
+			return -1;
+		}
+		dlmemory->shadow[dlist[i].set_address / 4] = dlist[i].set_data;
+	}
+
+	return 0;
+}
+
+#define DL_SHADOW(reg)	(dlmemory->shadow[get_reg_off(&(reg)) / 4])
+
+#define DL_CHECK_REG(reg, val, what, id) \
+	if (DL_SHADOW(reg) != (val)) { \
+		SLOG_ERROR("DL check: " what "%d is 0x%08x, expected 0x%08x", id, DL_SHADOW(reg), (val)); \
+		errors++; \
+	}
+
+int vsp_dl_check(struct vsp_private_data *vdata, vsp_dev_t *dev, struct dl_body *body)
+{
+	struct dl_memory *dlmemory = vdata->dlmemory;
+	struct display_header *dheader;
+	rpf_par_t *rpf_par;
+	wpf_par_t *wpf_par = &dev->param.wpf_par[0];
+	uint32_t src_rpf;
+	int errors = 0;
+	int i;
+
+	if (!dlmemory->shadow) {
+		return 0;
+	}
+	memset(dlmemory->shadow, 0, VSP_REG_SIZE);
+
+	if (dlmemory->dl_mode == DL_MODE_AUTO_REPEAT) {
+		/* the body goes into the header at the next vsync, check the header itself */
+		dheader = dlmemory->head[0].dheader;
+		if ((dheader->num_list_minus1 & 7) != DL_LINKED_BODY_NUM - 1) {
+			SLOG_ERROR("DL check: header links %u bodies", (dheader->num_list_minus1 & 7) + 1);
+			errors++;
+		}
+		if (dheader->pnext_header != dlmemory->head[0].paddr) {
+			SLOG_ERROR("DL check: header does not repeat itself");
+			errors++;
+		}
+		if ((unsigned)(body - dlmemory->arena.body) != dlmemory->arena.last) {
+			SLOG_ERROR("DL check: body is not the published one");
+			errors++;
+		}
+	}
+	if (vsp_dl_play_body(dlmemory, body->paddr, body->reg_count * 8)) {
+		errors++;
+	}
+
+	src_rpf = DL_SHADOW(dev->reg.wpf[0].src_rpf);
+	for (i = 0; i < VSPD_INPUT_IMAGE_NUM; i++) {
+		rpf_par = &dev->param.rpf_par[i];
+
+		if (!!((src_rpf >> i*2) & SRC_RPF_MASK) != !!rpf_par->active) {
+			SLOG_ERROR("DL check: RPF%d is %s in the list", i, rpf_par->active ? "not routed" : "routed");
+			errors++;
+		}
+		if (!rpf_par->active) {
+			continue;
+		}
+		DL_CHECK_REG(dev->reg.rpf[i].srcm_addr_y, rpf_par->srcm_addr_y, "address of RPF", i);
+		DL_CHECK_REG(dev->reg.rpf[i].srcm_pstride, rpf_par->srcm_pstride, "stride of RPF", i);
+		DL_CHECK_REG(dev->reg.rpf[i].src_esize, rpf_par->src_esize, "size of RPF", i);
+		DL_CHECK_REG(dev->reg.rpf[i].infmt, rpf_par->infmt, "format of RPF", i);
+		DL_CHECK_REG(dev->reg.rpf[i].loc, rpf_par->loc, "position of RPF", i);
+		/* the layer has to stay inside the master layer */
+		if (((rpf_par->loc >> 16) + (rpf_par->src_esize >> 16) > dev->info.mWidth) ||
+		    ((rpf_par->loc & 0xffff) + (rpf_par->src_esize & 0xffff) > dev->info.mHeight)) {
+			SLOG_ERROR("DL check: RPF%d at %d,%d %dx%d is outside of %dx%d", i,
+				rpf_par->loc >> 16, rpf_par->loc & 0xffff,
+				rpf_par->src_esize >> 16, rpf_par->src_esize & 0xffff,
+				dev->info.mWidth, dev->info.mHeight);
+			errors++;
+		}
+	}
+	DL_CHECK_REG(dev->reg.wpf[0].src_rpf, wpf_par->src_rpf, "routing of WPF", 0);
+	DL_CHECK_REG(dev->reg.wpf[0].outfmt, 0x00800000 | wpf_par->outfmt, "format of WPF", 0);
+
+	dlmemory->stats.checked++;
+	if (errors) {
+		dlmemory->stats.errors++;
+	}
+
+	return errors ? -1 : 0;
+}
+
+int vsp_dl_set_check(struct vsp_private_data *vdata, int enable)
+{
+	struct dl_memory *dlmemory = vdata->dlmemory;
+
+	if (enable && !dlmemory->shadow) {
+		dlmemory->shadow = calloc(1, VSP_REG_SIZE);
+		if (!dlmemory->shadow) {
+			return -1;
+		}
+	} else if (!enable && dlmemory->shadow) {
+		free(dlmemory->shadow);
+		dlmemory->shadow = NULL;
+	}
+
+	return 0;
+}
+
+void vsp_dl_account(struct vsp_private_data *vdata, struct dl_body *body, uint64_t cycles)
+{
+	struct dl_stats *stats = &vdata->dlmemory->stats;
+
+	stats->commits++;
+	stats->last_bytes = body->reg_count * 8;
+	stats->bytes += stats->last_bytes;
+	stats->cycles += cycles;
+	if (cycles > stats->max_cycles) {
+		stats->max_cycles = cycles;
+	}
+}
+
+/*
+ * Port vsync count at which the VSP latched the list published by commit seq.
+ * Returns 1 with *vsync set, 0 while it may still be latched, -1 if it never
+ * was, or is too old to be in the log.
+ */
+int vsp_dl_latch_vsync(struct vsp_private_data *vdata, unsigned seq, unsigned *vsync)
+{
+	struct dl_arena *arena = &vdata->dlmemory->arena;
+	unsigned count = __atomic_load_n(&arena->latch_count, __ATOMIC_ACQUIRE);
+	struct dl_latch *latch;
+	unsigned i;
+
+	/* newest first, the oldest slot is the next one the ISR writes */
+	for (i = 1; (i < DL_LATCH_LOG) && (i <= count); i++) {
+		latch = &arena->latch_log[(count - i) & (DL_LATCH_LOG - 1)];
+		if (latch->seq == seq) {
+			*vsync = latch->vsync;
+			return 1;
+		}
+		if ((int)(latch->seq - seq) < 0) {
+			/* not latched yet, or lists before and after it were: replaced while pending */
+			return (i == 1) ? 0 : -1;
+		}
+	}
+
+	return count ? -1 : 0;
+}
+
+void vsp_dl_get_stats(struct vsp_private_data *vdata, int *value)
+{
+	struct dl_stats *stats = &vdata->dlmemory->stats;
+	uint64_t cps = SYSPAGE_ENTRY(qtime)->cycles_per_sec;
+
+	value[WFD_DL_STATS_COMMITS_RCAR] = stats->commits;
+	value[WFD_DL_STATS_BYTES_LAST_RCAR] = stats->last_bytes;
+	value[WFD_DL_STATS_BYTES_AVG_RCAR] = stats->commits ? stats->bytes / stats->commits : 0;
+	value[WFD_DL_STATS_GEN_AVG_RCAR] = stats->commits ? stats->cycles * 1000000 / cps / stats->commits : 0;
+	value[WFD_DL_STATS_GEN_MAX_RCAR] = stats->max_cycles * 1000000 / cps;
+	value[WFD_DL_STATS_CHECKED_RCAR] = stats->checked;
+	value[WFD_DL_STATS_ERRORS_RCAR] = stats->errors;
+}
@@ -58,6 +58,7 @@
 
 
 #define VSP_INT_EVENT		            (0x69)
+#define DL_ARENA_RETIRE_PULSE		    (0x6A)
 
 #define PIPE_VALIDATE(pipe, ret) {\
 	if (pipe >= VSPD_INPUT_IMAGE_NUM) \
@@ -185,6 +186,7 @@ typedef struct {
 	int		hcoord;
 	int		vcoord;
 	int 	fmt;
+	int		stride;			/* luma line pitch in bytes, 0 if packed */
 	img_add_t	addr;
 }image_t;
 
@@ -278,6 +280,45 @@ typedef struct {
 	lif_par_t lif_par;	
 } vsp_par_t;
 
+/* address registers patched when a VSPI partition plan is replayed */
+#define VSPI_PLAN_ADDR_NUM		6
+#define VSPI_PLAN_PART_MAX		8	/* one display list per partition */
+#define VSPI_PLAN_PATCH_MAX		(VSPI_PLAN_PART_MAX * VSPI_PLAN_ADDR_NUM)
+
+typedef struct {
+	uint32_t		*data;		/* set_data of the display list entry */
+	int				base;		/* VSPI_PLAN_BASE_* the value is relative to */
+	uint32_t		delta;
+} vspi_patch_t;
+
+enum {
+	VSPI_PLAN_BASE_SRC_Y,
+	VSPI_PLAN_BASE_SRC_C0,
+	VSPI_PLAN_BASE_SRC_C1,
+	VSPI_PLAN_BASE_DST_Y,
+	VSPI_PLAN_BASE_DST_C0,
+	VSPI_PLAN_BASE_DST_C1,
+};
+
+/* DL chain of the last scale operation, reused while the geometry is the same */
+typedef struct {
+	int				valid;
+	uint32_t		src_width;
+	uint32_t		src_height;
+	uint32_t		src_stride;
+	uint32_t		src_fmt;
+	uint32_t		src_rect[4];
+	uint32_t		dst_width;
+	uint32_t		dst_height;
+	uint32_t		dst_fmt;
+	uint32_t		part_num;
+	vspi_patch_t	patch[VSPI_PLAN_PATCH_MAX];
+	unsigned		patch_num;
+	/* statistics */
+	unsigned		hits;
+	unsigned		misses;
+} vspi_plan_t;
+
 typedef struct {
 	uint32_t 		reg_base;
 	uintptr_t 		reg_base_ptr;
@@ -295,6 +336,7 @@ typedef struct {
 	vsp_reg_t		reg;
 	struct 			vsp_private_data *pvdata;
 	int				state;
+	vspi_plan_t		plan;
 } vsp_dev_t;
 
 /* DL mode */
@@ -311,10 +353,18 @@ enum {
 #define DISPLAY_LIST_NUM 8
 #define DISPLAY_LIST_BODY_NUM 8
 #define DL_HEADER_SIZE 128
-#define DL_BODY_SIZE 512
+/* a VSPD list writes all 5 RPFs and the WPF, 66 entries */
+#define DL_BODY_SIZE 1024
 #define DL_LINKED_BODY_NUM 1
 /* use 8 work body for switching a linked body */
 #define DL_BODY_NUM_FOR_WORK 1
+/* triple buffered bodies used by the VSPD commit path in header mode */
+#define DL_BODY_ARENA_NUM 3
+#define DL_ARENA_IDX_NONE DL_BODY_ARENA_NUM
+/* give up waiting for a free arena body after this many milliseconds */
+#define DL_ARENA_WAIT_MAX_MS 50
+/* latched display lists remembered for the frame timing, power of two */
+#define DL_LATCH_LOG 16
 
 
 #define VSP_STATUS_LOOP_CNT		(50)
@@ -395,6 +445,55 @@ struct dl_head {
 	struct dl_head *next;
 };
 
+/*
+ * Fixed set of DL bodies for one pipeline, shared by the commit path and the
+ * DU vsync ISR without an interrupt lock. A commit publishes a body with a
+ * single exchange of the pending index and the ISR takes it with another one,
+ * so a body replaced before the ISR saw it goes straight back to the commit
+ * path. The ISR counts in released[] every body the VSP stopped reading; a
+ * body is free once all of its handovers (handed[]) have been released.
+ */
+struct dl_latch {
+	unsigned seq;			/* commit that published the list */
+	unsigned vsync;			/* port vsync count at which the VSP latched it */
+};
+
+struct dl_arena {
+	struct dl_body body[DL_BODY_ARENA_NUM];
+	unsigned seq[DL_BODY_ARENA_NUM];		/* commit that last published the body */
+	unsigned handed[DL_BODY_ARENA_NUM];		/* handovers to the ISR, commit path only */
+	unsigned released[DL_BODY_ARENA_NUM];	/* handovers given back, vsync ISR only */
+	unsigned pending;		/* published by the last commit, not taken by the ISR yet */
+	unsigned programmed;	/* written to the header by the ISR */
+	unsigned latched;		/* fetched by the VSP for the current frame */
+	unsigned retiring;		/* let go of at the last vsync, released at the next one */
+	unsigned last;			/* published by the last commit */
+	unsigned frame_count;
+	/* written by the ISR, entry n at [n % DL_LATCH_LOG] */
+	struct dl_latch latch_log[DL_LATCH_LOG];
+	unsigned latch_count;
+	/* a commit waiting for a free body, woken by a pulse from the vsync ISR */
+	unsigned want_retire;
+	int chid;
+	int coid;
+	struct sigevent event;
+	/* statistics */
+	unsigned commits;		/* also the sequence number of the last commit */
+	unsigned waits;			/* commits that had to wait for a free body */
+	unsigned dropped;		/* pending bodies replaced before being latched */
+};
+
+/* display list generation statistics of the VSPD commit path */
+struct dl_stats {
+	unsigned commits;
+	unsigned last_bytes;
+	uint64_t bytes;
+	uint64_t cycles;		/* from parameter setup to publish */
+	uint64_t max_cycles;
+	unsigned checked;		/* lists played back by the checker */
+	unsigned errors;		/* lists that did not match their parameters */
+};
+
 struct dl_memory {
 	int size;
 	vsp_phy_addr_t paddr;
@@ -408,6 +507,7 @@ struct dl_memory {
 	struct dl_body body[DL_BODY_NUM_FOR_WORK*DISPLAY_LIST_NUM];
 	int active_body_index;
 	int start;
+	struct dl_arena arena;
 
 	/* header less mode */
 	struct dl_body single_body[DISPLAY_LIST_NUM];
@@ -416,6 +516,10 @@ struct dl_memory {
 	struct dl_body *active_body_next_set;
 	struct dl_body *next_body;
 	struct dl_body *pending_body;
+
+	struct dl_stats stats;
+	/* register model the checker plays lists back into, NULL when off */
+	uint32_t *shadow;
 };
 
 struct vsp_private_data {
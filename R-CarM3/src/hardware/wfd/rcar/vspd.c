@@ -49,7 +49,7 @@ int vspd_run_dl(struct vsp_private_data *vdata, vsp_dev_t *dev, void *dl, int dl
 	return ret;
 }
 
-static int vspd_dl_output_du_head_mode(	struct vsp_private_data *vdata, vsp_dev_t *dev)
+static int vspd_dl_output_du_head_mode(	struct vsp_private_data *vdata, vsp_dev_t *dev, struct dl_body **dl_body)
 {
 	int i;
 	struct dl_body *body;
@@ -68,11 +68,12 @@ static int vspd_dl_output_du_head_mode(	struct vsp_private_data *vdata, vsp_dev_
 	vsp_wpf_to_dl_core(vdata, dev, &dev->param.wpf_par[0], body);
 
 	vdata->dlmemory->head[0].dl_body_list[0] = body;
+	*dl_body = body;
 
 	return vspd_run_dl(vdata, dev, &vdata->dlmemory->head[0], DL_MODE_AUTO_REPEAT);
 }
 
-static int vspd_dl_output_du_head_less(struct vsp_private_data *vdata, vsp_dev_t *dev)
+static int vspd_dl_output_du_head_less(struct vsp_private_data *vdata, vsp_dev_t *dev, struct dl_body **dl_body)
 {
 	int i;
 	struct dl_body *body;
@@ -87,6 +88,7 @@ static int vspd_dl_output_du_head_less(struct vsp_private_data *vdata, vsp_dev_t
 	}
 
 	vsp_wpf_to_dl_core(vdata, dev, &dev->param.wpf_par[0], body);
+	*dl_body = body;
 
 	return vspd_run_dl(vdata, dev, body, DL_MODE_HEADER_LESS_AUTO_REPEAT);
 }
@@ -133,17 +135,24 @@ const struct sigevent* vspd2_intr (void* arg, int id)
 int vspd_dl_output_du(struct vsp_private_data *vdata, vsp_dev_t *dev, int pipeid)
 {
 	int ret = EXIT_SUCCESS;
+	uint64_t start = ClockCycles();
+	struct dl_body *body = NULL;
 	TRACE;
 	if (vdata->dlmemory->dl_mode == DL_MODE_HEADER_LESS_AUTO_REPEAT){
 		/* header less auto repeat mode */
-		return vspd_dl_output_du_head_less(vdata, dev);
+		ret = vspd_dl_output_du_head_less(vdata, dev, &body);
 	}
 	else if(vdata->dlmemory->dl_mode == DL_MODE_AUTO_REPEAT){
 		/* normal auto repeat mode */
-		return vspd_dl_output_du_head_mode(vdata, dev);
+		ret = vspd_dl_output_du_head_mode(vdata, dev, &body);
 	} else {
 		ret = EXIT_FAILURE;
 	}
+	if ((ret == EXIT_SUCCESS) && body) {
+		vsp_dl_account(vdata, body, ClockCycles() - start);
+		/* off the clock, the checker is a debugging aid */
+		vsp_dl_check(vdata, dev, body);
+	}
 	return ret;
 }
 
@@ -161,6 +170,16 @@ int	VspLib_frame_update( void *arg, vsp_pipe_t *pipe )
 	return dev->state;
 }
 
+/* Called from the DU vsync interrupt handler, returns an event to deliver or NULL */
+const struct sigevent *VspLib_compose_update_sync (void *arg, unsigned vsync)
+{
+	vsp_dev_t *dev = (vsp_dev_t *)arg;
+
+	if (dev->pvdata && dev->pvdata->dlmemory)
+		return vsp_dl_irq_vsync(dev->pvdata, dev, vsync);
+	return NULL;
+}
+
 void VspLib_activate_pipe ( void *arg, int pipeId )
 {
 	PIPE_VALIDATE(pipeId,return);
@@ -121,7 +121,7 @@ void scale_frame_prepare (vsp_dev_t *dev, vsp_pipe_t *pipe)
 	wpf_par->dstm_addr_y = pipe->dst.addr.y_rgb;
 	wpf_par->dstm_addr_c0 = pipe->dst.addr.c0;
 	wpf_par->dstm_addr_c1 = pipe->dst.addr.c1;
-	wpf_par->outfmt = pipe->dst.fmt;
+	wpf_par->outfmt = pipe->dst.fmt & 0x7f;
 	switch (wpf_par->outfmt)
 	{
 		case VSPCORE_RGBP888:
@@ -138,6 +138,14 @@ void scale_frame_prepare (vsp_dev_t *dev, vsp_pipe_t *pipe)
 	get_stride(wpf_par->outfmt, &multiply, &division, &multiply_c, &division_c);
 	wpf_par->dstm_stride_y = (pipe->dst.width * bpp * multiply) / division;
 	wpf_par->dstm_stride_c = (pipe->dst.width * bpp * multiply_c) / division_c;	
+	/* same Y/C order bits as the RPF, after the stride used the plain format */
+	if (wpf_par->outfmt == VSPCORE_YUV422Itype0)
+	{
+		if (pipe->dst.fmt & ORDER_YUY2)
+			wpf_par->outfmt |= (1<<15);	/*SPYCS=1*/
+		else if (pipe->dst.fmt & ORDER_YVYU)
+			wpf_par->outfmt |= (1<<15) | (1<<14); /*SPUVS,SPYCS=1*/
+	}
     /* set clipping parameter */
 	wpf_par->hszclip = VSP_WPF_HSZCLIP_HCEN;
     if( pipe->dst.width < INPUT_WPF_HSIZE_MAX)
@@ -197,7 +205,7 @@ void scale_frame_update(vsp_dev_t *dev, vsp_pipe_t *pipe, uint32_t dst_offset, u
         val_hszclip |= dst_width;
         val_hszclip |= margin << 16;
         dev->param.wpf_par[id].hszclip 	    = val_hszclip;
-        bpp = get_bpp(dev->param.wpf_par[id].outfmt);
+        bpp = get_bpp(dev->param.wpf_par[id].outfmt & 0x7f);
         dev->param.wpf_par[id].dstm_addr_y 	+= INPUT_WPF_HSIZE_MAX*bpp;
         if (dev->param.wpf_par[id].dstm_addr_c0 > 0)
             dev->param.wpf_par[id].dstm_addr_c0 += INPUT_WPF_HSIZE_MAX*bpp;
@@ -359,6 +367,104 @@ void vspi_set_part_diff_to_dl(vsp_dev_t *dev, struct display_header *pre_head, u
 	head->int_auto = 2;
 }
 
+static int vspi_plan_match(vspi_plan_t *plan, vsp_pipe_t *pipe)
+{
+	return plan->valid &&
+		(plan->src_width == pipe->src.width) &&
+		(plan->src_height == pipe->src.height) &&
+		(plan->src_stride == pipe->src.stride) &&
+		(plan->src_fmt == pipe->src.fmt) &&
+		(plan->src_rect[0] == pipe->src_rect[0]) &&
+		(plan->src_rect[1] == pipe->src_rect[1]) &&
+		(plan->src_rect[2] == pipe->src_rect[2]) &&
+		(plan->src_rect[3] == pipe->src_rect[3]) &&
+		(plan->dst_width == pipe->dst.width) &&
+		(plan->dst_height == pipe->dst.height) &&
+		(plan->dst_fmt == pipe->dst.fmt);
+}
+
+static uint32_t vspi_plan_base(vsp_pipe_t *pipe, int base)
+{
+	switch (base)
+	{
+		case VSPI_PLAN_BASE_SRC_Y:	return pipe->src.addr.y_rgb;
+		case VSPI_PLAN_BASE_SRC_C0:	return pipe->src.addr.c0;
+		case VSPI_PLAN_BASE_SRC_C1:	return pipe->src.addr.c1;
+		case VSPI_PLAN_BASE_DST_Y:	return pipe->dst.addr.y_rgb;
+		case VSPI_PLAN_BASE_DST_C0:	return pipe->dst.addr.c0;
+		default:					return pipe->dst.addr.c1;
+	}
+}
+
+/* Remember where the buffer addresses sit in the DL chain just built */
+static void vspi_plan_record(vsp_dev_t *dev, vsp_pipe_t *pipe, uint32_t part_num)
+{
+	vspi_plan_t *plan = &dev->plan;
+	uint32_t reg_off[VSPI_PLAN_ADDR_NUM];
+	uint32_t part, i;
+	int base;
+
+	reg_off[VSPI_PLAN_BASE_SRC_Y] = get_reg_off((uintptr_t)&dev->reg.rpf[0].srcm_addr_y);
+	reg_off[VSPI_PLAN_BASE_SRC_C0] = get_reg_off((uintptr_t)&dev->reg.rpf[0].srcm_addr_c0);
+	reg_off[VSPI_PLAN_BASE_SRC_C1] = get_reg_off((uintptr_t)&dev->reg.rpf[0].srcm_addr_c1);
+	reg_off[VSPI_PLAN_BASE_DST_Y] = get_reg_off((uintptr_t)&dev->reg.wpf[0].dstm_addr_y);
+	reg_off[VSPI_PLAN_BASE_DST_C0] = get_reg_off((uintptr_t)&dev->reg.wpf[0].dstm_addr_c0);
+	reg_off[VSPI_PLAN_BASE_DST_C1] = get_reg_off((uintptr_t)&dev->reg.wpf[0].dstm_addr_c1);
+
+	plan->valid = 0;
+	plan->patch_num = 0;
+	if (part_num > VSPI_PLAN_PART_MAX)
+		return;
+
+	for (part = 0; part < part_num; part++)
+	{
+		struct dl_body *body = &dev->pvdata->dlmemory->body[part];
+
+		for (i = 0; i < body->reg_count; i++)
+		{
+			for (base = 0; base < VSPI_PLAN_ADDR_NUM; base++)
+			{
+				if (body->dlist[i].set_address == reg_off[base])
+					break;
+			}
+			/* unused planes stay at zero */
+			if ((base == VSPI_PLAN_ADDR_NUM) || (body->dlist[i].set_data == 0))
+				continue;
+			if (plan->patch_num == VSPI_PLAN_PATCH_MAX)
+				return;
+			plan->patch[plan->patch_num].data = &body->dlist[i].set_data;
+			plan->patch[plan->patch_num].base = base;
+			plan->patch[plan->patch_num].delta = body->dlist[i].set_data - vspi_plan_base(pipe, base);
+			plan->patch_num++;
+		}
+	}
+
+	plan->src_width = pipe->src.width;
+	plan->src_height = pipe->src.height;
+	plan->src_stride = pipe->src.stride;
+	plan->src_fmt = pipe->src.fmt;
+	plan->src_rect[0] = pipe->src_rect[0];
+	plan->src_rect[1] = pipe->src_rect[1];
+	plan->src_rect[2] = pipe->src_rect[2];
+	plan->src_rect[3] = pipe->src_rect[3];
+	plan->dst_width = pipe->dst.width;
+	plan->dst_height = pipe->dst.height;
+	plan->dst_fmt = pipe->dst.fmt;
+	plan->part_num = part_num;
+	plan->valid = 1;
+}
+
+static void vspi_plan_replay(vsp_dev_t *dev, vsp_pipe_t *pipe)
+{
+	vspi_plan_t *plan = &dev->plan;
+	unsigned i;
+
+	for (i = 0; i < plan->patch_num; i++)
+	{
+		*plan->patch[i].data = vspi_plan_base(pipe, plan->patch[i].base) + plan->patch[i].delta;
+	}
+}
+
 int	VspLib_scale_start( void *arg, vsp_pipe_t *pipe )
 {
 	uint32_t offset=0;
@@ -370,6 +476,16 @@ int	VspLib_scale_start( void *arg, vsp_pipe_t *pipe )
 		(struct display_header *)(dev->pvdata->dlmemory->vaddr);
     
 	pipe->vsp_pipe_id = 0;
+
+	if (vspi_plan_match(&dev->plan, pipe))
+	{
+		/* same geometry as last time, only the buffers moved */
+		vspi_plan_replay(dev, pipe);
+		dev->plan.hits++;
+		goto start;
+	}
+	dev->plan.misses++;
+
 	scale_frame_prepare (dev,pipe);	
     width = pipe->dst.width;
     
@@ -395,7 +511,9 @@ int	VspLib_scale_start( void *arg, vsp_pipe_t *pipe )
         offset += div_size;
         par_indx ++;
     }
-    
+    vspi_plan_record(dev, pipe, par_indx);
+
+start:
 	dev->reg.dl->ctrl = VI6_DL_CTRL_AR_WAIT | VI6_DL_CTRL_DL_ENABLE;
 	/* DL LWORD swap */
 	dev->reg.dl->swap = VI6_DL_SWAP_LWS;
@@ -83,6 +83,11 @@
 
 /* Contents of the CHCRB register */
 #define SYSDMAC_CHCRB_DRST          0x00008000
+#define SYSDMAC_CHCRB_DPTR_MASK     0x00FF0000
+#define SYSDMAC_CHCRB_DPTR_SHIFT    16
+
+/* Contents of the TCRB register */
+#define SYSDMAC_TCRB_MASK           0x00FFFFFF
 
 /* Memory descriptors related definitions */
 #define SYSDMAC_DESCRIPTORS_PER_GROUP     128
@@ -655,6 +660,16 @@ dma_setup_descriptor(void *handle, const dma_transfer_t *tinfo, uint32_t chcr)
 
     segs = tinfo->src_flags & DMA_ADDR_FLAG_SEGMENTED ? tinfo->src_fragments : tinfo->dst_fragments;
 
+    // The ring has to fit in the descriptor memory reserved for the channel
+    if (segs > (chan->desc_num ? chan->desc_num : SYSDMAC_DESCRIPTORS_PER_GROUP)) {
+        fprintf(stderr, "SYSDMAC: %d segments exceed the descriptor memory of the channel\n", segs);
+        return -1;
+    }
+
+    chan->desc_ring      = desc;
+    chan->desc_segs      = segs;
+    chan->xfer_unit_size = tinfo->xfer_unit_size;
+
     out32(chan->regs + RCAR_SYSDMAC_DMADPBASE, dpbase);
     out32(chan->regs + RCAR_SYSDMAC_DMAFIXDPBASE, dpbase >> 32);
     out32(chan->regs + RCAR_SYSDMAC_DMACHCRB, SYSDMAC_CHCRB_DRST);  // Reset descriptor
@@ -755,6 +770,7 @@ dma_setup_xfer(void *handle, const dma_transfer_t *tinfo)
 
     out32(chan->regs + RCAR_SYSDMAC_DMACHCR, chcr);
 
+    chan->desc_segs  = 0;
     chan->xfer_count = tinfo->xfer_bytes / tinfo->xfer_unit_size;
     chan->xfer_unit_size = tinfo->xfer_unit_size;
 
@@ -830,12 +846,40 @@ dma_abort(void *handle)
     return 0;
 }
 
+/*
+ * In descriptor mode DMATCR only covers the descriptor being transferred, so the
+ * count left in the whole ring is the remainder of the current descriptor (DMATCRB)
+ * plus the length of every descriptor after it. DPTR points to the descriptor that
+ * is loaded next and is re-read to get a consistent pair across a descriptor switch.
+ */
 static unsigned
 dma_bytes_left(void *handle)
 {
-    dma_channel_t *chan = handle;
+    dma_channel_t   *chan = handle;
+    uint32_t        dptr, tcrb, count;
+    int             cur, i;
+
+    if (chan->desc_segs == 0) {
+        return (in32(chan->regs + RCAR_SYSDMAC_DMATCR) * chan->xfer_unit_size);
+    }
+
+    do {
+        dptr = in32(chan->regs + RCAR_SYSDMAC_DMACHCRB) & SYSDMAC_CHCRB_DPTR_MASK;
+        tcrb = in32(chan->regs + RCAR_SYSDMAC_DMATCRB) & SYSDMAC_TCRB_MASK;
+    } while (dptr != (in32(chan->regs + RCAR_SYSDMAC_DMACHCRB) & SYSDMAC_CHCRB_DPTR_MASK));
+
+    cur = dptr >> SYSDMAC_CHCRB_DPTR_SHIFT;
+    if (cur == 0) {
+        cur = chan->desc_segs;
+    }
+    cur--;
+
+    count = tcrb;
+    for (i = cur + 1; i < chan->desc_segs; i++) {
+        count += chan->desc_ring[i].tcr;
+    }
 
-    return (in32(chan->regs + RCAR_SYSDMAC_DMATCR) * chan->xfer_unit_size);
+    return (count * chan->xfer_unit_size);
 }
 
 static int
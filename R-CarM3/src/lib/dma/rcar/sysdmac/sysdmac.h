@@ -69,6 +69,10 @@ typedef struct
 
     // external descriptor memory
     dma_addr_t      desc;
+
+    // descriptor ring of the current segmented transfer, 0 segments in register mode
+    int             desc_segs;
+    volatile sysdmac_desc_t *desc_ring;
 } dma_channel_t;
 
 
@@ -27,14 +27,19 @@
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <fcntl.h>
+#ifdef __QNXNTO__
 #include <sys/neutrino.h>
 #include <hw/inout.h>
 #include <sys/resmgr.h>
 #include <sys/iofunc.h>
 #include <sys/dispatch.h>
+#include <atomic.h>
+#else
+/* host build of imr-mesh, only the config parser and the mesh builder */
+typedef uint64_t paddr_t;
+#endif
 #include <errno.h>
 #include <string.h>
-#include <atomic.h>
 #include <pthread.h>
 #include <time.h>
 #include <unistd.h>
@@ -45,6 +50,20 @@
 #define RCAR_IMRLX4_PULSE 			58
 #define RCAR_IMRLX4_END				59
 
+#define RCAR_IMRLX4_CHANNELS		4
+#define RCAR_IMRLX4_CHANNEL_ANY		-1	/* img_info_t channel: render on any idle IMR */
+
+/* Precompiled mesh written by imr-mesh, loaded instead of the text config when valid */
+#define RCAR_IMRLX4_MESH_FILE		"/etc/imrlx4.mesh"
+#define RCAR_IMRLX4_MESH_MAGIC		0x48534D49	/* "IMSH" */
+#define RCAR_IMRLX4_MESH_VERSION	3
+
+/* TRIMR triangle strip mode, TRI draws every vertex with the two before it */
+#define RCAR_IMRLX4_TRIMR_TSM		(1 << 3)
+
+/* Display list of a registered (source, destination) pair: WTL SSAR, WTL DSAR, GOSUB mesh, TRAP */
+#define RCAR_IMRLX4_PATCH_WORDS		8
+
 typedef struct _correct_conf {
 	int min;
 	int max;
@@ -60,12 +79,13 @@ typedef struct _img_conf {
 	correct_conf_t V;
 	uint32_t *coords;
 	int def_set;
+	int strip;					/* one triangle strip per row of squares */
 } img_conf_t;
 
 typedef struct _img_info {
-	int hcoid;
+	int hcoid;					/* completion pulse, its value is the IMR channel */
 	int pulse;
-	int channel;
+	int channel;				/* IMR channel or RCAR_IMRLX4_CHANNEL_ANY */
 	uint32_t cx;
 	uint32_t cy;
 	uint32_t dw;
@@ -73,31 +93,91 @@ typedef struct _img_info {
 	uint32_t bpp;
 } img_info_t;
 
+/* Header of the mesh file, followed by the display list as it is given to the IMR */
+typedef struct _imrlx4_mesh_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t width;				/* source size the mesh was built for */
+	uint32_t height;
+	uint32_t squareW;
+	uint32_t squareH;
+	correct_conf_t Y;
+	correct_conf_t U;
+	correct_conf_t V;
+	uint32_t dl_size;			/* bytes of display list */
+	uint32_t checksum;			/* rcar_imrlx4_mesh_checksum() of the header and the display list */
+} imrlx4_mesh_hdr_t;
+
+/* Instance of the library, one per corrected stream */
 typedef struct _rcar_imr {
+	img_info_t img;
+	img_conf_t img_conf;
+	uint32_t *dl;				/* display list, physically contiguous */
+	uint32_t dl_size;
+	imrlx4_mesh_hdr_t *mesh;	/* mapped mesh file until the display list is set up */
+	size_t mesh_size;
+	int channel;				/* IMR rendering the last frame */
+	uint32_t channels;			/* mask of the IMR channels the instance renders on */
+	paddr_t dl_phys;			/* mesh, called as a subroutine */
+	paddr_t dl_main;			/* GOSUB mesh, TRAP: buffers set by SSAR and DSAR */
+	uint32_t *patch;			/* RCAR_IMRLX4_PATCH_WORDS per registered pair, NULL if none */
+	uint32_t patch_size;
+	paddr_t patch_phys;
+	uint32_t nsrc;
+	uint32_t ndst;
+} rcar_imr_t;
+
+/* Utilisation of an IMR channel since it was started */
+typedef struct _rcar_imr_stats {
+	uint32_t users;				/* instances that may render on it */
+	uint32_t frames;
+	uint32_t waits;				/* frames that waited for the channel to be idle */
+	uint32_t max_us;			/* longest render */
+	uint64_t busy_us;			/* time spent rendering */
+	uint64_t up_us;				/* time since the channel was started */
+} rcar_imr_stats_t;
+
+#ifdef __QNXNTO__
+/* IMR-LX4 channel, shared by the instances that render on it */
+typedef struct _rcar_imr_engine {
 	int iid;
 	int tid;
 	int	chid;
 	int	coid;
 	int irq;
+	int channel;
 	pthread_attr_t attr;
 	struct sched_param param;
 	struct sigevent event;
-	img_info_t img;
-	img_conf_t img_conf;
+	rcar_imr_t *setup;			/* instance the registers are programmed for */
+	rcar_imr_t *busy;			/* instance being rendered, NULL when idle */
+	uint64_t start;				/* ClockCycles() of the render start */
+	uint64_t up;				/* ClockCycles() when the channel was started */
+	rcar_imr_stats_t stats;
 	uintptr_t pbase;
 	uintptr_t vbase;
-} rcar_imr_t;
+} rcar_imr_engine_t;
 
 paddr_t rcar_imrlx4_mphys(void *addr);
-void rcar_imrlx4_setup();
-void rcar_imrlx4_enable_clock();
-void rcar_imrlx4_configure();
-void rcar_imrlx4_DL_init();
-void rcar_imrlx4_update_frame(paddr_t source, paddr_t dest);
+int rcar_imrlx4_setup(rcar_imr_engine_t *eng);
+void rcar_imrlx4_enable_clock(rcar_imr_engine_t *eng);
+void rcar_imrlx4_configure(rcar_imr_engine_t *eng, rcar_imr_t *imr);
+int rcar_imrlx4_DL_init(rcar_imr_t *imr);
+int rcar_imrlx4_update_frame(rcar_imr_t *imr, paddr_t source, paddr_t dest);
+int rcar_imrlx4_register_buffers(rcar_imr_t *imr, void **src, uint32_t nsrc, void **dst, uint32_t ndst);
+int rcar_imrlx4_update_buffers(rcar_imr_t *imr, uint32_t src, uint32_t dst);
 void *rcar_imrlx4_event_handler(void *data);
-int rcar_imrlx4_create_thread();
-int rcar_imrlx4_init(img_info_t img);
-int rcar_imrlx4_fini();
+int rcar_imrlx4_create_thread(rcar_imr_engine_t *eng);
+rcar_imr_t *rcar_imrlx4_init(img_info_t img);
+int rcar_imrlx4_fini(rcar_imr_t *imr);
+int rcar_imrlx4_get_stats(int channel, rcar_imr_stats_t *stats);
+#endif
+void rcar_imrlx4_mesh_layout(img_info_t *img, img_conf_t *conf);
+uint32_t rcar_imrlx4_DL_vertices(img_info_t *img, img_conf_t *conf);
+uint32_t rcar_imrlx4_DL_size(img_info_t *img, img_conf_t *conf);
+uint32_t rcar_imrlx4_DL_build(img_info_t *img, img_conf_t *conf, uint32_t *dl);
+uint32_t rcar_imrlx4_mesh_checksum(const imrlx4_mesh_hdr_t *hdr, const uint32_t *dl);
+int rcar_imrlx4_mesh_load(rcar_imr_t *imr, const char *filename);
 int parse_device_config(rcar_imr_t *imr);
 int get_config_data(rcar_imr_t *imr, const char *filename);
 int parse_config (rcar_imr_t *imr, char *opt, int line);
@@ -76,6 +76,18 @@ int parse_config (rcar_imr_t *imr, char *opt, int line)
 		else PARSE_ERROR(line);
 		return 0;
 	}
+	if(opt_setup_begin && (str = strstr(opt, "mesh"))){
+		str1 = str;
+		if((str = strstr(str1, "="))){
+			if(strstr(str, "strip"))
+				imr->img_conf.strip = 1;
+			else if(strstr(str, "list"))
+				imr->img_conf.strip = 0;
+			else PARSE_ERROR(line);
+		}
+		else PARSE_ERROR(line);
+		return 0;
+	}
 	if(opt_setup_begin && (str = strstr(opt, "Y"))){
 		str1 = str;
 		if((str = strstr(str1, "="))){
@@ -150,6 +162,11 @@ int parse_config (rcar_imr_t *imr, char *opt, int line)
 	}
 	if(opt_coord_begin && (str = strstr(opt, "("))){
 		uint32_t tmp = 0;
+		//Every line gives the 3 vertexes of a triangle
+		if(offs + 3 > numVertex){
+			fprintf(stderr, "Invalid imrlx4.conf: There are %d/%d vertexes were declared \r\n", offs + 3, numVertex);
+			return -1;
+		}
 		if((str1 = strtok(str, " ,()")))
 			tmp |= ((uint16_t)atoi(str1) << 16);
 		else PARSE_ERROR(line);
@@ -157,10 +174,6 @@ int parse_config (rcar_imr_t *imr, char *opt, int line)
 			tmp |= ((uint16_t)atoi(str1));
 		else PARSE_ERROR(line);
 		*(imr->img_conf.coords + (offs++)) = tmp;
-		if(offs > numVertex){
-			fprintf(stderr, "Invalid imrlx4.conf: There are %d/%d vertexes were declared \r\n", offs, numVertex);
-			return -1;
-		}
 
 		tmp = 0;
 		if((str1 = strtok(NULL, " ,()")))
@@ -21,8 +21,29 @@
 
 #include "imrlx4.h"
 #include <arm/r-car.h>
+#include <sys/syspage.h>
 
-rcar_imr_t* imr;
+/*
+ * The IMR channels are shared by every instance of the process. A channel is started
+ * by the first instance that may render on it and stopped with the last one; each
+ * frame goes to an idle channel, which is reprogrammed when it last rendered for
+ * another instance. rcar_imr_open serialises init and fini, rcar_imr_mutex guards
+ * the channel state used per frame.
+ */
+static rcar_imr_engine_t rcar_imr_engines[RCAR_IMRLX4_CHANNELS];
+static pthread_mutex_t rcar_imr_open = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t rcar_imr_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rcar_imr_cond = PTHREAD_COND_INITIALIZER;
+
+static const struct {
+	uintptr_t base;
+	int irq;
+} rcar_imr_channels[RCAR_IMRLX4_CHANNELS] = {
+	{ RCAR_IMRLX40_BASE, RCAR_INTCSYS_IMRLX40 },
+	{ RCAR_IMRLX41_BASE, RCAR_INTCSYS_IMRLX41 },
+	{ RCAR_IMRLX42_BASE, RCAR_INTCSYS_IMRLX42 },
+	{ RCAR_IMRLX43_BASE, RCAR_INTCSYS_IMRLX43 }
+};
 
 paddr_t rcar_imrlx4_mphys(void *addr)
 {
@@ -34,34 +55,53 @@ paddr_t rcar_imrlx4_mphys(void *addr)
 	return offset;
 }
 
-void rcar_imrlx4_setup()
+static uint64_t rcar_imrlx4_cycles_to_us(uint64_t cycles)
+{
+	uint64_t cps = SYSPAGE_ENTRY(qtime)->cycles_per_sec;
+
+	return (cycles / cps) * 1000000 + (cycles % cps) * 1000000 / cps;
+}
+
+/* Start a channel: registers, clock, interrupt handler. Called with rcar_imr_open held */
+int rcar_imrlx4_setup(rcar_imr_engine_t *eng)
 {
 	uint32_t reg;
 
-	/* Enable clock */
-	rcar_imrlx4_enable_clock();
+	eng->pbase = rcar_imr_channels[eng->channel].base;
+	eng->irq = rcar_imr_channels[eng->channel].irq;
+	eng->setup = NULL;
+	eng->busy = NULL;
+	memset(&eng->stats, 0, sizeof(eng->stats));
 
-	/* Basic configure */
-	rcar_imrlx4_configure();
+	if ((eng->vbase = (uintptr_t)mmap_device_io(RCAR_IMRLX4_SIZE, eng->pbase)) == (uintptr_t)MAP_FAILED) {
+		fprintf(stderr, "%s: IMRLX4 base mmap_device_io (0x%x) failed \r\n", __FUNCTION__, (uint32_t)eng->pbase);
+		return -1;
+	}
 
-	/* Display list initial */
-	rcar_imrlx4_DL_init();
+	/* Enable clock */
+	rcar_imrlx4_enable_clock(eng);
 
 	/* Wait for interrupt */
-	if(rcar_imrlx4_create_thread()) {
+	if(rcar_imrlx4_create_thread(eng)) {
 		fprintf(stderr, "%s: create interrupt handler failed \r\n", __FUNCTION__);
+		munmap_device_io(eng->vbase, RCAR_IMRLX4_SIZE);
+		return -1;
 	}
 
 	//Enable interrupts
-	reg = in32(imr->vbase + RCAR_IMRLX4_ICR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_ICR);
 	reg |= (3 << 0);
-	out32(imr->vbase + RCAR_IMRLX4_ICR, reg);
-	reg = in32(imr->vbase + RCAR_IMRLX4_IMR);
+	out32(eng->vbase + RCAR_IMRLX4_ICR, reg);
+	reg = in32(eng->vbase + RCAR_IMRLX4_IMR);
 	reg &= ~(3 << 0);
-	out32(imr->vbase + RCAR_IMRLX4_IMR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_IMR, reg);
+
+	eng->up = ClockCycles();
+
+	return 0;
 }
 
-void rcar_imrlx4_enable_clock()
+void rcar_imrlx4_enable_clock(rcar_imr_engine_t *eng)
 {
 	//Enable clock for IMRLX4 module
 	uintptr_t SMSTPCR8_reg;
@@ -71,7 +111,7 @@ void rcar_imrlx4_enable_clock()
 	SMSTPCR8_reg   = mmap_device_io(4, 0xE6150990);
 	MSTPSR8_reg	   = mmap_device_io(4, 0xE61509A0);
 
-	mask = 1 << 23; //IMR0
+	mask = 1 << (23 - eng->channel); //IMR0 is bit 23, IMR3 bit 20
 	/* Enale supply clock to module */
 	tmp = in32(MSTPSR8_reg);
 	tmp &= ~mask;
@@ -82,287 +122,336 @@ void rcar_imrlx4_enable_clock()
 	munmap_device_io(MSTPSR8_reg, 4);
 }
 
-void rcar_imrlx4_configure()
+void rcar_imrlx4_configure(rcar_imr_engine_t *eng, rcar_imr_t *imr)
 {
 	uint32_t reg;
 
 	//Source and Destination coordinate Decimal Point
-	reg = in32(imr->vbase + RCAR_IMRLX4_UVDPOR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_UVDPOR);
 	reg &= ~(0x07);
 	reg &= ~(1 << 8);
-	out32(imr->vbase + RCAR_IMRLX4_UVDPOR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_UVDPOR, reg);
 
 	//Source Width and Source Height
-	reg = in32(imr->vbase + RCAR_IMRLX4_SUSR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_SUSR);
 	reg &= ~(0x7FF | (0x7FF << 16));
 	reg |= ((imr->img.dw - 2) << 16) | ((imr->img.dw - 1) << 0);
-	out32(imr->vbase + RCAR_IMRLX4_SUSR, reg);
-	reg = in32(imr->vbase + RCAR_IMRLX4_SVSR);
+	out32(eng->vbase + RCAR_IMRLX4_SUSR, reg);
+	reg = in32(eng->vbase + RCAR_IMRLX4_SVSR);
 	reg &= ~(0x7FF);
 	reg |= ((imr->img.dh - 1) << 0);
-	out32(imr->vbase + RCAR_IMRLX4_SVSR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_SVSR, reg);
 
 	//Source stride and destination stride
-	reg = in32(imr->vbase + RCAR_IMRLX4_SSTR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_SSTR);
 	reg &= ~(0x3FFF);
 	reg |= ((imr->img.dw * imr->img.bpp) << 0);
-	out32(imr->vbase + RCAR_IMRLX4_SSTR, reg);
-	reg = in32(imr->vbase + RCAR_IMRLX4_DSTR);
+	out32(eng->vbase + RCAR_IMRLX4_SSTR, reg);
+	reg = in32(eng->vbase + RCAR_IMRLX4_DSTR);
 	reg &= ~(0x3FFF);
 	reg |= ((imr->img.dw * imr->img.bpp) << 0);
-	out32(imr->vbase + RCAR_IMRLX4_DSTR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_DSTR, reg);
 
 	//Triangle mode: Texture mapping enable, clockwise drawing
-	reg = in32(imr->vbase + RCAR_IMRLX4_TRIMR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_TRIMR);
 	reg &= ~(0x47 << 0);
 	reg |= (1 << 0) | (1 << 6);
-	out32(imr->vbase + RCAR_IMRLX4_TRIMSR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_TRIMSR, reg);
 
 	//X Clip MIN, X Clip MAX
-	reg = in32(imr->vbase + RCAR_IMRLX4_XMINR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_XMINR);
 	reg &= ~(0x1FFF);
 	reg |= (imr->img.cx << 0);
-	out32(imr->vbase + RCAR_IMRLX4_XMINR, reg);
-	reg = in32(imr->vbase + RCAR_IMRLX4_XMAXR);
+	out32(eng->vbase + RCAR_IMRLX4_XMINR, reg);
+	reg = in32(eng->vbase + RCAR_IMRLX4_XMAXR);
 	reg &= ~(0x1FFF);
 	reg |= (imr->img.dw << 0);
-	out32(imr->vbase + RCAR_IMRLX4_XMAXR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_XMAXR, reg);
 
 	//Y Clip MIN, Y Clip MAX
-	reg = in32(imr->vbase + RCAR_IMRLX4_YMINR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_YMINR);
 	reg &= ~(0x1FFF);
 	reg |= (imr->img.cy << 0);
-	out32(imr->vbase + RCAR_IMRLX4_YMINR, reg);
-	reg = in32(imr->vbase + RCAR_IMRLX4_YMAXR);
+	out32(eng->vbase + RCAR_IMRLX4_YMINR, reg);
+	reg = in32(eng->vbase + RCAR_IMRLX4_YMAXR);
 	reg &= ~(0x1FFF);
 	reg |= (imr->img.dh << 0);
-	out32(imr->vbase + RCAR_IMRLX4_YMAXR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_YMAXR, reg);
 
 	//Render mode 2: YUV422 enable, YCFORM(UYVY)
-	reg = in32(imr->vbase + RCAR_IMRLX4_CMRCR2);
+	reg = in32(eng->vbase + RCAR_IMRLX4_CMRCR2);
 	reg &= ~(0x64 << 0);
 	reg |= (1 << 2) | (1 << 5) | (1 << 12) | (1 << 15);
-	out32(imr->vbase + RCAR_IMRLX4_CMRCSR2, reg);
+	out32(eng->vbase + RCAR_IMRLX4_CMRCSR2, reg);
 
 	//Triangle color: YCFORM(UYVY)
-	reg = in32(imr->vbase + RCAR_IMRLX4_TRICR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_TRICR);
 	reg |= (1 << 31);
-	out32(imr->vbase + RCAR_IMRLX4_TRICR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_TRICR, reg);
 
 	//Render mode 1: Luminance/Hue correction enable
 	//Use correction offset parameter specified by register
-	reg = in32(imr->vbase + RCAR_IMRLX4_CMRCR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_CMRCR);
 	reg &= ~((1 << 1) | (1 << 2) | (1 << 3) | (1 << 4) |
 			 (1 << 5) | (1 << 6) | (1 << 9) | (1 << 12) |
 			 (1 << 16) | (1 << 17) | (1 << 18) | (1 << 19));
 	reg |= (1 << 1) | (1 << 2) | (1 << 16) |
 		   (1 << 17) | (1 << 18) | (1 << 19);
-	out32(imr->vbase + RCAR_IMRLX4_CMRCSR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_CMRCSR, reg);
 
 	//Minimum/Maximum Luminance
-	reg = in32(imr->vbase + RCAR_IMRLX4_YLMINR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_YLMINR);
 	reg &= ~(0xFFF);
 	reg |= imr->img_conf.Y.min;
-	out32(imr->vbase + RCAR_IMRLX4_YLMINR, reg);
-	reg = in32(imr->vbase + RCAR_IMRLX4_YLMAXR);
+	out32(eng->vbase + RCAR_IMRLX4_YLMINR, reg);
+	reg = in32(eng->vbase + RCAR_IMRLX4_YLMAXR);
 	reg &= ~(0xFFF);
 	reg |= imr->img_conf.Y.max;
-	out32(imr->vbase + RCAR_IMRLX4_YLMAXR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_YLMAXR, reg);
 
 	//Minimun/Maximum Hue
-	reg = in32(imr->vbase + RCAR_IMRLX4_UBMINR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_UBMINR);
 	reg &= ~(0xFFF);
 	reg |= imr->img_conf.U.min;
-	out32(imr->vbase + RCAR_IMRLX4_UBMINR, reg);
-	reg = in32(imr->vbase + RCAR_IMRLX4_UBMAXR);
+	out32(eng->vbase + RCAR_IMRLX4_UBMINR, reg);
+	reg = in32(eng->vbase + RCAR_IMRLX4_UBMAXR);
 	reg &= ~(0xFFF);
 	reg |= imr->img_conf.U.max;
-	out32(imr->vbase + RCAR_IMRLX4_UBMAXR, reg);
-	reg = in32(imr->vbase + RCAR_IMRLX4_VRMINR);
+	out32(eng->vbase + RCAR_IMRLX4_UBMAXR, reg);
+	reg = in32(eng->vbase + RCAR_IMRLX4_VRMINR);
 	reg &= ~(0xFFF);
 	reg |= imr->img_conf.V.min;
-	out32(imr->vbase + RCAR_IMRLX4_VRMINR, reg);
-	reg = in32(imr->vbase + RCAR_IMRLX4_VRMAXR);
+	out32(eng->vbase + RCAR_IMRLX4_VRMINR, reg);
+	reg = in32(eng->vbase + RCAR_IMRLX4_VRMAXR);
 	reg &= ~(0xFFF);
 	reg |= imr->img_conf.V.max;
-	out32(imr->vbase + RCAR_IMRLX4_VRMAXR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_VRMAXR, reg);
 
 	//Correction decimal point
-	reg = in32(imr->vbase + RCAR_IMRLX4_CPDPOR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_CPDPOR);
 	reg &= ~((7 << 0) | (7 << 4) | (7 << 8));
 	reg |= (0 << 0) | (0 << 4) | (0 << 8);
-	out32(imr->vbase + RCAR_IMRLX4_CPDPOR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_CPDPOR, reg);
 
 	//Luminance correction parameter
-	reg = in32(imr->vbase + RCAR_IMRLX4_YLCPR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_YLCPR);
 	reg &= ~(0xFFFF);
 	reg |= ((imr->img_conf.Y.scal) << 8) | ((imr->img_conf.Y.offs) << 0);
-	out32(imr->vbase + RCAR_IMRLX4_YLCPR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_YLCPR, reg);
 
 	//Hue correction parameter
-	reg = in32(imr->vbase + RCAR_IMRLX4_UBCPR);
+	reg = in32(eng->vbase + RCAR_IMRLX4_UBCPR);
 	reg &= ~(0xFFFF);
 	reg |= ((imr->img_conf.U.scal) << 8) | ((imr->img_conf.U.offs) << 0);
-	out32(imr->vbase + RCAR_IMRLX4_UBCPR, reg);
-	reg = in32(imr->vbase + RCAR_IMRLX4_VRCPR);
+	out32(eng->vbase + RCAR_IMRLX4_UBCPR, reg);
+	reg = in32(eng->vbase + RCAR_IMRLX4_VRCPR);
 	reg &= ~(0xFFFF);
 	reg |= ((imr->img_conf.V.scal) << 8) | ((imr->img_conf.V.offs) << 0);
-	out32(imr->vbase + RCAR_IMRLX4_VRCPR, reg);
+	out32(eng->vbase + RCAR_IMRLX4_VRCPR, reg);
 }
 
-void rcar_imrlx4_DL_init()
+int rcar_imrlx4_DL_init(rcar_imr_t *imr)
 {
-	uint32_t memSize, squareW, squareH,
-			 numSquare, numTri, numVertex;
-	uint32_t *display_list;
-	int offs1 = 4, offs2 = 0;
-
-	squareW = imr->img_conf.squareW;
-	squareH = imr->img_conf.squareH;
-	numSquare = (imr->img.dw / squareW) * (imr->img.dh / squareH);
-	numTri = numSquare * 2; //1 square is divided into 2 triangles
-	numVertex = numTri * 3;
-
-	//4 byte coordinate for every vertex
-	//4 byte dummy luminance for every vertex
-	//4 byte dummy hue for every vertex
-	//12 byte for TRI, SYNCM, TRAP instruction
-	memSize = (numVertex * 4 + 3) * 4;
-	display_list = mmap(0, memSize, PROT_READ | PROT_WRITE | PROT_NOCACHE, MAP_ANON | MAP_PHYS | MAP_PRIVATE, NOFD, 0);
-	memset(display_list, 0, memSize);
-
-	//TRI
-	memset((uint8_t*)display_list, numVertex, 1);
-	memset((uint8_t*)display_list + 1, numVertex >> 8, 1);
-	memset((uint8_t*)display_list + 3, RCAR_IMRLX4_INST_TRI, 1);
-
-	for(int k = 1; k <= numTri; k++){
-		int C = ((k - 1) / 2) % (imr->img.dw / squareW);   //integer modulo
-		int R = (k - 1) / (2 * (imr->img.dw / squareW));  //integer division
-		if (k % 2 != 0){
-		    //coords = (C, R + 1); (C, R); (C + 1, R);
-			uint16_t coordsX;
-			uint16_t coordsY;
-			coordsX = C * squareW;
-			coordsY = (R + 1) * squareH;
-			//u, v coordinates
-			memset((uint8_t*)display_list + 0 + offs1, coordsY, 1);
-			memset((uint8_t*)display_list + 1 + offs1, coordsY >> 8, 1);
-			memset((uint8_t*)display_list + 2 + offs1, coordsX, 1);
-			memset((uint8_t*)display_list + 3 + offs1, coordsX >> 8, 1);
-			//X, Y coordinates
-			if(imr->img_conf.def_set == 1)
-			{
-				memset((uint8_t*)display_list + 4 + offs1, coordsY, 1);
-				memset((uint8_t*)display_list + 5 + offs1, coordsY >> 8, 1);
-				memset((uint8_t*)display_list + 6 + offs1, coordsX, 1);
-				memset((uint8_t*)display_list + 7 + offs1, coordsX >> 8, 1);
-			}
-			else memcpy(display_list + 1 + (offs1 / 4), imr->img_conf.coords + (offs2++), 4 );
-
-			coordsX = C * squareW;
-			coordsY = R * squareH;
-			memset((uint8_t*)display_list + 16 + offs1, coordsY, 1);
-			memset((uint8_t*)display_list + 17 + offs1, coordsY >> 8, 1);
-			memset((uint8_t*)display_list + 18 + offs1, coordsX, 1);
-			memset((uint8_t*)display_list + 19 + offs1, coordsX >> 8, 1);
-			if(imr->img_conf.def_set == 1)
-			{
-				memset((uint8_t*)display_list + 20 + offs1, coordsY, 1);
-				memset((uint8_t*)display_list + 21 + offs1, coordsY >> 8, 1);
-				memset((uint8_t*)display_list + 22 + offs1, coordsX, 1);
-				memset((uint8_t*)display_list + 23 + offs1, coordsX >> 8, 1);
-			}
-			else memcpy(display_list + 5 + (offs1 / 4), imr->img_conf.coords + (offs2++), 4 );
-
-			coordsX = (C + 1) * squareW;
-			coordsY = R * squareH;
-			memset((uint8_t*)display_list + 32 + offs1, coordsY, 1);
-			memset((uint8_t*)display_list + 33 + offs1, coordsY >> 8, 1);
-			memset((uint8_t*)display_list + 34 + offs1, coordsX, 1);
-			memset((uint8_t*)display_list + 35 + offs1, coordsX >> 8, 1);
-			if(imr->img_conf.def_set == 1)
-			{
-				memset((uint8_t*)display_list + 36 + offs1, coordsY, 1);
-				memset((uint8_t*)display_list + 37 + offs1, coordsY >> 8, 1);
-				memset((uint8_t*)display_list + 38 + offs1, coordsX, 1);
-				memset((uint8_t*)display_list + 39 + offs1, coordsX >> 8, 1);
-			}
-			else memcpy(display_list + 9 + (offs1 / 4), imr->img_conf.coords + (offs2++), 4 );
-		}
-		else{
-		    //coords = (C + 1, R); (C, R + 1); (C + 1, R + 1);
-			uint16_t coordsX;
-			uint16_t coordsY;
-			coordsX = (C + 1) * squareW;
-			coordsY = R * squareH;
-			memset((uint8_t*)display_list + 0 + offs1, coordsY, 1);
-			memset((uint8_t*)display_list + 1 + offs1, coordsY >> 8, 1);
-			memset((uint8_t*)display_list + 2 + offs1, coordsX, 1);
-			memset((uint8_t*)display_list + 3 + offs1, coordsX >> 8, 1);
-			if(imr->img_conf.def_set == 1)
-			{
-				memset((uint8_t*)display_list + 4 + offs1, coordsY, 1);
-				memset((uint8_t*)display_list + 5 + offs1, coordsY >> 8, 1);
-				memset((uint8_t*)display_list + 6 + offs1, coordsX, 1);
-				memset((uint8_t*)display_list + 7 + offs1, coordsX >> 8, 1);
-			}
-			else memcpy(display_list + 1 + (offs1 / 4), imr->img_conf.coords + (offs2++), 4 );
-
-			coordsX = C * squareW;
-			coordsY = (R + 1) * squareH;
-			memset((uint8_t*)display_list + 16 + offs1, coordsY, 1);
-			memset((uint8_t*)display_list + 17 + offs1, coordsY >> 8, 1);
-			memset((uint8_t*)display_list + 18 + offs1, coordsX, 1);
-			memset((uint8_t*)display_list + 19 + offs1, coordsX >> 8, 1);
-			if(imr->img_conf.def_set == 1)
-			{
-				memset((uint8_t*)display_list + 20 + offs1, coordsY, 1);
-				memset((uint8_t*)display_list + 21 + offs1, coordsY >> 8, 1);
-				memset((uint8_t*)display_list + 22 + offs1, coordsX, 1);
-				memset((uint8_t*)display_list + 23 + offs1, coordsX >> 8, 1);
-			}
-			else memcpy(display_list + 5 + (offs1 / 4), imr->img_conf.coords + (offs2++), 4 );
-
-			coordsX = (C + 1) * squareW;
-			coordsY = (R + 1) * squareH;
-			memset((uint8_t*)display_list + 32 + offs1, coordsY, 1);
-			memset((uint8_t*)display_list + 33 + offs1, coordsY >> 8, 1);
-			memset((uint8_t*)display_list + 34 + offs1, coordsX, 1);
-			memset((uint8_t*)display_list + 35 + offs1, coordsX >> 8, 1);
-			if(imr->img_conf.def_set == 1)
-			{
-				memset((uint8_t*)display_list + 36 + offs1, coordsY, 1);
-				memset((uint8_t*)display_list + 37 + offs1, coordsY >> 8, 1);
-				memset((uint8_t*)display_list + 38 + offs1, coordsX, 1);
-				memset((uint8_t*)display_list + 39 + offs1, coordsX >> 8, 1);
-			}
-			else memcpy(display_list + 9 + (offs1 / 4), imr->img_conf.coords + (offs2++), 4 );
-		}
-		offs1 += 48;
+	imrlx4_mesh_hdr_t *hdr = imr->mesh;
+	uint32_t mesh_size, *p;
+
+	if(!hdr)
+		rcar_imrlx4_mesh_layout(&imr->img, &imr->img_conf);
+
+	mesh_size = hdr ? hdr->dl_size : rcar_imrlx4_DL_size(&imr->img, &imr->img_conf);
+	//The mesh is followed by the GOSUB, address, TRAP calling it
+	imr->dl_size = mesh_size + 3 * 4;
+	imr->dl = mmap(0, imr->dl_size, PROT_READ | PROT_WRITE | PROT_NOCACHE, MAP_ANON | MAP_PHYS | MAP_PRIVATE, NOFD, 0);
+	if(imr->dl == MAP_FAILED) {
+		fprintf(stderr, "%s: display list mmap failed \r\n", __FUNCTION__);
+		imr->dl = NULL;
+		return -1;
 	}
-	//SYNCM
-	memset((uint8_t*)display_list + (memSize - 5), RCAR_IMRLX4_INST_SYNCM, 1);
-	//TRAP
-	memset((uint8_t*)display_list + (memSize - 1), RCAR_IMRLX4_INST_TRAP, 1);
 
-	//Display List Start Address Register
-	out32(imr->vbase + RCAR_IMRLX4_DLSAR, rcar_imrlx4_mphys(display_list));
+	if(hdr) {
+		//Precompiled mesh, copied as is
+		memcpy(imr->dl, hdr + 1, mesh_size);
+		munmap(imr->mesh, imr->mesh_size);
+		imr->mesh = NULL;
+	}
+	else
+		rcar_imrlx4_DL_build(&imr->img, &imr->img_conf, imr->dl);
+
+	/*
+	 * The mesh is the same for every frame, only the buffers change: it returns to
+	 * the caller instead of ending the list, so the per buffer display lists of
+	 * rcar_imrlx4_register_buffers() share it.
+	 */
+	imr->dl_phys = rcar_imrlx4_mphys(imr->dl);
+	p = imr->dl + mesh_size / 4;
+	p[-1] = RCAR_IMRLX4_INST_RET << 24;
+	imr->dl_main = imr->dl_phys + mesh_size;
+	*p++ = RCAR_IMRLX4_INST_GOBSUB << 24;
+	*p++ = (uint32_t)imr->dl_phys;
+	*p++ = RCAR_IMRLX4_INST_TRAP << 24;
+
+	return 0;
 }
 
-void rcar_imrlx4_update_frame(paddr_t source, paddr_t dest)
+/* Idle channel for imr, the one already programmed for it first. Called with rcar_imr_mutex held */
+static int rcar_imrlx4_idle(rcar_imr_t *imr)
 {
+	int ch, idle = -1;
+
+	for(ch = 0; ch < RCAR_IMRLX4_CHANNELS; ch++) {
+		if(!(imr->channels & (1 << ch)) || rcar_imr_engines[ch].busy)
+			continue;
+		if(rcar_imr_engines[ch].setup == imr)
+			return ch;
+		if(idle < 0)
+			idle = ch;
+	}
+	return idle;
+}
+
+/* Take an idle channel of the instance, waiting for one when they are all busy */
+static rcar_imr_engine_t *rcar_imrlx4_acquire(rcar_imr_t *imr)
+{
+	rcar_imr_engine_t *eng;
+	int ch, waited = 0;
+
+	pthread_mutex_lock(&rcar_imr_mutex);
+	while((ch = rcar_imrlx4_idle(imr)) < 0) {
+		waited = 1;
+		pthread_cond_wait(&rcar_imr_cond, &rcar_imr_mutex);
+	}
+	eng = &rcar_imr_engines[ch];
+	eng->busy = imr;
+	if(waited)
+		eng->stats.waits++;
+	pthread_mutex_unlock(&rcar_imr_mutex);
+
 	//Stop render
-	out32(imr->vbase + RCAR_IMRLX4_CR, (0 << 0));
+	out32(eng->vbase + RCAR_IMRLX4_CR, (0 << 0));
+
+	//Program the channel for this instance if it last rendered another one
+	if(eng->setup != imr) {
+		rcar_imrlx4_configure(eng, imr);
+		eng->setup = imr;
+	}
+
+	return eng;
+}
+
+/* Run the display list at dl on the channel taken by rcar_imrlx4_acquire() */
+static int rcar_imrlx4_start(rcar_imr_engine_t *eng, rcar_imr_t *imr, paddr_t dl)
+{
+	//Display List Start Address Register
+	out32(eng->vbase + RCAR_IMRLX4_DLSAR, (uint32_t)dl);
+
+	//Start render
+	eng->start = ClockCycles();
+	imr->channel = eng->channel;
+	out32(eng->vbase + RCAR_IMRLX4_CR, (1 << 0));
+
+	return eng->channel;
+}
+
+/*
+ * Render a frame on an idle channel of the instance, waiting for one when they are
+ * all busy. Completion is signalled by the pulse of the instance, with the channel
+ * as value. Returns the channel.
+ */
+int rcar_imrlx4_update_frame(rcar_imr_t *imr, paddr_t source, paddr_t dest)
+{
+	rcar_imr_engine_t *eng;
+
+	if(imr == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+	eng = rcar_imrlx4_acquire(imr);
 
 	//Start source address
-	out32(imr->vbase + RCAR_IMRLX4_SSAR, rcar_imrlx4_mphys((void*)source));
+	out32(eng->vbase + RCAR_IMRLX4_SSAR, rcar_imrlx4_mphys((void*)source));
 
 	//Start destination address
-	out32(imr->vbase + RCAR_IMRLX4_DSAR, rcar_imrlx4_mphys((void*)dest));
+	out32(eng->vbase + RCAR_IMRLX4_DSAR, rcar_imrlx4_mphys((void*)dest));
 
-	//Start render
-	out32(imr->vbase + RCAR_IMRLX4_CR, (1 << 0));
+	return rcar_imrlx4_start(eng, imr, imr->dl_main);
+}
+
+/*
+ * Resolve the physical addresses of a fixed set of buffers once and build the display
+ * list of every (source, destination) pair, so rcar_imrlx4_update_buffers() only has to
+ * point DLSAR at it. Not to be called while frames of the instance are rendering.
+ */
+int rcar_imrlx4_register_buffers(rcar_imr_t *imr, void **src, uint32_t nsrc, void **dst, uint32_t ndst)
+{
+	paddr_t *phys, sphys, dphys;
+	uint32_t *p, s, d;
+
+	if(imr == NULL || nsrc == 0 || ndst == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(imr->patch) {
+		munmap(imr->patch, imr->patch_size);
+		imr->patch = NULL;
+	}
+
+	if((phys = calloc(nsrc + ndst, sizeof(paddr_t))) == NULL) {
+		return -1;
+	}
+	for(s = 0; s < nsrc + ndst; s++) {
+		if((phys[s] = rcar_imrlx4_mphys(s < nsrc ? src[s] : dst[s - nsrc])) == (paddr_t)-1) {
+			fprintf(stderr, "%s: buffer %u has no physical address \r\n", __FUNCTION__, s);
+			free(phys);
+			return -1;
+		}
+	}
+
+	imr->patch_size = nsrc * ndst * RCAR_IMRLX4_PATCH_WORDS * 4;
+	imr->patch = mmap(0, imr->patch_size, PROT_READ | PROT_WRITE | PROT_NOCACHE, MAP_ANON | MAP_PHYS | MAP_PRIVATE, NOFD, 0);
+	if(imr->patch == MAP_FAILED) {
+		fprintf(stderr, "%s: display list mmap failed \r\n", __FUNCTION__);
+		imr->patch = NULL;
+		free(phys);
+		return -1;
+	}
+	imr->patch_phys = rcar_imrlx4_mphys(imr->patch);
+	imr->nsrc = nsrc;
+	imr->ndst = ndst;
+
+	p = imr->patch;
+	for(s = 0; s < nsrc; s++) {
+		sphys = phys[s];
+		for(d = 0; d < ndst; d++) {
+			dphys = phys[nsrc + d];
+			//WTL: source and destination address
+			p[0] = (RCAR_IMRLX4_INST_WTL << 24) | ((RCAR_IMRLX4_SSAR / 4) << 16) | 1;
+			p[1] = (uint32_t)sphys;
+			p[2] = (RCAR_IMRLX4_INST_WTL << 24) | ((RCAR_IMRLX4_DSAR / 4) << 16) | 1;
+			p[3] = (uint32_t)dphys;
+			//GOSUB mesh, TRAP
+			p[4] = RCAR_IMRLX4_INST_GOBSUB << 24;
+			p[5] = (uint32_t)imr->dl_phys;
+			p[6] = RCAR_IMRLX4_INST_TRAP << 24;
+			p[7] = RCAR_IMRLX4_INST_NOP << 24;
+			p += RCAR_IMRLX4_PATCH_WORDS;
+		}
+	}
+
+	free(phys);
+	return 0;
+}
+
+/* rcar_imrlx4_update_frame() for buffers src and dst of rcar_imrlx4_register_buffers() */
+int rcar_imrlx4_update_buffers(rcar_imr_t *imr, uint32_t src, uint32_t dst)
+{
+	if(imr == NULL || imr->patch == NULL || src >= imr->nsrc || dst >= imr->ndst) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return rcar_imrlx4_start(rcar_imrlx4_acquire(imr), imr,
+					imr->patch_phys + (src * imr->ndst + dst) * RCAR_IMRLX4_PATCH_WORDS * 4);
 }
 
 void *rcar_imrlx4_event_handler(void *data)
@@ -372,23 +461,37 @@ void *rcar_imrlx4_event_handler(void *data)
 	int	rcvid;
 	uint32_t stat;
 	int retry = 0;
+	int hcoid, hpulse;
+	uint64_t us;
 
-	rcar_imr_t *imr = (rcar_imr_t*)data;
+	rcar_imr_engine_t *eng = (rcar_imr_engine_t*)data;
 
 	SETIOV(&iov, &pulse, sizeof(pulse));
 
 	for (;;) {
-		if ((rcvid = MsgReceivev(imr->chid, &iov, 1, NULL)) == -1)
+		if ((rcvid = MsgReceivev(eng->chid, &iov, 1, NULL)) == -1)
 			continue;
 
 		switch (pulse.code){
 			case RCAR_IMRLX4_PULSE:
 				//Status
-				stat = in32(imr->vbase + RCAR_IMRLX4_SR);
+				stat = in32(eng->vbase + RCAR_IMRLX4_SR);
 				//Clear status
-				out32(imr->vbase + RCAR_IMRLX4_SRCR, stat);
+				out32(eng->vbase + RCAR_IMRLX4_SRCR, stat);
 				if(stat & 0x01){
-					MsgSendPulse(imr->img.hcoid, 21, imr->img.pulse, 0);
+					pthread_mutex_lock(&rcar_imr_mutex);
+					hcoid = eng->busy ? eng->busy->img.hcoid : -1;
+					hpulse = eng->busy ? eng->busy->img.pulse : 0;
+					us = rcar_imrlx4_cycles_to_us(ClockCycles() - eng->start);
+					eng->stats.frames++;
+					eng->stats.busy_us += us;
+					if(us > eng->stats.max_us)
+						eng->stats.max_us = us;
+					eng->busy = NULL;
+					pthread_cond_broadcast(&rcar_imr_cond);
+					pthread_mutex_unlock(&rcar_imr_mutex);
+					if(hcoid != -1)
+						MsgSendPulse(hcoid, 21, hpulse, eng->channel);
 				}
 				else{
 					retry++;
@@ -398,7 +501,7 @@ void *rcar_imrlx4_event_handler(void *data)
 						return NULL;
 					}
 				}
-				InterruptUnmask(imr->irq, imr->iid);
+				InterruptUnmask(eng->irq, eng->iid);
 				break;
 			case RCAR_IMRLX4_END:
 				return NULL;
@@ -411,35 +514,35 @@ void *rcar_imrlx4_event_handler(void *data)
 	return 0;
 }
 
-int rcar_imrlx4_create_thread()
+int rcar_imrlx4_create_thread(rcar_imr_engine_t *eng)
 {
 	ThreadCtl(_NTO_TCTL_IO, 0);
 
-	if ((imr->chid = ChannelCreate(_NTO_CHF_DISCONNECT | _NTO_CHF_UNBLOCK)) == -1)
+	if ((eng->chid = ChannelCreate(_NTO_CHF_DISCONNECT | _NTO_CHF_UNBLOCK)) == -1)
 		return -1;
 
-	if ((imr->coid = ConnectAttach(0, 0, imr->chid, _NTO_SIDE_CHANNEL, 0)) == -1)
+	if ((eng->coid = ConnectAttach(0, 0, eng->chid, _NTO_SIDE_CHANNEL, 0)) == -1)
 		goto fail;
 
-	pthread_attr_init(&imr->attr);
-	pthread_attr_setschedpolicy(&imr->attr, SCHED_RR);
-	imr->param.sched_priority = 21;
-	pthread_attr_setschedparam(&imr->attr, &imr->param);
-	pthread_attr_setinheritsched(&imr->attr, PTHREAD_EXPLICIT_SCHED);
-	pthread_attr_setdetachstate(&imr->attr, PTHREAD_CREATE_DETACHED);
-	pthread_attr_setstacksize(&imr->attr, 8192);
+	pthread_attr_init(&eng->attr);
+	pthread_attr_setschedpolicy(&eng->attr, SCHED_RR);
+	eng->param.sched_priority = 21;
+	pthread_attr_setschedparam(&eng->attr, &eng->param);
+	pthread_attr_setinheritsched(&eng->attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setdetachstate(&eng->attr, PTHREAD_CREATE_DETACHED);
+	pthread_attr_setstacksize(&eng->attr, 8192);
 
-	imr->event.sigev_notify   = SIGEV_PULSE;
-	imr->event.sigev_coid     = imr->coid;
-	imr->event.sigev_code     = RCAR_IMRLX4_PULSE;
-	imr->event.sigev_priority = 21;
+	eng->event.sigev_notify   = SIGEV_PULSE;
+	eng->event.sigev_coid     = eng->coid;
+	eng->event.sigev_code     = RCAR_IMRLX4_PULSE;
+	eng->event.sigev_priority = 21;
 
 	// Create imrlx4 event handler
-	if (pthread_create(&imr->tid, &imr->attr, (void *)rcar_imrlx4_event_handler, imr)) {
+	if (pthread_create(&eng->tid, &eng->attr, (void *)rcar_imrlx4_event_handler, eng)) {
 		fprintf(stderr, "%s:  Unable to create event handler\n", __FUNCTION__);
 		goto fail;
 	}
-	if ((imr->iid = InterruptAttachEvent(imr->irq, &imr->event, _NTO_INTR_FLAGS_TRK_MSK|_NTO_INTR_FLAGS_END)) == -1){
+	if ((eng->iid = InterruptAttachEvent(eng->irq, &eng->event, _NTO_INTR_FLAGS_TRK_MSK|_NTO_INTR_FLAGS_END)) == -1){
 		fprintf(stderr,"%s: Interrupt attach failed.\n", __FUNCTION__);
 		goto fail;
 	}
@@ -447,57 +550,50 @@ int rcar_imrlx4_create_thread()
 	return 0;
 
 fail:
-	ConnectDetach(imr->coid);
-	ChannelDestroy(imr->chid);
+	ConnectDetach(eng->coid);
+	ChannelDestroy(eng->chid);
 	return -1;
 }
 
-int rcar_imrlx4_init(img_info_t img)
+/* Stop a channel once its last instance is gone. Called with rcar_imr_open held */
+static void rcar_imrlx4_stop(rcar_imr_engine_t *eng)
+{
+	/* Stop IMRLX4 */
+	out32(eng->vbase + RCAR_IMRLX4_CR, (0 << 0));
+
+	MsgSendPulse(eng->coid, 21, RCAR_IMRLX4_END, 0);
+	usleep(10);
+
+	pthread_cancel(eng->tid);
+	pthread_join(eng->tid, NULL);
+	InterruptDetach(eng->iid);
+	ConnectDetach(eng->coid);
+	ChannelDestroy(eng->chid);
+
+	munmap_device_io(eng->vbase, RCAR_IMRLX4_SIZE);
+}
+
+rcar_imr_t *rcar_imrlx4_init(img_info_t img)
 {
+	rcar_imr_t *imr;
+	int ch;
+
+	if(img.channel != RCAR_IMRLX4_CHANNEL_ANY && (img.channel < 0 || img.channel >= RCAR_IMRLX4_CHANNELS)) {
+		fprintf(stderr, "%s: Not supported IMR channel \r\n", __FUNCTION__);
+		return NULL;
+	}
+
 	if((imr = calloc(1, sizeof(rcar_imr_t))) == NULL) {
 		fprintf(stderr, "%s: calloc failed \r\n", __FUNCTION__);
-		return 0;
+		return NULL;
 	}
 
-	imr->img.hcoid = img.hcoid;
-	imr->img.pulse = img.pulse;
-	imr->img.channel = img.channel;
-	imr->img.cx = img.cx;
-	imr->img.cy = img.cy;
-	imr->img.dw = img.dw;
-	imr->img.dh = img.dh;
-	imr->img.bpp = img.bpp;
-
-	/* Physical base address and interrupt number */
-	switch(imr->img.channel) {
-		case 0:
-			imr->pbase = RCAR_IMRLX40_BASE;
-			imr->irq = RCAR_INTCSYS_IMRLX40;
-			break;
-		case 1:
-			imr->pbase = RCAR_IMRLX41_BASE;
-			imr->irq = RCAR_INTCSYS_IMRLX41;
-			break;
-		case 2:
-			imr->pbase = RCAR_IMRLX42_BASE;
-			imr->irq = RCAR_INTCSYS_IMRLX42;
-			break;
-		case 3:
-			imr->pbase = RCAR_IMRLX43_BASE;
-			imr->irq = RCAR_INTCSYS_IMRLX43;
-			break;
-		default:
-			fprintf(stderr, "%s: Not supported IMR channel \r\n", __FUNCTION__);
-			return -1;
-	}
+	imr->img = img;
+	imr->channel = -1;
 
-	if ((imr->vbase = (uintptr_t)mmap_device_io(RCAR_IMRLX4_SIZE, imr->pbase)) == (uintptr_t)MAP_FAILED) {
-        fprintf(stderr, "%s: IMRLX4 base mmap_device_io (0x%x) failed \r\n", __FUNCTION__, (uint32_t)imr->pbase);
-        rcar_imrlx4_fini();
-        return (errno);
-    }
+	imr->img_conf.strip = 1;
 
-	if(parse_device_config(imr) == -1)
+	if(rcar_imrlx4_mesh_load(imr, RCAR_IMRLX4_MESH_FILE) == -1 && parse_device_config(imr) == -1)
 	{
 		imr->img_conf.def_set = 1;
 		//square width, square height(unit use to divide image)
@@ -534,29 +630,106 @@ int rcar_imrlx4_init(img_info_t img)
 		fprintf(stderr, "%s: Use default setting \r\n", __FUNCTION__);
 	}
 
-	/* Enable IMRLX4 */
-	rcar_imrlx4_setup();
+	/* Display list initial */
+	if(rcar_imrlx4_DL_init(imr)) {
+		rcar_imrlx4_fini(imr);
+		return NULL;
+	}
+
+	/* Join the channels of the instance, starting the ones not running yet */
+	pthread_mutex_lock(&rcar_imr_open);
+	for(ch = 0; ch < RCAR_IMRLX4_CHANNELS; ch++) {
+		rcar_imr_engine_t *eng = &rcar_imr_engines[ch];
 
-	return 0;
+		if(img.channel != RCAR_IMRLX4_CHANNEL_ANY && img.channel != ch)
+			continue;
+		eng->channel = ch;
+		if(eng->stats.users == 0 && rcar_imrlx4_setup(eng))
+			continue;
+		pthread_mutex_lock(&rcar_imr_mutex);
+		eng->stats.users++;
+		imr->channels |= 1 << ch;
+		pthread_mutex_unlock(&rcar_imr_mutex);
+	}
+	pthread_mutex_unlock(&rcar_imr_open);
+
+	if(!imr->channels) {
+		fprintf(stderr, "%s: no IMR channel could be started \r\n", __FUNCTION__);
+		rcar_imrlx4_fini(imr);
+		return NULL;
+	}
+
+	return imr;
 }
 
-int rcar_imrlx4_fini()
+int rcar_imrlx4_fini(rcar_imr_t *imr)
 {
-	/* Stop IMRLX4 */
-	out32(imr->vbase + RCAR_IMRLX4_CR, (0 << 0));
+	int ch;
 
-	MsgSendPulse(imr->coid, 21, RCAR_IMRLX4_END, 0);
-	usleep(10);
+	if(imr == NULL)
+		return 0;
 
-	pthread_cancel(imr->tid);
-	pthread_join(imr->tid, NULL);
-	InterruptDetach(imr->iid);
-	ConnectDetach(imr->coid);
-	ChannelDestroy(imr->chid);
+	pthread_mutex_lock(&rcar_imr_open);
+	for(ch = 0; ch < RCAR_IMRLX4_CHANNELS; ch++) {
+		rcar_imr_engine_t *eng = &rcar_imr_engines[ch];
 
-	munmap_device_io(imr->vbase, RCAR_IMRLX4_SIZE);
+		if(!(imr->channels & (1 << ch)))
+			continue;
 
+		/* Let a frame in progress complete before the display list goes */
+		pthread_mutex_lock(&rcar_imr_mutex);
+		while(eng->busy == imr)
+			pthread_cond_wait(&rcar_imr_cond, &rcar_imr_mutex);
+		if(eng->setup == imr)
+			eng->setup = NULL;
+		eng->stats.users--;
+		pthread_mutex_unlock(&rcar_imr_mutex);
+
+		if(eng->stats.users == 0)
+			rcar_imrlx4_stop(eng);
+	}
+	pthread_mutex_unlock(&rcar_imr_open);
+
+	if(imr->patch)
+		munmap(imr->patch, imr->patch_size);
+	if(imr->dl)
+		munmap(imr->dl, imr->dl_size);
+	if(imr->mesh)
+		munmap(imr->mesh, imr->mesh_size);
+	free(imr->img_conf.coords);
 	free(imr);
 
 	return 0;
 }
+
+/* Utilisation of a channel, or the sum of all of them for RCAR_IMRLX4_CHANNEL_ANY */
+int rcar_imrlx4_get_stats(int channel, rcar_imr_stats_t *stats)
+{
+	rcar_imr_engine_t *eng;
+	uint64_t now = ClockCycles();
+	int ch;
+
+	if(channel != RCAR_IMRLX4_CHANNEL_ANY && (channel < 0 || channel >= RCAR_IMRLX4_CHANNELS)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+
+	pthread_mutex_lock(&rcar_imr_mutex);
+	for(ch = 0; ch < RCAR_IMRLX4_CHANNELS; ch++) {
+		eng = &rcar_imr_engines[ch];
+		if((channel != RCAR_IMRLX4_CHANNEL_ANY && ch != channel) || eng->stats.users == 0)
+			continue;
+		stats->users += eng->stats.users;
+		stats->frames += eng->stats.frames;
+		stats->waits += eng->stats.waits;
+		stats->busy_us += eng->stats.busy_us;
+		stats->up_us += rcar_imrlx4_cycles_to_us(now - eng->up);
+		if(eng->stats.max_us > stats->max_us)
+			stats->max_us = eng->stats.max_us;
+	}
+	pthread_mutex_unlock(&rcar_imr_mutex);
+
+	return 0;
+}
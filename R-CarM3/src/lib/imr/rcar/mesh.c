@@ -0,0 +1,247 @@
+/*
+* $QNXLicenseC:
+* Copyright 2014, QNX Software Systems.
+*
+* Licensed under the Apache License, Version 2.0 (the "License"). You
+* may not reproduce, modify or distribute this software except in
+* compliance with the License. You may obtain a copy of the License
+* at: http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" basis,
+* WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+*
+* This file may contain contributions from others, either as
+* contributors under the License or as licensors under other terms.
+* Please review this entire file for other proprietary rights or license
+* notices, as well as the QNX Development Suite License Guide at
+* http://licensing.qnx.com/license-guide/ for other information.
+* $
+*/
+
+#include <stddef.h>
+#include "imrlx4.h"
+#include <arm/r-car.h>
+
+/*
+ * Destination of the grid point (C, R), taken from the triangle list of the config:
+ * corners 0 (C, R + 1), 1 (C, R), 2 (C + 1, R) and 5 (C + 1, R + 1) of a square.
+ */
+static uint32_t rcar_imrlx4_grid_coord(img_conf_t *conf, uint32_t cols, uint32_t rows, uint32_t C, uint32_t R)
+{
+	uint32_t sC = (C < cols) ? C : C - 1;
+	uint32_t sR = (R < rows) ? R : R - 1;
+	uint32_t *tri = conf->coords + (sR * cols + sC) * 6;
+
+	if(C == sC)
+		return (R == sR) ? tri[1] : tri[0];
+	return (R == sR) ? tri[2] : tri[5];
+}
+
+/*
+ * A strip shares every vertex between up to six triangles, which is only possible
+ * when the config gives the same destination to all the copies of a grid point.
+ * Otherwise fall back to the triangle list.
+ */
+void rcar_imrlx4_mesh_layout(img_info_t *img, img_conf_t *conf)
+{
+	uint32_t cols = img->dw / conf->squareW;
+	uint32_t rows = img->dh / conf->squareH;
+	uint32_t C, R, *tri;
+
+	if(!conf->strip || conf->def_set)
+		return;
+
+	for(R = 0; R < rows; R++) {
+		for(C = 0; C < cols; C++) {
+			tri = conf->coords + (R * cols + C) * 6;
+			if(tri[0] != rcar_imrlx4_grid_coord(conf, cols, rows, C, R + 1) ||
+			   tri[1] != rcar_imrlx4_grid_coord(conf, cols, rows, C, R) ||
+			   tri[2] != rcar_imrlx4_grid_coord(conf, cols, rows, C + 1, R) ||
+			   tri[3] != tri[2] || tri[4] != tri[0] ||
+			   tri[5] != rcar_imrlx4_grid_coord(conf, cols, rows, C + 1, R + 1)) {
+				fprintf(stderr, "%s: square %d,%d does not share its vertexes, use a triangle list \r\n",
+							__FUNCTION__, C, R);
+				conf->strip = 0;
+				return;
+			}
+		}
+	}
+}
+
+/* Vertexes fetched by the IMR for every frame */
+uint32_t rcar_imrlx4_DL_vertices(img_info_t *img, img_conf_t *conf)
+{
+	uint32_t cols = img->dw / conf->squareW;
+	uint32_t rows = img->dh / conf->squareH;
+
+	//1 square is divided into 2 triangles, a strip shares them along the row
+	return conf->strip ? rows * (cols + 1) * 2 : rows * cols * 2 * 3;
+}
+
+/* Bytes of the display list drawing the source as squareW x squareH squares */
+uint32_t rcar_imrlx4_DL_size(img_info_t *img, img_conf_t *conf)
+{
+	uint32_t numVertex = rcar_imrlx4_DL_vertices(img, conf);
+	uint32_t numTri = conf->strip ? img->dh / conf->squareH : 1;
+
+	//4 byte source and 4 byte destination coordinate for every vertex
+	//4 byte dummy luminance for every vertex
+	//4 byte dummy hue for every vertex
+	//4 byte for every TRI, 12 byte for WTS, SYNCM, TRAP instruction
+	return (numVertex * 4 + numTri + 3) * 4;
+}
+
+/* Destination of the next vertex of the triangle list, the source point itself by default */
+static uint32_t rcar_imrlx4_list_coord(img_conf_t *conf, int *coord, uint16_t x, uint16_t y)
+{
+	return conf->def_set ? (((uint32_t)x << 16) | y) : conf->coords[(*coord)++];
+}
+
+static uint32_t *rcar_imrlx4_vertex(uint32_t *dl, uint16_t x, uint16_t y, uint32_t dest)
+{
+	//u, v coordinates
+	dl[0] = ((uint32_t)x << 16) | y;
+	//X, Y coordinates
+	dl[1] = dest;
+	dl[2] = 0;
+	dl[3] = 0;
+
+	return dl + 4;
+}
+
+/*
+ * Write the display list to dl, which must hold rcar_imrlx4_DL_size() bytes.
+ * It starts by selecting the strip or list mode of TRI. Returns the bytes written.
+ */
+uint32_t rcar_imrlx4_DL_build(img_info_t *img, img_conf_t *conf, uint32_t *dl)
+{
+	uint32_t cols = img->dw / conf->squareW;
+	uint32_t rows = img->dh / conf->squareH;
+	uint32_t *p = dl;
+	uint32_t C, R;
+	uint16_t x0, x1, y0, y1;
+	int coord = 0;
+
+	if(conf->strip) {
+		//WTS: set strip mode
+		*p++ = (RCAR_IMRLX4_INST_WTS << 24) | ((RCAR_IMRLX4_TRIMSR / 4) << 16) | RCAR_IMRLX4_TRIMR_TSM;
+
+		for(R = 0; R < rows; R++) {
+			y0 = R * conf->squareH;
+			y1 = (R + 1) * conf->squareH;
+			//TRI, one strip per row
+			*p++ = (RCAR_IMRLX4_INST_TRI << 24) | (((cols + 1) * 2) & 0xFFFF);
+			for(C = 0; C <= cols; C++) {
+				x0 = C * conf->squareW;
+				//coords = (C, R); (C, R + 1); the diagonal goes from (C, R + 1) to (C + 1, R)
+				p = rcar_imrlx4_vertex(p, x0, y0, conf->def_set ? (((uint32_t)x0 << 16) | y0) :
+										rcar_imrlx4_grid_coord(conf, cols, rows, C, R));
+				p = rcar_imrlx4_vertex(p, x0, y1, conf->def_set ? (((uint32_t)x0 << 16) | y1) :
+										rcar_imrlx4_grid_coord(conf, cols, rows, C, R + 1));
+			}
+		}
+	}
+	else {
+		//WTS: clear strip mode
+		*p++ = (RCAR_IMRLX4_INST_WTS << 24) | ((RCAR_IMRLX4_TRIMCR / 4) << 16) | RCAR_IMRLX4_TRIMR_TSM;
+		//TRI
+		*p++ = (RCAR_IMRLX4_INST_TRI << 24) | ((cols * rows * 2 * 3) & 0xFFFF);
+
+		for(R = 0; R < rows; R++) {
+			y0 = R * conf->squareH;
+			y1 = (R + 1) * conf->squareH;
+			for(C = 0; C < cols; C++) {
+				x0 = C * conf->squareW;
+				x1 = (C + 1) * conf->squareW;
+				//coords = (C, R + 1); (C, R); (C + 1, R);
+				p = rcar_imrlx4_vertex(p, x0, y1, rcar_imrlx4_list_coord(conf, &coord, x0, y1));
+				p = rcar_imrlx4_vertex(p, x0, y0, rcar_imrlx4_list_coord(conf, &coord, x0, y0));
+				p = rcar_imrlx4_vertex(p, x1, y0, rcar_imrlx4_list_coord(conf, &coord, x1, y0));
+				//coords = (C + 1, R); (C, R + 1); (C + 1, R + 1);
+				p = rcar_imrlx4_vertex(p, x1, y0, rcar_imrlx4_list_coord(conf, &coord, x1, y0));
+				p = rcar_imrlx4_vertex(p, x0, y1, rcar_imrlx4_list_coord(conf, &coord, x0, y1));
+				p = rcar_imrlx4_vertex(p, x1, y1, rcar_imrlx4_list_coord(conf, &coord, x1, y1));
+			}
+		}
+	}
+
+	//SYNCM
+	*p++ = RCAR_IMRLX4_INST_SYNCM << 24;
+	//TRAP
+	*p++ = RCAR_IMRLX4_INST_TRAP << 24;
+
+	return (p - dl) * 4;
+}
+
+/*
+ * Fletcher style sum over the 32-bit words of the header up to the checksum,
+ * which covers the square size and the Y/U/V correction, and of the display list.
+ */
+uint32_t rcar_imrlx4_mesh_checksum(const imrlx4_mesh_hdr_t *hdr, const uint32_t *dl)
+{
+	const uint32_t *data = (const uint32_t *)hdr;
+	uint32_t a = 1, b = 0;
+	uint32_t i;
+
+	for(i = 0; i < offsetof(imrlx4_mesh_hdr_t, checksum) / 4; i++) {
+		a += data[i];
+		b += a;
+	}
+	for(i = 0; i < hdr->dl_size / 4; i++) {
+		a += dl[i];
+		b += a;
+	}
+
+	return b ^ ((a << 16) | (a >> 16));
+}
+
+/*
+ * Map a mesh file written by imr-mesh. It is only taken when it was built for
+ * this source size and its checksum matches, the display list is then copied
+ * as is by rcar_imrlx4_DL_init() and the text config is not parsed at all.
+ * The list must end with the TRAP rcar_imrlx4_DL_build() writes, DL_init()
+ * turns it into the RET of the mesh subroutine.
+ */
+int rcar_imrlx4_mesh_load(rcar_imr_t *imr, const char *filename)
+{
+	imrlx4_mesh_hdr_t *hdr;
+	struct stat st;
+	int fd;
+
+	if((fd = open(filename, O_RDONLY)) == -1)
+		return -1;
+
+	if(fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(imrlx4_mesh_hdr_t)) {
+		close(fd);
+		return -1;
+	}
+
+	hdr = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if(hdr == MAP_FAILED)
+		return -1;
+
+	if(hdr->magic != RCAR_IMRLX4_MESH_MAGIC || hdr->version != RCAR_IMRLX4_MESH_VERSION ||
+	   hdr->width != imr->img.dw || hdr->height != imr->img.dh ||
+	   (hdr->dl_size & 3) || hdr->dl_size > st.st_size - sizeof(imrlx4_mesh_hdr_t) ||
+	   hdr->dl_size < 2 * 4 ||
+	   ((uint32_t *)(hdr + 1))[hdr->dl_size / 4 - 1] != RCAR_IMRLX4_INST_TRAP << 24 ||
+	   rcar_imrlx4_mesh_checksum(hdr, (uint32_t *)(hdr + 1)) != hdr->checksum) {
+		fprintf(stderr, "%s: %s does not match %dx%d, use the text config \r\n", __FUNCTION__,
+					filename, imr->img.dw, imr->img.dh);
+		munmap(hdr, st.st_size);
+		return -1;
+	}
+
+	imr->img_conf.squareW = hdr->squareW;
+	imr->img_conf.squareH = hdr->squareH;
+	imr->img_conf.Y = hdr->Y;
+	imr->img_conf.U = hdr->U;
+	imr->img_conf.V = hdr->V;
+	imr->mesh = hdr;
+	imr->mesh_size = st.st_size;
+
+	return 0;
+}
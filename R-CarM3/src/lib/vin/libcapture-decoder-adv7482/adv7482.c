@@ -507,15 +507,21 @@ int get_num_instance()
     return *addr;
 }
 
+/*
+ * Replay a register table. Writes to consecutive sub addresses of the same slave are
+ * merged into one auto-increment transfer and the slave address travels in the
+ * message header, so each transfer costs a single devctl. The only waits are the
+ * ones the table asks for, in ms.
+ */
 static int adv7482_write_table(const struct adv7482_reg_info *regs)
 {
     int ret = 0;
     int	status = EOK;
-    i2c_addr_t slave;
+    int len;
 
     struct {
         i2c_send_t hdr;		
-        unsigned char bytes[8];	
+        unsigned char bytes[ADV7482_I2C_BURST + 1];	
     } omsg;
 
     while (1) {
@@ -523,93 +529,67 @@ static int adv7482_write_table(const struct adv7482_reg_info *regs)
             if(regs->sub_addr == ADV7482_I2C_EOR)
                 break;		// End of script
             if(regs->sub_addr == ADV7482_I2C_WAIT)
-                delay(5);	// Wait a moment
+                delay(regs->value);
+            regs++;
+            continue;
         }
-        else {
-            
-            slave.addr = regs->addr >> 1;
-            slave.fmt = I2C_ADDRFMT_7BIT;
 
-            status = devctl(fd, DCMD_I2C_SET_SLAVE_ADDR, &slave, sizeof(slave), NULL);
+        omsg.hdr.slave.addr = regs->addr >> 1;
+        omsg.hdr.slave.fmt = I2C_ADDRFMT_7BIT;
+        omsg.hdr.stop = 1;
+        omsg.bytes[0] = regs->sub_addr;
+        len = 0;
 
-            if (status != EOK) {
-                fprintf(stderr, "%s: Set slave addr failed\n", __FUNCTION__);
-                return -1;
-            }
-            
-            omsg.hdr.slave = slave;
-            omsg.hdr.slave.fmt = I2C_ADDRFMT_7BIT;
-            omsg.hdr.len = 2;
-            omsg.hdr.stop = 1;
-            omsg.bytes[0] = regs->sub_addr;
-            omsg.bytes[1] = regs->value;
+        do {
+            omsg.bytes[++len] = regs->value;
+            regs++;
+        } while((len < ADV7482_I2C_BURST) && (regs->addr == regs[-1].addr) &&
+                (regs->sub_addr == regs[-1].sub_addr + 1));
 
-            status = devctl(fd, DCMD_I2C_SEND, &omsg, sizeof(omsg.hdr) + omsg.hdr.len, NULL);
+        omsg.hdr.len = len + 1;
 
-            if(status != EOK) {
-                fprintf(stderr, "%s: Send failed, addr=%x, reg=%x, val=%x\n", __FUNCTION__, 
-                                        regs->addr, regs->sub_addr, regs->value);
-                return -1;
-            }	
-        }
-    
-        regs++;
+        status = devctl(fd, DCMD_I2C_SEND, &omsg, sizeof(omsg.hdr) + omsg.hdr.len, NULL);
+
+        if(status != EOK) {
+            fprintf(stderr, "%s: Send failed, addr=%x, reg=%x, len=%d\n", __FUNCTION__, 
+                                    omsg.hdr.slave.addr << 1, omsg.bytes[0], len);
+            return -1;
+        }	
     }
     return ret;
 }
 
-static int adv7482_read(uint8_t addr, uint8_t sub_addr, uint8_t *value)
+/* Read len consecutive registers in one combined write/read transfer */
+static int adv7482_read_burst(uint8_t addr, uint8_t sub_addr, uint8_t *value, int len)
 {
-    int ret = 0;
     int status = EOK;
-    i2c_addr_t slave;
-
-    struct  {
-        i2c_send_t hdr;		
-        unsigned char bytes[8];	
-    } omsg;
-    
-    struct {
-        i2c_recv_t hdr;	
-        unsigned char bytes[16];
-    } imsg;
+    iov_t siov[2], riov[2];
+    i2c_sendrecv_t hdr;
 
-    slave.addr = addr >> 1;
-    slave.fmt = I2C_ADDRFMT_7BIT;
+    hdr.slave.addr = addr >> 1;
+    hdr.slave.fmt = I2C_ADDRFMT_7BIT;
+    hdr.send_len = 1;
+    hdr.recv_len = len;
+    hdr.stop = 1;
 
-    status = devctl(fd, DCMD_I2C_SET_SLAVE_ADDR, &slave, sizeof(slave), NULL);
+    SETIOV(&siov[0], &hdr, sizeof(hdr));
+    SETIOV(&siov[1], &sub_addr, 1);
+    SETIOV(&riov[0], &hdr, sizeof(hdr));
+    SETIOV(&riov[1], value, len);
 
-    if (status != EOK) {
-        fprintf(stderr, "%s: Set slave addr failed\n", __FUNCTION__);
-        return -1;
-    }
-
-    omsg.hdr.slave = slave;
-    omsg.hdr.len = 1;
-    omsg.hdr.stop = 0; 
-    omsg.bytes[0] = sub_addr;
-
-    status = devctl(fd, DCMD_I2C_SEND, &omsg, sizeof(omsg.hdr) + omsg.hdr.len, NULL);
+    status = devctlv(fd, DCMD_I2C_SENDRECV, 2, 2, siov, riov, NULL);
 
     if (status != EOK) {
-        fprintf(stderr, "%s: Send failed\n", __FUNCTION__);
+        fprintf(stderr, "%s: Read failed, addr=%x, reg=%x\n", __FUNCTION__, addr, sub_addr);
         return -1;
     }
     
-    imsg.hdr.slave = slave;
-    imsg.hdr.len = 1;
-    imsg.hdr.stop = 1;
-
-    status = devctl(fd, DCMD_I2C_RECV, &imsg, sizeof(imsg.hdr) + imsg.hdr.len, NULL);
+    return 0;
+}
 
-    if (status != EOK) {
-        fprintf(stderr, "%s: Read failed\n", __FUNCTION__);
-        return -1;
-    }
-    
-    *value = imsg.bytes[0];
-    
-    return ret;
+static int adv7482_read(uint8_t addr, uint8_t sub_addr, uint8_t *value)
+{
+    return adv7482_read_burst(addr, sub_addr, value, 1);
 }
 
 static int adv7482_write(uint8_t addr, uint8_t sub_addr, uint8_t value)
@@ -726,6 +706,9 @@ static int adv7482_hdmi_get_vid_info(video_info_t* video)
     uint8_t msb;
     uint8_t lsb;
     uint8_t hdmi_int;
+    uint8_t timing[ADV7482_HDMI_STATUS2_REG - ADV7482_HDMI_STATUS1_REG + 1];
+    uint8_t last[sizeof(timing)];
+    int wait;
     
     video->signal = 0;
 	
@@ -754,39 +737,42 @@ static int adv7482_hdmi_get_vid_info(video_info_t* video)
         usleep(1000);
     }
 	
-	delay(1000);	// Fix me: wait for signal is stable
+	/*
+	 * The measured timing takes a few frames to settle once locked: status 1 to
+	 * status 2 are read in one transfer until two readouts agree.
+	 */
+	for(wait = 0; wait < ADV7482_SETTLE_TIMEOUT; wait += ADV7482_SETTLE_POLL) {
+		ret = adv7482_read_burst(ADV7482_I2C_HDMI, ADV7482_HDMI_STATUS1_REG, timing, sizeof(timing));
+
+		if (ret < 0)
+			return -1;
+
+		if (wait && !memcmp(timing, last, sizeof(timing)))
+			break;
+
+		memcpy(last, timing, sizeof(timing));
+		delay(ADV7482_SETTLE_POLL);
+	}
 	
 	video->signal = 1;
 
     /* Decide interlaced or progressive */
-    ret = adv7482_read(ADV7482_I2C_HDMI, ADV7482_HDMI_STATUS2_REG, &hdmi_int);
-            
-    if (ret < 0)
-        return -1;
+    hdmi_int = timing[ADV7482_HDMI_STATUS2_REG - ADV7482_HDMI_STATUS1_REG];
     
     video->interlace = 0;
     
     if ((hdmi_int & ADV7482_HDMI_IP_FLAG) != 0)
         video->interlace = 1;
     
-    ret = adv7482_read(ADV7482_I2C_HDMI, ADV7482_HDMI_LWIDTH_REG, &lsb);
-            
-    if (ret < 0)
-        return -1;
+    msb = timing[0];
+    lsb = timing[ADV7482_HDMI_LWIDTH_REG - ADV7482_HDMI_STATUS1_REG];
     
     video->width = (uint32_t)(ADV7482_HDMI_LWIDTH_MSBS_MASK & msb);
     video->width = (lsb | (video->width << 8));
     
     /* Decide lines per frame */
-    ret = adv7482_read(ADV7482_I2C_HDMI, ADV7482_HDMI_F0HEIGHT_MSBS_REG, &msb);
-            
-    if (ret < 0)
-        return -1;
-    
-    ret = adv7482_read(ADV7482_I2C_HDMI, ADV7482_HDMI_F0HEIGHT_LSBS_REG, &lsb);
-            
-    if (ret < 0)
-        return -1;
+    msb = timing[ADV7482_HDMI_F0HEIGHT_MSBS_REG - ADV7482_HDMI_STATUS1_REG];
+    lsb = timing[ADV7482_HDMI_F0HEIGHT_LSBS_REG - ADV7482_HDMI_STATUS1_REG];
     
     video->height = (uint32_t)(ADV7482_HDMI_F0HEIGHT_MSBS_MASK & msb);
     video->height = (lsb | (video->height << 8));
@@ -862,6 +848,7 @@ static int adv7482_cvbs_get_vid_info(video_info_t* video)
 {
     int ret = 0;
     uint8_t value;
+    int wait;
 	
 	video->signal = 0;
     
@@ -871,15 +858,21 @@ static int adv7482_cvbs_get_vid_info(video_info_t* video)
     if (ret < 0)
         return ret;
     
-	delay(500);	// Fix me: wait for signal is stable
-	
-	/* Detect input signal */
-    if(adv7482_read(ADV7482_I2C_SDP, ADV7482_SDP_R_REG_10, &value)) {
-		return -1;
-	}
-    
-	if (!(value & ADV7482_SDP_R_REG_10_IN_LOCK)) {
-		return -1;
+	/* Detect input signal, polled until the SDP locks instead of a fixed wait */
+	for(wait = 0; ; wait += ADV7482_SETTLE_POLL) {
+		if(adv7482_read(ADV7482_I2C_SDP, ADV7482_SDP_R_REG_10, &value)) {
+			return -1;
+		}
+
+		if (value & ADV7482_SDP_R_REG_10_IN_LOCK) {
+			break;
+		}
+
+		if (wait >= ADV7482_SDP_LOCK_TIMEOUT) {
+			return -1;
+		}
+
+		delay(ADV7482_SETTLE_POLL);
 	}
 	
 	video->signal = 1;
@@ -64,6 +64,11 @@
 #define ADV7482_I2C_WAIT				0x01
 #define ADV7482_I2C_EOR					0xFE	
 #define ADV7482_I2C_NOT_ADDR			0xFF	
+#define ADV7482_I2C_BURST				32		/* registers written by one auto-increment transfer */
+
+#define ADV7482_SETTLE_POLL				10		/* ms between two reads of the lock status */
+#define ADV7482_SETTLE_TIMEOUT			1000	/* ms for the HDMI timing measurement to settle */
+#define ADV7482_SDP_LOCK_TIMEOUT		500		/* ms for the SDP to lock on the CVBS input */
 
 /****************************************/
 /* ADV7482 IO register definition       */
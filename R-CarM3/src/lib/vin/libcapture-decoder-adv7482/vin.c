@@ -99,14 +99,18 @@ int capture_update(capture_context_t context, uint32_t flags)
 	rcar_context_t *p_decoder = (rcar_context_t *)context;
 	video_info_t* video = &p_decoder->video;
 	int channel = p_decoder->active_dev;
+	struct timespec from, to;
 	
 	pthread_mutex_lock(&mutex);
 	
 	if((p_decoder->enable) && (!p_decoder->is_runing)) {
+		clock_gettime(CLOCK_MONOTONIC, &from);
 		if(DECODER_INIT(channel, video)) {
 			pthread_mutex_unlock(&mutex);
 			return -1;
 		}
+		clock_gettime(CLOCK_MONOTONIC, &to);
+		p_decoder->init_time = (timespec2nsec(&to) - timespec2nsec(&from)) / 1000;
 		p_decoder->is_runing = 1;
 	}
 	else if((!p_decoder->enable) && (p_decoder->is_runing)) {
@@ -161,6 +165,7 @@ int capture_is_property(capture_context_t context, uint32_t prop)
 		case CAPTURE_PROPERTY_SRC_WIDTH:
 		case CAPTURE_PROPERTY_SRC_HEIGHT:
 		case CAPTURE_PROPERTY_SRC_FORMAT:
+		case ADV7482_PROPERTY_INIT_TIME:
 		{
 			return 1;
 		}
@@ -211,6 +216,9 @@ int capture_get_property_i(capture_context_t context, uint32_t prop, int32_t* va
 				*value |= CAPTURE_FRAME_FLAG_INTERLACED;
 			}
 			break;
+		case ADV7482_PROPERTY_INIT_TIME:
+			*value = p_decoder->init_time;
+			break;
 		default:
 			errno = ENOTSUP;
 			return -1;
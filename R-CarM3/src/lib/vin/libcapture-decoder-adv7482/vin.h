@@ -31,11 +31,15 @@
 #include <vcapture/capture.h>
 #include "adv7482.h"
 
+/* Driver specific property, us taken by the last decoder bring-up */
+#define ADV7482_PROPERTY_INIT_TIME		CAPTURE_PROPERTY('A', 'D', 'I', 'T')
+
 typedef struct  _capture_context {
 	int enable;
 	int is_runing;
 	int source_idx;
 	int active_dev;
+	uint32_t init_time;
 	video_info_t video;
 } rcar_context_t;
 
@@ -19,8 +19,16 @@
 * $
 */
 
+#include <pthread.h>
 #include "csi2.h"
 
+/*
+ * The VINs of a group share the CSI-2 receiver, only the first user sets it up.
+ * The mutex is held for the whole setup and reset, one bit per VIN channel.
+ */
+static pthread_mutex_t rcar_csi2_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t rcar_csi2_users[2];
+
 static void rcar_csi2_enable_clock(rcar_csi2_t *csi)
 {
 	uintptr_t CPG_CSI0CKCR_reg;
@@ -131,6 +139,14 @@ int rcar_csi2_init(int channel, rcar_csi2_t* csi)
 	uint32_t vcdt = 0;
 	uint32_t vcdt2 = 0;
 	
+	pthread_mutex_lock(&rcar_csi2_mutex);
+	
+	/* Already set up for this context */
+	if(csi->vbase && (rcar_csi2_users[channel] & (1 << csi->user))) {
+		pthread_mutex_unlock(&rcar_csi2_mutex);
+		return 0;
+	}
+	
 	if(channel) {
 		csi->pbase = RCAR_CSI20_BASE;
 		csi->lanes = 1;
@@ -143,10 +159,17 @@ int rcar_csi2_init(int channel, rcar_csi2_t* csi)
 	/* Map base address */
 	if ((csi->vbase = (uintptr_t)mmap_device_io(RCAR_CSI2_SIZE, csi->pbase)) == (uintptr_t)MAP_FAILED) {
         fprintf(stderr, "%s: CSI2 base mmap_device_io (0x%x) failed", __FUNCTION__, (uint32_t)csi->pbase);
-        rcar_csi2_fini(channel, csi);
+        csi->vbase = 0;
+        pthread_mutex_unlock(&rcar_csi2_mutex);
         return -1;
     }
 	
+	if(rcar_csi2_users[channel]) {
+		rcar_csi2_users[channel] |= 1 << csi->user;
+		pthread_mutex_unlock(&rcar_csi2_mutex);
+		return 0;
+	}
+	
 	/* Supply clock for module */
 	rcar_csi2_enable_clock(csi);
 
@@ -177,13 +200,14 @@ int rcar_csi2_init(int channel, rcar_csi2_t* csi)
 				break;
 			default:
 				fprintf(stderr, "%s: lanes is invalid (%d)\n", __FUNCTION__, csi->lanes);
-				return -EINVAL;
+				ret = -EINVAL;
+				goto fail;
 		}
 		
 		/* set PHY frequency */
 		ret = rcar_csi2_set_phy_freq(csi);
 		if (ret < 0)
-			return ret;
+			goto fail;
 		
 		/* Enable lanes */
 		out32(csi->vbase + RCAR_CSI2_PHYCNT, tmp);
@@ -226,11 +250,34 @@ int rcar_csi2_init(int channel, rcar_csi2_t* csi)
 			fprintf(stderr, "%s: Timeout of reading the PHY data lane\n", __FUNCTION__);
 	}
 	
+	rcar_csi2_users[channel] |= 1 << csi->user;
+	pthread_mutex_unlock(&rcar_csi2_mutex);
+	
 	return 0;
+	
+fail:
+	pthread_mutex_unlock(&rcar_csi2_mutex);
+	munmap_device_io(csi->vbase, RCAR_CSI2_SIZE);
+	csi->vbase = 0;
+	return ret;
 }
 
 int rcar_csi2_fini(int channel, rcar_csi2_t* csi)
 {
+	if (!csi->vbase) {
+		return 0;
+	}
+	
+	/* Keep the receiver running for the other VINs of the group */
+	pthread_mutex_lock(&rcar_csi2_mutex);
+	rcar_csi2_users[channel] &= ~(1 << csi->user);
+	if(rcar_csi2_users[channel]) {
+		pthread_mutex_unlock(&rcar_csi2_mutex);
+		munmap_device_io(csi->vbase, RCAR_CSI2_SIZE);
+		csi->vbase = 0;
+		return 0;
+	}
+	
 	out32(csi->vbase + RCAR_CSI2_PHYCNT, 0);
 	
 	/* Reset CSI2 hardware */
@@ -241,9 +288,10 @@ int rcar_csi2_fini(int channel, rcar_csi2_t* csi)
 	/* Disable clock */
 	//rcar_csi2_disable_clock(csi);
 	
-    if (csi->vbase) {
-        munmap_device_io(csi->vbase, RCAR_CSI2_SIZE);
-    }
+	pthread_mutex_unlock(&rcar_csi2_mutex);
+	
+    munmap_device_io(csi->vbase, RCAR_CSI2_SIZE);
+    csi->vbase = 0;
 
     return 0;
 }
@@ -178,6 +178,7 @@ typedef struct _rcar_csi2 {
 	uintptr_t pbase;
 	uint32_t lanes;
 	csi2_info_t* info;
+	uint32_t user;		/* VIN channel of the context, bit in the receiver users */
 } rcar_csi2_t;
 
 
@@ -24,6 +24,7 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <sys/neutrino.h>
+#include <sys/syspage.h>
 #include <hw/inout.h>
 #include <sys/resmgr.h>
 #include <sys/iofunc.h>
@@ -47,9 +48,339 @@
 #define SOC_FINI	 rcar_vin_fini
 #define SOC_UPDATE	 rcar_vin_update
 
-extern rcar_imrlx4_init();
-extern rcar_imrlx4_fini();
-pthread_mutex_t mutex;
+static const int rcar_vin_irqs[RCAR_VIN_CHANNELS] = {
+	RCAR_INTCSYS_VIN0, RCAR_INTCSYS_VIN1, RCAR_INTCSYS_VIN2, RCAR_INTCSYS_VIN3,
+	RCAR_INTCSYS_VIN4, RCAR_INTCSYS_VIN5, RCAR_INTCSYS_VIN6, RCAR_INTCSYS_VIN7
+};
+
+/* Reset the frame queue, every client buffer is owned by the driver */
+static void rcar_vin_queue_init(rcar_vin_t *vin)
+{
+	cam_buf_t *buf = &vin->buf;
+	int i;
+
+	for(i = 0; i < RCAR_VIN_MAX_FRAMES; i++) {
+		buf->state[i] = RCAR_VIN_FRAME_FREE;
+	}
+	buf->head = 0;
+	buf->count = 0;
+	buf->busy = -1;
+	buf->dropped = 0;
+	buf->overwritten = 0;
+	buf->imr_dropped = 0;
+	vin->imr_head = 0;
+	vin->imr_count = 0;
+	vin->imr_running = 0;
+	vin->irq_stamp = 0;
+	vin->last_interval = 0;
+	memset(&vin->stats, 0, sizeof(vin->stats));
+}
+
+static uint64_t rcar_vin_cycles_to_ns(uint64_t cycles)
+{
+	uint64_t cps = SYSPAGE_ENTRY(qtime)->cycles_per_sec;
+
+	return (cycles / cps) * 1000000000 + (cycles % cps) * 1000000000 / cps;
+}
+
+static void rcar_vin_hist_add(rcar_vin_hist_t *hist, uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	int bin = 0;
+
+	while(bin < RCAR_VIN_HIST_BINS - 1 && (us >> bin))
+		bin++;
+	hist->bins[bin]++;
+	if(us > hist->max)
+		hist->max = us > UINT32_MAX ? UINT32_MAX : us;
+}
+
+/*
+ * Stamp the frame end being handled: the interrupt time in CLOCK_MONOTONIC, taken
+ * back from the cycles elapsed since the interrupt handler ran, and the wakeup
+ * latency and interval jitter statistics. Called with the frame lock held.
+ */
+static void rcar_vin_frame_end(rcar_vin_t *vin)
+{
+	struct timespec now;
+	uint64_t stamp, interval;
+
+	vin->irq_wake = ClockCycles();
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	stamp = timespec2nsec(&now) - rcar_vin_cycles_to_ns(vin->irq_wake - vin->irq_cycles);
+
+	vin->stats.frames++;
+	rcar_vin_hist_add(&vin->stats.irq_wakeup, rcar_vin_cycles_to_ns(vin->irq_wake - vin->irq_cycles));
+
+	if(vin->irq_stamp) {
+		interval = stamp - vin->irq_stamp;
+		if(vin->last_interval) {
+			rcar_vin_hist_add(&vin->stats.interval_jitter, interval > vin->last_interval ?
+								interval - vin->last_interval : vin->last_interval - interval);
+		}
+		vin->last_interval = interval;
+	}
+	vin->irq_stamp = stamp;
+
+	/* CLOCK_MONOTONIC counts from boot, read back with RCAR_VIN_PROPERTY_*_TO_FRAME */
+	if(!vin->start_to_frame) {
+		vin->start_to_frame = stamp - vin->start;
+		if(!vin->first_frame) {
+			vin->first_frame = stamp;
+		}
+	}
+}
+
+/* The client buffer holds the frame that ended at stamp */
+static void rcar_vin_frame_stamp(rcar_vin_t *vin, int idx, uint64_t stamp, uint64_t wake)
+{
+	vin->buf.stamp[idx] = stamp;
+	vin->buf.wake[idx] = wake;
+}
+
+static int rcar_vin_queue_pop(rcar_vin_t *vin)
+{
+	cam_buf_t *buf = &vin->buf;
+	int idx = buf->ready[buf->head];
+
+	buf->head = (buf->head + 1) % RCAR_VIN_MAX_FRAMES;
+	buf->count--;
+
+	return idx;
+}
+
+/*
+ * Pick the client buffer receiving the next frame, called with the mutex held.
+ * A buffer held by the client is never written: when none is free the oldest
+ * frame not delivered yet is replaced, otherwise the new frame is dropped.
+ */
+static int rcar_vin_queue_target(rcar_vin_t *vin)
+{
+	cam_buf_t *buf = &vin->buf;
+	int i;
+
+	for(i = 0; i < vin->frm_nbufs; i++) {
+		if(buf->state[i] == RCAR_VIN_FRAME_FREE) {
+			return i;
+		}
+	}
+
+	if(buf->count) {
+		buf->overwritten++;
+		return rcar_vin_queue_pop(vin);
+	}
+
+	buf->dropped++;
+	return -1;
+}
+
+/* The IMR completed the busy buffer, append it to the ready frames */
+static void rcar_vin_queue_done(rcar_vin_t *vin)
+{
+	cam_buf_t *buf = &vin->buf;
+
+	if(buf->busy < 0) {
+		return;
+	}
+
+	buf->ready[(buf->head + buf->count) % RCAR_VIN_MAX_FRAMES] = buf->busy;
+	buf->count++;
+	buf->state[buf->busy] = RCAR_VIN_FRAME_READY;
+	buf->busy = -1;
+}
+
+/* Give a buffer held by the client back to the driver */
+static int rcar_vin_queue_put(rcar_vin_t *vin, uint32_t idx)
+{
+	pthread_mutex_lock(&vin->mutex);
+
+	if(idx >= (uint32_t)vin->frm_nbufs || vin->buf.state[idx] != RCAR_VIN_FRAME_CLIENT) {
+		pthread_mutex_unlock(&vin->mutex);
+		errno = EINVAL;
+		return -1;
+	}
+
+	rcar_vin_hist_add(&vin->stats.wakeup_release, rcar_vin_cycles_to_ns(ClockCycles() - vin->buf.wake[idx]));
+	vin->buf.state[idx] = RCAR_VIN_FRAME_FREE;
+
+	pthread_mutex_unlock(&vin->mutex);
+	return 0;
+}
+
+/*
+ * Direct capture: queue the frame completed in a VIN slot and program the slot with
+ * a free client buffer. Without one the slot keeps its buffer and captures into it
+ * again, the frame is counted as dropped.
+ */
+static void rcar_vin_queue_slot(rcar_vin_t *vin, int slot)
+{
+	cam_buf_t *buf = &vin->buf;
+	int idx;
+
+	if((idx = rcar_vin_queue_target(vin)) < 0) {
+		return;
+	}
+
+	buf->busy = vin->slot_frm[slot];
+	rcar_vin_frame_stamp(vin, buf->busy, vin->irq_stamp, vin->irq_wake);
+	rcar_vin_queue_done(vin);
+
+	buf->state[idx] = RCAR_VIN_FRAME_BUSY;
+	vin->slot_frm[slot] = idx;
+	out32(vin->vbase + RCAR_VIN_MB(slot), (uint32_t)vin->frm_paddr[idx]);
+}
+
+static uint32_t rcar_vin_format_bpp(uint32_t format)
+{
+	switch(format)
+	{
+		case SCREEN_FORMAT_RGBA8888:
+			return 4;
+		case SCREEN_FORMAT_RGB565:
+		case SCREEN_FORMAT_UYVY:
+		case SCREEN_FORMAT_RGBA5551:
+			return 2;
+	}
+	return 0;
+}
+
+/* IMR source neither programmed in a VIN slot nor queued, called with the mutex held */
+static int rcar_vin_imr_free_src(rcar_vin_t *vin)
+{
+	int used = 0;
+	int i;
+
+	for(i = 0; i < vin->nbufs; i++) {
+		used |= 1 << vin->slot_src[i];
+	}
+	for(i = 0; i < vin->imr_count; i++) {
+		used |= 1 << vin->imr_queue[(vin->imr_head + i) % RCAR_VIN_IMR_QUEUE].src;
+	}
+	for(i = 0; i < RCAR_VIN_IMR_BUFFER; i++) {
+		if(!(used & (1 << i))) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Distortion correction worker: takes the captured sources queued by the event thread
+ * in order and corrects them one at a time into free client buffers, so a slow IMR
+ * pass never delays the handling of the next frame end.
+ */
+static void *rcar_vin_imr_worker(void *data)
+{
+	rcar_vin_t *vin = (rcar_vin_t *)data;
+	struct _pulse pulse;
+	int src, idx;
+
+	for (;;) {
+		if (MsgReceivePulse(vin->imr_chid, &pulse, sizeof(pulse), NULL) == -1)
+			continue;
+
+		pthread_mutex_lock(&vin->mutex);
+
+		switch (pulse.code)
+		{
+			case RCAR_VIN_IMR_PULSE:
+				/* The frame is corrected, its source may be programmed in a VIN slot again */
+				if(vin->imr_running) {
+					rcar_vin_queue_done(vin);
+					vin->imr_head = (vin->imr_head + 1) % RCAR_VIN_IMR_QUEUE;
+					vin->imr_count--;
+					vin->imr_running = 0;
+					pthread_cond_broadcast(&vin->cond);
+				}
+				break;
+			case RCAR_VIN_END:
+				pthread_mutex_unlock(&vin->mutex);
+				return NULL;
+			default:
+				break;
+		}
+
+		while(!vin->imr_running && vin->imr_count) {
+			imr_frame_t *frm = &vin->imr_queue[vin->imr_head];
+
+			if((idx = rcar_vin_queue_target(vin)) < 0) {
+				vin->imr_head = (vin->imr_head + 1) % RCAR_VIN_IMR_QUEUE;
+				vin->imr_count--;
+				continue;
+			}
+
+			vin->buf.state[idx] = RCAR_VIN_FRAME_BUSY;
+			vin->buf.busy = idx;
+			rcar_vin_frame_stamp(vin, idx, frm->stamp, frm->wake);
+			vin->imr_running = 1;
+			src = frm->src;
+
+			pthread_mutex_unlock(&vin->mutex);
+			if(vin->imr_registered)
+				rcar_imrlx4_update_buffers(vin->imr_ctx, src, idx);
+			else
+				rcar_imrlx4_update_frame(vin->imr_ctx, vin->buf.addr[src], (paddr_t)vin->frm_bufs[idx]);
+			pthread_mutex_lock(&vin->mutex);
+		}
+
+		pthread_mutex_unlock(&vin->mutex);
+	}
+}
+
+static int rcar_vin_imr_start(rcar_vin_t *vin)
+{
+	pthread_attr_t attr;
+	struct sched_param param;
+
+	if ((vin->imr_chid = ChannelCreate(_NTO_CHF_DISCONNECT | _NTO_CHF_UNBLOCK)) == -1)
+		return -1;
+
+	if ((vin->imr_coid = ConnectAttach(0, 0, vin->imr_chid, _NTO_SIDE_CHANNEL, 0)) == -1)
+		goto fail;
+
+	/* Below the event thread, which must not wait for a correction */
+	pthread_attr_init(&attr);
+	pthread_attr_setschedpolicy(&attr, SCHED_RR);
+	param.sched_priority = 20;
+	pthread_attr_setschedparam(&attr, &param);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setstacksize(&attr, 8192);
+
+	if (pthread_create(&vin->imr_tid, &attr, rcar_vin_imr_worker, vin)) {
+		fprintf(stderr, "%s:  Unable to create IMR worker\n", __FUNCTION__);
+		vin->imr_tid = 0;
+		ConnectDetach(vin->imr_coid);
+		goto fail;
+	}
+	return 0;
+
+fail:
+	ChannelDestroy(vin->imr_chid);
+	return -1;
+}
+
+static void rcar_vin_imr_stop(rcar_vin_t *vin)
+{
+	if(!vin->imr_tid)
+		return;
+
+	MsgSendPulse(vin->imr_coid, 21, RCAR_VIN_END, 0);
+	pthread_join(vin->imr_tid, NULL);
+	vin->imr_tid = 0;
+	ConnectDetach(vin->imr_coid);
+	ChannelDestroy(vin->imr_chid);
+}
+
+/* Only stamps the interrupt, the event thread does the rest */
+static const struct sigevent *rcar_vin_isr(void *area, int id)
+{
+	rcar_vin_t *vin = (rcar_vin_t *)area;
+
+	InterruptMask(vin->irq, id);
+	vin->irq_cycles = ClockCycles();
+
+	return &vin->event;
+}
 
 paddr_t rcar_vin_mphys(void *addr) 
 {
@@ -68,6 +399,9 @@ void *rcar_vin_event_handler(void *data)
 	iov_t iov;
 	int	rcvid;
 	int slot = 0;
+	int src;
+	int kick;
+	imr_frame_t *frm;
 
 	SETIOV(&iov, &pulse, sizeof(pulse));
 	
@@ -87,24 +421,45 @@ void *rcar_vin_event_handler(void *data)
 				vin_ints = in32(vin->vbase + RCAR_VIN_INTS);
 				out32(vin->vbase + RCAR_VIN_INTS, vin_ints);	
 				if((vin_ints & (1 << 1))||(vin_ints & (1 << 4))) {
-					pthread_mutex_lock(&mutex);
+					kick = 0;
+					pthread_mutex_lock(&vin->mutex);
+					rcar_vin_frame_end(vin);
 					slot = in32(vin->vbase + RCAR_VIN_MS);
 					slot &= (3 << 3);
 					slot = slot >> 3;
-					if(slot < vin->nbufs) {
-						vin->buf.latest = slot;
-						rcar_imrlx4_update_frame(vin->buf.addr[slot], (paddr_t)vin->frm_bufs[slot]);
+					if(slot < vin->nbufs && vin->direct) {
+						rcar_vin_queue_slot(vin, slot);
+						pthread_cond_broadcast(&vin->cond);
+					}
+					else if(slot < vin->nbufs) {
+						/*
+						 * Hand the captured source to the IMR worker and program the slot with a
+						 * free one, the VIN comes back to the slot two frames later. When the
+						 * worker is behind, or there is no IMR instance, the frame is dropped and
+						 * the slot captured into again.
+						 */
+						if(vin->imr_ctx && vin->imr_count < RCAR_VIN_IMR_QUEUE) {
+							src = rcar_vin_imr_free_src(vin);
+							frm = &vin->imr_queue[(vin->imr_head + vin->imr_count) % RCAR_VIN_IMR_QUEUE];
+							frm->src = vin->slot_src[slot];
+							frm->stamp = vin->irq_stamp;
+							frm->wake = vin->irq_wake;
+							vin->imr_count++;
+							vin->slot_src[slot] = src;
+							out32(vin->vbase + RCAR_VIN_MB(slot), (uint32_t)vin->buf.phys[src]);
+							kick = 1;
+						}
+						else {
+							vin->buf.imr_dropped++;
+						}
 					}
-					pthread_mutex_unlock(&mutex);
+					pthread_mutex_unlock(&vin->mutex);
+					if(kick)
+						MsgSendPulse(vin->imr_coid, 20, RCAR_VIN_IMR_KICK, 0);
 				}
 				InterruptUnmask(vin->irq, vin->iid);
 				atomic_clr_value(&vin->frm_end, 1);
 				break;
-			case RCAR_VIN_IMR_PULSE:
-				pthread_mutex_lock(&mutex);
-				pthread_cond_broadcast(&vin->cond);
-				pthread_mutex_unlock(&mutex);
-				break;
 			case RCAR_VIN_END:
 				return NULL;
 			default:
@@ -146,7 +501,7 @@ int rcar_vin_create_thread(capture_context_t context)
 		fprintf(stderr, "%s:  Unable to create event handler\n", __FUNCTION__);
 		goto fail;
 	}
-	if ((vin->iid = InterruptAttachEvent(vin->irq, &vin->event, _NTO_INTR_FLAGS_TRK_MSK|_NTO_INTR_FLAGS_END)) == -1){
+	if ((vin->iid = InterruptAttach(vin->irq, rcar_vin_isr, vin, sizeof(*vin), _NTO_INTR_FLAGS_TRK_MSK|_NTO_INTR_FLAGS_END)) == -1){
 		fprintf(stderr,"%s: Interrupt attach failed.\n", __FUNCTION__);
 		goto fail;
 	}
@@ -196,10 +551,7 @@ void rcar_vin_enable_clock(capture_context_t context)
 	SMSTPCR8_reg   = mmap_device_io(4, 0xE6150990);
 	MSTPSR8_reg	   = mmap_device_io(4, 0xE61509A0);
 
-	if(p_soc->active_dev)
-		mask = (1 << 7);					// VIN4
-	else
-		mask = (1 << 11);					// VIN0
+	mask = (1 << (11 - p_soc->channel));	// VIN0 is MSTP811, VIN7 MSTP804
 
 	/* Enale supply clock to module */
 	tmp = in32(MSTPSR8_reg);
@@ -226,10 +578,7 @@ void rcar_vin_disable_clock (capture_context_t context)
 	SMSTPCR8_reg   = mmap_device_io(4, 0xE6150990);
 	MSTPSR8_reg	   = mmap_device_io(4, 0xE61509A0);
 
-	if(p_soc->active_dev)
-		tmp = (1 << 7);
-	else
-		tmp = (1 << 11);
+	tmp = (1 << (11 - p_soc->channel));
 	
 	/* Stop supply clock to module */
 	out32(CPG_CPGWPR_reg, tmp);
@@ -268,7 +617,10 @@ void rcar_vin_scale(rcar_vin_t* vin)
 	out32(vin->vbase + RCAR_VIN_UDS_PASS_BW, (bwidth_h << 16) | bwidth_v);
 	out32(vin->vbase + RCAR_VIN_UDS_CLIPSIZE, clip_size);
 
-	out32(vin->vbase + RCAR_VIN_IS, (cam->dw + 31) & ~0x1f);
+	if(vin->direct)
+		out32(vin->vbase + RCAR_VIN_IS, cam->dstride / vin->bpp);
+	else
+		out32(vin->vbase + RCAR_VIN_IS, (cam->dw + 31) & ~0x1f);
 	//out32(vin->vbase + RCAR_VIN_IS, (cam->dw + 15) & ~0x0f);
 }
 
@@ -299,7 +651,20 @@ void rcar_vin_crop(rcar_vin_t* vin)
 	}
 }
 
-void rcar_vin_setup(capture_context_t context)
+static void rcar_vin_unmap_sources(rcar_vin_t *vin)
+{
+	int i;
+	
+	for(i = 0; i < RCAR_VIN_IMR_BUFFER; i++) {
+		if(vin->buf.addr[i]) {
+			munmap((void *)vin->buf.addr[i], vin->buf.size);
+			vin->buf.addr[i] = 0;
+		}
+	}
+	vin->buf.size = 0;
+}
+
+int rcar_vin_setup(capture_context_t context)
 {
 	int i;
 	uint32_t input_is_yuv = 0;
@@ -380,25 +745,50 @@ void rcar_vin_setup(capture_context_t context)
 	if(p_soc->active_dev == 0)
 		dmr2 |= (RCAR_VIN_DMR2_VPS | RCAR_VIN_DMR2_HPS);
 	
-	/* Maximum supported capture buffer */
-	vin->nbufs = vin->frm_nbufs;
-	if(vin->frm_nbufs >= RCAR_VIN_MAX_BUFFER)
-		vin->nbufs = RCAR_VIN_MAX_BUFFER;
-	
-	//Mmap middle buffer
-	mem_size = cam->dh * (cam->dw * img.bpp);
-	for(i = 0; i < vin->nbufs; i++) { 
-		vin->buf.addr[i] = (uintptr_t)mmap(0, mem_size, PROT_READ | PROT_WRITE | PROT_NOCACHE,
-														MAP_ANON | MAP_PHYS | MAP_PRIVATE, NOFD, 0);
-		memset((void*)vin->buf.addr[i], 0, mem_size);
-		out32(vin->vbase + RCAR_VIN_MB(i), rcar_vin_mphys((void *)vin->buf.addr[i]));
+	/* The VIN slots are decoupled from the client buffers by the IMR, use all of them */
+	vin->nbufs = RCAR_VIN_MAX_BUFFER;
+	if(vin->frm_nbufs > RCAR_VIN_MAX_FRAMES)
+		vin->frm_nbufs = RCAR_VIN_MAX_FRAMES;
+	pthread_mutex_lock(&vin->mutex);
+	rcar_vin_queue_init(vin);
+	pthread_mutex_unlock(&vin->mutex);
+	
+	if(vin->direct) {
+		/* The first client buffers go straight to the VIN slots */
+		for(i = 0; i < vin->nbufs; i++) {
+			vin->buf.state[i] = RCAR_VIN_FRAME_BUSY;
+			vin->slot_frm[i] = i;
+			out32(vin->vbase + RCAR_VIN_MB(i), (uint32_t)vin->frm_paddr[i]);
+		}
+	}
+	else {
+		//Mmap middle buffer, the ones queued for the IMR are swapped out of the slots
+		mem_size = cam->dh * (cam->dw * img.bpp);
+		vin->buf.size = mem_size;
+		for(i = 0; i < RCAR_VIN_IMR_BUFFER; i++) { 
+			vin->buf.addr[i] = (uintptr_t)mmap(0, mem_size, PROT_READ | PROT_WRITE | PROT_NOCACHE,
+															MAP_ANON | MAP_PHYS | MAP_PRIVATE, NOFD, 0);
+			if(vin->buf.addr[i] == (uintptr_t)MAP_FAILED) {
+				fprintf(stderr, "%s: IMR source mmap (%u bytes) failed\n", __FUNCTION__, mem_size);
+				vin->buf.addr[i] = 0;
+				rcar_vin_unmap_sources(vin);
+				return -1;
+			}
+			memset((void*)vin->buf.addr[i], 0, mem_size);
+			vin->buf.phys[i] = rcar_vin_mphys((void *)vin->buf.addr[i]);
+		}
+		for(i = 0; i < vin->nbufs; i++) { 
+			vin->slot_src[i] = i;
+			out32(vin->vbase + RCAR_VIN_MB(i), (uint32_t)vin->buf.phys[i]);
+		}
 	}
 	
 	/* Interrupt type */
 	interrupt = cam->interlace ? RCAR_VIN_IE_EFE : RCAR_VIN_IE_FIE;
 	
-	/* Apply setup */
-	out32(vin->vbase + RCAR_VIN_CSI_IFMD, ifmd);
+	/* Apply setup, the CSI routing is set by the first VIN of each group */
+	if(p_soc->channel % RCAR_VIN_GROUP_CHANNELS == 0)
+		out32(vin->vbase + RCAR_VIN_CSI_IFMD, ifmd);
 	out32(vin->vbase + RCAR_VIN_INTS, interrupt);
 	out32(vin->vbase + RCAR_VIN_DMR, dmr);
 	out32(vin->vbase + RCAR_VIN_DMR2, dmr2);
@@ -413,19 +803,41 @@ void rcar_vin_setup(capture_context_t context)
 		fprintf(stderr, "%s: create interrupt handler failed\n", __FUNCTION__);
 	}
 	
-	/* IMRLX4 init */
-	img.hcoid = vin->coid;
-	img.pulse = RCAR_VIN_IMR_PULSE;
-	img.channel = 0;
-	img.cx = cam->cx;
-	img.cy = cam->cy;
-	img.dw = cam->dw;
-	img.dh = cam->dh;
-	rcar_imrlx4_init(img);
+	/* IMRLX4 init, not needed when capturing straight into the client buffers */
+	if(!vin->direct) {
+		if(rcar_vin_imr_start(vin)) {
+			fprintf(stderr, "%s: create IMR worker failed\n", __FUNCTION__);
+		}
+		img.hcoid = vin->imr_coid;
+		img.pulse = RCAR_VIN_IMR_PULSE;
+		img.channel = vin->imr_channel;
+		img.cx = cam->cx;
+		img.cy = cam->cy;
+		img.dw = cam->dw;
+		img.dh = cam->dh;
+		if((vin->imr_ctx = rcar_imrlx4_init(img)) == NULL) {
+			fprintf(stderr, "%s: IMR init failed, frames are dropped\n", __FUNCTION__);
+		}
+		else {
+			/* Sources and client buffers are fixed until the next enable, translate them once */
+			void *srcs[RCAR_VIN_IMR_BUFFER];
+			
+			for(i = 0; i < RCAR_VIN_IMR_BUFFER; i++) {
+				srcs[i] = (void *)vin->buf.addr[i];
+			}
+			vin->imr_registered = !rcar_imrlx4_register_buffers(vin->imr_ctx, srcs, RCAR_VIN_IMR_BUFFER,
+																vin->frm_bufs, vin->frm_nbufs);
+			if(!vin->imr_registered) {
+				fprintf(stderr, "%s: IMR buffer registration failed, translating every frame\n", __FUNCTION__);
+			}
+		}
+	}
 
 	/* Start */
 	out32(vin->vbase + RCAR_VIN_IE, interrupt);
 	out32(vin->vbase + RCAR_VIN_FC, RCAR_VIN_FC_C_FRAME); 
+	
+	return 0;
 }
 
 int rcar_vin_update(capture_context_t context)
@@ -459,7 +871,7 @@ int rcar_vin_fini(capture_context_t context)
 	}
 	
 	/* Disable HDMI audio */
-	if(p_soc->active_dev == 0) {
+	if(p_soc->channel == 0) {
 		audio_stop();
 		audio_deinit();
 	}
@@ -490,8 +902,15 @@ int rcar_vin_fini(capture_context_t context)
 	ConnectDetach(vin->coid);
 	ChannelDestroy(vin->chid);
 	
-	pthread_cond_destroy(&vin->cond);
-	pthread_mutex_destroy(&vin->mutex);
+	rcar_vin_imr_stop(vin);
+	rcar_imrlx4_fini(vin->imr_ctx);
+	vin->imr_ctx = NULL;
+	vin->imr_registered = 0;
+	
+	/* The IMR sources are only mapped when the VIN does not capture into the client buffers */
+	if(!vin->direct) {
+		rcar_vin_unmap_sources(vin);
+	}
 	
 	munmap_device_io(vin->vbase, RCAR_VIN_SIZE);
 	
@@ -503,26 +922,72 @@ int rcar_vin_fini(capture_context_t context)
 	return 0;
 }
 
-int rcar_vin_init(capture_context_t context)
+/*
+ * Check that the client buffers can be programmed in the VIN memory base registers:
+ * physically contiguous, below 4GB and aligned, with a stride of 16 pixels.
+ */
+static int rcar_vin_import_buffers(rcar_vin_t *vin)
 {
-	pthread_condattr_t attr;
+	cam_info_t *cam = &vin->cam;
+	uint32_t bpp, stride, size;
+	off64_t offset;
+	size_t contig;
+	int i;
+	
+	/* One buffer more than the VIN slots, for the client to hold */
+	bpp = rcar_vin_format_bpp(cam->dfmt);
+	if(vin->frm_bufs == NULL || vin->frm_nbufs <= RCAR_VIN_MAX_BUFFER || vin->frm_nbufs > RCAR_VIN_MAX_FRAMES ||
+		bpp == 0 || cam->dw == 0 || cam->dh == 0) {
+		fprintf(stderr, "%s: Invalid buffers or destination format\n", __FUNCTION__);
+		errno = EINVAL;
+		return -1;
+	}
 	
+	stride = cam->dstride ? cam->dstride : cam->dw * bpp;
+	if(stride < cam->dw * bpp || stride % (16 * bpp)) {
+		fprintf(stderr, "%s: Invalid stride %d\n", __FUNCTION__, stride);
+		errno = EINVAL;
+		return -1;
+	}
+	size = stride * cam->dh;
+	
+	for(i = 0; i < vin->frm_nbufs; i++) {
+		if(mem_offset64(vin->frm_bufs[i], NOFD, size, &offset, &contig) == -1 || contig < size ||
+			(offset & (RCAR_VIN_MB_ALIGN - 1)) || offset + size > 0x100000000ULL) {
+			fprintf(stderr, "%s: Buffer %d not usable by the VIN\n", __FUNCTION__, i);
+			errno = EINVAL;
+			return -1;
+		}
+		vin->frm_paddr[i] = offset;
+	}
+	
+	cam->dstride = stride;
+	vin->bpp = bpp;
+	vin->direct = 1;
+	
+	return 0;
+}
+
+int rcar_vin_init(capture_context_t context)
+{
 	rcar_context_t *p_soc = (rcar_context_t *)context;
 	rcar_vin_t *vin = &p_soc->vin;
 	
 	/* Physical base address and interrupt number */
-	switch(p_soc->active_dev) {
-		case 0:
-			vin->pbase = RCAR_VIN0_BASE;
-			vin->irq = RCAR_INTCSYS_VIN0;
-			break;
-		case 1:
-			vin->pbase = RCAR_VIN4_BASE;
-			vin->irq = RCAR_INTCSYS_VIN4;
-			break;
-		default:
-			fprintf(stderr, "%s: Not supported capture device\n", __FUNCTION__);
-			return -1;
+	if(p_soc->active_dev > 1 || p_soc->channel >= RCAR_VIN_CHANNELS) {
+		fprintf(stderr, "%s: Not supported capture device\n", __FUNCTION__);
+		return -1;
+	}
+	vin->pbase = RCAR_VIN0_BASE + p_soc->channel * RCAR_VIN_SIZE;
+	vin->irq = rcar_vin_irqs[p_soc->channel];
+	
+	/*
+	 * Pass-through without correction captures straight into the client buffers.
+	 * The buffers and the IMR setting may have changed since the last enable.
+	 */
+	vin->direct = 0;
+	if(!vin->imr && rcar_vin_import_buffers(vin)) {
+		return -1;
 	}
 	
 	/* Map base address */
@@ -532,49 +997,83 @@ int rcar_vin_init(capture_context_t context)
         return (errno);
     }
 	
-	/* Signal */
-	pthread_mutex_init(&vin->mutex, NULL);
-	pthread_condattr_init(&attr);
-    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
-	pthread_cond_init(&vin->cond, &attr);
-	
 	/* Enable HDMI audio */
-	if(p_soc->active_dev == 0) {
+	if(p_soc->channel == 0) {
 		audio_setup(p_soc->screen_idx);
 		audio_start();
 	}
 	
 	/* Enable VIN */
-	rcar_vin_setup(context);
+	if(rcar_vin_setup(context)) {
+		if(p_soc->channel == 0) {
+			audio_stop();
+			audio_deinit();
+		}
+		munmap_device_io(vin->vbase, RCAR_VIN_SIZE);
+		return -1;
+	}
 	
 	return 0;
 }
 
 capture_context_t capture_create_context(uint32_t flags)
 {	
-	ThreadCtl(_NTO_TCTL_IO, 0);
+	pthread_condattr_t attr;
+	rcar_context_t *rcar_context;
 	
-	pthread_mutex_init(&mutex, NULL);
-	pthread_mutex_lock(&mutex);
+	ThreadCtl(_NTO_TCTL_IO, 0);
 	
 	if((rcar_context = calloc(1, sizeof(rcar_context_t))) == NULL) {
 		fprintf(stderr, "%s: calloc failed\n", __FUNCTION__);
-		pthread_mutex_unlock(&mutex);
 		return NULL;
 	}
 	
 	rcar_context->active_dev = 0;
+	rcar_context->channel = 0;
 	rcar_context->is_runing = 0;
 	rcar_context->enable = 0;
+	rcar_context->vin.imr = 1;
+	rcar_context->vin.imr_channel = RCAR_IMRLX4_CHANNEL_ANY;
+	
+	/* Control lock of the context, frame lock and signal of its VIN channel */
+	pthread_mutex_init(&rcar_context->mutex, NULL);
+	pthread_mutex_init(&rcar_context->vin.mutex, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&rcar_context->vin.cond, &attr);
+	pthread_condattr_destroy(&attr);
 
-	pthread_mutex_unlock(&mutex);
 	return rcar_context;
 }
 
+/*
+ * Import the buffers set by CAPTURE_PROPERTY_FRAME_BUFFERS so that the VIN captures
+ * straight into them. They must be physically contiguous, below 4GB and aligned
+ * for the VIN memory base registers; the stride is CAPTURE_PROPERTY_DST_STRIDE or
+ * the destination width when not set.
+ */
 int capture_create_buffers(capture_context_t context, uint32_t property)
 {
-	errno = ENOTSUP;
-	return -1;
+	rcar_context_t *p_soc = (rcar_context_t *)context;
+	int ret;
+	
+	if(property != CAPTURE_PROPERTY_FRAME_BUFFERS) {
+		errno = ENOTSUP;
+		return -1;
+	}
+	
+	pthread_mutex_lock(&p_soc->mutex);
+	
+	if(p_soc->is_runing) {
+		pthread_mutex_unlock(&p_soc->mutex);
+		errno = EBUSY;
+		return -1;
+	}
+	
+	ret = rcar_vin_import_buffers(&p_soc->vin);
+	
+	pthread_mutex_unlock(&p_soc->mutex);
+	return ret;
 }
 
 void capture_destroy_context(capture_context_t context)
@@ -582,50 +1081,56 @@ void capture_destroy_context(capture_context_t context)
 	rcar_context_t *p_soc = (rcar_context_t *)context;
 	
 	if(p_soc) {
-		pthread_mutex_lock(&mutex);
+		pthread_mutex_lock(&p_soc->mutex);
 		SOC_FINI(context);
+		pthread_mutex_unlock(&p_soc->mutex);
+		
+		pthread_cond_destroy(&p_soc->vin.cond);
+		pthread_mutex_destroy(&p_soc->vin.mutex);
+		pthread_mutex_destroy(&p_soc->mutex);
 		free(p_soc);
-		rcar_imrlx4_fini();
-		pthread_mutex_unlock(&mutex);
 	}
-	
-	pthread_mutex_destroy(&mutex);
 }
 
 int capture_update(capture_context_t context, uint32_t flags)
 {
 	rcar_context_t *p_soc = (rcar_context_t *)context;
+	struct timespec now;
 	
-	pthread_mutex_lock(&mutex);
+	pthread_mutex_lock(&p_soc->mutex);
 	
 	if((p_soc->enable) && (!p_soc->is_runing)) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		p_soc->vin.start = timespec2nsec(&now);
+		p_soc->vin.start_to_frame = 0;
 		if(SOC_INIT(context)) {
-			pthread_mutex_unlock(&mutex);
+			pthread_mutex_unlock(&p_soc->mutex);
 			return -1;
 		}
 		p_soc->is_runing = 1;
 	}
 	else if((!p_soc->enable) && (p_soc->is_runing)) {
 		if(SOC_FINI(context)) {
-			pthread_mutex_unlock(&mutex);
+			pthread_mutex_unlock(&p_soc->mutex);
 			return -1;
 		}
 		p_soc->is_runing = 0;
+		pthread_mutex_unlock(&p_soc->mutex);
 		return 0;
 	}
 	
 	if(SOC_UPDATE(context)) {
-		pthread_mutex_unlock(&mutex);
+		pthread_mutex_unlock(&p_soc->mutex);
 		return -1;
 	}
 	
-	pthread_mutex_unlock(&mutex);
+	pthread_mutex_unlock(&p_soc->mutex);
 	return 0;	
 }
 
 int capture_get_frame(capture_context_t context, uint64_t timeout, uint32_t flags)
 {	
-	int ret;
+	int ret, idx;
 	struct timespec from;
 	struct timespec to;
 	uint64_t time_from;
@@ -634,10 +1139,10 @@ int capture_get_frame(capture_context_t context, uint64_t timeout, uint32_t flag
 	rcar_context_t *p_soc = (rcar_context_t *)context;
 	rcar_vin_t *vin = &p_soc->vin;
 	
-	pthread_mutex_lock(&mutex);
+	pthread_mutex_lock(&vin->mutex);
 	
 	if(p_soc->enable == 0) {
-		pthread_mutex_unlock(&mutex);
+		pthread_mutex_unlock(&vin->mutex);
 		errno = ECANCELED;
 		return -1;
 	}
@@ -653,51 +1158,52 @@ int capture_get_frame(capture_context_t context, uint64_t timeout, uint32_t flag
 	}
 	nsec2timespec(&to, time_to);
 		
-	while(1) {
-		ret = pthread_cond_timedwait(&vin->cond, &mutex, &to);
+	while(vin->buf.count == 0) {
+		ret = pthread_cond_timedwait(&vin->cond, &vin->mutex, &to);
 		if (ret == EOK) {
-			break;
+			continue;
 		}	
 		else if(ret == ETIMEDOUT)
 		{
-			pthread_mutex_unlock(&mutex);
+			pthread_mutex_unlock(&vin->mutex);
 			errno = ETIMEDOUT;
 			return -1;
 		}
 		else {
-			pthread_mutex_unlock(&mutex);
+			pthread_mutex_unlock(&vin->mutex);
 			return -1;	
 		}				
 	}
 			
-	if(vin->buf.latest < vin->nbufs) {
-		vin->buf.release = vin->buf.latest;
-		pthread_mutex_unlock(&mutex);
-		return vin->buf.release;
+	/* Skip to the newest frame, the older ones go back to the driver */
+	if(flags & CAPTURE_FLAG_LATEST_FRAME) {
+		while(vin->buf.count > 1) {
+			vin->buf.state[rcar_vin_queue_pop(vin)] = RCAR_VIN_FRAME_FREE;
+		}
 	}
 	
-	pthread_mutex_unlock(&mutex);
-	return 0;
+	/* The client owns the frame until it releases it */
+	idx = rcar_vin_queue_pop(vin);
+	vin->buf.state[idx] = RCAR_VIN_FRAME_CLIENT;
+	if(vin->frm_stamps)
+		vin->frm_stamps[idx] = vin->buf.stamp[idx];
+	
+	pthread_mutex_unlock(&vin->mutex);
+	return idx;
 }
 
 int capture_release_frame(capture_context_t context, uint32_t idx)
 {	
 	rcar_context_t *p_soc = (rcar_context_t *)context;
-	rcar_vin_t *vin = &p_soc->vin;
-	
-	if(idx > vin->nbufs) {
-		errno = EINVAL;
-		return -1;
-	}
 	
-	vin->buf.done[idx] = 1;
-
-	return 0;
+	return rcar_vin_queue_put(&p_soc->vin, idx);
 }
 
 int capture_put_buffer(capture_context_t ctx, uint32_t idx, uint32_t flags)
 {
-	return 0;
+	rcar_context_t *p_soc = (rcar_context_t *)ctx;
+	
+	return rcar_vin_queue_put(&p_soc->vin, idx);
 }
 
 int capture_is_property(capture_context_t context, uint32_t prop)
@@ -723,6 +1229,15 @@ int capture_is_property(capture_context_t context, uint32_t prop)
 		case CAPTURE_PROPERTY_FRAME_TIMESTAMP:
 		case CAPTURE_PROPERTY_FRAME_NBUFFERS:
 		case CAPTURE_PROPERTY_FRAME_BUFFERS:
+		case RCAR_VIN_PROPERTY_FRAMES_DROPPED:
+		case RCAR_VIN_PROPERTY_FRAMES_OVERWRITTEN:
+		case RCAR_VIN_PROPERTY_STATS:
+		case RCAR_VIN_PROPERTY_IMR:
+		case RCAR_VIN_PROPERTY_IMR_DROPPED:
+		case RCAR_VIN_PROPERTY_BOOT_TO_FRAME:
+		case RCAR_VIN_PROPERTY_START_TO_FRAME:
+		case RCAR_VIN_PROPERTY_IMR_CHANNEL:
+		case RCAR_VIN_PROPERTY_IMR_STATS:
 		{
 			return 1;
 		}
@@ -742,6 +1257,27 @@ int capture_get_property_i(capture_context_t context, uint32_t prop, int32_t *va
 		case CAPTURE_ENABLE:
 			*value = p_soc->enable;
 			break;
+		case RCAR_VIN_PROPERTY_FRAMES_DROPPED:
+			*value = p_soc->vin.buf.dropped;
+			break;
+		case RCAR_VIN_PROPERTY_FRAMES_OVERWRITTEN:
+			*value = p_soc->vin.buf.overwritten;
+			break;
+		case RCAR_VIN_PROPERTY_IMR:
+			*value = p_soc->vin.imr;
+			break;
+		case RCAR_VIN_PROPERTY_IMR_DROPPED:
+			*value = p_soc->vin.buf.imr_dropped;
+			break;
+		case RCAR_VIN_PROPERTY_BOOT_TO_FRAME:
+			*value = p_soc->vin.first_frame / 1000000;
+			break;
+		case RCAR_VIN_PROPERTY_START_TO_FRAME:
+			*value = p_soc->vin.start_to_frame / 1000000;
+			break;
+		case RCAR_VIN_PROPERTY_IMR_CHANNEL:
+			*value = p_soc->vin.imr_channel;
+			break;
 		default:
 			errno = ENOTSUP;
 			return -1;
@@ -751,11 +1287,33 @@ int capture_get_property_i(capture_context_t context, uint32_t prop, int32_t *va
 
 int capture_get_property_p(capture_context_t context, uint32_t prop, void **value)
 {
+	rcar_context_t *p_soc = (rcar_context_t *)context;
+	rcar_vin_t *vin = &p_soc->vin;
+	int i;
+	
 	switch(prop)
 	{
 		case CAPTURE_PROPERTY_DEVICE_INFO:
 			strcpy((char*)(value), SOC_INFO);
 			break;
+		case RCAR_VIN_PROPERTY_STATS:
+			if(*value == NULL) {
+				errno = EINVAL;
+				return -1;
+			}
+			pthread_mutex_lock(&vin->mutex);
+			memcpy(*value, &vin->stats, sizeof(rcar_vin_stats_t));
+			pthread_mutex_unlock(&vin->mutex);
+			break;
+		case RCAR_VIN_PROPERTY_IMR_STATS:
+			if(*value == NULL) {
+				errno = EINVAL;
+				return -1;
+			}
+			for(i = 0; i < RCAR_IMRLX4_CHANNELS; i++) {
+				rcar_imrlx4_get_stats(i, (rcar_imr_stats_t *)*value + i);
+			}
+			break;
 		default:
 			errno = ENOTSUP;
 			return -1;
@@ -772,14 +1330,18 @@ int capture_set_property_i(capture_context_t context, uint32_t prop, int32_t val
 	switch(prop)
 	{
 		case CAPTURE_PROPERTY_DEVICE:
+			/* bits 8-9 select the VIN within the group of the CSI-2 receiver */
 			p_soc->active_dev = value & 0xF;
 			p_soc->screen_idx = (value & 0xF0) >> 4;
+			p_soc->channel = (p_soc->active_dev ? RCAR_VIN_GROUP_CHANNELS : 0) +
+							 ((value >> 8) & (RCAR_VIN_GROUP_CHANNELS - 1));
 			break;
 		case CAPTURE_ENABLE:
 			/* CSI2 init */
 			if(value == 2) {
 				rcar_csi2_t *csi = &p_soc->csi;
 				csi->info = (csi2_info_t*)cam;
+				csi->user = p_soc->channel;
 				rcar_csi2_init(p_soc->active_dev, csi);
 			}
 			else {
@@ -827,6 +1389,18 @@ int capture_set_property_i(capture_context_t context, uint32_t prop, int32_t val
 			break;
 		case CAPTURE_PROPERTY_FRAME_NBUFFERS:
 			vin->frm_nbufs = value;
+			vin->direct = 0;
+			break;
+		case RCAR_VIN_PROPERTY_IMR:
+			vin->imr = value ? 1 : 0;
+			break;
+		case RCAR_VIN_PROPERTY_IMR_CHANNEL:
+			/* Applies from the next enable */
+			if(value != RCAR_IMRLX4_CHANNEL_ANY && (value < 0 || value >= RCAR_IMRLX4_CHANNELS)) {
+				errno = EINVAL;
+				return -1;
+			}
+			vin->imr_channel = value;
 			break;
 		default:
 			errno = ENOTSUP;
@@ -847,10 +1421,13 @@ int capture_set_property_p(capture_context_t context, uint32_t prop, void *value
 			strcpy(cam->sfmt, (char*)value);
 			break;
 		case CAPTURE_PROPERTY_FRAME_BUFFERS:
+			/* New buffers have to be imported again by capture_create_buffers */
 			vin->frm_bufs = (void**)value;
+			vin->direct = 0;
 			break;
 		case CAPTURE_PROPERTY_FRAME_TIMESTAMP:
-			/* Not implemented yet */
+			/* Filled with the frame end time of a buffer when it is delivered */
+			vin->frm_stamps = (uint64_t *)value;
 			break;
 		case CAPTURE_PROPERTY_FRAME_FLAGS:
 			/* Not implemented yet */
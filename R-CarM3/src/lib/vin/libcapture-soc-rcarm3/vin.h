@@ -41,9 +41,38 @@
 #define RCAR_VIN_MAX_WIDTH				4096
 #define RCAR_VIN_MAX_HEIGHT				4096
 #define RCAR_VIN_MAX_BUFFER 			3
+#define RCAR_VIN_MAX_FRAMES 			16
+#define RCAR_VIN_MB_ALIGN 				128
+#define RCAR_VIN_CHANNELS 				8
+#define RCAR_VIN_GROUP_CHANNELS 		4
+
+#ifndef RCAR_INTCSYS_VIN7
+#define RCAR_INTCSYS_VIN7				(171 + 32)
+#endif
 #define RCAR_VIN_PULSE 					55
 #define RCAR_VIN_END 					56
 #define RCAR_VIN_IMR_PULSE 				57
+#define RCAR_VIN_IMR_KICK 				58
+#define RCAR_VIN_IMR_QUEUE 				(RCAR_VIN_MAX_BUFFER - 1)	/* captured frames waiting for or in the IMR */
+#define RCAR_VIN_IMR_BUFFER 			(RCAR_VIN_MAX_BUFFER + RCAR_VIN_IMR_QUEUE)	/* IMR sources, slots plus queue */
+
+/* Driver specific properties, frames lost because no client buffer was available */
+#define RCAR_VIN_PROPERTY_FRAMES_DROPPED		CAPTURE_PROPERTY('R', 'V', 'D', 'R')
+#define RCAR_VIN_PROPERTY_FRAMES_OVERWRITTEN	CAPTURE_PROPERTY('R', 'V', 'O', 'W')
+/* Distortion correction by the IMR, 0 captures straight into the client buffers */
+#define RCAR_VIN_PROPERTY_IMR				CAPTURE_PROPERTY('R', 'V', 'I', 'M')
+#define RCAR_VIN_PROPERTY_IMR_DROPPED		CAPTURE_PROPERTY('R', 'V', 'I', 'D')
+/* IMR channel of the context, RCAR_IMRLX4_CHANNEL_ANY (default) renders on any idle one */
+#define RCAR_VIN_PROPERTY_IMR_CHANNEL		CAPTURE_PROPERTY('R', 'V', 'I', 'C')
+/* IMR utilisation, rcar_imr_stats_t[RCAR_IMRLX4_CHANNELS] copied to the buffer passed */
+#define RCAR_VIN_PROPERTY_IMR_STATS			CAPTURE_PROPERTY('R', 'V', 'I', 'S')
+/* Latency histograms, rcar_vin_stats_t copied to the buffer passed to capture_get_property_p */
+#define RCAR_VIN_PROPERTY_STATS				CAPTURE_PROPERTY('R', 'V', 'S', 'T')
+/* Time to the first frame in ms, since boot for the context and since the last enable */
+#define RCAR_VIN_PROPERTY_BOOT_TO_FRAME		CAPTURE_PROPERTY('R', 'V', 'B', 'F')
+#define RCAR_VIN_PROPERTY_START_TO_FRAME	CAPTURE_PROPERTY('R', 'V', 'S', 'F')
+
+#define RCAR_VIN_HIST_BINS				20	/* bin n counts [2^(n-1), 2^n) us, the last one all above */
 
 /* Video n Main Control Register */
 #define RCAR_VIN_MC_DPINE				(1 << 27)
@@ -125,13 +154,49 @@ typedef struct _cam_info {
 	uint32_t update;
 } cam_info_t;
 
+/* Ownership of a client frame buffer */
+typedef enum {
+	RCAR_VIN_FRAME_FREE,			/* owned by the driver, can receive a frame */
+	RCAR_VIN_FRAME_BUSY,			/* being written by the IMR */
+	RCAR_VIN_FRAME_READY,			/* holds a completed frame not delivered yet */
+	RCAR_VIN_FRAME_CLIENT			/* delivered, owned by the client until released */
+} rcar_vin_frame_state_t;
+
+typedef struct _rcar_vin_hist {
+	uint32_t bins[RCAR_VIN_HIST_BINS];
+	uint32_t max;							/* us */
+} rcar_vin_hist_t;
+
+typedef struct _rcar_vin_stats {
+	uint32_t frames;
+	rcar_vin_hist_t irq_wakeup;				/* frame end interrupt to the event thread */
+	rcar_vin_hist_t wakeup_release;			/* event thread to the release of the frame by the client */
+	rcar_vin_hist_t interval_jitter;		/* change of the frame interval between two frames */
+} rcar_vin_stats_t;
+
 typedef struct _cam_buf {
-	paddr_t	addr[RCAR_VIN_MAX_BUFFER];
-	int done[RCAR_VIN_MAX_BUFFER];
-	int latest;
-	int release;
+	paddr_t	addr[RCAR_VIN_IMR_BUFFER];		/* IMR sources, captured by the VIN and copied to the client buffers */
+	paddr_t	phys[RCAR_VIN_IMR_BUFFER];
+	uint32_t size;							/* of each IMR source, 0 when they are not mapped */
+	int state[RCAR_VIN_MAX_FRAMES];
+	int ready[RCAR_VIN_MAX_FRAMES];			/* completed frames in capture order */
+	int head;
+	int count;
+	int busy;								/* client buffer written by the IMR, -1 if none */
+	uint64_t stamp[RCAR_VIN_MAX_FRAMES];	/* CLOCK_MONOTONIC ns of the frame end interrupt */
+	uint64_t wake[RCAR_VIN_MAX_FRAMES];		/* ClockCycles() when the event thread handled it */
+	unsigned dropped;						/* frames not captured, every client buffer was held */
+	unsigned overwritten;					/* completed frames replaced before their delivery */
+	unsigned imr_dropped;					/* frames not corrected, the IMR queue was full or IMR init failed */
 } cam_buf_t;
 
+/* IMR source waiting for the IMR, out of the VIN slots until it is corrected */
+typedef struct _imr_frame {
+	int src;
+	uint64_t stamp;
+	uint64_t wake;
+} imr_frame_t;
+
 typedef struct _rcar_vin {
 	int iid;	
 	int tid;
@@ -147,6 +212,31 @@ typedef struct _rcar_vin {
 	void **frm_bufs;
 	int frm_nbufs;
 	int nbufs;
+	int direct;								/* the VIN writes the client buffers, no IMR copy */
+	paddr_t frm_paddr[RCAR_VIN_MAX_FRAMES];	/* client buffers imported by capture_create_buffers */
+	int slot_frm[RCAR_VIN_MAX_BUFFER];		/* client buffer programmed in each VIN slot */
+	int slot_src[RCAR_VIN_MAX_BUFFER];		/* IMR source programmed in each VIN slot */
+	uint32_t bpp;
+	uint64_t *frm_stamps;					/* client array set by CAPTURE_PROPERTY_FRAME_TIMESTAMP */
+	volatile uint64_t irq_cycles;			/* ClockCycles() in the interrupt handler */
+	uint64_t irq_stamp;						/* CLOCK_MONOTONIC ns of the last frame end */
+	uint64_t irq_wake;						/* ClockCycles() when the event thread handled it */
+	uint64_t last_interval;					/* ns between the last two frame ends */
+	uint64_t first_frame;					/* CLOCK_MONOTONIC ns of the first frame end, 0 until then */
+	uint64_t start;							/* CLOCK_MONOTONIC ns of the last enable */
+	uint64_t start_to_frame;				/* ns from the last enable to its first frame end */
+	rcar_vin_stats_t stats;
+	int imr;								/* distortion correction enabled */
+	int imr_channel;						/* IMR channel or RCAR_IMRLX4_CHANNEL_ANY */
+	rcar_imr_t *imr_ctx;					/* IMR library instance, NULL when not correcting */
+	int imr_registered;						/* slots and client buffers registered with imr_ctx */
+	pthread_t imr_tid;						/* IMR worker, 0 if not running */
+	int imr_chid;
+	int imr_coid;
+	imr_frame_t imr_queue[RCAR_VIN_IMR_QUEUE];	/* captured sources, the first one is being corrected */
+	int imr_head;
+	int imr_count;
+	int imr_running;
 	cam_buf_t buf;
 	cam_info_t cam;
 	uintptr_t pbase;
@@ -154,14 +244,14 @@ typedef struct _rcar_vin {
 } rcar_vin_t;
 
 typedef struct  _capture_context {
+	pthread_mutex_t mutex;			/* serialises the control of the context */
 	int enable;
 	int is_runing;
 	int active_dev;
+	int channel;					/* VIN index, VIN0-3 take CSI40 and VIN4-7 CSI20 */
 	int screen_idx;
 	rcar_vin_t vin;
 	rcar_csi2_t csi;
 } rcar_context_t;
 
-rcar_context_t* rcar_context;
-
 #endif // __VIN_H__
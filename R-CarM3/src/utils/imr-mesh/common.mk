@@ -0,0 +1,34 @@
+ifndef QCONFIG
+QCONFIG=qconfig.mk
+endif
+include $(QCONFIG)
+
+include $(MKFILES_ROOT)/qmacros.mk
+
+define PINFO
+PINFO DESCRIPTION=IMR-LX4 mesh compiler for R-CarM3
+endef
+
+#####AUTO-GENERATED by packaging script... do not checkin#####
+   INSTALL_ROOT_nto = $(PROJECT_ROOT)/../../../install
+   USE_INSTALL_ROOT=1
+##############################################################
+
+NAME := imr-mesh
+USEFILE = $(PROJECT_ROOT)/Usemsg
+INSTALLDIR = usr/bin
+
+# The config parser and the display list builder come from the static IMR library,
+# the host build compiles them directly as the library is only built for QNX
+ifeq ($(OS),linux)
+EXTRA_SRCVPATH += $(PRODUCT_ROOT)/../lib/imr/rcar
+SRCS = imr-mesh.c config.c mesh.c
+else
+LIBS = rcar-imr
+endif
+
+include $(MKFILES_ROOT)/qtargets.mk
+
+EXTRA_INCVPATH += $(PRODUCT_ROOT)/../lib/imr/public/hw
+EXTRA_INCVPATH += $(PRODUCT_ROOT)/../hardware/startup/lib/public
+EXTRA_LIBVPATH += $(PRODUCT_ROOT)/../lib/imr/rcar/aarch64/a.le
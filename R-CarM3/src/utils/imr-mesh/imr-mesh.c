@@ -0,0 +1,137 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2014, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <imrlx4.h>
+
+typedef struct
+{
+	const char	*config;
+	const char	*output;
+	uint32_t	width;
+	uint32_t	height;
+	int			verbose;
+} mesh_info;
+
+static int parse_commandline(mesh_info *info, int argc, char *argv[])
+{
+	char *value;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		value = strchr(argv[i], '=');
+		if (value) {
+			*value++ = 0;
+		}
+		if (!strcmp(argv[i], "-v")) {
+			info->verbose = 1;
+		} else if (value && !strcmp(argv[i], "width")) {
+			info->width = strtoul(value, NULL, 0);
+		} else if (value && !strcmp(argv[i], "height")) {
+			info->height = strtoul(value, NULL, 0);
+		} else if (value && !strcmp(argv[i], "config")) {
+			info->config = value;
+		} else if (value && !strcmp(argv[i], "output")) {
+			info->output = value;
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if (!info->width || !info->height) {
+		fprintf(stderr, "width and height of the source are required\n");
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	mesh_info info = {
+		.config = "/etc/imrlx4.conf",
+		.output = "imrlx4.mesh",
+	};
+	imrlx4_mesh_hdr_t hdr;
+	rcar_imr_t imr;
+	uint32_t *dl;
+	FILE *fp;
+
+	if (parse_commandline(&info, argc, argv)) {
+		return EXIT_FAILURE;
+	}
+
+	memset(&imr, 0, sizeof(imr));
+	imr.img.dw = info.width;
+	imr.img.dh = info.height;
+	imr.img_conf.strip = 1;
+
+	if (get_config_data(&imr, info.config) || !imr.img_conf.squareW || !imr.img_conf.squareH) {
+		fprintf(stderr, "\n%s: no valid setup for %ux%u\n", info.config, info.width, info.height);
+		return EXIT_FAILURE;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = RCAR_IMRLX4_MESH_MAGIC;
+	hdr.version = RCAR_IMRLX4_MESH_VERSION;
+	hdr.width = info.width;
+	hdr.height = info.height;
+	hdr.squareW = imr.img_conf.squareW;
+	hdr.squareH = imr.img_conf.squareH;
+	hdr.Y = imr.img_conf.Y;
+	hdr.U = imr.img_conf.U;
+	hdr.V = imr.img_conf.V;
+
+	rcar_imrlx4_mesh_layout(&imr.img, &imr.img_conf);
+
+	if ((dl = calloc(1, rcar_imrlx4_DL_size(&imr.img, &imr.img_conf))) == NULL) {
+		fprintf(stderr, "calloc failed\n");
+		return EXIT_FAILURE;
+	}
+	hdr.dl_size = rcar_imrlx4_DL_build(&imr.img, &imr.img_conf, dl);
+	hdr.checksum = rcar_imrlx4_mesh_checksum(&hdr, dl);
+
+	if ((fp = fopen(info.output, "wb")) == NULL) {
+		fprintf(stderr, "%s: %s\n", info.output, strerror(errno));
+		free(dl);
+		return EXIT_FAILURE;
+	}
+	if ((fwrite(&hdr, sizeof(hdr), 1, fp) != 1) || (fwrite(dl, hdr.dl_size, 1, fp) != 1)) {
+		fprintf(stderr, "%s: write failed\n", info.output);
+		fclose(fp);
+		remove(info.output);
+		free(dl);
+		return EXIT_FAILURE;
+	}
+	fclose(fp);
+	free(dl);
+
+	if (info.verbose) {
+		printf("%s: %ux%u, square %ux%u, %s mesh, %u vertexes, %u DL bytes per frame, checksum 0x%08x\n",
+				info.output, hdr.width, hdr.height, hdr.squareW, hdr.squareH,
+				imr.img_conf.strip ? "strip" : "list", rcar_imrlx4_DL_vertices(&imr.img, &imr.img_conf),
+				hdr.dl_size, hdr.checksum);
+	}
+	return EXIT_SUCCESS;
+}
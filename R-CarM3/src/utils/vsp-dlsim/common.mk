@@ -0,0 +1,39 @@
+ifndef QCONFIG
+QCONFIG=qconfig.mk
+endif
+include $(QCONFIG)
+
+include $(MKFILES_ROOT)/qmacros.mk
+
+define PINFO
+PINFO DESCRIPTION=VSP display list simulator for R-CarM3
+endef
+
+#####AUTO-GENERATED by packaging script... do not checkin#####
+   INSTALL_ROOT_nto = $(PROJECT_ROOT)/../../../install
+   USE_INSTALL_ROOT=1
+##############################################################
+
+NAME := vsp-dlsim
+USEFILE = $(PROJECT_ROOT)/Usemsg
+INSTALLDIR = usr/bin
+
+# Host only: the display list generation of the WFD driver is compiled against
+# the QNX stubs in host/ and the VSP register model in host.c instead of the hardware
+EXTRA_SRCVPATH += $(PRODUCT_ROOT)/../hardware/wfd/rcar
+SRCS = vsp-dlsim.c host.c vsp_dl.c vspd.c vspi.c vsp_cmn.c
+
+# the driver headers expect the QNX types, its ISR helpers are plain inline
+CCFLAGS += -D__QNXNTO__ -D_GNU_SOURCE -fgnu89-inline
+
+include $(MKFILES_ROOT)/qtargets.mk
+
+EXTRA_INCVPATH += $(PROJECT_ROOT)/host
+EXTRA_INCVPATH += $(PRODUCT_ROOT)/../hardware/wfd/rcar
+EXTRA_INCVPATH += $(PRODUCT_ROOT)/../hardware/wfd/common
+EXTRA_INCVPATH += $(PRODUCT_ROOT)/../lib/wfdcfg/public
+EXTRA_INCVPATH += $(PRODUCT_ROOT)/../hardware/startup/lib/public
+
+# run the default sweep, fails on any list the model or the checker rejects
+check: $(BUILDNAME)
+	./$(BUILDNAME)
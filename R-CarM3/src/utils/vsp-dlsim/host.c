@@ -0,0 +1,282 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2016, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * The QNX kernel and libc calls of the VSP driver, for running it on a build
+ * host. Device memory is plain heap memory, so the VSP registers are a model
+ * the simulator reads and writes. Everything runs on one thread: interrupt
+ * handlers are called by the simulator between driver calls, and a receive
+ * that would block lets the simulator run the hardware instead.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syspage.h>
+#include <sys/slog.h>
+#include <hw/inout.h>
+
+#include "host.h"
+
+#define HOST_CHANNEL_NUM	8
+#define HOST_PULSE_NUM		8
+#define HOST_INTR_NUM		8
+/* fake physical address of the first typed memory mapping */
+#define HOST_PADDR_BASE		0x40000000
+#define HOST_PADDR_ALIGN	0x00100000
+
+typedef struct {
+	int			used;
+	int			code[HOST_PULSE_NUM];
+	unsigned	head;
+	unsigned	tail;
+} host_channel_t;
+
+typedef struct {
+	const struct sigevent *(*handler)(void *, int);
+	void		*area;
+} host_intr_t;
+
+int host_verbose;
+void (*host_idle)(int chid);
+struct qtime_entry _host_qtime = { 1000000000ULL };
+
+static host_channel_t channel[HOST_CHANNEL_NUM];
+static host_intr_t intr[HOST_INTR_NUM];
+static uint64_t next_paddr = HOST_PADDR_BASE;
+
+int ThreadCtl(int cmd, void *data)
+{
+	return 0;
+}
+
+/* the handlers never run concurrently with the driver */
+void InterruptLock(intrspin_t *spin)
+{
+}
+
+void InterruptUnlock(intrspin_t *spin)
+{
+}
+
+int InterruptAttach(int irq, const struct sigevent *(*handler)(void *, int),
+	const void *area, int size, unsigned flags)
+{
+	int id;
+
+	for (id = 0; id < HOST_INTR_NUM; id++) {
+		if (!intr[id].handler) {
+			intr[id].handler = handler;
+			intr[id].area = (void *)area;
+			return id;
+		}
+	}
+	errno = EAGAIN;
+	return -1;
+}
+
+int InterruptDetach(int id)
+{
+	if ((id < 0) || (id >= HOST_INTR_NUM)) {
+		errno = EINVAL;
+		return -1;
+	}
+	intr[id].handler = NULL;
+	return 0;
+}
+
+void host_interrupt(int id)
+{
+	if ((id >= 0) && (id < HOST_INTR_NUM) && intr[id].handler) {
+		host_deliver(intr[id].handler(intr[id].area, id));
+	}
+}
+
+int ChannelCreate(unsigned flags)
+{
+	int chid;
+
+	/* 0 is never a channel, a zeroed sigevent delivers nothing */
+	for (chid = 1; chid < HOST_CHANNEL_NUM; chid++) {
+		if (!channel[chid].used) {
+			memset(&channel[chid], 0, sizeof(channel[chid]));
+			channel[chid].used = 1;
+			return chid;
+		}
+	}
+	errno = EAGAIN;
+	return -1;
+}
+
+int ChannelDestroy(int chid)
+{
+	if ((chid <= 0) || (chid >= HOST_CHANNEL_NUM) || !channel[chid].used) {
+		errno = EINVAL;
+		return -1;
+	}
+	channel[chid].used = 0;
+	return 0;
+}
+
+/* a connection is the channel it was attached to */
+int ConnectAttach(uint32_t nd, pid_t pid, int chid, unsigned index, int flags)
+{
+	if ((chid <= 0) || (chid >= HOST_CHANNEL_NUM) || !channel[chid].used) {
+		errno = EINVAL;
+		return -1;
+	}
+	return chid;
+}
+
+int ConnectDetach(int coid)
+{
+	return 0;
+}
+
+void host_deliver(const struct sigevent *event)
+{
+	host_channel_t *ch;
+
+	if (!event || (event->sigev_signo <= 0) || (event->sigev_signo >= HOST_CHANNEL_NUM)) {
+		return;
+	}
+	ch = &channel[event->sigev_signo];
+	/* a full queue drops the pulse, like a pulse the kernel cannot allocate */
+	if (ch->used && (ch->tail - ch->head < HOST_PULSE_NUM)) {
+		ch->code[ch->tail++ % HOST_PULSE_NUM] = event->sigev_value.sival_int;
+	}
+}
+
+static int host_receive(int chid, struct _pulse *pulse)
+{
+	host_channel_t *ch;
+
+	if ((chid <= 0) || (chid >= HOST_CHANNEL_NUM) || !channel[chid].used) {
+		errno = EINVAL;
+		return -1;
+	}
+	ch = &channel[chid];
+	if ((ch->head == ch->tail) && host_idle) {
+		host_idle(chid);
+	}
+	if (ch->head == ch->tail) {
+		errno = ETIMEDOUT;
+		return -1;
+	}
+	memset(pulse, 0, sizeof(*pulse));
+	pulse->code = ch->code[ch->head++ % HOST_PULSE_NUM];
+	return 0;
+}
+
+int MsgReceivePulse(int chid, void *pulse, int bytes, void *info)
+{
+	struct _pulse p;
+	int ret;
+
+	ret = host_receive(chid, &p);
+	if (ret == 0) {
+		memcpy(pulse, &p, (bytes < (int)sizeof(p)) ? bytes : (int)sizeof(p));
+	}
+	return ret;
+}
+
+int MsgReceivev(int chid, const iov_t *riov, int rparts, void *info)
+{
+	struct _pulse p;
+	int ret;
+
+	ret = host_receive(chid, &p);
+	if ((ret == 0) && (rparts > 0)) {
+		memcpy(riov[0].iov_base, &p, (riov[0].iov_len < sizeof(p)) ? riov[0].iov_len : sizeof(p));
+	}
+	return ret;
+}
+
+/* a receive never blocks, so there is nothing to time out */
+int TimerTimeout(clockid_t id, int flags, const struct sigevent *notify,
+	const uint64_t *ntime, uint64_t *otime)
+{
+	return 0;
+}
+
+uint64_t ClockCycles(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* the model reaches any state at once */
+unsigned delay(unsigned msec)
+{
+	return 0;
+}
+
+int slogf(int opcode, int severity, const char *fmt, ...)
+{
+	va_list ap;
+
+	if ((severity > _SLOG_WARNING) && !host_verbose) {
+		return 0;
+	}
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+	return 0;
+}
+
+/* shared anonymous memory stands in for the typed memory pool */
+int posix_typed_mem_open(const char *name, int oflag, int tflag)
+{
+	return open("/dev/zero", oflag);
+}
+
+/* each mapping gets its own 32-bit physical range, the DL loader only sees those */
+int mem_offset64(const void *addr, int fd, size_t len, off64_t *offset, size_t *contig_len)
+{
+	*offset = next_paddr;
+	next_paddr += (len + HOST_PADDR_ALIGN - 1) & ~(uint64_t)(HOST_PADDR_ALIGN - 1);
+	if (contig_len) {
+		*contig_len = len;
+	}
+	return 0;
+}
+
+/* register blocks are zeroed heap memory, the simulator models their behaviour */
+uintptr_t mmap_device_io(size_t len, uint64_t io)
+{
+	void *ptr = calloc(1, len);
+
+	return ptr ? (uintptr_t)ptr : (uintptr_t)MAP_FAILED;
+}
+
+int munmap_device_io(uintptr_t io, size_t len)
+{
+	free((void *)io);
+	return 0;
+}
@@ -0,0 +1,42 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2016, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#ifndef _HOST_H_
+#define _HOST_H_
+#include <sys/neutrino.h>
+
+/* print the driver's informational slog messages too, errors always are */
+extern int host_verbose;
+
+/*
+ * Called when a receive on chid finds no pulse queued, in place of blocking.
+ * The model runs the hardware the caller waits for and raises its interrupt,
+ * a receive that still finds nothing times out.
+ */
+extern void (*host_idle)(int chid);
+
+/* run the handler attached with InterruptAttach() and deliver its event */
+extern void host_interrupt(int id);
+
+/* queue the pulse of an event set up with SIGEV_PULSE_INIT(), NULL is ignored */
+extern void host_deliver(const struct sigevent *event);
+
+#endif
@@ -0,0 +1,23 @@
+/* Host stand-in for the Khronos <KHR/khrplatform.h>, what WF/wfd.h uses */
+#ifndef __khrplatform_h_
+#define __khrplatform_h_
+#include <stdint.h>
+
+#define KHRONOS_APICALL
+#define KHRONOS_APIENTRY
+#define KHRONOS_APIATTRIBUTES
+
+typedef int32_t		khronos_int32_t;
+typedef uint32_t	khronos_uint32_t;
+typedef uint64_t	khronos_uint64_t;
+typedef uint8_t		khronos_uint8_t;
+typedef float		khronos_float_t;
+typedef uint64_t	khronos_utime_nanoseconds_t;
+
+typedef enum {
+	KHRONOS_FALSE = 0,
+	KHRONOS_TRUE = 1,
+	KHRONOS_BOOLEAN_ENUM_FORCE_SIZE = 0x7FFFFFFF
+} khronos_boolean_enum_t;
+
+#endif
@@ -0,0 +1 @@
+/* Host stand-in for the QNX <_pack64.h>, nothing the VSP driver uses */
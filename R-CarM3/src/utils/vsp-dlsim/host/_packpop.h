@@ -0,0 +1 @@
+/* Host stand-in for the QNX <_packpop.h>, nothing the VSP driver uses */
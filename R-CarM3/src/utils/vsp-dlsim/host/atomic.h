@@ -0,0 +1 @@
+/* Host stand-in for the QNX <atomic.h>, nothing the VSP driver uses */
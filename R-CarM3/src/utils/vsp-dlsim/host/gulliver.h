@@ -0,0 +1 @@
+/* Host stand-in for the QNX <gulliver.h>, nothing the VSP driver uses */
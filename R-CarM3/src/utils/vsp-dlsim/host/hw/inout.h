@@ -0,0 +1,13 @@
+/* Host stand-in for the QNX <hw/inout.h>, device memory comes from the heap */
+#ifndef _HW_INOUT_INCLUDED
+#define _HW_INOUT_INCLUDED
+#include <stdint.h>
+#include <stddef.h>
+
+static inline uint32_t in32(uintptr_t port) { return *(volatile uint32_t *)port; }
+static inline void out32(uintptr_t port, uint32_t val) { *(volatile uint32_t *)port = val; }
+
+extern uintptr_t mmap_device_io(size_t len, uint64_t io);
+extern int munmap_device_io(uintptr_t io, size_t len);
+
+#endif
@@ -0,0 +1 @@
+/* Host stand-in for the QNX <hw/pci.h>, nothing the VSP driver uses */
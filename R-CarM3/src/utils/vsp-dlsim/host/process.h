@@ -0,0 +1,2 @@
+/* Host stand-in for the QNX <process.h> */
+#include <sys/platform.h>
@@ -0,0 +1,14 @@
+/* Host stand-in for the QNX <sys/mman.h> extensions, on top of the host one */
+#ifndef __HOST_MMAN_H_INCLUDED
+#define __HOST_MMAN_H_INCLUDED
+#include_next <sys/mman.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define PROT_NOCACHE						0
+#define POSIX_TYPED_MEM_ALLOCATE_CONTIG		0x02
+
+extern int posix_typed_mem_open(const char *name, int oflag, int tflag);
+extern int mem_offset64(const void *addr, int fd, size_t len, off64_t *offset, size_t *contig_len);
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * Host stand-in for the QNX <sys/neutrino.h>, only what the VSP driver uses.
+ * The kernel calls are implemented in host.c, pulses go through the queues
+ * there and interrupts are raised by the simulator.
+ */
+#ifndef __NEUTRINO_H_INCLUDED
+#define __NEUTRINO_H_INCLUDED
+#include <sys/platform.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <signal.h>
+#include <time.h>
+
+typedef struct intrspin {
+	volatile unsigned	value;
+} intrspin_t;
+
+struct _pulse {
+	uint16_t		type;
+	uint16_t		subtype;
+	int8_t			code;
+	uint8_t			zero[3];
+	union sigval	value;
+	int32_t			scoid;
+};
+
+typedef struct {
+	uint16_t		type;
+	uint16_t		combine_len;
+	uint16_t		mgrid;
+	uint16_t		subtype;
+} io_msg_t;
+
+typedef struct iovec iov_t;
+#define SETIOV(_iov, _addr, _len) \
+	((_iov)->iov_base = (void *)(_addr), (_iov)->iov_len = (_len))
+
+#define _NTO_TCTL_IO				14
+#define _NTO_SIDE_CHANNEL			0x40000000
+#define _NTO_TIMEOUT_RECEIVE		(1 << 2)
+#define SIGEV_PULSE_PRIO_INHERIT	(-1)
+#define NOFD						(-1)
+
+/* never delivered by the host kernel, host_deliver() queues the pulse */
+#define SIGEV_PULSE_INIT(__e, __coid, __prio, __code, __value) \
+	((__e)->sigev_notify = SIGEV_NONE, \
+	(__e)->sigev_signo = (__coid), \
+	(__e)->sigev_value.sival_int = (__code))
+
+/* the host is coherent, keep the ordering the barrier gives on the target */
+#define dsb()	__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+extern int ThreadCtl(int cmd, void *data);
+extern void InterruptLock(intrspin_t *spin);
+extern void InterruptUnlock(intrspin_t *spin);
+extern int InterruptAttach(int intr, const struct sigevent *(*handler)(void *, int),
+	const void *area, int size, unsigned flags);
+extern int InterruptDetach(int id);
+extern int ChannelCreate(unsigned flags);
+extern int ChannelDestroy(int chid);
+extern int ConnectAttach(uint32_t nd, pid_t pid, int chid, unsigned index, int flags);
+extern int ConnectDetach(int coid);
+extern int MsgReceivePulse(int chid, void *pulse, int bytes, void *info);
+extern int MsgReceivev(int chid, const iov_t *riov, int rparts, void *info);
+extern int TimerTimeout(clockid_t id, int flags, const struct sigevent *notify,
+	const uint64_t *ntime, uint64_t *otime);
+extern uint64_t ClockCycles(void);
+extern unsigned delay(unsigned msec);
+
+#endif
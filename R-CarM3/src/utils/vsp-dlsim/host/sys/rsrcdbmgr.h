@@ -0,0 +1 @@
+/* Host stand-in for the QNX <sys/rsrcdbmgr.h>, nothing the VSP driver uses */
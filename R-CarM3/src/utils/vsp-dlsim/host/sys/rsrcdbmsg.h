@@ -0,0 +1 @@
+/* Host stand-in for the QNX <sys/rsrcdbmsg.h>, nothing the VSP driver uses */
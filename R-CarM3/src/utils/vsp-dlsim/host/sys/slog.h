@@ -0,0 +1,17 @@
+/* Host stand-in for the QNX <sys/slog.h>, slogf() prints to stderr */
+#ifndef __SLOG_H_INCLUDED
+#define __SLOG_H_INCLUDED
+#include <sys/slogcodes.h>
+
+#define _SLOG_SHUTDOWN	0
+#define _SLOG_CRITICAL	1
+#define _SLOG_ERROR		2
+#define _SLOG_WARNING	3
+#define _SLOG_NOTICE	4
+#define _SLOG_INFO		5
+#define _SLOG_DEBUG1	6
+#define _SLOG_DEBUG2	7
+
+extern int slogf(int opcode, int severity, const char *fmt, ...);
+
+#endif
@@ -0,0 +1,8 @@
+/* Host stand-in for the QNX <sys/slogcodes.h> */
+#ifndef __SLOGCODES_H_INCLUDED
+#define __SLOGCODES_H_INCLUDED
+
+#define _SLOG_SETCODE(major, minor)	(((major) << 8) | (minor))
+#define _SLOGC_GRAPHICS_DISPLAY		_SLOG_SETCODE(12, 1)
+
+#endif
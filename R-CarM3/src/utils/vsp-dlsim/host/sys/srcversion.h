@@ -0,0 +1 @@
+/* Host stand-in for the QNX <sys/srcversion.h>, nothing the VSP driver uses */
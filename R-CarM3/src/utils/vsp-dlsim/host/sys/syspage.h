@@ -0,0 +1,13 @@
+/* Host stand-in for the QNX <sys/syspage.h>, only the clock rate */
+#ifndef __SYSPAGE_H_INCLUDED
+#define __SYSPAGE_H_INCLUDED
+#include <stdint.h>
+
+struct qtime_entry {
+	uint64_t	cycles_per_sec;
+};
+
+extern struct qtime_entry _host_qtime;
+#define SYSPAGE_ENTRY(entry)	(&_host_##entry)
+
+#endif
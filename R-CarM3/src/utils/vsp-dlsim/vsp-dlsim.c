@@ -0,0 +1,835 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2016, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+/*
+ * Host simulator of the VSP display list generation. The VSP driver sources
+ * are built against a model of the VSP register file (host.c), the model
+ * executes the display lists the way the DL loader does and checks what the
+ * hardware would run. Sweeps the same setups as wfd-bench.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/neutrino.h>
+#include <sys/syspage.h>
+
+#include "vsp.h"
+#include "host.h"
+
+#define MAX_LAYERS		4
+#define MAX_SWEEP		8
+#define NUM_IMAGES		2
+
+/* index into VSP_LIST */
+#define SIM_VSPD_ID		0
+#define SIM_VSPI_ID		3
+
+/* fake physical addresses of the layer and scaler images, never dereferenced */
+#define SIM_IMAGE_BASE(n, k)	(0x60000000 + (n) * 0x02000000 + (k) * 0x01000000)
+#define SIM_SCALED_BASE(k)		(0x70000000 + (k) * 0x01000000)
+
+/* VSPI partitions the DL memory has room for */
+#define SIM_PART_MAX	DISPLAY_LIST_NUM
+
+enum {
+	SIM_DL_HEADER,
+	SIM_DL_HEADER_LESS,
+};
+
+typedef struct
+{
+	const char	*name;
+	int			fmt;		/* as WfdToVspFormat() gives it */
+	int			scaled;		/* what the VSPI scales it to */
+} sim_format_t;
+
+static const sim_format_t format_list[] = {
+	{ "rgba8888",	VSPCORE_RGBP888,						VSPCORE_RGBP888 },
+	{ "rgbx8888",	VSPCORE_RGBP888 | OPACITY_FULL,			VSPCORE_RGBP888 },
+	{ "rgb565",		VSPCORE_RGB565,							VSPCORE_RGBP888 },
+	{ "uyvy",		VSPCORE_YUV422Itype0 | ORDER_UYVY,		VSPCORE_YUV422Itype0 | ORDER_UYVY },
+	{ "yuy2",		VSPCORE_YUV422Itype0 | ORDER_YUY2,		VSPCORE_YUV422Itype0 | ORDER_YUY2 },
+	{ "nv12",		VSPCORE_YUV420SP,						VSPCORE_YUV420SP },
+};
+
+static const char *dl_name[] = { "header", "less" };
+
+typedef struct
+{
+	int		width;
+	int		height;
+	int		commits;
+	int		rate;				/* commits per vsync */
+	int		layers[MAX_SWEEP];
+	int		num_layers;
+	int		formats[MAX_SWEEP];	/* index into format_list */
+	int		num_formats;
+	int		scales[MAX_SWEEP];
+	int		num_scales;
+	int		dls[2];
+	int		num_dls;
+} sim_info;
+
+/* parameters a commit generated its list from */
+typedef struct
+{
+	unsigned	seq;
+	rpf_par_t	rpf[VSPD_INPUT_IMAGE_NUM];
+	wpf_par_t	wpf;
+} sim_snap_t;
+
+/* registers the WPF of the VSPI ran one partition with */
+typedef struct
+{
+	uint32_t	src_bsize;
+	uint32_t	src_addr_y;
+	uint32_t	src_addr_c0;
+	uint32_t	uds_hszclip;
+	uint32_t	uds_clip_size;
+	uint32_t	uds_hphase;
+	uint32_t	wpf_hszclip;
+	uint32_t	dst_addr_y;
+	uint32_t	dst_addr_c0;
+} sim_part_t;
+
+typedef struct
+{
+	vsp_dev_t	*vspd;
+	vsp_dev_t	*vspi;
+	unsigned	vsync;
+	int			stalled;		/* no vsyncs, the display is off */
+	/* list the VSPD ran during the current frame, as fetched */
+	int			fetched;
+	uint64_t	fetch_paddr;
+	uint32_t	fetch_bytes;
+	struct display_list fetch[DL_BODY_SIZE / 8];
+	/* header less: list the DL loader repeats */
+	uint64_t	run_paddr;
+	uint32_t	run_bytes;
+	sim_snap_t	snap[DL_BODY_ARENA_NUM];	/* per arena body */
+	/* partitions of the last VSPI run */
+	sim_part_t	part[SIM_PART_MAX];
+	int			part_num;
+	unsigned	errors;			/* found by the model in the current setup */
+	unsigned	total_errors;
+} sim_ctx;
+
+static sim_ctx *sim;
+
+static void sim_error(sim_ctx *ctx, const char *fmt, ...)
+{
+	va_list ap;
+
+	fprintf(stderr, "vsync %u: ", ctx->vsync);
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	fputc('\n', stderr);
+	ctx->errors++;
+}
+
+/* CPU address of a list the DL loader fetches, NULL if it is outside of the DL memory */
+static void *sim_dl(struct dl_memory *dlmemory, uint64_t paddr, uint32_t bytes)
+{
+	if ((paddr < dlmemory->paddr) || (paddr + bytes > dlmemory->paddr + dlmemory->size)) {
+		return NULL;
+	}
+	return (uint8_t *)dlmemory->vaddr + (paddr - dlmemory->paddr);
+}
+
+/* execute a list body into the register model */
+static int sim_play(sim_ctx *ctx, vsp_dev_t *dev, uint64_t paddr, uint32_t bytes)
+{
+	struct display_list *dlist;
+	uint32_t i;
+
+	dlist = sim_dl(dev->pvdata->dlmemory, paddr, bytes);
+	if (!dlist || (bytes & 7) || (bytes > DL_BODY_SIZE)) {
+		sim_error(ctx, "list of %u bytes at 0x%llx is not in the DL memory", bytes, (unsigned long long)paddr);
+		return -1;
+	}
+	for (i = 0; i < bytes / 8; i++) {
+		if ((dlist[i].set_address & 3) || (dlist[i].set_address >= VSP_REG_SIZE)) {
+			sim_error(ctx, "list at 0x%llx writes to bad register 0x%x", (unsigned long long)paddr, dlist[i].set_address);
+			return -1;
+		}
+		*(volatile uint32_t *)(dev->reg_base_ptr + dlist[i].set_address) = dlist[i].set_data;
+	}
+	return 0;
+}
+
+/* remember the list the VSP runs during this frame */
+static void sim_fetch(sim_ctx *ctx, uint64_t paddr, uint32_t bytes)
+{
+	struct display_list *dlist = sim_dl(ctx->vspd->pvdata->dlmemory, paddr, bytes);
+
+	if (dlist && (bytes <= sizeof(ctx->fetch))) {
+		memcpy(ctx->fetch, dlist, bytes);
+		ctx->fetch_paddr = paddr;
+		ctx->fetch_bytes = bytes;
+		ctx->fetched = 1;
+	}
+}
+
+#define SIM_CHECK_REG(reg, val, what, id) \
+	if ((reg) != (val)) { \
+		sim_error(ctx, "%s%d is 0x%08x, commit %u set 0x%08x", what, id, (reg), (val), seq); \
+	}
+
+/* the registers the VSP runs the frame with against the commit that made the list in body idx */
+static void sim_compare(sim_ctx *ctx, unsigned idx)
+{
+	vsp_dev_t *dev = ctx->vspd;
+	sim_snap_t *snap = &ctx->snap[idx];
+	unsigned seq = dev->pvdata->dlmemory->arena.seq[idx];
+	int i;
+
+	if (snap->seq != seq) {
+		sim_error(ctx, "arena body %u holds commit %u, the last one published in it was %u", idx, seq, snap->seq);
+		return;
+	}
+	SIM_CHECK_REG(dev->reg.wpf[0].src_rpf, snap->wpf.src_rpf, "routing of WPF", 0);
+	SIM_CHECK_REG(dev->reg.wpf[0].outfmt, 0x00800000 | snap->wpf.outfmt, "format of WPF", 0);
+	for (i = 0; i < VSPD_INPUT_IMAGE_NUM; i++) {
+		if (!snap->rpf[i].active) {
+			continue;
+		}
+		SIM_CHECK_REG(dev->reg.rpf[i].srcm_addr_y, snap->rpf[i].srcm_addr_y, "address of RPF", i);
+		SIM_CHECK_REG(dev->reg.rpf[i].srcm_addr_c0, snap->rpf[i].srcm_addr_c0, "chroma address of RPF", i);
+		SIM_CHECK_REG(dev->reg.rpf[i].src_esize, snap->rpf[i].src_esize, "size of RPF", i);
+		SIM_CHECK_REG(dev->reg.rpf[i].infmt, snap->rpf[i].infmt, "format of RPF", i);
+		SIM_CHECK_REG(dev->reg.rpf[i].loc, snap->rpf[i].loc, "position of RPF", i);
+	}
+}
+
+/*
+ * Header mode frame start: the VSP fetches the header it was started with,
+ * which the DU vsync ISR rewrote at the previous vsync, and runs its body.
+ */
+static void sim_frame_header(sim_ctx *ctx)
+{
+	vsp_dev_t *dev = ctx->vspd;
+	struct dl_memory *dlmemory = dev->pvdata->dlmemory;
+	struct dl_arena *arena = &dlmemory->arena;
+	struct display_header *dheader;
+	uint64_t plist = 0;
+	uint32_t i;
+
+	if (!dlmemory->start) {
+		host_deliver(VspLib_compose_update_sync(dev, ctx->vsync));
+		return;
+	}
+
+	dheader = sim_dl(dlmemory, dev->reg.dl->hdr_addr0, DL_HEADER_SIZE);
+	if (!dheader) {
+		sim_error(ctx, "header 0x%x is not in the DL memory", dev->reg.dl->hdr_addr0);
+		return;
+	}
+	if ((dheader->pnext_header != dev->reg.dl->hdr_addr0) || !(dheader->int_auto & 1)) {
+		sim_error(ctx, "header does not repeat itself");
+	}
+	for (i = 0; i <= (dheader->num_list_minus1 & 7); i++) {
+		if (sim_play(ctx, dev, dheader->display_list[i].plist, dheader->display_list[i].num_bytes)) {
+			return;
+		}
+	}
+	plist = dheader->display_list[0].plist;
+	sim_fetch(ctx, plist, dheader->display_list[0].num_bytes);
+
+	host_deliver(VspLib_compose_update_sync(dev, ctx->vsync));
+
+	/* the ISR has taken the fetched body as latched */
+	if ((arena->latched >= DL_BODY_ARENA_NUM) || (arena->body[arena->latched].paddr != plist)) {
+		sim_error(ctx, "the VSP runs 0x%llx, the arena has %u latched", (unsigned long long)plist, arena->latched);
+		return;
+	}
+	sim_compare(ctx, arena->latched);
+}
+
+/*
+ * Header less frame start: the DL loader takes the body an update was flagged
+ * for, or runs the previous one again, then the frame end and display start
+ * interrupts come in.
+ */
+static void sim_frame_header_less(sim_ctx *ctx)
+{
+	vsp_dev_t *dev = ctx->vspd;
+	struct dl_memory *dlmemory = dev->pvdata->dlmemory;
+	uint32_t size = dev->reg.dl->body_size0;
+	int i;
+
+	if (!dev->reg.vi6_ctrl->cmd[0]) {
+		return;
+	}
+	if (size & VI6_DL_BODY_SIZE_UPD0) {
+		ctx->run_paddr = dev->reg.dl->hdr_addr0;
+		ctx->run_bytes = size & (VI6_DL_BODY_SIZE_UPD0 - 1);
+		dev->reg.dl->body_size0 = size & ~VI6_DL_BODY_SIZE_UPD0;
+	}
+	if (sim_play(ctx, dev, ctx->run_paddr, ctx->run_bytes)) {
+		return;
+	}
+	sim_fetch(ctx, ctx->run_paddr, ctx->run_bytes);
+
+	dev->reg.vi6_ctrl->wpf_irq[0].irq_sta = VI6_WPFn_IRQ_DFE;
+	dev->reg.vi6_ctrl->dsp_irq.dsp_irq_sta = VI6_DISP_IRQ_STA_DST;
+	host_interrupt(dev->iid);
+
+	/* the body the loader repeats has to stay allocated */
+	for (i = 0; i < DISPLAY_LIST_NUM; i++) {
+		if (dlmemory->single_body[i].paddr == ctx->run_paddr) {
+			if (dlmemory->single_body[i].use == 0) {
+				sim_error(ctx, "the VSP runs the freed list 0x%llx", (unsigned long long)ctx->run_paddr);
+			}
+			break;
+		}
+	}
+}
+
+static void sim_vsync(sim_ctx *ctx)
+{
+	struct dl_memory *dlmemory = ctx->vspd->pvdata->dlmemory;
+	struct display_list *dlist;
+
+	ctx->vsync++;
+
+	/* nobody may write the list the VSP ran during the frame that just ended */
+	if (ctx->fetched) {
+		dlist = sim_dl(dlmemory, ctx->fetch_paddr, ctx->fetch_bytes);
+		if (!dlist || memcmp(dlist, ctx->fetch, ctx->fetch_bytes)) {
+			sim_error(ctx, "list 0x%llx was rewritten while the VSP ran it", (unsigned long long)ctx->fetch_paddr);
+		}
+		ctx->fetched = 0;
+	}
+
+	if (dlmemory->dl_mode == DL_MODE_AUTO_REPEAT) {
+		sim_frame_header(ctx);
+	} else {
+		sim_frame_header_less(ctx);
+	}
+}
+
+/*
+ * The VSPI runs its chain of headers from DL_HDR_ADDR0, one partition each,
+ * auto starting the next frame until a header asks for the interrupt.
+ */
+static void sim_vspi_run(sim_ctx *ctx)
+{
+	vsp_dev_t *dev = ctx->vspi;
+	struct dl_memory *dlmemory = dev->pvdata->dlmemory;
+	struct display_header *dheader;
+	uint32_t paddr = dev->reg.dl->hdr_addr0;
+	sim_part_t *part;
+	uint32_t i;
+
+	ctx->part_num = 0;
+	if (!dev->reg.vi6_ctrl->cmd[0]) {
+		sim_error(ctx, "VSPI waited for, but not started");
+		return;
+	}
+	dev->reg.vi6_ctrl->cmd[0] = 0;
+
+	while (1) {
+		if (ctx->part_num == SIM_PART_MAX) {
+			sim_error(ctx, "VSPI chain longer than %d partitions", SIM_PART_MAX);
+			return;
+		}
+		dheader = sim_dl(dlmemory, paddr, DL_HEADER_SIZE);
+		if (!dheader) {
+			sim_error(ctx, "VSPI header 0x%x is not in the DL memory", paddr);
+			return;
+		}
+		for (i = 0; i <= (dheader->num_list_minus1 & 7); i++) {
+			if (sim_play(ctx, dev, dheader->display_list[i].plist, dheader->display_list[i].num_bytes)) {
+				return;
+			}
+		}
+
+		part = &ctx->part[ctx->part_num++];
+		part->src_bsize = dev->reg.rpf[0].src_bsize;
+		part->src_addr_y = dev->reg.rpf[0].srcm_addr_y;
+		part->src_addr_c0 = dev->reg.rpf[0].srcm_addr_c0;
+		part->uds_hszclip = dev->reg.uds[0].hszclip;
+		part->uds_clip_size = dev->reg.uds[0].clip_size;
+		part->uds_hphase = dev->reg.uds[0].hphase;
+		part->wpf_hszclip = dev->reg.wpf[0].hszclip;
+		part->dst_addr_y = dev->reg.wpf[0].dstm_addr_y;
+		part->dst_addr_c0 = dev->reg.wpf[0].dstm_addr_c0;
+
+		if (!(dheader->int_auto & 1)) {
+			break;
+		}
+		paddr = dheader->pnext_header;
+	}
+	if (!(dheader->int_auto & 2)) {
+		sim_error(ctx, "VSPI chain ends without its interrupt");
+		return;
+	}
+
+	dev->reg.vi6_ctrl->wpf_irq[0].irq_sta = VI6_WPFn_IRQ_FRE | VI6_WPFn_IRQ_DFE;
+	host_interrupt(dev->iid);
+}
+
+/* the driver waits for a pulse: let the hardware it waits for run */
+static void sim_idle(int chid)
+{
+	sim_ctx *ctx = sim;
+
+	if (ctx->vspi && (chid == ctx->vspi->irqchan)) {
+		sim_vspi_run(ctx);
+	} else if (!ctx->stalled && (chid == ctx->vspd->pvdata->dlmemory->arena.chid)) {
+		sim_vsync(ctx);
+	}
+}
+
+/* the partitions have to tile the output and read inside the source */
+static void sim_vspi_check(sim_ctx *ctx, vsp_pipe_t *pipe)
+{
+	int dst_bpp = get_bpp(pipe->dst.fmt & 0x7f);
+	int src_bpp = get_bpp(pipe->src.fmt & 0x7f);
+	int src_stride = pipe->src.stride ? pipe->src.stride : pipe->src.width * src_bpp;
+	int parts = (pipe->dst.width + INPUT_WPF_HSIZE_MAX - 1) / INPUT_WPF_HSIZE_MAX;
+	uint32_t offset, width, x;
+	int k;
+
+	if (ctx->part_num != parts) {
+		sim_error(ctx, "VSPI ran %d partitions for %d pixels, expected %d", ctx->part_num, pipe->dst.width, parts);
+		return;
+	}
+	for (k = 0; k < parts; k++) {
+		sim_part_t *part = &ctx->part[k];
+
+		if (host_verbose) {
+			printf("  part %d: src 0x%08x %08x uds %08x %08x %08x wpf %08x dst 0x%08x\n", k, part->src_addr_y,
+				part->src_bsize, part->uds_hszclip, part->uds_clip_size, part->uds_hphase, part->wpf_hszclip, part->dst_addr_y);
+		}
+
+		offset = k * INPUT_WPF_HSIZE_MAX;
+		width = part->wpf_hszclip & 0xfff;
+		if (part->dst_addr_y != pipe->dst.addr.y_rgb + offset * dst_bpp) {
+			sim_error(ctx, "VSPI partition %d writes to 0x%08x, expected 0x%08x", k,
+				part->dst_addr_y, pipe->dst.addr.y_rgb + offset * dst_bpp);
+		}
+		if ((width < ((pipe->dst.width - offset < INPUT_WPF_HSIZE_MAX) ? pipe->dst.width - offset : INPUT_WPF_HSIZE_MAX)) ||
+		    (offset + width > (uint32_t)pipe->dst.width)) {
+			sim_error(ctx, "VSPI partition %d writes %u pixels at %u of %d", k, width, offset, pipe->dst.width);
+		}
+		x = ((part->src_addr_y - pipe->src.addr.y_rgb) % src_stride) / src_bpp;
+		if ((part->src_addr_y < pipe->src.addr.y_rgb) ||
+		    (x + (part->src_bsize >> 16) > (uint32_t)pipe->src.width)) {
+			sim_error(ctx, "VSPI partition %d reads %u pixels at %u of %d", k, part->src_bsize >> 16, x, pipe->src.width);
+		}
+	}
+}
+
+/*
+ * Scale the bottom layer like the scaler thread does. A plan replayed for new
+ * buffers has to run the same partitions as one built for them from scratch.
+ */
+static void sim_scale(sim_ctx *ctx, vsp_pipe_t *pipe)
+{
+	vsp_dev_t *dev = ctx->vspi;
+	sim_part_t part[SIM_PART_MAX];
+	int part_num;
+	unsigned hits = dev->plan.hits;
+
+	VspLib_scale_start(dev, pipe);
+	sim_vspi_check(ctx, pipe);
+	if (dev->plan.hits == hits) {
+		return;
+	}
+
+	memcpy(part, ctx->part, sizeof(part));
+	part_num = ctx->part_num;
+	dev->plan.valid = 0;
+	VspLib_scale_start(dev, pipe);
+	dev->plan.misses--;
+	if ((part_num != ctx->part_num) || memcmp(part, ctx->part, part_num * sizeof(part[0]))) {
+		sim_error(ctx, "replayed VSPI plan differs from the one rebuilt for the same buffers");
+	}
+}
+
+/* every body but the latched one has been handed back once the commits stop */
+static void sim_arena_check(sim_ctx *ctx)
+{
+	struct dl_arena *arena = &ctx->vspd->pvdata->dlmemory->arena;
+	int held = 0;
+	int i, n;
+
+	for (i = 0; i < DL_BODY_ARENA_NUM; i++) {
+		n = (int)(arena->handed[i] - arena->released[i]);
+		if ((n < 0) || (n > 1) || (n && (i != (int)arena->latched))) {
+			sim_error(ctx, "arena body %d handed %u times, released %u times", i, arena->handed[i], arena->released[i]);
+		}
+		held += n;
+	}
+	if (held != 1) {
+		sim_error(ctx, "%d arena bodies held after the commits stopped", held);
+	}
+}
+
+static vsp_dev_t *sim_open_vspd(sim_ctx *ctx, sim_info *info, int dl)
+{
+	vsp_info_t vsp_info;
+	vsp_dev_t *dev;
+
+	memset(&vsp_info, 0, sizeof(vsp_info));
+	vsp_info.Id = SIM_VSPD_ID;
+	vsp_info.mWidth = info->width;
+	vsp_info.mHeight = info->height;
+	vsp_info.mFormat = VSPCORE_RGBP888;
+
+	dev = VspLib_init(&vsp_info, NULL);
+	if (!dev) {
+		return NULL;
+	}
+	/* the driver always starts in header mode */
+	if (dl == SIM_DL_HEADER_LESS) {
+		vsp_dl_destroy(dev->pvdata);
+		if (vsp_dl_create(dev->pvdata, NULL, DL_MODE_HEADER_LESS_AUTO_REPEAT)) {
+			free(dev->pvdata);
+			dev->pvdata = NULL;
+			VspLib_fini(dev);
+			return NULL;
+		}
+		vsp_dl_reset(dev->pvdata);
+	}
+	if (vsp_dl_set_check(dev->pvdata, 1)) {
+		VspLib_fini(dev);
+		return NULL;
+	}
+	return dev;
+}
+
+/* remember the parameters of the list a commit published */
+static void sim_snapshot(sim_ctx *ctx, unsigned commits)
+{
+	vsp_dev_t *dev = ctx->vspd;
+	struct dl_arena *arena = &dev->pvdata->dlmemory->arena;
+	sim_snap_t *snap;
+	int i;
+
+	if (arena->commits == commits) {
+		return;
+	}
+	for (i = 0; i < DL_BODY_ARENA_NUM; i++) {
+		if (arena->seq[i] == arena->commits) {
+			snap = &ctx->snap[i];
+			snap->seq = arena->commits;
+			memcpy(snap->rpf, dev->param.rpf_par, sizeof(snap->rpf));
+			snap->wpf = dev->param.wpf_par[0];
+			return;
+		}
+	}
+	sim_error(ctx, "commit %u is in no arena body", arena->commits);
+}
+
+/* one composition commit of layer n, the way vsp_frame_update() sets it up */
+static void sim_commit(sim_ctx *ctx, sim_info *info, int n, int fmt, int scale, int k)
+{
+	vsp_dev_t *dev = ctx->vspd;
+	struct dl_arena *arena = &dev->pvdata->dlmemory->arena;
+	const sim_format_t *format = &format_list[fmt];
+	unsigned commits = arena->commits;
+	vsp_pipe_t pipe, scaled;
+	int dst_rect[4], src_rect[4];
+	uint32_t base = SIM_IMAGE_BASE(n, k % NUM_IMAGES);
+	int bpp, stride_c;
+
+	/* same tiles as wfd-bench, the bottom layer covers the port */
+	dst_rect[0] = n ? (n - 1) * info->width / 4 : 0;
+	dst_rect[1] = n ? info->height / 4 : 0;
+	dst_rect[2] = n ? (info->width / 4) & ~1 : info->width;
+	dst_rect[3] = n ? (info->height / 2) & ~1 : info->height;
+	src_rect[0] = 0;
+	src_rect[1] = 0;
+	src_rect[2] = (n || !ctx->vspi) ? dst_rect[2] : (dst_rect[2] * 100 / scale) & ~1;
+	src_rect[3] = (n || !ctx->vspi) ? dst_rect[3] : (dst_rect[3] * 100 / scale) & ~1;
+
+	memset(&pipe, 0, sizeof(pipe));
+	pipe.vsp_pipe_id = n;
+	pipe.src.fmt = format->fmt;
+	pipe.src.width = src_rect[2];
+	pipe.src.height = src_rect[3];
+	bpp = get_bpp(format->fmt & 0x7f);
+	stride_c = ((format->fmt & 0x7f) == VSPCORE_YUV420SP) ? src_rect[2] : 0;
+	pipe.src.addr.y_rgb = base;
+	pipe.src.addr.c0 = stride_c ? base + src_rect[2] * bpp * src_rect[3] : base;
+	pipe.src.addr.c1 = base;
+	memcpy(pipe.src_rect, src_rect, sizeof(src_rect));
+
+	if (!n && ctx->vspi) {
+		memset(&scaled, 0, sizeof(scaled));
+		scaled.src = pipe.src;
+		memcpy(scaled.src_rect, src_rect, sizeof(src_rect));
+		scaled.dst.width = dst_rect[2];
+		scaled.dst.height = dst_rect[3];
+		scaled.dst.fmt = format->scaled;
+		scaled.dst.addr.y_rgb = SIM_SCALED_BASE(k % NUM_IMAGES);
+		if ((format->scaled & 0x7f) == VSPCORE_YUV420SP) {
+			scaled.dst.addr.c0 = scaled.dst.addr.y_rgb + dst_rect[2] * dst_rect[3];
+		}
+		sim_scale(ctx, &scaled);
+
+		pipe.src.fmt = format->scaled;
+		pipe.src.width = dst_rect[2];
+		pipe.src.height = dst_rect[3];
+		pipe.src.addr = scaled.dst.addr;
+		pipe.src_rect[2] = dst_rect[2];
+		pipe.src_rect[3] = dst_rect[3];
+	}
+
+	pipe.dst.fmt = VSPCORE_RGBP888;	/* BRU blends in RGB */
+	pipe.dst.width = dst_rect[2];
+	pipe.dst.height = dst_rect[3];
+	pipe.dst.hcoord = dst_rect[0];
+	pipe.dst.vcoord = dst_rect[1];
+
+	VspLib_frame_update(dev, &pipe);
+	sim_snapshot(ctx, commits);
+}
+
+static void sim_run(sim_ctx *ctx, sim_info *info, int num, int fmt, int scale, int dl)
+{
+	uint64_t cps = SYSPAGE_ENTRY(qtime)->cycles_per_sec;
+	uint64_t start, cycles, total = 0, max = 0;
+	int value[WFD_DL_STATS_COUNT_RCAR];
+	struct dl_arena *arena;
+	int commits = 0;
+	int i, k;
+
+	memset(ctx->snap, 0, sizeof(ctx->snap));
+	ctx->errors = 0;
+	ctx->fetched = 0;
+	ctx->run_bytes = 0;
+	ctx->stalled = 0;
+	ctx->vspi = NULL;
+	ctx->vspd = sim_open_vspd(ctx, info, dl);
+	if (!ctx->vspd) {
+		fprintf(stderr, "cannot set up the VSPD\n");
+		ctx->total_errors++;
+		return;
+	}
+	if (scale != 100) {
+		vsp_info_t vsp_info;
+
+		memset(&vsp_info, 0, sizeof(vsp_info));
+		vsp_info.Id = SIM_VSPI_ID;
+		ctx->vspi = VspLib_init(&vsp_info, NULL);
+		if (!ctx->vspi) {
+			fprintf(stderr, "cannot set up the VSPI\n");
+			ctx->total_errors++;
+			VspLib_fini(ctx->vspd);
+			return;
+		}
+	}
+	arena = &ctx->vspd->pvdata->dlmemory->arena;
+
+	for (i = 0; i < num; i++) {
+		VspLib_activate_pipe(ctx->vspd, i);
+	}
+	for (k = 0; k < info->commits; k++) {
+		/* the display goes off for the third quarter of the setup and comes back */
+		ctx->stalled = (k >= info->commits / 2) && (k < info->commits * 3 / 4);
+		if (ctx->stalled) {
+			ctx->fetched = 0;
+		}
+		for (i = 0; i < num; i++) {
+			start = ClockCycles();
+			sim_commit(ctx, info, i, fmt, scale, k);
+			cycles = ClockCycles() - start;
+			total += cycles;
+			if (cycles > max) {
+				max = cycles;
+			}
+			if ((++commits % info->rate == 0) && !ctx->stalled) {
+				sim_vsync(ctx);
+			}
+		}
+	}
+	ctx->stalled = 0;
+	for (i = 0; i < num; i++) {
+		unsigned seq = arena->commits;
+
+		VspLib_deactivate_pipe(ctx->vspd, i);
+		sim_snapshot(ctx, seq);
+		sim_vsync(ctx);
+	}
+	/* one vsync to latch the last list, one to release the one before */
+	sim_vsync(ctx);
+	sim_vsync(ctx);
+	if (dl == SIM_DL_HEADER) {
+		sim_arena_check(ctx);
+	}
+
+	vsp_dl_get_stats(ctx->vspd->pvdata, value);
+	printf("%6d %-9s %4d%% %-6s  %6u %6u  %6d  %5d %5d  %d/%d  %5u %5u  %u\n", num, format_list[fmt].name, scale,
+		dl_name[dl], (unsigned)(total * 1000000 / cps / commits), (unsigned)(max * 1000000 / cps),
+		value[WFD_DL_STATS_BYTES_AVG_RCAR], value[WFD_DL_STATS_GEN_AVG_RCAR], value[WFD_DL_STATS_GEN_MAX_RCAR],
+		value[WFD_DL_STATS_CHECKED_RCAR], value[WFD_DL_STATS_ERRORS_RCAR],
+		arena->waits, arena->dropped, ctx->errors);
+	ctx->total_errors += ctx->errors + value[WFD_DL_STATS_ERRORS_RCAR];
+
+	if (ctx->vspi) {
+		VspLib_fini(ctx->vspi);
+		ctx->vspi = NULL;
+	}
+	VspLib_fini(ctx->vspd);
+	ctx->vspd = NULL;
+}
+
+static int parse_list(char *str, int *out, int max)
+{
+	int n = 0;
+	char *tok;
+
+	for (tok = strtok(str, ","); tok && n < max; tok = strtok(NULL, ",")) {
+		out[n++] = strtol(tok, NULL, 0);
+	}
+	return n;
+}
+
+static int parse_names(char *str, int *out, int max, const char *const *names, int num, size_t size)
+{
+	int n = 0;
+	int i;
+	char *tok;
+
+	for (tok = strtok(str, ","); tok && n < max; tok = strtok(NULL, ",")) {
+		for (i = 0; i < num; i++) {
+			if (!strcmp(tok, *(const char *const *)((const char *)names + i * size))) {
+				out[n++] = i;
+				break;
+			}
+		}
+		if (i == num) {
+			fprintf(stderr, "unknown name %s\n", tok);
+			return -1;
+		}
+	}
+	return n;
+}
+
+static int parse_commandline(sim_info *info, int argc, char *argv[])
+{
+	char *value;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		value = strchr(argv[i], '=');
+		if (value) {
+			*value++ = 0;
+		}
+		if (!strcmp(argv[i], "-v")) {
+			host_verbose = 1;
+		} else if (value && !strcmp(argv[i], "size")) {
+			if (sscanf(value, "%dx%d", &info->width, &info->height) != 2) {
+				fprintf(stderr, "size is WIDTHxHEIGHT\n");
+				return -1;
+			}
+		} else if (value && !strcmp(argv[i], "commits")) {
+			info->commits = strtol(value, NULL, 0);
+		} else if (value && !strcmp(argv[i], "rate")) {
+			info->rate = strtol(value, NULL, 0);
+		} else if (value && !strcmp(argv[i], "layers")) {
+			info->num_layers = parse_list(value, info->layers, MAX_SWEEP);
+		} else if (value && !strcmp(argv[i], "formats")) {
+			info->num_formats = parse_names(value, info->formats, MAX_SWEEP, &format_list[0].name,
+				sizeof(format_list) / sizeof(format_list[0]), sizeof(format_list[0]));
+			if (info->num_formats < 0) {
+				return -1;
+			}
+		} else if (value && !strcmp(argv[i], "scales")) {
+			info->num_scales = parse_list(value, info->scales, MAX_SWEEP);
+		} else if (value && !strcmp(argv[i], "dl")) {
+			info->num_dls = parse_names(value, info->dls, 2, dl_name, 2, sizeof(dl_name[0]));
+			if (info->num_dls < 0) {
+				return -1;
+			}
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if ((info->commits < 4) || (info->rate <= 0)) {
+		fprintf(stderr, "commits must be 4 or more, rate positive\n");
+		return -1;
+	}
+	if ((info->width <= 0) || (info->width > SIM_PART_MAX * INPUT_WPF_HSIZE_MAX) || (info->height <= 0)) {
+		fprintf(stderr, "size must be up to %d pixels wide\n", SIM_PART_MAX * INPUT_WPF_HSIZE_MAX);
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	sim_info info = {
+		.width = 1920,
+		.height = 1080,
+		.commits = 120,
+		.rate = 1,
+		.layers = { 1, 2, 3, 4 },
+		.num_layers = 4,
+		.formats = { 0, 2, 3, 5 },
+		.num_formats = 4,
+		.scales = { 100, 50, 200 },
+		.num_scales = 3,
+		.dls = { SIM_DL_HEADER, SIM_DL_HEADER_LESS },
+		.num_dls = 2,
+	};
+	sim_ctx ctx;
+	int l, f, s, d;
+
+	memset(&ctx, 0, sizeof(ctx));
+	if (parse_commandline(&info, argc, argv)) {
+		return EXIT_FAILURE;
+	}
+	sim = &ctx;
+	host_idle = sim_idle;
+
+	printf("%dx%d, %d commits per vsync\n", info.width, info.height, info.rate);
+	printf("layers fmt       scale dl      commit us (avg max)  DL bytes  DL us (avg max)  checked/bad  waits drops  model errors\n");
+	for (d = 0; d < info.num_dls; d++) {
+		for (l = 0; l < info.num_layers; l++) {
+			if ((info.layers[l] < 1) || (info.layers[l] > MAX_LAYERS)) {
+				continue;
+			}
+			for (f = 0; f < info.num_formats; f++) {
+				for (s = 0; s < info.num_scales; s++) {
+					if (info.scales[s] <= 0) {
+						continue;
+					}
+					sim_run(&ctx, &info, info.layers[l], info.formats[f], info.scales[s], info.dls[d]);
+				}
+			}
+		}
+	}
+
+	if (ctx.total_errors) {
+		printf("%u errors\n", ctx.total_errors);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
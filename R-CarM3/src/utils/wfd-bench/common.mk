@@ -0,0 +1,28 @@
+ifndef QCONFIG
+QCONFIG=qconfig.mk
+endif
+include $(QCONFIG)
+
+include $(MKFILES_ROOT)/qmacros.mk
+
+define PINFO
+PINFO DESCRIPTION=WFD display list benchmark for R-CarM3
+endef
+
+#####AUTO-GENERATED by packaging script... do not checkin#####
+   INSTALL_ROOT_nto = $(PROJECT_ROOT)/../../../install
+   USE_INSTALL_ROOT=1
+##############################################################
+
+NAME := wfd-bench
+USEFILE = $(PROJECT_ROOT)/Usemsg
+INSTALLDIR = usr/bin
+
+# The driver links against the wfdcfg stub, a cfglib with the same SONAME
+# has to be found at runtime (see hardware/wfd/rcar/common.mk).
+LIBS = WFDrcar
+
+include $(MKFILES_ROOT)/qtargets.mk
+
+EXTRA_INCVPATH += $(PRODUCT_ROOT)/../hardware/wfd/common
+EXTRA_LIBVPATH += $(INSTALL_ROOT_nto)/$(CPUVARDIR)/usr/lib/graphics/R_CarM3
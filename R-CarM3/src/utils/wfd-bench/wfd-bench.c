@@ -0,0 +1,387 @@
+/*
+ * $QNXLicenseC:
+ * Copyright 2016, QNX Software Systems.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"). You
+ * may not reproduce, modify or distribute this software except in
+ * compliance with the License. You may obtain a copy of the License
+ * at: http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OF ANY KIND, either express or implied.
+ *
+ * This file may contain contributions from others, either as
+ * contributors under the License or as licensors under other terms.
+ * Please review this entire file for other proprietary rights or license
+ * notices, as well as the QNX Development Suite License Guide at
+ * http://licensing.qnx.com/license-guide/ for other information.
+ * $
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/neutrino.h>
+#include <sys/syspage.h>
+
+#define WFD_WFDEXT_PROTOTYPES
+#include <WF/wfd.h>
+#include <WF/wfdext.h>
+
+#define MAX_LAYERS		4
+#define MAX_SWEEP		8
+#define NUM_IMAGES		2
+
+typedef struct
+{
+	const char	*name;
+	int			format;
+} bench_format_t;
+
+static const bench_format_t format_list[] = {
+	{ "rgba8888",	WFD_FORMAT_RGBA8888_QNX },
+	{ "rgbx8888",	WFD_FORMAT_RGBX8888_QNX },
+	{ "rgb565",		WFD_FORMAT_RGB565_QNX },
+	{ "uyvy",		WFD_FORMAT_UYVY_QNX },
+	{ "yuy2",		WFD_FORMAT_YUY2_QNX },
+	{ "nv12",		WFD_FORMAT_NV12_QNX },
+};
+
+typedef struct
+{
+	int		port_index;
+	int		commits;
+	int		layers[MAX_SWEEP];
+	int		num_layers;
+	int		formats[MAX_SWEEP];		/* index into format_list */
+	int		num_formats;
+	int		scales[MAX_SWEEP];
+	int		num_scales;
+	int		check;
+	int		view;
+} bench_info;
+
+typedef struct
+{
+	WFDDevice	dev;
+	WFDPort		port;
+	int			width;
+	int			height;
+	WFDint		pipe_ids[MAX_LAYERS];
+	int			num_pipes;
+} bench_ctx;
+
+typedef struct
+{
+	WFDPipeline	pipe;
+	WFDEGLImage	images[NUM_IMAGES];
+	WFDSource	sources[NUM_IMAGES];
+} bench_layer;
+
+static int parse_list(char *str, int *out, int max)
+{
+	int n = 0;
+	char *tok;
+
+	for (tok = strtok(str, ","); tok && n < max; tok = strtok(NULL, ",")) {
+		out[n++] = strtol(tok, NULL, 0);
+	}
+	return n;
+}
+
+static int parse_formats(char *str, int *out, int max)
+{
+	int n = 0;
+	unsigned i;
+	char *tok;
+
+	for (tok = strtok(str, ","); tok && n < max; tok = strtok(NULL, ",")) {
+		for (i = 0; i < sizeof(format_list) / sizeof(format_list[0]); i++) {
+			if (!strcmp(tok, format_list[i].name)) {
+				out[n++] = i;
+				break;
+			}
+		}
+		if (i == sizeof(format_list) / sizeof(format_list[0])) {
+			fprintf(stderr, "unknown format %s\n", tok);
+			return -1;
+		}
+	}
+	return n;
+}
+
+static int parse_commandline(bench_info *info, int argc, char *argv[])
+{
+	char *value;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		value = strchr(argv[i], '=');
+		if (value) {
+			*value++ = 0;
+		}
+		if (!strcmp(argv[i], "-c")) {
+			info->check = 1;
+		} else if (!strcmp(argv[i], "-v")) {
+			info->view = 1;
+		} else if (value && !strcmp(argv[i], "port")) {
+			info->port_index = strtol(value, NULL, 0);
+		} else if (value && !strcmp(argv[i], "commits")) {
+			info->commits = strtol(value, NULL, 0);
+		} else if (value && !strcmp(argv[i], "layers")) {
+			info->num_layers = parse_list(value, info->layers, MAX_SWEEP);
+		} else if (value && !strcmp(argv[i], "formats")) {
+			info->num_formats = parse_formats(value, info->formats, MAX_SWEEP);
+			if (info->num_formats < 0) {
+				return -1;
+			}
+		} else if (value && !strcmp(argv[i], "scales")) {
+			info->num_scales = parse_list(value, info->scales, MAX_SWEEP);
+		} else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return -1;
+		}
+	}
+
+	if (info->commits <= 0) {
+		fprintf(stderr, "commits must be positive\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int bench_open(bench_ctx *ctx, bench_info *info)
+{
+	WFDint port_ids[8];
+	WFDPortMode mode;
+	int num;
+
+	ctx->dev = wfdCreateDevice(WFD_DEFAULT_DEVICE_ID, NULL);
+	if (ctx->dev == WFD_INVALID_HANDLE) {
+		fprintf(stderr, "wfdCreateDevice failed\n");
+		return -1;
+	}
+
+	num = wfdEnumeratePorts(ctx->dev, port_ids, 8, NULL);
+	if (info->port_index >= num) {
+		fprintf(stderr, "port %d not found, %d ports\n", info->port_index, num);
+		return -1;
+	}
+	ctx->port = wfdCreatePort(ctx->dev, port_ids[info->port_index], NULL);
+	if (ctx->port == WFD_INVALID_HANDLE) {
+		fprintf(stderr, "wfdCreatePort failed: 0x%x\n", wfdGetError(ctx->dev));
+		return -1;
+	}
+
+	/* keep the mode the port comes up with */
+	mode = wfdGetCurrentPortMode(ctx->dev, ctx->port);
+	if (mode == WFD_INVALID_HANDLE) {
+		if (wfdGetPortModes(ctx->dev, ctx->port, &mode, 1) < 1) {
+			fprintf(stderr, "no port mode\n");
+			return -1;
+		}
+		wfdSetPortMode(ctx->dev, ctx->port, mode);
+	}
+	ctx->width = wfdGetPortModeAttribi(ctx->dev, ctx->port, mode, WFD_PORT_MODE_WIDTH);
+	ctx->height = wfdGetPortModeAttribi(ctx->dev, ctx->port, mode, WFD_PORT_MODE_HEIGHT);
+
+	ctx->num_pipes = wfdGetPortAttribi(ctx->dev, ctx->port, WFD_PORT_PIPELINE_ID_COUNT);
+	if (ctx->num_pipes > MAX_LAYERS) {
+		ctx->num_pipes = MAX_LAYERS;
+	}
+	wfdGetPortAttribiv(ctx->dev, ctx->port, WFD_PORT_BINDABLE_PIPELINE_IDS, ctx->num_pipes, ctx->pipe_ids);
+
+	wfdSetPortAttribi(ctx->dev, ctx->port, WFD_PORT_DL_CHECK_RCAR, info->check);
+	wfdDeviceCommit(ctx->dev, WFD_COMMIT_ENTIRE_PORT, ctx->port);
+
+	printf("port %d: %dx%d, %d pipelines\n", info->port_index, ctx->width, ctx->height, ctx->num_pipes);
+	return 0;
+}
+
+static void bench_close(bench_ctx *ctx)
+{
+	if (ctx->port != WFD_INVALID_HANDLE) {
+		wfdSetPortAttribi(ctx->dev, ctx->port, WFD_PORT_DL_CHECK_RCAR, 0);
+		wfdDestroyPort(ctx->dev, ctx->port);
+	}
+	if (ctx->dev != WFD_INVALID_HANDLE) {
+		wfdDestroyDevice(ctx->dev);
+	}
+}
+
+static void layer_destroy(bench_ctx *ctx, bench_layer *layer)
+{
+	int i;
+
+	if (layer->pipe != WFD_INVALID_HANDLE) {
+		wfdBindSourceToPipeline(ctx->dev, layer->pipe, WFD_INVALID_HANDLE, WFD_TRANSITION_IMMEDIATE, NULL);
+		wfdDestroyPipeline(ctx->dev, layer->pipe);
+	}
+	for (i = 0; i < NUM_IMAGES; i++) {
+		if (layer->sources[i] != WFD_INVALID_HANDLE) {
+			wfdDestroySource(ctx->dev, layer->sources[i]);
+		}
+	}
+	if (layer->images[0] != NULL) {
+		wfdDestroyWFDEGLImagesQNX(ctx->dev, NUM_IMAGES, layer->images);
+	}
+	memset(layer, 0, sizeof(*layer));
+}
+
+/*
+ * Layer n covers a tile of the port, the bottom layer the whole port. The
+ * bottom layer is scaled from a source of 100/scale times its size.
+ */
+static int layer_create(bench_ctx *ctx, bench_layer *layer, int n, int format, int scale)
+{
+	WFDint src_rect[4], dst_rect[4];
+	int i;
+
+	memset(layer, 0, sizeof(*layer));
+
+	dst_rect[0] = n ? (n - 1) * ctx->width / 4 : 0;
+	dst_rect[1] = n ? ctx->height / 4 : 0;
+	dst_rect[2] = n ? (ctx->width / 4) & ~1 : ctx->width;
+	dst_rect[3] = n ? (ctx->height / 2) & ~1 : ctx->height;
+	src_rect[0] = 0;
+	src_rect[1] = 0;
+	src_rect[2] = n ? dst_rect[2] : (dst_rect[2] * 100 / scale) & ~1;
+	src_rect[3] = n ? dst_rect[3] : (dst_rect[3] * 100 / scale) & ~1;
+
+	if (wfdCreateWFDEGLImagesQNX(ctx->dev, src_rect[2], src_rect[3], format,
+			WFD_USAGE_DISPLAY_QNX | WFD_USAGE_WRITE_QNX, NUM_IMAGES, layer->images) != WFD_ERROR_NONE) {
+		fprintf(stderr, "cannot create %dx%d images\n", src_rect[2], src_rect[3]);
+		return -1;
+	}
+
+	layer->pipe = wfdCreatePipeline(ctx->dev, ctx->pipe_ids[n], NULL);
+	if (layer->pipe == WFD_INVALID_HANDLE) {
+		fprintf(stderr, "wfdCreatePipeline(%d) failed: 0x%x\n", ctx->pipe_ids[n], wfdGetError(ctx->dev));
+		return -1;
+	}
+	for (i = 0; i < NUM_IMAGES; i++) {
+		layer->sources[i] = wfdCreateSourceFromImage(ctx->dev, layer->pipe, layer->images[i], NULL);
+		if (layer->sources[i] == WFD_INVALID_HANDLE) {
+			fprintf(stderr, "wfdCreateSourceFromImage failed: 0x%x\n", wfdGetError(ctx->dev));
+			return -1;
+		}
+	}
+
+	wfdSetPipelineAttribiv(ctx->dev, layer->pipe, WFD_PIPELINE_SOURCE_RECTANGLE, 4, src_rect);
+	wfdSetPipelineAttribiv(ctx->dev, layer->pipe, WFD_PIPELINE_DESTINATION_RECTANGLE, 4, dst_rect);
+	wfdBindPipelineToPort(ctx->dev, ctx->port, layer->pipe);
+	wfdBindSourceToPipeline(ctx->dev, layer->pipe, layer->sources[0], WFD_TRANSITION_AT_VSYNC, NULL);
+
+	return 0;
+}
+
+static void bench_run(bench_ctx *ctx, bench_info *info, int num, int fmt, int scale)
+{
+	uint64_t cps = SYSPAGE_ENTRY(qtime)->cycles_per_sec;
+	bench_layer layer[MAX_LAYERS];
+	WFDint dl[WFD_DL_STATS_COUNT_RCAR];
+	WFDint timing[WFD_FRAME_TIMING_COUNT_RCAR];
+	WFDint pool[WFD_SCALE_POOL_STATS_COUNT_RCAR];
+	uint64_t start, cycles, total = 0, max = 0;
+	int i, k;
+
+	memset(layer, 0, sizeof(layer));
+	for (i = 0; i < num; i++) {
+		if (layer_create(ctx, &layer[i], i, format_list[fmt].format, i ? 100 : scale)) {
+			goto done;
+		}
+	}
+	wfdSetPortAttribi(ctx->dev, ctx->port, WFD_PORT_SCALE_POOL_STATS_RCAR, 0);
+	/* first commit allocates the scaling buffers, keep it out of the numbers */
+	wfdDeviceCommit(ctx->dev, WFD_COMMIT_ENTIRE_PORT, ctx->port);
+	wfdSetPortAttribi(ctx->dev, ctx->port, WFD_PORT_DL_STATS_RCAR, 0);
+	wfdSetPipelineAttribi(ctx->dev, layer[0].pipe, WFD_PIPELINE_FRAME_TIMING_RCAR, 0);
+
+	for (k = 0; k < info->commits; k++) {
+		for (i = 0; i < num; i++) {
+			wfdBindSourceToPipeline(ctx->dev, layer[i].pipe, layer[i].sources[(k + 1) % NUM_IMAGES],
+				WFD_TRANSITION_AT_VSYNC, NULL);
+		}
+		start = ClockCycles();
+		wfdDeviceCommit(ctx->dev, WFD_COMMIT_ENTIRE_PORT, ctx->port);
+		cycles = ClockCycles() - start;
+		total += cycles;
+		if (cycles > max) {
+			max = cycles;
+		}
+	}
+
+	wfdGetPortAttribiv(ctx->dev, ctx->port, WFD_PORT_DL_STATS_RCAR, WFD_DL_STATS_COUNT_RCAR, dl);
+	printf("%6d %-9s %4d%%  %6u %6u  %6d  %5d %5d  %d/%d\n", num, format_list[fmt].name, scale,
+		(unsigned)(total * 1000000 / cps / info->commits), (unsigned)(max * 1000000 / cps),
+		dl[WFD_DL_STATS_BYTES_AVG_RCAR], dl[WFD_DL_STATS_GEN_AVG_RCAR], dl[WFD_DL_STATS_GEN_MAX_RCAR],
+		dl[WFD_DL_STATS_CHECKED_RCAR], dl[WFD_DL_STATS_ERRORS_RCAR]);
+
+	if (info->view) {
+		wfdGetPipelineAttribiv(ctx->dev, layer[0].pipe, WFD_PIPELINE_FRAME_TIMING_RCAR,
+			WFD_FRAME_TIMING_COUNT_RCAR, timing);
+		printf("       ready %d/%d/%d us, latch %d/%d/%d us (p50/p99/max), %d vblanks missed\n",
+			timing[WFD_FRAME_TIMING_READY_P50_RCAR], timing[WFD_FRAME_TIMING_READY_P99_RCAR],
+			timing[WFD_FRAME_TIMING_READY_MAX_RCAR], timing[WFD_FRAME_TIMING_LATCH_P50_RCAR],
+			timing[WFD_FRAME_TIMING_LATCH_P99_RCAR], timing[WFD_FRAME_TIMING_LATCH_MAX_RCAR],
+			timing[WFD_FRAME_TIMING_MISSED_RCAR]);
+		wfdGetPortAttribiv(ctx->dev, ctx->port, WFD_PORT_SCALE_POOL_STATS_RCAR,
+			WFD_SCALE_POOL_STATS_COUNT_RCAR, pool);
+		printf("       scale pool %d allocated, %d avoided, %d evicted, %d failed, %d buffers %d bytes\n",
+			pool[WFD_SCALE_POOL_ALLOCS_RCAR], pool[WFD_SCALE_POOL_REUSES_RCAR],
+			pool[WFD_SCALE_POOL_EVICTIONS_RCAR], pool[WFD_SCALE_POOL_FAILURES_RCAR],
+			pool[WFD_SCALE_POOL_BUFFERS_RCAR], pool[WFD_SCALE_POOL_BYTES_RCAR]);
+	}
+
+done:
+	for (i = 0; i < num; i++) {
+		layer_destroy(ctx, &layer[i]);
+	}
+	wfdDeviceCommit(ctx->dev, WFD_COMMIT_ENTIRE_PORT, ctx->port);
+}
+
+int main(int argc, char *argv[])
+{
+	bench_info info = {
+		.port_index = 0,
+		.commits = 120,
+		.layers = { 1, 2, 3, 4 },
+		.num_layers = 4,
+		.formats = { 0, 2, 3, 5 },
+		.num_formats = 4,
+		.scales = { 100, 50, 200 },
+		.num_scales = 3,
+	};
+	bench_ctx ctx;
+	int l, f, s;
+
+	memset(&ctx, 0, sizeof(ctx));
+	if (parse_commandline(&info, argc, argv)) {
+		return EXIT_FAILURE;
+	}
+	if (bench_open(&ctx, &info)) {
+		bench_close(&ctx);
+		return EXIT_FAILURE;
+	}
+
+	printf("layers fmt       scale  commit us (avg max)  DL bytes  DL us (avg max)  checked/bad\n");
+	for (l = 0; l < info.num_layers; l++) {
+		if ((info.layers[l] < 1) || (info.layers[l] > ctx.num_pipes)) {
+			continue;
+		}
+		for (f = 0; f < info.num_formats; f++) {
+			for (s = 0; s < info.num_scales; s++) {
+				if (info.scales[s] <= 0) {
+					continue;
+				}
+				bench_run(&ctx, &info, info.layers[l], info.formats[f], info.scales[s]);
+			}
+		}
+	}
+
+	bench_close(&ctx);
+	return EXIT_SUCCESS;
+}